@@ -5,6 +5,14 @@
 
 #define BROADCASTER_PORT_NUMBER             20000
 
+// If built with BROADCASTER_SHM, revised sessions are handed from
+// the Broadcaster to the Satellite in buffers of an MMPS bank mapped
+// to shared memory, instead of being sent over the loopback connection.
+//
+#define BROADCASTER_SHM_NAME                "/vp_broadcaster"
+#define BROADCASTER_SHM_NUMBER_OF_BUFFERS   1000
+#define BROADCASTER_SHM_CHANNEL_SESSIONS    0
+
 typedef struct session {
     uint64              receiptId;
     uint64              sessionId;
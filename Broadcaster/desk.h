@@ -5,6 +5,10 @@
 
 #include "broadcaster_api.h"
 
+#ifdef BROADCASTER_SHM
+#include "mmps.h"
+#endif
+
 #define MAX_REVISED_SESSIONS_PER_STEP       100
 
 #define SLEEP_WHEN_LISTENER_IS_BUSY                2                // Seconds
@@ -14,6 +18,8 @@
 #define TIMEOUT_DISCONNECT_IF_IDLE               300                // Seconds
 #define TIMEOUT_ON_WAIT_FOR_BEGIN_TO_TRANSMIT     10 * 1000 * 1000	// Milliseconds
 #define TIMEOUT_ON_POLL_FOR_RECEIPT                5 * 1000 * 1000	// Milliseconds
+#define SLEEP_ON_CANNOT_MAP_SHM                    1 * 1000 * 1000  // Microseconds
+#define TIMEOUT_ON_WAIT_FOR_SHM_BUFFER                        1000  // Milliseconds
 
 typedef struct desk {
     struct {
@@ -22,6 +28,9 @@ typedef struct desk {
         pthread_attr_t      attributes;
         pthread_mutex_t     readyToGoMutex;
         pthread_cond_t      readyToGoCond;
+#ifdef BROADCASTER_SHM
+        struct MMPS_Pool    *pool;
+#endif
     } listener;
 
     struct {
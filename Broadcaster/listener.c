@@ -21,12 +21,76 @@ conversation(struct desk *desk, int sockFD);
 static int
 broadcasterDialog(struct desk *desk, int sockFD);
 
+#ifdef BROADCASTER_SHM
+
+static int
+handOverSession(struct desk *desk, struct session *session);
+
+#else
+
 static int
 sendReceipt(int sockFD, struct session *session);
 
 static int
 receiveReceipt(int sockFD, struct session *session, uint64 *receiptId);
 
+#endif
+
+#ifdef BROADCASTER_SHM
+
+/*
+ * Instead of waiting for the Satellite to connect, map the bank shared
+ * with the Satellite and hand revised sessions over in its buffers.
+ */
+void *
+listenerThread(void *arg)
+{
+	struct desk         *desk;
+	struct MMPS_Pool    *pool;
+	int                 rc;
+
+    desk = (struct desk *)arg;
+
+    pool = MMPS_InitPool(1);
+    if (pool == NULL) {
+        ReportError("Cannot create broadcaster pool");
+        pthread_exit(NULL);
+    }
+
+    rc = MMPS_InitBank(pool, 0,
+        sizeof(struct session),
+        0,
+        BROADCASTER_SHM_NUMBER_OF_BUFFERS);
+    if (rc != 0) {
+        ReportError("Cannot create broadcaster bank: rc=%d", rc);
+        pthread_exit(NULL);
+    }
+
+    while (1)
+    {
+        rc = MMPS_MapShMemBufferBank(pool, 0, BROADCASTER_SHM_NAME);
+        if (rc == 0)
+            break;
+
+        ReportError("Cannot map broadcaster bank, wait for %d microseconds: rc=%d",
+            SLEEP_ON_CANNOT_MAP_SHM, rc);
+        usleep(SLEEP_ON_CANNOT_MAP_SHM);
+    }
+
+    desk->listener.pool = pool;
+
+    while (1)
+    {
+        rc = conversation(desk, -1);
+        if (rc != 0)
+            ReportInfo("Broadcaster conversation has broken");
+    }
+
+	pthread_exit(NULL);
+}
+
+#else
+
 void *
 listenerThread(void *arg)
 {
@@ -95,6 +159,8 @@ listenerThread(void *arg)
 	pthread_exit(NULL);
 }
 
+#endif
+
 void
 listenerKnockKnock(struct desk *desk)
 {
@@ -202,7 +268,9 @@ broadcasterDialog(struct desk *desk, int sockFD)
 {
 	int                 sessionNumber;
 	struct session      *session;
+#ifndef BROADCASTER_SHM
     uint64              receiptId;
+#endif
     int                 rc;
 
     pthread_mutex_lock(&desk->watchdog.mutex);
@@ -218,6 +286,14 @@ broadcasterDialog(struct desk *desk, int sockFD)
         	if (session->sessionId == 0)
         	    continue;
 
+#ifdef BROADCASTER_SHM
+            rc = handOverSession(desk, session);
+            if (rc != 0)
+                break;
+
+            ReportInfo("Handed over revised session %lu",
+                be64toh(session->sessionId));
+#else
             rc = sendReceipt(sockFD, session);
             if (rc != 0)
                 break;
@@ -238,6 +314,7 @@ broadcasterDialog(struct desk *desk, int sockFD)
                 rc = -1;
                 break;
             }
+#endif
         }
 
         if (rc == 0)
@@ -249,6 +326,42 @@ broadcasterDialog(struct desk *desk, int sockFD)
     return rc;
 }
 
+#ifdef BROADCASTER_SHM
+
+/*
+ * Copy revised session to a buffer of the bank shared with the Satellite
+ * and put the buffer to the channel of sessions. Satellite gives
+ * the buffer back to the bank when it has taken over the session,
+ * so there is no receipt to wait for.
+ */
+static int
+handOverSession(struct desk *desk, struct session *session)
+{
+	struct MMPS_Buffer  *buffer;
+	int                 rc;
+
+    buffer = MMPS_PeekBufferTimed(desk->listener.pool, 0,
+        MMPS_NO_OWNER,
+        TIMEOUT_ON_WAIT_FOR_SHM_BUFFER);
+    if (buffer == NULL) {
+        ReportError("No buffer available for revised session");
+        return -1;
+    }
+
+    MMPS_PutData(buffer, (char *) session, sizeof(struct session));
+
+    rc = MMPS_SendShMemBuffer(buffer, BROADCASTER_SHM_CHANNEL_SESSIONS);
+    if (rc != 0) {
+        MMPS_PokeBuffer(buffer);
+        ReportError("Cannot hand over revised session: rc=%d", rc);
+        return -1;
+    }
+
+	return 0;
+}
+
+#else
+
 static int
 sendReceipt(int sockFD, struct session *session)
 {
@@ -342,3 +455,5 @@ receiveReceipt(int sockFD, struct session *session, uint64 *receiptId)
 
 	return 0;
 }
+
+#endif
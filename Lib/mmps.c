@@ -1,15 +1,30 @@
 // System definition files.
 //
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <errno.h>
 #include <fcntl.h>
 #include <pthread.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 
+#ifdef LINUX
+#include <sys/syscall.h>
+#endif
+
+#ifdef MMPS_IO_URING
+#include <linux/io_uring.h>
+#endif
+
 #ifndef LINUX
 #include <atomic.h>
 #endif
@@ -25,6 +40,444 @@
 
 const unsigned int NOTHING = 0xFFFF0000;
 
+// Magic value at the beginning of a shared memory segment of a bank.
+//
+#define MMPS_SHM_MAGIC                  0x4D4D5053
+
+// Maximal number of buffers that are peeked from a bank at once
+// by MMPS_PeekBuffers(), or given back to their banks at once
+// by MMPS_PokeBuffer().
+//
+#define MMPS_POKE_BATCH_SIZE            128
+
+// Maximal number of buffers handed over to one recvmsg() or sendmsg()
+// by MMPS_ReceiveIntoChain() and MMPS_SendChain().
+//
+#define MMPS_NUMBER_OF_VECTORS          64
+
+// Number of spare descriptors for spliced buffers allocated at once
+// when the stash of spare descriptors of a pool runs empty.
+//
+#define MMPS_SPLICES_PER_BATCH          64
+
+// Data of buffers of 'allocate on demand' banks is taken from slabs,
+// with one list of slabs per size class (power of two) between 64 bytes
+// and MAX_BLOCK_SIZE. Larger data is allocated with malloc().
+// Each thread keeps a cache of up to MMPS_SLAB_CACHE_SIZE chunks
+// per size class, and refills or flushes half of it at once.
+// Slabs are aligned to their size, which is a power of two of at least
+// MMPS_SLAB_SIZE and at least MMPS_SLAB_MIN_CHUNKS chunks. The first chunk
+// of a slab holds its descriptor. A slab whose chunks are all free is
+// unmapped, except for one such slab kept per size class.
+//
+#define MMPS_SLAB_MIN_CLASS             6
+#define MMPS_SLAB_MAX_CLASS             20
+#define MMPS_SLAB_NUMBER_OF_CLASSES     (MMPS_SLAB_MAX_CLASS - MMPS_SLAB_MIN_CLASS + 1)
+#define MMPS_SLAB_SIZE                  256 * KB
+#define MMPS_SLAB_MIN_CHUNKS            8
+#define MMPS_SLAB_CACHE_SIZE            32
+
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED                  1
+#endif
+
+// Number of NUMA nodes in the system and NUMA node of each CPU,
+// looked up once by NumberOfNodes() at bank initialization.
+//
+static unsigned int     numberOfNumaNodes = 0;
+static unsigned int     *cpuNodes = NULL;
+static long             numberOfCpuNodes = 0;
+
+// Descriptor of a slab, stored in its first chunk. Free chunks of a slab
+// are linked through their first word.
+//
+struct Slab
+{
+    struct Slab         *next;
+    struct Slab         *prev;
+    void                *chunks;
+    unsigned int        numberOfChunks;
+    unsigned int        numberOfFreeChunks;
+};
+
+// Lists of slabs with free chunks of each slab size class, shared by all
+// threads.
+//
+static struct
+{
+    pthread_spinlock_t  lock;
+    struct Slab         *slabs;
+    unsigned int        numberOfEmptySlabs;
+} slabClasses[MMPS_SLAB_NUMBER_OF_CLASSES];
+
+// Per-thread caches of free chunks.
+//
+struct SlabCache
+{
+    unsigned int        numberOfChunks[MMPS_SLAB_NUMBER_OF_CLASSES];
+    void                *chunks[MMPS_SLAB_NUMBER_OF_CLASSES][MMPS_SLAB_CACHE_SIZE];
+};
+
+static pthread_once_t   slabOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t    slabCacheKey;
+static __thread struct SlabCache *slabCache = NULL;
+
+// Stripe of statistics counters of each thread, assigned round robin
+// on first use (0 means not yet assigned, otherwise it is stripe + 1).
+//
+static unsigned int     numberOfCounterStripeUsers = 0;
+static __thread unsigned int counterStripe = 0;
+
+#define CountEvent(bank, counter, value) \
+    __atomic_add_fetch(&LocalCounters(bank)->counter, (value), __ATOMIC_RELAXED)
+
+// Bank lock is tried first, so that it is counted how often
+// it had to be waited for.
+//
+#ifdef MMPS_MUTEX
+#define BankLock(bank) \
+    do { \
+        if (pthread_mutex_trylock(&(bank)->mutex.lock) != 0) { \
+            CountEvent(bank, contentions, 1); \
+            pthread_mutex_lock(&(bank)->mutex.lock); \
+        } \
+    } while (0)
+#define BankUnlock(bank)                pthread_mutex_unlock(&(bank)->mutex.lock)
+#else
+#define BankLock(bank) \
+    do { \
+        if (pthread_spin_trylock(&(bank)->lock) != 0) { \
+            CountEvent(bank, contentions, 1); \
+            pthread_spin_lock(&(bank)->lock); \
+        } \
+    } while (0)
+#define BankUnlock(bank)                pthread_spin_unlock(&(bank)->lock)
+#endif
+
+static unsigned int
+PullBufferIds(
+    struct MMPS_Bank    *bank,
+    unsigned int        *ids,
+    unsigned int        numberOfIds,
+    unsigned int        *numberOfQueuedIds);
+
+static void
+PushBufferIds(
+    struct MMPS_Bank    *bank,
+    unsigned int        *ids,
+    unsigned int        numberOfIds);
+
+static unsigned int
+NumberOfFreeBufferIds(struct MMPS_Bank *bank);
+
+static struct MMPS_Magazine *
+MagazineById(
+    struct MMPS_Bank    *bank,
+    unsigned int        magazineId);
+
+static struct MMPS_Magazine *
+LocalMagazine(struct MMPS_Bank *bank);
+
+static unsigned int
+TakeBufferId(struct MMPS_Bank *bank);
+
+static unsigned int
+TakeBufferIds(
+    struct MMPS_Bank    *bank,
+    unsigned int        *ids,
+    unsigned int        numberOfIds);
+
+static unsigned int
+PeekBufferId(struct MMPS_Bank *bank);
+
+static unsigned int
+PeekBufferIds(
+    struct MMPS_Bank    *bank,
+    unsigned int        *ids,
+    unsigned int        numberOfIds);
+
+static void
+PokeBufferIds(
+    struct MMPS_Bank    *bank,
+    unsigned int        *ids,
+    unsigned int        numberOfIds);
+
+static void
+PokeBufferIdsByBank(
+    struct MMPS_Bank    **banks,
+    unsigned int        *ids,
+    unsigned int        numberOfIds);
+
+static int
+CreateBank(
+    struct MMPS_Pool    *pool,
+    unsigned int        bankId,
+    unsigned int        bufferSize,
+    unsigned int        followerSize,
+    unsigned int        numberOfBuffers,
+    unsigned int        options,
+    unsigned int        node,
+    struct MMPS_Bank    **createdBank);
+
+static void
+DestroyBank(struct MMPS_Bank *bank);
+
+static void
+BuildSizeClasses(struct MMPS_Pool *pool);
+
+static unsigned int
+SizeClass(unsigned int size);
+
+static unsigned int
+PositionOfSize(
+    struct MMPS_Pool    *pool,
+    unsigned int        size);
+
+static struct MMPS_Buffer *
+PeekBufferFromBank(
+    struct MMPS_Pool    *pool,
+    unsigned int        bankId,
+    const unsigned int  ownerId);
+
+static struct MMPS_Buffer *
+PeekChainOfSize(
+    struct MMPS_Pool    *pool,
+    unsigned int        position,
+    unsigned int        size,
+    const unsigned int  ownerId);
+
+static int
+AllocateBankData(struct MMPS_Bank *bank);
+
+static int
+AllocateBankFollowers(struct MMPS_Bank *bank);
+
+static int
+InitBankMagazines(
+    struct MMPS_Bank    *bank,
+    unsigned int        magazineSize);
+
+static int
+ShrinkElasticBank(struct MMPS_Bank *bank);
+
+static unsigned int
+CollectBlockIds(
+    struct MMPS_Bank    *bank,
+    unsigned int        firstBufferId,
+    unsigned int        *blockIds);
+
+static struct MMPS_Buffer *
+BufferOfBank(
+    struct MMPS_Bank    *bank,
+    unsigned int        bufferId);
+
+static struct MMPS_Buffer *
+PeekBuffersFromBank(
+    struct MMPS_Bank    *bank,
+    unsigned int        numberOfBuffers,
+    const unsigned int  ownerId);
+
+static struct MMPS_Bank *
+NodeBank(
+    struct MMPS_Bank    *bank,
+    unsigned int        node);
+
+static unsigned int
+LocalNode(struct MMPS_Bank *bank);
+
+static unsigned int
+NumberOfNodes(void);
+
+static void
+BindToNode(
+    struct MMPS_Bank    *bank,
+    void                *address,
+    size_t              size);
+
+static void *
+AllocateDescriptors(size_t size);
+
+static struct MMPS_Buffer *
+TakeSpliceDescriptor(struct MMPS_Pool *pool);
+
+static void
+GiveSpliceDescriptor(
+    struct MMPS_Pool    *pool,
+    struct MMPS_Buffer  *buffer);
+
+static void
+WakeWaiters(struct MMPS_Bank *bank);
+
+static void
+DeadlineAfter(
+    struct timespec     *deadline,
+    unsigned int        timeout);
+
+static size_t
+ShMemHeaderSize(struct MMPS_Bank *bank);
+
+static void
+InitShMemBank(
+    struct MMPS_Bank        *bank,
+    struct MMPS_ShMemBank   *sharedBank,
+    size_t                  headerSize);
+
+static void
+LockShMem(pthread_mutex_t *lock);
+
+static struct MMPS_ShMemEntry *
+ShMemEntries(
+    struct MMPS_ShMemBank       *sharedBank,
+    struct MMPS_ShMemChannel    *sharedChannel);
+
+static unsigned int
+PullShMemBufferIds(
+    struct MMPS_ShMemBank   *sharedBank,
+    unsigned int            *ids,
+    unsigned int            numberOfIds,
+    unsigned int            *numberOfQueuedIds);
+
+static void
+PushShMemBufferIds(
+    struct MMPS_ShMemBank   *sharedBank,
+    unsigned int            *ids,
+    unsigned int            numberOfIds);
+
+static unsigned int
+NumberOfFreeShMemBufferIds(struct MMPS_ShMemBank *sharedBank);
+
+static struct MMPS_Counters *
+LocalCounters(struct MMPS_Bank *bank);
+
+static void
+RaiseHighWaterMark(
+    struct MMPS_Bank    *bank,
+    unsigned int        numberOfQueuedIds);
+
+static unsigned int
+ChainLengthClass(unsigned int chainLength);
+
+static int
+DumpBankStatistics(
+    int                         fd,
+    const char                  *poolName,
+    struct MMPS_BankStatistics  *statistics);
+
+static unsigned int
+DropTouch(struct MMPS_Buffer *buffer);
+
+static void
+ShareDataBlock(struct MMPS_Buffer *owner);
+
+static unsigned int
+ReleaseDataBlock(struct MMPS_Buffer *owner);
+
+static void
+InitSlabs(void);
+
+static size_t
+SlabSize(unsigned int slabClass);
+
+static struct Slab *
+MapSlab(unsigned int slabClass);
+
+static struct SlabCache *
+LocalSlabCache(void);
+
+static void
+FlushSlabCache(void *arg);
+
+static unsigned int
+TakeSlabChunks(
+    unsigned int        slabClass,
+    void                **chunks,
+    unsigned int        numberOfChunks);
+
+static void
+GiveSlabChunks(
+    unsigned int        slabClass,
+    void                **chunks,
+    unsigned int        numberOfChunks);
+
+static void *
+AllocateSlabChunk(unsigned int size);
+
+static void
+ReleaseSlabChunk(
+    void                *chunk,
+    unsigned int        size);
+
+static void
+InitBuffer(
+    struct MMPS_Bank    *bank,
+    struct MMPS_Buffer  *buffer,
+    unsigned int        bufferId);
+
+static unsigned int
+NumberOfBuffersInBlock(
+    struct MMPS_Bank    *bank,
+    unsigned int        blockId);
+
+static unsigned int
+NumberOfCommittedBuffers(struct MMPS_Bank *bank);
+
+static size_t
+HugePageSize(void);
+
+static size_t
+PageAlignedSize(
+    struct MMPS_Bank    *bank,
+    size_t              size);
+
+static void *
+MapRange(
+    struct MMPS_Bank    *bank,
+    size_t              size,
+    const char          *purpose,
+    size_t              *pageSize);
+
+static void *
+ReserveRange(
+    struct MMPS_Bank    *bank,
+    size_t              size,
+    size_t              *pageSize);
+
+static int
+CommitRange(
+    void                *address,
+    size_t              size);
+
+static void
+DecommitRange(
+    void                *address,
+    size_t              size);
+
+static int
+InitElasticBank(struct MMPS_Bank *bank);
+
+static int
+CommitNextBlock(
+    struct MMPS_Bank    *bank,
+    unsigned int        numberOfCommittedBlocks);
+
+static int
+ReserveElasticPayload(
+    struct MMPS_Bank    *bank,
+    boolean             followers);
+
+#ifdef MMPS_IO_URING
+
+static void
+LendToBufferRing(
+    struct MMPS_BufferRing  *ring,
+    unsigned int            ringBufferId,
+    struct MMPS_Buffer      *buffer);
+
+static void
+RefillBufferRing(struct MMPS_BufferRing *ring);
+
+#endif // MMPS_IO_URING
+
 /*
  * @brief   Allocate and initialize buffer pool.
  *
@@ -55,6 +508,23 @@ MMPS_InitPool(const unsigned int numberOfBanks)
 #endif
 
     pool->numberOfBanks = numberOfBanks;
+    pool->exhaustionPolicy = MMPS_EXHAUSTION_LARGER;
+
+    pool->sizeClasses.numberOfBanks = 0;
+    pool->sizeClasses.bankIds = malloc(numberOfBanks * sizeof(unsigned int));
+    if (pool->sizeClasses.bankIds == NULL)
+    {
+        free(pool);
+
+        ReportSoftAlert("[MMPS] Out of memory");
+
+        return NULL;
+    }
+
+    memset(&pool->sizeClasses.first, 0, sizeof(pool->sizeClasses.first));
+
+    pthread_spin_init(&pool->splices.lock, PTHREAD_PROCESS_PRIVATE);
+    pool->splices.spares = NULL;
 
     // Make sure pointers to buffer banks are set to null.
     //
@@ -97,29 +567,50 @@ MMPS_InitBank(
     unsigned int        followerSize,
     unsigned int        numberOfBuffers)
 {
-    size_t              maxBlockSize;
-    long long           totalBlockSize;
-    unsigned int        numberOfBlocks;
-    size_t              eachBlockSize;
-    size_t              lastBlockSize;
-    unsigned int        buffersPerBlock;
-    size_t              bankAllocSize;
+    return MMPS_InitBankWithOptions(
+            pool,
+            bankId,
+            bufferSize,
+            followerSize,
+            numberOfBuffers,
+            0);
+}
 
+/*
+ * @brief   Initialize buffer bank with options - MMPS pool must be
+ *          already initialized.
+ *
+ * Same as MMPS_InitBank(), but allows to choose how the memory
+ * of the bank is obtained.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor - already initialized
+ *                      with MMPS_InitPool().
+ * @param   bankId      Bank id of the bank to be initialized.
+ * @param   bufferSize  Size of buffers in a bank or 0 (see MMPS_InitBank()).
+ * @param   followerSize    Size of the follower or 0 if buffers in this bank
+ *                          are not supposed to have followers.
+ * @param   numberOfBuffers Maximal number of buffer descriptors
+ *                          in the specified bank.
+ * @param   options     Combination of MMPS_BANK_* options or 0.
+ *
+ * @return  0 upon successful completion.
+ * @return  Error code (negative value), if bank cannot be created.
+ */
+int
+MMPS_InitBankWithOptions(
+    struct MMPS_Pool    *pool,
+    unsigned int        bankId,
+    unsigned int        bufferSize,
+    unsigned int        followerSize,
+    unsigned int        numberOfBuffers,
+    unsigned int        options)
+{
     struct MMPS_Bank    *bank;
-    struct MMPS_Buffer  *buffer;
-
-    unsigned int        blockId;
-    unsigned int        blockSize;
-    void                *block;
-    unsigned int        bufferIdSequential;
-    unsigned int        bufferIdInBlock;
-
-#ifdef MMPS_INIT_BANK
-    ReportDebug("[MMPS] Create bank %u with %u buffers of size %u",
-        bankId,
-        numberOfBuffers,
-        bufferSize);
-#endif
+    struct MMPS_Bank    **nodeBanks;
+    unsigned int        numberOfNodes;
+    unsigned int        node;
+    unsigned int        numberOfBuffersOnNode;
+    int                 rc;
 
     // Quit if bank id is out of range.
     //
@@ -131,304 +622,302 @@ MMPS_InitBank(
     if (pool->banks[bankId] != NULL)
         return MMPS_WRONG_BANK_ID;
 
-    // Calculate parameters needed to allocate the memory structures
-    // to store the buffer queue.
-
-    maxBlockSize = MAX_BLOCK_SIZE - MAX_BLOCK_SIZE % sizeof(struct MMPS_Buffer);
-
-    buffersPerBlock = maxBlockSize / sizeof(struct MMPS_Buffer);
+    numberOfNodes = (options & MMPS_BANK_NUMA) ? NumberOfNodes() : 1;
 
-    totalBlockSize = (long) numberOfBuffers * (long)sizeof(struct MMPS_Buffer);
-    if (totalBlockSize <= maxBlockSize)
+    if (numberOfNodes == 1)
     {
-        numberOfBlocks = 1;
-        eachBlockSize = totalBlockSize;
-        lastBlockSize = 0;
+        rc = CreateBank(pool,
+                bankId,
+                bufferSize,
+                followerSize,
+                numberOfBuffers,
+                options & ~MMPS_BANK_NUMA,
+                0,
+                &bank);
+        if (rc != MMPS_OK)
+            return rc;
     }
     else
     {
-        if ((totalBlockSize % maxBlockSize) == 0)
+        // Split buffers of the bank between sub-banks, one per NUMA node.
+        //
+        nodeBanks = malloc(numberOfNodes * sizeof(struct MMPS_Bank *));
+        if (nodeBanks == NULL)
         {
-            numberOfBlocks = totalBlockSize / maxBlockSize;
-            eachBlockSize = maxBlockSize;
-            lastBlockSize = 0;
+            ReportSoftAlert("[MMPS] Out of memory");
+
+            return MMPS_OUT_OF_MEMORY;
         }
-        else
+
+        for (node = 0; node < numberOfNodes; node++)
         {
-            numberOfBlocks = (totalBlockSize / maxBlockSize) + 1;
-            eachBlockSize = maxBlockSize;
-            lastBlockSize = totalBlockSize % maxBlockSize;
-        }
-    }
+            numberOfBuffersOnNode = numberOfBuffers / numberOfNodes;
+            if (node < numberOfBuffers % numberOfNodes)
+                numberOfBuffersOnNode++;
+
+            rc = CreateBank(pool,
+                    bankId,
+                    bufferSize,
+                    followerSize,
+                    numberOfBuffersOnNode,
+                    options,
+                    node,
+                    &nodeBanks[node]);
+            if (rc != MMPS_OK)
+            {
+                // Unwind sub-banks of the nodes already created.
+                //
+                while (node > 0)
+                {
+                    node--;
 
-#ifdef MMPS_INIT_BANK
-    ReportDebug("[MMPS] " \
-            "... maxBlockSize=%lu buffersPerBlock=%u numberOfBlocks=%u " \
-            "eachBlockSize=%lu lastBlockSize=%lu",
-            maxBlockSize,
-            buffersPerBlock,
-            numberOfBlocks,
-            eachBlockSize,
-            lastBlockSize);
-#endif
+                    DestroyBank(nodeBanks[node]);
+                }
 
-    // Calculate amount of memory to be allocated for the bank.
-    //
-    bankAllocSize = sizeof(struct MMPS_Bank);
-    bankAllocSize += numberOfBuffers * sizeof(unsigned int);
-    bankAllocSize += numberOfBlocks * sizeof(void *);
+                free(nodeBanks);
 
-    bank = malloc(bankAllocSize);
-    if (bank == NULL)
-    {
-        ReportSoftAlert("[MMPS] Out of memory");
+                return rc;
+            }
 
-        return MMPS_OUT_OF_MEMORY;
-    }
+            nodeBanks[node]->numa.numberOfNodes = numberOfNodes;
+            nodeBanks[node]->numa.banks = nodeBanks;
+        }
 
-#ifdef MMPS_EYECATCHER
-    strncpy(bank->eyeCatcher, EYECATCHER_BANK, EYECATCHER_SIZE);
+        bank = nodeBanks[0];
+
+#ifdef MMPS_INIT_BANK
+        ReportDebug("[MMPS] Bank %u is spread over %u NUMA nodes",
+                bankId,
+                numberOfNodes);
 #endif
+    }
 
-    // Initialize bank values.
+    pool->banks[bankId] = bank;
 
-#ifdef MMPS_MUTEX
-    pthread_mutexattr_init(&bank->mutex.attr);
+    BuildSizeClasses(pool);
 
-    pthread_mutexattr_setpshared(&bank->mutex.attr, PTHREAD_PROCESS_PRIVATE);
+    return MMPS_OK;
+}
 
-    pthread_mutex_init(&bank->mutex.lock, &bank->mutex.attr);
-#else
-    pthread_spin_init(&bank->lock, PTHREAD_PROCESS_PRIVATE);
-#endif
+/*
+ * @brief   Allocate data memory blocks for all buffers of the specified bank.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor - already initialized
+ *                      with MMPS_InitPool().
+ * @param   bankId      Bank id of the bank those buffers to allocate.
+ *
+ * @return  0 upon successful completion.
+ * @return  Error code (negative value), in case of error.
+ */
+int
+MMPS_AllocateImmediately(
+    struct MMPS_Pool    *pool,
+    unsigned int        bankId)
+{
+    struct MMPS_Bank    *bank;
+    unsigned int        node;
+    int                 rc;
 
-    bank->bankId              = bankId;
-    bank->allocateOnDemand    = FALSE;
-    bank->pool                = pool;
-    bank->sharedMemoryHandle  = 0;
-    bank->numberOfBuffers     = numberOfBuffers;
-    bank->bufferSize          = bufferSize;
-    bank->followerSize        = followerSize;
-    bank->numberOfBlocks      = numberOfBlocks;
-    bank->eachBlockSize       = eachBlockSize;
-    bank->lastBlockSize       = lastBlockSize;
-    bank->buffersPerBlock     = buffersPerBlock;
-    bank->cursor.peek         = 0;
-    bank->cursor.poke         = 0;
+    bank = pool->banks[bankId];
 
-    bank->blocks = (void *) (
-        (unsigned long) bank +
-        (unsigned long) (bankAllocSize - numberOfBlocks * sizeof(void *))
-    );
+    for (node = 0; node < bank->numa.numberOfNodes; node++)
+    {
+        rc = AllocateBankData(NodeBank(bank, node));
+        if (rc != MMPS_OK)
+            return rc;
+    }
 
-#ifdef MMPS_INIT_BANK
-    ReportDebug("[MMPS] ... bank=0x%016lX (%lu bytes) bank->blocks=0x%016lX",
-            (unsigned long) bank,
-            bankAllocSize,
-            (unsigned long) bank->blocks);
-#endif
+    return MMPS_OK;
+}
 
-    blockId = 0;
-    bufferIdSequential = 0;
-    bufferIdInBlock = buffersPerBlock;
+/*
+ * @brief   Allocate follower memory blocks for all buffers of the specified bank.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor - already initialized
+ *                      with MMPS_InitPool().
+ * @param   bankId      Bank id of the bank those followers to allocate.
+ *
+ * @return  0 upon successful completion.
+ * @return  Error code (negative value), in case of error.
+ */
+extern int
+MMPS_AllocateFollowers(
+    struct MMPS_Pool    *pool,
+    unsigned int        bankId)
+{
+    struct MMPS_Bank    *bank;
+    unsigned int        node;
+    int                 rc;
 
-    // Set block to null to omit compiler messages like 'block may be used
-    // uninitialized'.
-    //
-    block = NULL;
+    bank = pool->banks[bankId];
 
-    // Allocate all parts of buffer queue, allocate all buffers
-    // and put them in a queue.
-    //
-    while (bufferIdSequential < bank->numberOfBuffers)
+    for (node = 0; node < bank->numa.numberOfNodes; node++)
     {
-        // Is it time to allocate new block for buffer queue?
-        //
-        if (bufferIdInBlock == buffersPerBlock)
-        {
-            bufferIdInBlock = 0;
-
-            if ((blockId + 1) < numberOfBlocks) {
-                blockSize = eachBlockSize;
-            } else {
-                blockSize = (lastBlockSize == 0) ? eachBlockSize : lastBlockSize;
-            }
-
-            block = malloc(blockSize);
-            if (block == NULL)
-            {
-                ReportSoftAlert("[MMPS] Out of memory");
-
-                return MMPS_OUT_OF_MEMORY;
-            }
-
-#ifdef MMPS_INIT_BANK_DEEP
-            ReportDebug("[MMPS]   > allocated block=0x%016lX",
-                    (unsigned long) block);
-#endif
-
-            bank->blocks[blockId] = block;
-            blockId++;
-        }
-
-        bank->ids[bufferIdSequential] = bufferIdSequential;
-
-        buffer = (void *)
-            ((unsigned long) block +
-            (unsigned long) (bufferIdInBlock * sizeof(struct MMPS_Buffer)));
-
-#ifdef MMPS_EYECATCHER
-        strncpy(buffer->eyeCatcher, EYECATCHER_BUFFER, EYECATCHER_SIZE);
-#endif
-
-#ifdef MMPS_INIT_BANK_DEEP
-        ReportDebug("[MMPS]     > buffer=0x%016lX bufferId=%u",
-                (unsigned long) buffer,
-                bufferIdSequential);
-#endif
-
-        // Initialize buffer values.
-
-        buffer->bufferId      = bufferIdSequential;
-        buffer->bank          = bank;
-        buffer->prev          = NULL;
-        buffer->next          = NULL;
-        buffer->ownerId       = MMPS_NO_OWNER;
-        buffer->touches       = 0;
-        buffer->bufferSize    = bufferSize;
-        buffer->followerSize  = followerSize;
-        buffer->dataSize      = 0;
-        buffer->data          = NULL;
-        buffer->cursor        = NULL;
-        buffer->dmaAddress    = NULL;
-
-        bufferIdSequential++;
-        bufferIdInBlock++;
+        rc = AllocateBankFollowers(NodeBank(bank, node));
+        if (rc != MMPS_OK)
+            return rc;
     }
 
-    pool->banks[bankId] = bank;
-
-#ifdef MMPS_INIT_BANK
-    ReportDebug("[MMPS] Created bank %u with %u buffers of size %u, " \
-            "with total bank size %lld MB",
-            bankId,
-            bank->numberOfBuffers,
-            bufferSize,
-            totalBlockSize >> 20);
-
-    ReportDebug("[MMPS] There are %u block(s) of size %lu KB each and %lu KB last",
-            bank->numberOfBlocks,
-            bank->eachBlockSize >> 10,
-            bank->lastBlockSize >> 10);
-#endif
-
     return MMPS_OK;
 }
 
-/*
- * @brief   Allocate data memory blocks for all buffers of the specified bank.
+/**
+ * @brief   Set the 'allocate on demand' flag for the specified bank.
+ *
+ * Data of buffers is allocated on each peek and released on each poke.
+ * Memory comes from slabs with free lists per size class and per-thread
+ * caches in front of them, so that peek and poke do not go to malloc().
  *
  * @param   pool        Pointer to MMPS pool descriptor - already initialized
  *                      with MMPS_InitPool().
- * @param   bankId      Bank id of the bank those buffers to allocate.
+ * @param   bankId      Bank id of the bank set as 'allocate on demand'.
  *
  * @return  0 upon successful completion.
  * @return  Error code (negative value), in case of error.
  */
-int
-MMPS_AllocateImmediately(
+extern int
+MMPS_AllocateOnDemand(
     struct MMPS_Pool    *pool,
     unsigned int        bankId)
 {
-    struct MMPS_Bank    *bank;
-    struct MMPS_Buffer  *buffer;
-    unsigned int        bufferId;
+    struct MMPS_Bank *bank;
+    unsigned int node;
 
     bank = pool->banks[bankId];
 
-    for (bufferId = 0; bufferId < bank->numberOfBuffers; bufferId++)
-    {
-        buffer = MMPS_BufferById(pool, bankId, bufferId);
-        //
-        // Function MMPS_BufferById() delivers trusted value,
-        // therefore, no need for error check.
-
-        buffer->data = malloc(buffer->bufferSize);
-        if (buffer->data == NULL)
-        {
-            ReportSoftAlert("[MMPS] Out of memory");
+    for (node = 0; node < bank->numa.numberOfNodes; node++)
+        NodeBank(bank, node)->allocateOnDemand = TRUE;
 
-            return MMPS_OUT_OF_MEMORY;
-        }
+    return 0;
+}
 
-        MMPS_ResetCursor(buffer);
+/*
+ * @brief   Choose what MMPS_PeekBufferOfSize() does when the bank
+ *          of requested size is exhausted.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   policy      One of MMPS_EXHAUSTION_*.
+ *
+ * @return  0 upon successful completion.
+ * @return  Error code (negative value), in case of error.
+ */
+int
+MMPS_SetExhaustionPolicy(
+    struct MMPS_Pool    *pool,
+    unsigned int        policy)
+{
+    switch (policy)
+    {
+    case MMPS_EXHAUSTION_LARGER:
+    case MMPS_EXHAUSTION_FAIL:
+    case MMPS_EXHAUSTION_CHAIN:
+        pool->exhaustionPolicy = policy;
+        return MMPS_OK;
+
+    default:
+        return MMPS_WRONG_POLICY;
     }
-
-    return MMPS_OK;
 }
 
 /*
- * @brief   Allocate follower memory blocks for all buffers of the specified bank.
+ * @brief   Put per-CPU magazines in front of the queue of "free" buffers.
+ *
+ * Each CPU gets its own magazine of free buffer ids. Peeks and pokes
+ * are served from the magazine of the CPU the caller is running on,
+ * and only refill or flush half a magazine at once against the bank.
+ * Must be called during initialization, before the bank is used
+ * by more than one thread.
  *
  * @param   pool        Pointer to MMPS pool descriptor - already initialized
  *                      with MMPS_InitPool().
- * @param   bankId      Bank id of the bank those followers to allocate.
+ * @param   bankId      Bank id of the bank to put magazines in front of.
+ * @param   magazineSize    Maximal number of buffer ids in each magazine.
  *
  * @return  0 upon successful completion.
  * @return  Error code (negative value), in case of error.
  */
-extern int
-MMPS_AllocateFollowers(
+int
+MMPS_InitMagazines(
     struct MMPS_Pool    *pool,
-    unsigned int        bankId)
+    unsigned int        bankId,
+    unsigned int        magazineSize)
 {
     struct MMPS_Bank    *bank;
-    struct MMPS_Buffer  *buffer;
-    unsigned int        bufferId;
+    unsigned int        node;
+    int                 rc;
+
+    if ((bankId + 1) > pool->numberOfBanks)
+        return MMPS_WRONG_BANK_ID;
 
     bank = pool->banks[bankId];
+    if ((bank == NULL) || (bank->magazines != NULL))
+        return MMPS_WRONG_BANK_ID;
 
-    for (bufferId = 0; bufferId < bank->numberOfBuffers; bufferId++)
-    {
-        buffer = MMPS_BufferById(pool, bankId, bufferId);
-        //
-        // Function MMPS_BufferById() delivers trusted value,
-        // therefore, no need for error check.
+    // Magazines are private to a process, buffer ids in them would be
+    // lost for other processes sharing the bank.
+    //
+    if (bank->sharedBank != NULL)
+        return MMPS_SHM_ERROR;
 
-        buffer->follower = malloc(buffer->followerSize);
-        if (buffer->follower == NULL)
-        {
-            ReportSoftAlert("[MMPS] Out of memory");
+    // A magazine must be able to hold at least two ids,
+    // otherwise there is nothing to batch.
+    //
+    if (magazineSize < 2)
+        return MMPS_OK;
 
-            return MMPS_OUT_OF_MEMORY;
-        }
+    for (node = 0; node < bank->numa.numberOfNodes; node++)
+    {
+        rc = InitBankMagazines(NodeBank(bank, node), magazineSize);
+        if (rc != MMPS_OK)
+            return rc;
     }
 
     return MMPS_OK;
 }
 
-/**
- * @brief   Set the 'allocate on demand' flag for the specified bank.
+/*
+ * @brief   Give back memory of elastic bank blocks that are not in use.
  *
- * @param   pool        Pointer to MMPS pool descriptor - already initialized
- *                      with MMPS_InitPool().
- * @param   bankId      Bank id of the bank set as 'allocate on demand'.
+ * Blocks are released from the highest committed block downwards,
+ * as long as all buffers of a block are free (in the queue of "free"
+ * buffers or in magazines).
+ * The block committed at initialization is never released.
  *
- * @return  0 upon successful completion.
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   bankId      Bank id of an elastic bank.
+ *
+ * @return  Number of released blocks upon successful completion.
  * @return  Error code (negative value), in case of error.
  */
-extern int
-MMPS_AllocateOnDemand(
+int
+MMPS_ShrinkBank(
     struct MMPS_Pool    *pool,
     unsigned int        bankId)
 {
-    struct MMPS_Bank *bank;
+    struct MMPS_Bank    *bank;
+    unsigned int        node;
+    int                 rc;
+    int                 releasedBlocks;
+
+    if ((bankId + 1) > pool->numberOfBanks)
+        return MMPS_WRONG_BANK_ID;
 
     bank = pool->banks[bankId];
+    if ((bank == NULL) || ((bank->options & MMPS_BANK_ELASTIC) == 0))
+        return MMPS_WRONG_BANK_ID;
 
-    bank->allocateOnDemand = TRUE;
+    releasedBlocks = 0;
 
-    return 0;
+    for (node = 0; node < bank->numa.numberOfNodes; node++)
+    {
+        rc = ShrinkElasticBank(NodeBank(bank, node));
+        if (rc < 0)
+            return rc;
+
+        releasedBlocks += rc;
+    }
+
+    return releasedBlocks;
 }
 
 /*
@@ -450,21 +939,53 @@ MMPS_MapShMemBufferBank(
     unsigned int        bankId,
     const char          *sharedMemoryName)
 {
-    struct MMPS_Bank    *bank;
-    struct MMPS_Buffer  *buffer;
-    int                 sharedMemoryHandle;
-    unsigned int        sharedMemorySize;
-    unsigned int        bufferId;
-    int                 rc;
+    struct MMPS_Bank        *bank;
+    struct MMPS_Buffer      *buffer;
+    struct MMPS_ShMemBank   *sharedBank;
+    struct stat             sharedMemoryStatus;
+    int                     sharedMemoryHandle;
+    size_t                  headerSize;
+    size_t                  sharedMemorySize;
+    boolean                 creator;
+    unsigned int            waited;
+    unsigned int            bufferId;
+    int                     rc;
 
     rc = MMPS_OK;
 
     bank = pool->banks[bankId];
 
+    if ((bank->options != 0) ||
+            (bank->numberOfMagazines != 0) ||
+            (bank->followerSize != 0) ||
+            (bank->sharedBank != NULL))
+    {
+        ReportError("[MMPS] Bank %u cannot be mapped to shared memory", bankId);
+
+        return MMPS_SHM_ERROR;
+    }
+
+    headerSize = ShMemHeaderSize(bank);
+    sharedMemorySize = headerSize + (size_t) bank->numberOfBuffers * bank->bufferSize;
+
+    // The first process creates the segment, all others attach to it.
+    //
+    creator = TRUE;
+
     sharedMemoryHandle = shm_open(
             sharedMemoryName,
-            O_CREAT | O_RDWR,
-            0777);
+            O_CREAT | O_EXCL | O_RDWR,
+            0660);
+    if ((sharedMemoryHandle == -1) && (errno == EEXIST))
+    {
+        creator = FALSE;
+
+        sharedMemoryHandle = shm_open(
+                sharedMemoryName,
+                O_RDWR,
+                0660);
+    }
+
     if (sharedMemoryHandle == -1)
     {
         ReportError("[MMPS] Cannot open shared memory: errno=%d", errno);
@@ -472,22 +993,55 @@ MMPS_MapShMemBufferBank(
         return MMPS_SHM_ERROR;
     }
 
-    sharedMemorySize = bank->numberOfBuffers * bank->bufferSize;
-
-    rc = ftruncate(sharedMemoryHandle, sharedMemorySize);
-    if (rc == -1)
+    if (creator == TRUE)
     {
-        ReportError("[MMPS] Cannot set shared memory size to %u: errno=%d",
-                sharedMemorySize,
-                errno);
+        if (ftruncate(sharedMemoryHandle, sharedMemorySize) == -1)
+        {
+            ReportError("[MMPS] Cannot set shared memory size to %lu: errno=%d",
+                    (unsigned long) sharedMemorySize,
+                    errno);
 
-        return MMPS_SHM_ERROR;
+            rc = MMPS_SHM_ERROR;
+            goto closeSegment;
+        }
     }
+    else
+    {
+        // Wait until the creator has set the size of the segment.
+        //
+        for (waited = 0; ; waited += 10)
+        {
+            if (fstat(sharedMemoryHandle, &sharedMemoryStatus) == -1)
+            {
+                ReportError("[MMPS] Cannot get shared memory size: errno=%d",
+                        errno);
 
-    bank->sharedMemoryHandle = sharedMemoryHandle;
+                rc = MMPS_SHM_ERROR;
+                goto closeSegment;
+            }
+
+            if ((sharedMemoryStatus.st_size != 0) ||
+                    (waited >= MMPS_SHM_ATTACH_TIMEOUT))
+                break;
+
+            usleep(10 * 1000);
+        }
+
+        if ((size_t) sharedMemoryStatus.st_size != sharedMemorySize)
+        {
+            ReportError("[MMPS] " \
+                    "Shared memory size %lu does not match bank %u (%lu)",
+                    (unsigned long) sharedMemoryStatus.st_size,
+                    bankId,
+                    (unsigned long) sharedMemorySize);
+
+            rc = MMPS_SHM_MISMATCH;
+            goto closeSegment;
+        }
+    }
 
 #ifndef MMPS_USE_64BIT_MMAP
-    bank->sharedMemoryAddress = mmap(
+    sharedBank = mmap(
             NULL,
             sharedMemorySize,
             PROT_READ | PROT_WRITE,
@@ -495,7 +1049,7 @@ MMPS_MapShMemBufferBank(
             sharedMemoryHandle,
             0);
 #else
-    bank->sharedMemoryAddress = mmap64(
+    sharedBank = mmap64(
             NULL,
             sharedMemorySize,
             PROT_READ | PROT_WRITE,
@@ -504,14 +1058,46 @@ MMPS_MapShMemBufferBank(
             0);
 #endif
 
-    if (bank->sharedMemoryAddress == MAP_FAILED)
+    if (sharedBank == MAP_FAILED)
     {
         ReportError("[MMPS] Cannot map buffer to shared memory: errno=%d",
                 errno);
 
-        return MMPS_CANNOT_MAP_TO_SHM;
+        rc = MMPS_CANNOT_MAP_TO_SHM;
+        goto closeSegment;
     }
 
+    if (creator == TRUE)
+    {
+        InitShMemBank(bank, sharedBank, headerSize);
+    }
+    else
+    {
+        for (waited = 0; ; waited += 10)
+        {
+            if ((__atomic_load_n(&sharedBank->ready, __ATOMIC_ACQUIRE) != 0) ||
+                    (waited >= MMPS_SHM_ATTACH_TIMEOUT))
+                break;
+
+            usleep(10 * 1000);
+        }
+
+        if ((sharedBank->ready == 0) ||
+                (sharedBank->magic != MMPS_SHM_MAGIC) ||
+                (sharedBank->bufferSize != bank->bufferSize) ||
+                (sharedBank->numberOfBuffers != bank->numberOfBuffers) ||
+                (sharedBank->dataOffset != headerSize))
+        {
+            ReportError("[MMPS] Shared memory does not match bank %u", bankId);
+
+            rc = MMPS_SHM_MISMATCH;
+            goto unmapSegment;
+        }
+    }
+
+    bank->sharedMemoryHandle = sharedMemoryHandle;
+    bank->sharedMemoryAddress = sharedBank;
+
     for (bufferId = 0; bufferId < bank->numberOfBuffers; bufferId++)
     {
         buffer = MMPS_BufferById(pool, bankId, bufferId);
@@ -520,75 +1106,102 @@ MMPS_MapShMemBufferBank(
         // therefore, no need for error check.
 
         rc = MMPS_MapShMemBuffer(buffer);
-        if (rc != 0)
-            break;
+        if (rc != MMPS_OK)
+            goto detachBuffers;
     }
 
-    return rc;
-}
+    // From now on peeks and pokes go to the queue of "free" buffers
+    // in the segment.
+    //
+    bank->sharedBank = sharedBank;
 
-/*
- * @brief   Map single data block to shared memory.
- *
- * Map data block of a single MMPS buffer descriptor to shared memory.
- *
- * @param   buffer      Pointer to MMPS buffer descriptor those data block
- *                      needs to be mapped to shared memory.
- *
- * @return  0 upon successful completion.
- * @return  Error code (negative value), if cannot map to shared memory.
- */
-int
-MMPS_MapShMemBuffer(struct MMPS_Buffer *buffer)
-{
-    struct MMPS_Bank    *bank;
-    unsigned long       offset;
+#ifdef MMPS_INIT_BANK
+    ReportDebug("[MMPS] Bank %u %s shared memory %s of %lu KB",
+            bankId,
+            (creator == TRUE) ? "created" : "attached to",
+            sharedMemoryName,
+            (unsigned long) sharedMemorySize >> 10);
+#endif
 
-    bank = buffer->bank;
+    return MMPS_OK;
 
-    if (buffer->data != NULL)
+detachBuffers:
+    while (bufferId > 0)
     {
-        ReportWarning("[MMPS] Buffer already mapped to shared memory");
+        bufferId--;
 
-        return MMPS_ALREADY_MAPPED_TO_SHM;
+        MMPS_UnmapShMemBuffer(MMPS_BufferById(pool, bankId, bufferId));
     }
 
-    offset = buffer->bufferId * buffer->bufferSize;
+    bank->sharedMemoryHandle = 0;
+    bank->sharedMemoryAddress = NULL;
 
-    buffer->data = bank->sharedMemoryAddress + offset;
-    buffer->cursor = buffer->data;
+unmapSegment:
+    munmap(sharedBank, sharedMemorySize);
 
-    return MMPS_OK;
+closeSegment:
+    close(sharedMemoryHandle);
+
+    // Segment that is not ready would only make others fail to attach.
+    //
+    if (creator == TRUE)
+        shm_unlink(sharedMemoryName);
+
+    return rc;
 }
 
 /*
- * @brief   Release single data block from shared memory.
+ * @brief   Release shared memory of a bank.
  *
- * Release data block of a single MMPS buffer descriptor from shared memory.
+ * Data blocks of all buffers of the specified bank are detached
+ * and the whole shared memory segment is unmapped at once. The bank
+ * must not be used afterwards.
  *
- * @param   buffer      Pointer to MMPS buffer descriptor those data block
- *                      needs to be unmapped from shared memory.
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   bankId      Bank id of a bank mapped with MMPS_MapShMemBufferBank().
  *
  * @return  0 upon successful completion.
  * @return  Error code (negative value), if cannot release shared memory mapping.
  */
 int
-MMPS_UnmapShMemBuffer(struct MMPS_Buffer *buffer)
+MMPS_UnmapShMemBufferBank(
+    struct MMPS_Pool    *pool,
+    unsigned int        bankId)
 {
-    int rc;
+    struct MMPS_Bank    *bank;
+    unsigned int        bufferId;
+    size_t              sharedMemorySize;
+    int                 rc;
 
-    if (buffer->data == NULL)
+    bank = pool->banks[bankId];
+
+    if (bank->sharedBank == NULL)
     {
         ReportWarning("[MMPS] " \
-                "Trying to unmap buffer from shared memory that was not mapped");
+                "Trying to unmap bank %u from shared memory that was not mapped",
+                bankId);
 
         return MMPS_NOT_MAPPED_TO_SHM;
     }
 
-    rc = munmap(buffer->data, buffer->bufferSize);
+    bank->sharedBank = NULL;
+
+    for (bufferId = 0; bufferId < bank->numberOfBuffers; bufferId++)
+        MMPS_UnmapShMemBuffer(MMPS_BufferById(pool, bankId, bufferId));
+
+    sharedMemorySize = ShMemHeaderSize(bank) +
+            (size_t) bank->numberOfBuffers * bank->bufferSize;
+
+    rc = munmap(bank->sharedMemoryAddress, sharedMemorySize);
+
+    close(bank->sharedMemoryHandle);
+
+    bank->sharedMemoryHandle = 0;
+    bank->sharedMemoryAddress = NULL;
+
     if (rc != 0)
     {
-        ReportError("[MMPS] Cannot unmap buffer from shared memory: errno=%d",
+        ReportError("[MMPS] Cannot unmap bank from shared memory: errno=%d",
                 errno);
 
         return MMPS_CANNOT_UNMAP_FROM_SHM;
@@ -597,1633 +1210,6519 @@ MMPS_UnmapShMemBuffer(struct MMPS_Buffer *buffer)
     return MMPS_OK;
 }
 
-#ifdef MMPS_DMA
-
 /*
- * @brief   Map data blocks to DMA.
+ * @brief   Map single data block to shared memory.
  *
- * Map data blocks of all buffer descriptor of the specified bank to DMA.
+ * Map data block of a single MMPS buffer descriptor to shared memory.
  *
- * @param   pool        Pointer to MMPS pool descriptor.
- * @param   bankId      Bank id.
- * @param   dmaCapabilities DMA capabilities bitmask as described by mmap().
- * @param   dmaFlags    DMA flags bitmask as described by mmap().
+ * @param   buffer      Pointer to MMPS buffer descriptor those data block
+ *                      needs to be mapped to shared memory.
  *
  * @return  0 upon successful completion.
- * @return  Error code (negative value), if cannot map to DMA.
+ * @return  Error code (negative value), if cannot map to shared memory.
  */
 int
-MMPS_DMAMapBufferBank(
-    struct MMPS_Pool    *pool,
-    unsigned int        bankId,
-    int                 dmaCapabilities,
-    int                 dmaFlags)
+MMPS_MapShMemBuffer(struct MMPS_Buffer *buffer)
 {
     struct MMPS_Bank    *bank;
-    struct MMPS_Buffer  *buffer;
-    unsigned int        bufferId;
-    int                 rc;
+    unsigned long       offset;
 
-    rc = MMPS_OK;
+    bank = buffer->bank;
 
-    bank = pool->banks[bankId];
-    for (bufferId = 0; bufferId < bank->numberOfBuffers; bufferId++)
+    if (buffer->data != NULL)
     {
-        buffer = MMPS_BufferById(pool, bankId, bufferId);
-        //
-        // Function MMPS_BufferById() delivers trusted value,
-        // therefore, no need for error check.
+        ReportWarning("[MMPS] Buffer already mapped to shared memory");
 
-        rc = MMPS_DMAMapBuffer(buffer, dmaCapabilities, dmaFlags);
-        if (rc != 0)
-            break;
+        return MMPS_ALREADY_MAPPED_TO_SHM;
     }
 
-    return rc;
+    offset = ((struct MMPS_ShMemBank *) bank->sharedMemoryAddress)->dataOffset +
+            (unsigned long) buffer->bufferId * buffer->bufferSize;
+
+    buffer->data = bank->sharedMemoryAddress + offset;
+    buffer->cursor = buffer->data;
+
+    return MMPS_OK;
 }
 
 /*
- * @brief   Map single data block to DMA.
+ * @brief   Release single data block from shared memory.
  *
- * Map data block of a single MMPS buffer descriptor to DMA.
+ * Detach data block of a single MMPS buffer descriptor from shared memory.
+ * The segment itself stays mapped until MMPS_UnmapShMemBufferBank().
  *
  * @param   buffer      Pointer to MMPS buffer descriptor those data block
- *                      needs to be mapped to DMA.
- * @param   dmaCapabilities DMA capabilities bitmask as described by mmap().
- * @param   dmaFlags    DMA flags bitmask as described by mmap().
+ *                      needs to be unmapped from shared memory.
  *
  * @return  0 upon successful completion.
- * @return  Error code (negative value), if cannot map to DMA.
+ * @return  Error code (negative value), if cannot release shared memory mapping.
  */
 int
-MMPS_DMAMapBuffer(
-    struct MMPS_Buffer  *buffer,
-    int                 dmaCapabilities,
-    int                 dmaFlags)
+MMPS_UnmapShMemBuffer(struct MMPS_Buffer *buffer)
 {
-    void *dmaAddress;
-
-    if (buffer->dmaAddress != NULL)
-    {
-        ReportWarning("[MMPS] Buffer already mapped to DMA");
-
-        return MMPS_ALREADY_MAPPED_TO_DMA;
-    }
-
-    dmaAddress = mmap(buffer->data,
-            buffer->bufferSize,
-            dmaCapabilities,
-            dmaFlags,
-            NOFD,
-            0);
-    if (dmaAddress == MAP_FAILED)
+    if (buffer->data == NULL)
     {
-        ReportError("[MMPS] Cannot map buffer to DMA: errno=%d",
-                errno);
+        ReportWarning("[MMPS] " \
+                "Trying to unmap buffer from shared memory that was not mapped");
 
-        return MMPS_CANNOT_MAP_TO_DMA;
+        return MMPS_NOT_MAPPED_TO_SHM;
     }
 
-    buffer->dmaAddress = dmaAddress;
+    // Data block is part of the mapping of the whole segment, which is
+    // released by MMPS_UnmapShMemBufferBank().
+    //
+    buffer->data = NULL;
+    buffer->cursor = NULL;
 
     return MMPS_OK;
 }
 
 /*
- * @brief   Release single data block from DMA.
+ * @brief   Hand a buffer over to another process.
  *
- * Release data block of a single MMPS buffer descriptor from DMA.
+ * Buffer id and data size are put to the specified channel of the shared
+ * memory segment of the bank and one receiver waiting on the channel
+ * is woken up. Local descriptor of the buffer is reset, it is used again
+ * when the buffer id comes back to this process through the queue
+ * of "free" buffers.
  *
- * @param   buffer      Pointer to MMPS buffer descriptor those data block
- *                      needs to be unmapped from DMA.
+ * @param   buffer      Pointer to MMPS buffer descriptor of a bank mapped
+ *                      to shared memory. Must not be part of a chain,
+ *                      touched or spliced.
+ * @param   channel     Channel id, less than MMPS_SHM_NUMBER_OF_CHANNELS.
  *
  * @return  0 upon successful completion.
- * @return  Error code (negative value), if cannot release DMA mapping.
+ * @return  Error code (negative value), in case of error.
  */
 int
-MMPS_DMAUnmapBuffer(struct MMPS_Buffer *buffer)
+MMPS_SendShMemBuffer(
+    struct MMPS_Buffer  *buffer,
+    unsigned int        channel)
 {
-    int rc;
+    struct MMPS_ShMemBank       *sharedBank;
+    struct MMPS_ShMemChannel    *sharedChannel;
+    struct MMPS_ShMemEntry      *entry;
 
-    if (buffer->dmaAddress == NULL)
+    sharedBank = buffer->bank->sharedBank;
+    if (sharedBank == NULL)
     {
-        ReportWarning("[MMPS] Trying to unmap buffer from DMA that was not mapped");
+        ReportWarning("[MMPS] Buffer is not mapped to shared memory");
 
-        return MMPS_NOT_MAPPED_TO_DMA;
+        return MMPS_NOT_IN_SHM;
     }
 
-    rc = munmap(buffer->dmaAddress, buffer->bufferSize);
-    if (rc != 0)
+    if (channel >= MMPS_SHM_NUMBER_OF_CHANNELS)
+        return MMPS_WRONG_CHANNEL;
+
+    if ((buffer->prev != NULL) ||
+            (buffer->next != NULL) ||
+            (buffer->touches != 1) ||
+            (buffer->origin != NULL) ||
+            (buffer->references != 0))
     {
-        ReportError("[MMPS] Cannot unmap buffer from DMA: errno=%d",
-                errno);
+        ReportWarning("[MMPS] " \
+                "Only single buffers may be handed over to another process");
 
-        return MMPS_CANNOT_UNMAP_FROM_DMA;
+        return MMPS_SHM_ERROR;
     }
 
-    // Reset DMA address, otherwise this buffer cannot be mapped to DMA again.
+    sharedChannel = &sharedBank->channels[channel];
+
+    LockShMem(&sharedChannel->lock);
+
+    // Channel has room for all buffers of a bank - it cannot overflow.
     //
-    buffer->dmaAddress = NULL;
+    entry = &ShMemEntries(sharedBank, sharedChannel)[sharedChannel->tail];
+
+    entry->bufferId = buffer->bufferId;
+    entry->dataSize = buffer->dataSize;
+
+    // Reset local descriptor as a poke would do, since the buffer may come
+    // back to this process through the queue of "free" buffers.
+    //
+#ifdef MMPS_USE_OWNER_ID
+    buffer->ownerId  = MMPS_NO_OWNER;
+#endif
+    buffer->dataSize = 0;
+    buffer->cursor   = buffer->data;
+
+    sharedChannel->tail++;
+    if (sharedChannel->tail == sharedBank->numberOfBuffers)
+        sharedChannel->tail = 0;
+
+    sharedChannel->numberOfEntries++;
+
+    pthread_cond_signal(&sharedChannel->condition);
+
+    pthread_mutex_unlock(&sharedChannel->lock);
 
     return MMPS_OK;
 }
 
-#endif // MMPS_DMA
-
 /*
- * @brief   Get buffer for specified MMPS pool and specified buffer bank.
+ * @brief   Take over a buffer handed by another process.
  *
  * @param   pool        Pointer to MMPS pool descriptor.
- * @param   bankId      Bank id.
- * @param   bufferId    Buffer id.
+ * @param   bankId      Bank id of a bank mapped to shared memory.
+ * @param   channel     Channel id, less than MMPS_SHM_NUMBER_OF_CHANNELS.
+ * @param   ownerId     Owner id or application id the buffer
+ *                      will be associated with.
+ * @param   timeout     Maximal time to wait in milliseconds, 0 not to wait
+ *                      at all or MMPS_WAIT_FOREVER.
  *
- * @return  Pointer to MMPS buffer descriptor.
+ * @return  Pointer to MMPS buffer descriptor, with cursor at the beginning
+ *          of data and data size set by the sender.
+ * @return  NULL if nothing was received within the timeout.
  */
 struct MMPS_Buffer *
-MMPS_BufferById(
+MMPS_ReceiveShMemBuffer(
     struct MMPS_Pool    *pool,
     unsigned int        bankId,
-    unsigned int        bufferId)
+    unsigned int        channel,
+    const unsigned int  ownerId,
+    unsigned int        timeout)
 {
-    struct MMPS_Bank    *bank;
-    void                *block;
-    unsigned int        blockId;
-    unsigned int        bufferIdInBlock;
-    struct MMPS_Buffer  *buffer;
+    struct MMPS_Bank            *bank;
+    struct MMPS_Buffer          *buffer;
+    struct MMPS_ShMemBank       *sharedBank;
+    struct MMPS_ShMemChannel    *sharedChannel;
+    struct MMPS_ShMemEntry      entry;
+    struct timespec             deadline;
+    int                         rc;
 
     bank = pool->banks[bankId];
 
-    blockId = bufferId / bank->buffersPerBlock;
-    bufferIdInBlock = bufferId % bank->buffersPerBlock;
-    block = bank->blocks[blockId];
+    sharedBank = bank->sharedBank;
+    if ((sharedBank == NULL) || (channel >= MMPS_SHM_NUMBER_OF_CHANNELS))
+    {
+        ReportWarning("[MMPS] Cannot receive from bank %u channel %u",
+                bankId,
+                channel);
 
-    buffer = (void *)
-        ((unsigned long) block +
-        (unsigned long) (bufferIdInBlock * sizeof(struct MMPS_Buffer)));
+        return NULL;
+    }
 
-#ifdef MMPS_PEEK_POKE
-    ReportDebug("[MMPS] " \
-            "... bufferId=%u bufferIdInBlock=%u block=0x%016lX " \
-            "buffer=0x%016lX data=0x%016lX",
-            bufferId,
-            bufferIdInBlock,
-            (unsigned long) block,
-            (unsigned long) buffer,
-            (unsigned long) buffer->data);
+    if ((timeout != 0) && (timeout != MMPS_WAIT_FOREVER))
+        DeadlineAfter(&deadline, timeout);
+
+    sharedChannel = &sharedBank->channels[channel];
+
+    LockShMem(&sharedChannel->lock);
+
+    while (sharedChannel->numberOfEntries == 0)
+    {
+        if (timeout == 0)
+            break;
+
+        if (timeout == MMPS_WAIT_FOREVER)
+        {
+            rc = pthread_cond_wait(&sharedChannel->condition,
+                    &sharedChannel->lock);
+        }
+        else
+        {
+            rc = pthread_cond_timedwait(&sharedChannel->condition,
+                    &sharedChannel->lock,
+                    &deadline);
+        }
+
+        if (rc == EOWNERDEAD)
+            pthread_mutex_consistent(&sharedChannel->lock);
+        else if (rc == ETIMEDOUT)
+            break;
+    }
+
+    if (sharedChannel->numberOfEntries == 0)
+    {
+        pthread_mutex_unlock(&sharedChannel->lock);
+
+        return NULL;
+    }
+
+    entry = ShMemEntries(sharedBank, sharedChannel)[sharedChannel->head];
+
+    sharedChannel->head++;
+    if (sharedChannel->head == sharedBank->numberOfBuffers)
+        sharedChannel->head = 0;
+
+    sharedChannel->numberOfEntries--;
+
+    pthread_mutex_unlock(&sharedChannel->lock);
+
+    buffer = BufferOfBank(bank, entry.bufferId);
+
+#ifdef MMPS_USE_OWNER_ID
+    buffer->ownerId = ownerId;
 #endif
 
+    buffer->prev     = NULL;
+    buffer->next     = NULL;
+    buffer->touches  = 1;
+    buffer->dataSize = entry.dataSize;
+    buffer->cursor   = buffer->data;
+
     return buffer;
 }
 
+#ifdef MMPS_IO_URING
+
 /*
- * @brief   Peek buffer from the first bank of the MMPS pool.
+ * @brief   Lend buffers of the specified bank to the kernel as an io_uring
+ *          provided buffer ring.
  *
  * @param   pool        Pointer to MMPS pool descriptor.
- * @param   ownerId     Owner id or application id the buffer
- *                      will be associated with.
- *                      This value will be stored in buffer descriptor.
- *
- * @return  Pointer to MMPS buffer descriptor upon successful completion.
- * @return  NULL if there are no free buffers available in a specified pool.
+ * @param   bankId      Bank id to peek buffers from.
+ * @param   ringFd      File descriptor of io_uring instance.
+ * @param   groupId     Buffer group id to register the ring with.
+ * @param   numberOfEntries Number of entries, a power of two not larger
+ *                      than MMPS_MAX_RING_ENTRIES.
+ * @param   ownerId     Owner id the buffers will be associated with.
+ * @param   ring        Where to store the pointer to buffer ring descriptor.
+ *
+ * @return  MMPS_OK upon successful completion.
+ * @return  Error code (negative value), if the ring cannot be created.
  */
-inline struct MMPS_Buffer *
-MMPS_PeekBuffer(
-    struct MMPS_Pool    *pool,
-    const unsigned int  ownerId)
+int
+MMPS_InitBufferRing(
+    struct MMPS_Pool        *pool,
+    unsigned int            bankId,
+    int                     ringFd,
+    unsigned int            groupId,
+    unsigned int            numberOfEntries,
+    const unsigned int      ownerId,
+    struct MMPS_BufferRing  **ring)
 {
-    return MMPS_PeekBufferFromBank(pool, 0, ownerId);
-}
+    struct MMPS_Bank        *bank;
+    struct MMPS_BufferRing  *newRing;
+    struct io_uring_buf_reg registration;
+    unsigned int            ringBufferId;
+    int                     rc;
 
-/*
- * @brief   Peek a buffer of preferred size from of the specified MMPS pool.
- *
- * MMPS will go through all banks until unused buffer is found.
- * If no buffer of a preferred size can be found,
- * a smaller buffer can be returned.
- *
- * @param   pool:       Pointer to MMPS pool descriptor.
- * @param   preferredSize Preferred/minimum size of requested buffer.
- * @param   ownerId:    Owner id or application id the buffer
- *                      will be associated with.
- *                      This value will be stored in buffer descriptor.
- *
- * @return  Pointer to MMPS buffer descriptor upon successful completion.
- * @return  NULL if there are no free buffers available in a specified pool.
- */
-struct MMPS_Buffer *
-MMPS_PeekBufferOfSize(
-    struct MMPS_Pool    *pool,
-    unsigned int        preferredSize,
-    const unsigned int  ownerId)
-{
-    struct MMPS_Bank    *bank;
-    struct MMPS_Buffer  *buffer;
-    unsigned int        bankId;
-
-#ifdef MMPS_PEEK_POKE
-#ifdef MMPS_USE_OWNER_ID
-    ReportDebug("[MMPS] Peek buffer of size %u for 0x%08X", preferredSize, ownerId);
-#else
-    ReportDebug("[MMPS] Peek buffer of size %u", preferredSize);
-#endif
-#endif
+    if ((bankId + 1) > pool->numberOfBanks)
+        return MMPS_WRONG_BANK_ID;
 
-    buffer = NULL;
+    bank = pool->banks[bankId];
+    if (bank == NULL)
+        return MMPS_WRONG_BANK_ID;
 
-    // Go through all banks, assuming banks are ordered by buffer size.
+    // Data of buffers of 'allocate on demand' banks does not exist
+    // before peek, such buffers would have to be lent one by one.
     //
-    for (bankId = 0; bankId < pool->numberOfBanks; bankId++)
+    if (bank->allocateOnDemand == TRUE)
     {
-        bank = pool->banks[bankId];
-
-        // If buffer size of this bank fits to request ...
-        //
-        if (bank->bufferSize >= preferredSize)
-        {
-            // ... then try to get a buffer from this bank.
-            //
-            buffer = MMPS_PeekBufferFromBank(pool, bankId, ownerId);
-            if (buffer != NULL)
-                break;
+        ReportError("[MMPS] Cannot lend buffers of bank %u allocated on demand",
+                bankId);
 
-            // If there are no free buffers in this bank,
-            // then go long with further banks.
-        }
+        return MMPS_RING_ERROR;
     }
 
-    // If no buffer is being found in the banks of preferred size,
-    // then try to get at least any buffer.
-    //
-    if (buffer == NULL)
+    if ((numberOfEntries == 0) ||
+            (numberOfEntries > MMPS_MAX_RING_ENTRIES) ||
+            ((numberOfEntries & (numberOfEntries - 1)) != 0))
     {
-        // Go through all banks.
-        //
-        for (bankId = 0; bankId < pool->numberOfBanks; bankId++)
-        {
-            bank = pool->banks[bankId];
+        ReportError("[MMPS] Wrong number of entries for buffer ring: %u",
+                numberOfEntries);
 
-            // Try to get a buffer.
-            //
-            buffer = MMPS_PeekBufferFromBank(pool, bankId, ownerId);
-            if (buffer != NULL)
-                break;
-        }
+        return MMPS_RING_ERROR;
     }
 
-    if (buffer == NULL)
+    newRing = malloc(sizeof(struct MMPS_BufferRing) +
+            numberOfEntries * sizeof(struct MMPS_Buffer *));
+    if (newRing == NULL)
+        return MMPS_OUT_OF_MEMORY;
+
+    newRing->missingIds = malloc(numberOfEntries * sizeof(unsigned short));
+    if (newRing->missingIds == NULL)
     {
-        ReportWarning("[MMPS] " \
-                "No free buffer available " \
-                "(requested preferred size %u for 0x%08X)",
-                preferredSize,
-                ownerId);
+        free(newRing);
 
-        return NULL;
+        return MMPS_OUT_OF_MEMORY;
     }
 
-    // For buffers of the bank with the 'alloc on demand' flag set on,
-    // allocate memory resources for data each time when the buffer is peeked.
+    // Ring shared with the kernel has to be page aligned, anonymous
+    // mapping delivers it zeroed, so its tail starts at 0.
     //
-    if (bank->allocateOnDemand == TRUE)
+    newRing->entriesSize = numberOfEntries * sizeof(struct io_uring_buf);
+    newRing->entries = mmap(NULL,
+            newRing->entriesSize,
+            PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS,
+            -1,
+            0);
+    if (newRing->entries == MAP_FAILED)
     {
-        buffer->data = malloc(buffer->bufferSize);
-        if (buffer->data == NULL)
-        {
-            MMPS_PokeBuffer(buffer);
+        ReportError("[MMPS] Cannot map memory for buffer ring: errno=%d",
+                errno);
 
-            ReportSoftAlert("[MMPS] Out of memory");
+        free(newRing->missingIds);
+        free(newRing);
 
-            return NULL;
-        }
+        return MMPS_OUT_OF_MEMORY;
+    }
 
-        buffer->cursor = buffer->data;
+    newRing->pool               = pool;
+    newRing->bankId             = bankId;
+    newRing->ownerId            = ownerId;
+    newRing->ringFd             = ringFd;
+    newRing->groupId            = groupId;
+    newRing->numberOfEntries    = numberOfEntries;
+    newRing->tail               = 0;
+    newRing->numberOfMissingIds = 0;
+
+    pthread_spin_init(&newRing->lock, PTHREAD_PROCESS_PRIVATE);
+
+    memset(&registration, 0, sizeof(registration));
+    registration.ring_addr      = (unsigned long) newRing->entries;
+    registration.ring_entries   = numberOfEntries;
+    registration.bgid           = groupId;
+
+    rc = syscall(__NR_io_uring_register,
+            ringFd,
+            IORING_REGISTER_PBUF_RING,
+            &registration,
+            1);
+    if (rc != 0)
+    {
+        ReportError("[MMPS] Cannot register buffer ring of bank %u: errno=%d",
+                bankId,
+                errno);
+
+        pthread_spin_destroy(&newRing->lock);
+        munmap(newRing->entries, newRing->entriesSize);
+        free(newRing->missingIds);
+        free(newRing);
+
+        return MMPS_CANNOT_REGISTER_RING;
     }
 
-    return buffer;
+    // Fill the ring. Slots for which the bank has no buffer yet
+    // stay empty until the ring is replenished.
+    //
+    for (ringBufferId = 0; ringBufferId < numberOfEntries; ringBufferId++)
+    {
+        newRing->buffers[ringBufferId] = NULL;
+        newRing->missingIds[newRing->numberOfMissingIds++] =
+                numberOfEntries - 1 - ringBufferId;
+    }
+
+    RefillBufferRing(newRing);
+
+    *ring = newRing;
+
+    return MMPS_OK;
 }
 
 /*
- * @brief   Peek an unused buffer from the specified MMPS bank.
+ * @brief   Take the buffer the kernel has filled out of the buffer ring.
  *
- * @param   pool        Pointer to MMPS pool descriptor.
- * @param   bankId      Bank id to search for unused buffer.
- * @param   ownerId     Owner id or application id the buffer
- *                      will be associated with.
- *                      This value will be stored in buffer descriptor.
+ * @param   ring        Pointer to MMPS buffer ring descriptor.
+ * @param   flags       Flags of io_uring completion.
+ * @param   result      Result of io_uring completion (number of bytes
+ *                      received).
  *
  * @return  Pointer to MMPS buffer descriptor upon successful completion.
- * @return  NULL if there are no free buffers available in a specified bank.
+ * @return  NULL if the completion does not carry a buffer.
  */
 struct MMPS_Buffer *
-MMPS_PeekBufferFromBank(
-    struct MMPS_Pool    *pool,
-    unsigned int        bankId,
-    const unsigned int  ownerId)
+MMPS_TakeFromBufferRing(
+    struct MMPS_BufferRing  *ring,
+    unsigned int            flags,
+    int                     result)
 {
-    struct MMPS_Bank    *bank;
-    struct MMPS_Buffer  *buffer;
-    unsigned int        bufferId;
-
-#ifdef MMPS_PEEK_POKE
-#ifdef MMPS_USE_OWNER_ID
-    ReportDebug("[MMPS] Peek buffer from bank %u for 0x%08X", bankId, ownerId);
-#else
-    ReportDebug("[MMPS] Peek buffer from bank %u", bankId);
-#endif
-#endif
-
-    bank = pool->banks[bankId];
+    struct MMPS_Buffer      *buffer;
+    unsigned int            ringBufferId;
 
-#ifdef MMPS_MUTEX
-    pthread_mutex_lock(&bank->mutex.lock);
-#else
-    pthread_spin_lock(&bank->lock);
-#endif
-
-    bufferId = bank->ids[bank->cursor.peek];
-
-#ifdef MMPS_PEEK_POKE
-    ReportDebug("[MMPS] ... bank->peekCursor=%u bank->pokeCursor=%u bufferId=%u",
-            bank->cursor.peek,
-            bank->cursor.poke,
-            bufferId);
-#endif
-
-    if (bufferId == NOTHING) {
-        //
-        // All buffers are in use (peek cursor has reached the poke cursor
-        // and there are no buffers behind the poke cursor in the buffer bank).
-        //
-        buffer = NULL;
-    } else {
-        buffer = MMPS_BufferById(pool, bankId, bufferId);
+    if ((flags & IORING_CQE_F_BUFFER) == 0)
+        return NULL;
 
-#ifdef MMPS_USE_OWNER_ID
-        if (buffer->ownerId != MMPS_NO_OWNER)
-        {
-#ifdef MMPS_MUTEX
-            pthread_mutex_unlock(&bank->mutex.lock);
-#else
-            pthread_spin_unlock(&bank->lock);
-#endif
+    ringBufferId = flags >> IORING_CQE_BUFFER_SHIFT;
+    if (ringBufferId >= ring->numberOfEntries)
+    {
+        ReportError("[MMPS] Completion carries unknown buffer id %u",
+                ringBufferId);
 
-            ReportError("[MMPS] Got buffer that already belongs to 0x%08X",
-                    ownerId);
+        return NULL;
+    }
 
-            return NULL;
-        }
+    pthread_spin_lock(&ring->lock);
 
-        buffer->ownerId = ownerId;
-#endif
+    buffer = ring->buffers[ringBufferId];
 
-        bank->ids[bank->cursor.peek] = NOTHING;
+    ring->buffers[ringBufferId] = NULL;
+    ring->missingIds[ring->numberOfMissingIds++] = ringBufferId;
 
-        bank->cursor.peek++;
-        if (bank->cursor.peek == bank->numberOfBuffers)
-            bank->cursor.peek = 0;
-    }
+    RefillBufferRing(ring);
 
-#ifdef MMPS_MUTEX
-    pthread_mutex_unlock(&bank->mutex.lock);
-#else
-    pthread_spin_unlock(&bank->lock);
-#endif
+    pthread_spin_unlock(&ring->lock);
 
     if (buffer == NULL)
     {
-        ReportWarning("[MMPS] " \
-                "No free buffer available (requested bank %u for 0x%08X)",
-                bankId,
-                ownerId);
+        ReportError("[MMPS] Completion carries empty buffer id %u",
+                ringBufferId);
 
         return NULL;
     }
 
-    // For buffers of the bank with the 'alloc on demand' flag set on,
-    // allocate memory resources for data each time when the buffer is peeked.
-    //
-    if (bank->allocateOnDemand == TRUE)
-    {
-        buffer->data = malloc(buffer->bufferSize);
-        if (buffer->data == NULL)
-        {
-            MMPS_PokeBuffer(buffer);
-
-            ReportSoftAlert("[MMPS] Out of memory");
-
-            return NULL;
-        }
-
-        buffer->cursor = buffer->data;
-    }
+    buffer->dataSize = (result > 0) ? result : 0;
+    buffer->cursor = buffer->data;
 
     return buffer;
 }
 
 /*
- * @brief   Poke buffer or buffer chain back to MMPS pool.
+ * @brief   Refill slots of the buffer ring that were left empty.
  *
- * In case of chain of buffers, the chain will be disassembled and each buffer
- * will be put back to a corresponding bank.
+ * @param   ring        Pointer to MMPS buffer ring descriptor.
  *
- * @param   buffer      Pointer to a buffer descriptor or a chain
- *                      of buffer descriptors to be put back to MMPS pool.
+ * @return  Number of slots that are still empty.
  */
-void
-MMPS_PokeBuffer(struct MMPS_Buffer *buffer)
+unsigned int
+MMPS_ReplenishBufferRing(struct MMPS_BufferRing *ring)
 {
-    struct MMPS_Bank    *bank;
-    struct MMPS_Buffer  *thisBuffer;
-    struct MMPS_Buffer  *nextBuffer;
-
-    thisBuffer = buffer;
-    do {
-        bank = thisBuffer->bank;
-
-#ifdef MMPS_PEEK_POKE
-#ifdef MMPS_USE_OWNER_ID
-        ReportDebug("[MMPS] Poke buffer %u to bank %u for 0x%08X",
-                thisBuffer->bufferId, bank->bankId, thisBuffer->ownerId);
-#else
-        ReportDebug("[MMPS] Poke buffer %u to bank %u",
-                thisBuffer->bufferId, bank->bankId);
-#endif
-#endif
-
-#ifdef MMPS_USE_OWNER_ID
-        if (thisBuffer->ownerId == MMPS_NO_OWNER)
-        {
-            ReportError("[MMPS] " \
-                    "Trying to poke buffer %u to bank %u that was not peeked",
-                    thisBuffer->bufferId,
-                    thisBuffer->bank->bankId);
-
-            break;
-        }
-#endif
-
-        nextBuffer = thisBuffer->next;
-
-        if ((nextBuffer != NULL) && (nextBuffer->prev != thisBuffer))
-        {
-            ReportError("[MMPS] " \
-                    "Detected broken buffer chain for buffers %u and %u",
-                    thisBuffer->bufferId,
-                    nextBuffer->bufferId);
-
-            nextBuffer = NULL;
-        }
-
-        // For buffers of the bank with the 'alloc on demand' flag set on,
-        // release memory resources used for data.
-        //
-        if (bank->allocateOnDemand == TRUE)
-        {
-            free(thisBuffer->data);
-            thisBuffer->data = NULL;
-            thisBuffer->cursor = NULL;
-        }
-
-        thisBuffer->prev = NULL;
-        thisBuffer->next = NULL;
-        thisBuffer->dataSize = 0;
-        thisBuffer->cursor = thisBuffer->data;
-#ifdef MMPS_USE_OWNER_ID
-        thisBuffer->ownerId = MMPS_NO_OWNER;
-#endif
-
-#ifdef MMPS_MUTEX
-        pthread_mutex_lock(&bank->mutex.lock);
-#else
-        pthread_spin_lock(&bank->lock);
-#endif
+    unsigned int numberOfMissingIds;
 
-        bank->ids[bank->cursor.poke] = thisBuffer->bufferId;
+    pthread_spin_lock(&ring->lock);
 
-        bank->cursor.poke++;
-        if (bank->cursor.poke == bank->numberOfBuffers)
-            bank->cursor.poke = 0;
+    RefillBufferRing(ring);
 
-#ifdef MMPS_MUTEX
-        pthread_mutex_unlock(&bank->mutex.lock);
-#else
-        pthread_spin_unlock(&bank->lock);
-#endif
+    numberOfMissingIds = ring->numberOfMissingIds;
 
-        thisBuffer = nextBuffer;
+    pthread_spin_unlock(&ring->lock);
 
-#ifdef MMPS_PEEK_POKE
-        if (thisBuffer != NULL)
-        {
-            ReportDebug("[MMPS] ... next buffer %u",
-                    thisBuffer->bufferId);
-        }
-#endif
-    } while (thisBuffer != NULL);
+    return numberOfMissingIds;
 }
 
 /*
- * @brief   Increment the number of touches of MMPS buffer.
+ * @brief   Unregister the buffer ring and give all its buffers back
+ *          to their bank.
  *
- * As long the number of touches is more than zero the MMPS buffer
- * could be poked back to the pool.
+ * @param   ring        Pointer to MMPS buffer ring descriptor.
  *
- * @param   buffer      Pointer to a buffer descriptor or a chain
- *                      of buffer descriptors to be touched.
+ * @return  MMPS_OK upon successful completion.
+ * @return  MMPS_CANNOT_REGISTER_RING if the kernel refused to unregister
+ *          the ring.
  */
-void
-MMPS_TouchBuffer(struct MMPS_Buffer *buffer)
+int
+MMPS_ReleaseBufferRing(struct MMPS_BufferRing *ring)
 {
-#ifdef LINUX
-
-#ifdef MMPS_MUTEX
-    pthread_mutex_lock(&buffer->bank->mutex.lock);
-#else
-    pthread_spin_lock(&buffer->bank->lock);
-#endif
+    struct io_uring_buf_reg registration;
+    unsigned int            ringBufferId;
+    int                     rc;
+
+    memset(&registration, 0, sizeof(registration));
+    registration.bgid = ring->groupId;
+
+    rc = syscall(__NR_io_uring_register,
+            ring->ringFd,
+            IORING_UNREGISTER_PBUF_RING,
+            &registration,
+            1);
+    if (rc != 0)
+    {
+        ReportError("[MMPS] Cannot unregister buffer ring of bank %u: errno=%d",
+                ring->bankId,
+                errno);
 
-    buffer->touches++;
+        return MMPS_CANNOT_REGISTER_RING;
+    }
 
-#ifdef MMPS_MUTEX
-    pthread_mutex_unlock(&buffer->bank->mutex.lock);
-#else
-    pthread_spin_unlock(&buffer->bank->lock);
-#endif
+    for (ringBufferId = 0; ringBufferId < ring->numberOfEntries; ringBufferId++)
+    {
+        if (ring->buffers[ringBufferId] != NULL)
+            MMPS_PokeBuffer(ring->buffers[ringBufferId]);
+    }
 
-#else // LINUX
+    pthread_spin_destroy(&ring->lock);
+    munmap(ring->entries, ring->entriesSize);
+    free(ring->missingIds);
+    free(ring);
 
-    atomic_add(&buffer->touches, 1);
-
-#endif // LINUX
+    return MMPS_OK;
 }
 
+#endif // MMPS_IO_URING
+
+#ifdef MMPS_DMA
+
 /*
- * @brief   Decrement the number of touches of MMPS buffer.
+ * @brief   Map data blocks to DMA.
+ *
+ * Map data blocks of all buffer descriptor of the specified bank to DMA.
  *
- * MMPS buffer could be poked back to the pool only when the number of touches
- * is equal zero. When last member absolves the MMPS buffer it is automatically
- * poked back to the pool - in such case there is no need to call
- * MMPS_PokeBuffer().
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   bankId      Bank id.
+ * @param   dmaCapabilities DMA capabilities bitmask as described by mmap().
+ * @param   dmaFlags    DMA flags bitmask as described by mmap().
  *
- * @param   buffer      Pointer to a buffer descriptor or a chain
- *                      of buffer descriptors to be absolved.
+ * @return  0 upon successful completion.
+ * @return  Error code (negative value), if cannot map to DMA.
  */
-void
-MMPS_AbsolveBuffer(struct MMPS_Buffer *buffer)
+int
+MMPS_DMAMapBufferBank(
+    struct MMPS_Pool    *pool,
+    unsigned int        bankId,
+    int                 dmaCapabilities,
+    int                 dmaFlags)
 {
-#ifdef LINUX
-
-#ifdef MMPS_MUTEX
-    pthread_mutex_lock(&buffer->bank->mutex.lock);
-#else
-    pthread_spin_lock(&buffer->bank->lock);
-#endif
-
-    buffer->touches--;
+    struct MMPS_Bank    *bank;
+    struct MMPS_Buffer  *buffer;
+    unsigned int        bufferId;
+    int                 rc;
 
-#ifdef MMPS_MUTEX
-    pthread_mutex_unlock(&buffer->bank->mutex.lock);
-#else
-    pthread_spin_unlock(&buffer->bank->lock);
-#endif
+    rc = MMPS_OK;
 
-    if (buffer->touches == 0)
+    bank = pool->banks[bankId];
+    for (bufferId = 0; bufferId < bank->numberOfBuffers; bufferId++)
     {
-        MMPS_PokeBuffer(buffer);
-    }
-
-#else // LINUX
+        buffer = MMPS_BufferById(pool, bankId, bufferId);
+        //
+        // Function MMPS_BufferById() delivers trusted value,
+        // therefore, no need for error check.
 
-    // Poke the buffer if that was the last touch.
-    //
-    if (atomic_sub_value(&buffer->touches, 1) == 1)
-    {
-        MMPS_PokeBuffer(buffer);
+        rc = MMPS_DMAMapBuffer(buffer, dmaCapabilities, dmaFlags);
+        if (rc != 0)
+            break;
     }
 
-#endif // LINUX
+    return rc;
 }
 
 /*
- * @brief   Get buffer from a chain, which precedes the referencing buffer.
+ * @brief   Map single data block to DMA.
  *
- * @param   buffer      Pointer to the referencing MMPS buffer descriptor.
+ * Map data block of a single MMPS buffer descriptor to DMA.
  *
- * @return  Pointer to MMPS buffer descriptor of the preceding buffer in a chain.
- * @return  NULL if referencing buffer is the first buffer in a chain.
+ * @param   buffer      Pointer to MMPS buffer descriptor those data block
+ *                      needs to be mapped to DMA.
+ * @param   dmaCapabilities DMA capabilities bitmask as described by mmap().
+ * @param   dmaFlags    DMA flags bitmask as described by mmap().
+ *
+ * @return  0 upon successful completion.
+ * @return  Error code (negative value), if cannot map to DMA.
  */
-inline struct MMPS_Buffer *
-MMPS_PreviousBuffer(struct MMPS_Buffer *buffer)
+int
+MMPS_DMAMapBuffer(
+    struct MMPS_Buffer  *buffer,
+    int                 dmaCapabilities,
+    int                 dmaFlags)
 {
-    return buffer->prev;
+    void *dmaAddress;
+
+    if (buffer->dmaAddress != NULL)
+    {
+        ReportWarning("[MMPS] Buffer already mapped to DMA");
+
+        return MMPS_ALREADY_MAPPED_TO_DMA;
+    }
+
+    dmaAddress = mmap(buffer->data,
+            buffer->bufferSize,
+            dmaCapabilities,
+            dmaFlags,
+            NOFD,
+            0);
+    if (dmaAddress == MAP_FAILED)
+    {
+        ReportError("[MMPS] Cannot map buffer to DMA: errno=%d",
+                errno);
+
+        return MMPS_CANNOT_MAP_TO_DMA;
+    }
+
+    buffer->dmaAddress = dmaAddress;
+
+    return MMPS_OK;
 }
 
 /*
- * @brief   Get buffer from a chain, which succeeds the referencing buffer.
+ * @brief   Release single data block from DMA.
  *
- * @param   buffer      Pointer to the referencing MMPS buffer descriptor.
+ * Release data block of a single MMPS buffer descriptor from DMA.
  *
- * @return  Pointer to MMPS buffer descriptor of the succeeding buffer in a chain.
- * @return  NULL if referencing buffer is the last buffer in a chain.
+ * @param   buffer      Pointer to MMPS buffer descriptor those data block
+ *                      needs to be unmapped from DMA.
+ *
+ * @return  0 upon successful completion.
+ * @return  Error code (negative value), if cannot release DMA mapping.
  */
-inline struct MMPS_Buffer *
-MMPS_NextBuffer(struct MMPS_Buffer *buffer)
+int
+MMPS_DMAUnmapBuffer(struct MMPS_Buffer *buffer)
 {
-    return buffer->next;
+    int rc;
+
+    if (buffer->dmaAddress == NULL)
+    {
+        ReportWarning("[MMPS] Trying to unmap buffer from DMA that was not mapped");
+
+        return MMPS_NOT_MAPPED_TO_DMA;
+    }
+
+    rc = munmap(buffer->dmaAddress, buffer->bufferSize);
+    if (rc != 0)
+    {
+        ReportError("[MMPS] Cannot unmap buffer from DMA: errno=%d",
+                errno);
+
+        return MMPS_CANNOT_UNMAP_FROM_DMA;
+    }
+
+    // Reset DMA address, otherwise this buffer cannot be mapped to DMA again.
+    //
+    buffer->dmaAddress = NULL;
+
+    return MMPS_OK;
 }
 
+#endif // MMPS_DMA
+
 /*
- * @brief   Get first buffer of a chain.
+ * @brief   Get buffer for specified MMPS pool and specified buffer bank.
  *
- * @param   chain       Pointer to the referencing MMPS buffer descriptor.
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   bankId      Bank id.
+ * @param   bufferId    Buffer id.
  *
- * @return  Pointer to MMPS buffer descriptor of the first buffer in a chain.
+ * @return  Pointer to MMPS buffer descriptor.
  */
-inline struct MMPS_Buffer *
-MMPS_FirstBuffer(struct MMPS_Buffer *chain)
+struct MMPS_Buffer *
+MMPS_BufferById(
+    struct MMPS_Pool    *pool,
+    unsigned int        bankId,
+    unsigned int        bufferId)
 {
-    struct MMPS_Buffer *firstBuffer;
+    struct MMPS_Bank    *bank;
+    unsigned int        node;
 
-    firstBuffer = chain;
+    bank = pool->banks[bankId];
 
-    while (firstBuffer->prev != NULL)
-        firstBuffer = firstBuffer->prev;
+    // Buffer ids of a bank spread over NUMA nodes go on from one sub-bank
+    // to the next.
+    //
+    for (node = 0; node + 1 < bank->numa.numberOfNodes; node++)
+    {
+        if (bufferId < NodeBank(bank, node)->numberOfBuffers)
+            break;
 
-    return firstBuffer;
+        bufferId -= NodeBank(bank, node)->numberOfBuffers;
+    }
+
+    return BufferOfBank(NodeBank(bank, node), bufferId);
 }
 
 /*
- * @brief   Get last buffer of a chain.
+ * @brief   Peek buffer from the first bank of the MMPS pool.
  *
- * @param   chain       Pointer to the referencing MMPS buffer descriptor.
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   ownerId     Owner id or application id the buffer
+ *                      will be associated with.
+ *                      This value will be stored in buffer descriptor.
  *
- * @return  Pointer to MMPS buffer descriptor of the last buffer in a chain.
+ * @return  Pointer to MMPS buffer descriptor upon successful completion.
+ * @return  NULL if there are no free buffers available in a specified pool.
  */
 inline struct MMPS_Buffer *
-MMPS_LastBuffer(struct MMPS_Buffer *chain)
+MMPS_PeekBuffer(
+    struct MMPS_Pool    *pool,
+    const unsigned int  ownerId)
 {
-    struct MMPS_Buffer *lastBuffer;
-
-    lastBuffer = chain;
-
-    while (lastBuffer->next != NULL)
-        lastBuffer = lastBuffer->next;
-
-    return lastBuffer;
+    return MMPS_PeekBufferFromBank(pool, 0, ownerId);
 }
 
 /*
- * @brief   Extend a chain with one more buffer.
+ * @brief   Peek a buffer of preferred size from of the specified MMPS pool.
  *
- * Peek one more buffer from the MMPS pool and append it at the end
- * of a specified chain of buffers. MMPS will try to peek a buffer
- * from the same bank, the referencing buffer belongs to.
- * If there no buffers available in that bank,
- * MMPS will search through all other banks for a free buffer.
+ * The bank of the smallest buffers that fit the preferred size is looked up
+ * in the size class table of the pool. What happens if that bank
+ * is exhausted depends on exhaustion policy of the pool.
  *
- * @param   buffer      Buffer to append a new buffer to.
+ * @param   pool:       Pointer to MMPS pool descriptor.
+ * @param   preferredSize Preferred/minimum size of requested buffer.
+ * @param   ownerId:    Owner id or application id the buffer
+ *                      will be associated with.
+ *                      This value will be stored in buffer descriptor.
  *
- * @return  Pointer to MMPS buffer descriptor of the attached buffer.
- *          If referenced buffer did already have a succeeding buffer (chain),
- *          then the pointer to MMPS buffer descriptor of the succeeding buffer
- *          will be returned.
- * @return  NULL if MMPS was not able to find any free buffer in a pool.
+ * @return  Pointer to MMPS buffer descriptor upon successful completion.
+ *          It may be the first buffer of a chain if no single buffer
+ *          can hold the preferred size (see MMPS_EXHAUSTION_*).
+ * @return  NULL if there are no free buffers available in a specified pool.
  */
 struct MMPS_Buffer *
-MMPS_ExtendBuffer(struct MMPS_Buffer *origBuffer)
+MMPS_PeekBufferOfSize(
+    struct MMPS_Pool    *pool,
+    unsigned int        preferredSize,
+    const unsigned int  ownerId)
 {
-    struct MMPS_Buffer *nextBuffer;
+    return MMPS_PeekBufferOfSizeWithPolicy(
+            pool,
+            preferredSize,
+            pool->exhaustionPolicy,
+            ownerId);
+}
 
-    nextBuffer = MMPS_PeekBufferFromBank(
-            origBuffer->bank->pool,
-            origBuffer->bank->bankId,
-#ifdef MMPS_USE_OWNER_ID
-            origBuffer->ownerId
-#else
-            MMPS_NO_OWNER
-#endif
-    );
+/*
+ * @brief   Peek a buffer of preferred size with explicit exhaustion policy.
+ *
+ * @param   pool:       Pointer to MMPS pool descriptor.
+ * @param   preferredSize Preferred/minimum size of requested buffer.
+ * @param   policy      One of MMPS_EXHAUSTION_*.
+ * @param   ownerId:    Owner id or application id the buffer
+ *                      will be associated with.
+ *                      This value will be stored in buffer descriptor.
+ *
+ * @return  Pointer to MMPS buffer descriptor upon successful completion.
+ *          It may be the first buffer of a chain if no single buffer
+ *          can hold the preferred size (see MMPS_EXHAUSTION_*).
+ * @return  NULL if there are no free buffers available in a specified pool
+ *          or, with MMPS_EXHAUSTION_FAIL, if no bank has buffers large enough.
+ */
+struct MMPS_Buffer *
+MMPS_PeekBufferOfSizeWithPolicy(
+    struct MMPS_Pool    *pool,
+    unsigned int        preferredSize,
+    unsigned int        policy,
+    const unsigned int  ownerId)
+{
+    struct MMPS_Buffer  *buffer;
+    unsigned int        numberOfBanks;
+    unsigned int        position;
 
-    if (nextBuffer == NULL)
-    {
-        nextBuffer = MMPS_PeekBufferOfSize(
-                origBuffer->bank->pool,
-                origBuffer->bufferSize,
+#ifdef MMPS_PEEK_POKE
 #ifdef MMPS_USE_OWNER_ID
-                origBuffer->ownerId
+    ReportDebug("[MMPS] Peek buffer of size %u for 0x%08X", preferredSize, ownerId);
 #else
-                MMPS_NO_OWNER
+    ReportDebug("[MMPS] Peek buffer of size %u", preferredSize);
+#endif
 #endif
-        );
-    }
+
+    buffer = NULL;
+
+    numberOfBanks = pool->sizeClasses.numberOfBanks;
+
+    // Find the bank of the smallest buffers that fit the request.
+    //
+    position = PositionOfSize(pool, preferredSize);
+
+    if (position < numberOfBanks)
+    {
+        buffer = PeekBufferFromBank(
+                pool,
+                pool->sizeClasses.bankIds[position],
+                ownerId);
+    }
+
+    if (buffer == NULL)
+    {
+        switch (policy)
+        {
+        case MMPS_EXHAUSTION_LARGER:
+            // No bank has buffers large enough - the largest buffers
+            // can only hold the requested size together.
+            //
+            if (position == numberOfBanks)
+            {
+                buffer = PeekChainOfSize(pool, position, preferredSize, ownerId);
+                break;
+            }
+
+            for (position++; position < numberOfBanks; position++)
+            {
+                buffer = PeekBufferFromBank(
+                        pool,
+                        pool->sizeClasses.bankIds[position],
+                        ownerId);
+                if (buffer != NULL)
+                    break;
+            }
+            break;
+
+        case MMPS_EXHAUSTION_CHAIN:
+            buffer = PeekChainOfSize(pool, position, preferredSize, ownerId);
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    if (buffer == NULL)
+    {
+        ReportWarning("[MMPS] " \
+                "No free buffer available " \
+                "(requested preferred size %u for 0x%08X)",
+                preferredSize,
+                ownerId);
+
+        return NULL;
+    }
+
+    return buffer;
+}
+
+/*
+ * @brief   Peek an unused buffer from the specified MMPS bank.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   bankId      Bank id to search for unused buffer.
+ * @param   ownerId     Owner id or application id the buffer
+ *                      will be associated with.
+ *                      This value will be stored in buffer descriptor.
+ *
+ * @return  Pointer to MMPS buffer descriptor upon successful completion.
+ * @return  NULL if there are no free buffers available in a specified bank.
+ */
+struct MMPS_Buffer *
+MMPS_PeekBufferFromBank(
+    struct MMPS_Pool    *pool,
+    unsigned int        bankId,
+    const unsigned int  ownerId)
+{
+    struct MMPS_Buffer  *buffer;
+
+#ifdef MMPS_PEEK_POKE
+#ifdef MMPS_USE_OWNER_ID
+    ReportDebug("[MMPS] Peek buffer from bank %u for 0x%08X", bankId, ownerId);
+#else
+    ReportDebug("[MMPS] Peek buffer from bank %u", bankId);
+#endif
+#endif
+
+    buffer = PeekBufferFromBank(pool, bankId, ownerId);
+    if (buffer == NULL)
+    {
+        ReportWarning("[MMPS] " \
+                "No free buffer available (requested bank %u for 0x%08X)",
+                bankId,
+                ownerId);
+
+        return NULL;
+    }
+
+    return buffer;
+}
+
+/*
+ * @brief   Peek an unused buffer from the specified MMPS bank, waiting
+ *          for a buffer to be given back if the bank is exhausted.
+ *
+ * The waiter registers itself before each peek attempt and remembers
+ * the number of wakeups of the bank. It goes asleep only if no poke
+ * has happened since then, so that a buffer given back in between
+ * is never missed. Pokes wake all waiters, with MMPS_BANK_FIFO option
+ * only the first waiter in the queue tries to peek.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   bankId      Bank id to search for unused buffer.
+ * @param   ownerId     Owner id or application id the buffer
+ *                      will be associated with.
+ *                      This value will be stored in buffer descriptor.
+ * @param   timeout     Maximal time to wait in milliseconds, 0 not to wait
+ *                      at all or MMPS_WAIT_FOREVER.
+ *
+ * @return  Pointer to MMPS buffer descriptor upon successful completion.
+ * @return  NULL if no buffer became available within the timeout.
+ */
+struct MMPS_Buffer *
+MMPS_PeekBufferTimed(
+    struct MMPS_Pool    *pool,
+    unsigned int        bankId,
+    const unsigned int  ownerId,
+    unsigned int        timeout)
+{
+    struct MMPS_Bank    *bank;
+    struct MMPS_Buffer  *buffer;
+    struct MMPS_Waiter  waiter;
+    struct MMPS_Waiter  *previous;
+    struct MMPS_Waiter  *current;
+    struct timespec     deadline;
+    unsigned long       numberOfWakeups;
+    boolean             fifo;
+    int                 rc;
+
+#ifdef MMPS_PEEK_POKE
+#ifdef MMPS_USE_OWNER_ID
+    ReportDebug("[MMPS] Peek buffer from bank %u for 0x%08X within %u ms",
+            bankId, ownerId, timeout);
+#else
+    ReportDebug("[MMPS] Peek buffer from bank %u within %u ms",
+            bankId, timeout);
+#endif
+#endif
+
+    bank = pool->banks[bankId];
+
+    fifo = ((bank->options & MMPS_BANK_FIFO) != 0) ? TRUE : FALSE;
+
+    // Try without waiting first. For a FIFO bank do not overtake
+    // those who are already waiting.
+    //
+    if ((fifo == FALSE) ||
+            (__atomic_load_n(&bank->waiters.numberOfWaiters, __ATOMIC_ACQUIRE) == 0))
+    {
+        buffer = PeekBufferFromBank(pool, bankId, ownerId);
+        if (buffer != NULL)
+            return buffer;
+    }
+
+    if (timeout == 0)
+    {
+        ReportWarning("[MMPS] " \
+                "No free buffer available (requested bank %u for 0x%08X)",
+                bankId,
+                ownerId);
+
+        return NULL;
+    }
+
+    if (timeout != MMPS_WAIT_FOREVER)
+        DeadlineAfter(&deadline, timeout);
+
+    buffer = NULL;
+
+    CountEvent(bank, waits, 1);
+
+    waiter.next = NULL;
+
+    pthread_mutex_lock(&bank->waiters.lock);
+
+    if (bank->waiters.last == NULL)
+        bank->waiters.first = &waiter;
+    else
+        bank->waiters.last->next = &waiter;
+
+    bank->waiters.last = &waiter;
+
+    __atomic_add_fetch(&bank->waiters.numberOfWaiters, 1, __ATOMIC_SEQ_CST);
+
+    for (;;)
+    {
+        numberOfWakeups = bank->waiters.numberOfWakeups;
+
+        if ((fifo == FALSE) || (bank->waiters.first == &waiter))
+        {
+            pthread_mutex_unlock(&bank->waiters.lock);
+
+            buffer = PeekBufferFromBank(pool, bankId, ownerId);
+
+            pthread_mutex_lock(&bank->waiters.lock);
+
+            if (buffer != NULL)
+                break;
+
+            // Some buffer was given back while peeking - try again.
+            //
+            if (bank->waiters.numberOfWakeups != numberOfWakeups)
+                continue;
+        }
+
+        if (timeout == MMPS_WAIT_FOREVER)
+        {
+            rc = pthread_cond_wait(&bank->waiters.condition,
+                    &bank->waiters.lock);
+        }
+        else
+        {
+            rc = pthread_cond_timedwait(&bank->waiters.condition,
+                    &bank->waiters.lock,
+                    &deadline);
+        }
+
+        if (rc == ETIMEDOUT)
+            break;
+    }
+
+    // Remove the waiter from the queue of waiters.
+    //
+    previous = NULL;
+    for (current = bank->waiters.first; current != &waiter; current = current->next)
+        previous = current;
+
+    if (previous == NULL)
+        bank->waiters.first = waiter.next;
+    else
+        previous->next = waiter.next;
+
+    if (bank->waiters.last == &waiter)
+        bank->waiters.last = previous;
+
+    __atomic_sub_fetch(&bank->waiters.numberOfWaiters, 1, __ATOMIC_SEQ_CST);
+
+    // Let the next waiter of a FIFO bank have its turn.
+    //
+    if ((fifo == TRUE) && (bank->waiters.first != NULL))
+        pthread_cond_broadcast(&bank->waiters.condition);
+
+    pthread_mutex_unlock(&bank->waiters.lock);
+
+    if (buffer == NULL)
+    {
+        CountEvent(bank, timeouts, 1);
+
+        ReportWarning("[MMPS] " \
+                "No buffer became available within %u ms " \
+                "(requested bank %u for 0x%08X)",
+                timeout,
+                bankId,
+                ownerId);
+    }
+
+    return buffer;
+}
+
+/*
+ * @brief   Peek several unused buffers from the specified MMPS bank at once.
+ *
+ * Buffers are returned as a chain linked in the order they were peeked.
+ * Either all requested buffers are peeked or none.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   bankId      Bank id to search for unused buffers.
+ * @param   numberOfBuffers Number of buffers to peek.
+ * @param   ownerId     Owner id or application id the buffers
+ *                      will be associated with.
+ *                      This value will be stored in buffer descriptors.
+ *
+ * @return  Pointer to MMPS buffer descriptor of the first buffer of a chain
+ *          upon successful completion.
+ * @return  NULL if there are not enough free buffers available
+ *          in a specified bank.
+ */
+struct MMPS_Buffer *
+MMPS_PeekBuffers(
+    struct MMPS_Pool    *pool,
+    unsigned int        bankId,
+    unsigned int        numberOfBuffers,
+    const unsigned int  ownerId)
+{
+    struct MMPS_Bank    *bank;
+    struct MMPS_Buffer  *chain;
+    unsigned int        localNode;
+    unsigned int        node;
+
+#ifdef MMPS_PEEK_POKE
+#ifdef MMPS_USE_OWNER_ID
+    ReportDebug("[MMPS] Peek %u buffers from bank %u for 0x%08X",
+            numberOfBuffers, bankId, ownerId);
+#else
+    ReportDebug("[MMPS] Peek %u buffers from bank %u",
+            numberOfBuffers, bankId);
+#endif
+#endif
+
+    bank = pool->banks[bankId];
+
+    chain = NULL;
+
+    // Prefer the sub-bank of the local NUMA node.
+    //
+    localNode = LocalNode(bank);
+    for (node = 0; node < bank->numa.numberOfNodes; node++)
+    {
+        chain = PeekBuffersFromBank(
+                NodeBank(bank, (localNode + node) % bank->numa.numberOfNodes),
+                numberOfBuffers,
+                ownerId);
+        if (chain != NULL)
+            break;
+    }
+
+    if (chain == NULL)
+    {
+        ReportWarning("[MMPS] " \
+                "Not enough free buffers available " \
+                "(requested bank %u for 0x%08X)",
+                bankId,
+                ownerId);
+
+        return NULL;
+    }
+
+    return chain;
+}
+
+/*
+ * @brief   Poke buffer or buffer chain back to MMPS pool.
+ *
+ * In case of chain of buffers, the chain will be disassembled and each buffer
+ * will be put back to a corresponding bank. Buffers of a chain are given back
+ * in batches grouped by bank, so that each bank is locked once per batch
+ * and not once per buffer.
+ *
+ * A buffer touched by several members (see MMPS_TouchBuffer()) only loses
+ * one touch, and goes back to its bank with the last touch. Its chaining
+ * is left intact until then, so that a shared chain could be poked
+ * by each of its members.
+ *
+ * @param   buffer      Pointer to a buffer descriptor or a chain
+ *                      of buffer descriptors to be put back to MMPS pool.
+ */
+void
+MMPS_PokeBuffer(struct MMPS_Buffer *buffer)
+{
+    struct MMPS_Bank    *bank;
+    struct MMPS_Bank    *chainBank;
+    struct MMPS_Buffer  *thisBuffer;
+    struct MMPS_Buffer  *nextBuffer;
+    struct MMPS_Buffer  *dataOwner;
+    struct MMPS_Bank    *pokedBanks[MMPS_POKE_BATCH_SIZE];
+    unsigned int        pokedIds[MMPS_POKE_BATCH_SIZE];
+    unsigned int        numberOfPokedIds;
+    unsigned int        chainLength;
+
+    numberOfPokedIds = 0;
+    chainLength = 0;
+
+    // Chain is counted in the histogram of the bank of its first buffer.
+    //
+    chainBank = buffer->bank;
+
+    thisBuffer = buffer;
+    do {
+        chainLength++;
+
+        bank = thisBuffer->bank;
+
+#ifdef MMPS_PEEK_POKE
+#ifdef MMPS_USE_OWNER_ID
+        ReportDebug("[MMPS] Poke buffer %u to bank %u for 0x%08X",
+                thisBuffer->bufferId, bank->bankId, thisBuffer->ownerId);
+#else
+        ReportDebug("[MMPS] Poke buffer %u to bank %u",
+                thisBuffer->bufferId, bank->bankId);
+#endif
+#endif
+
+#ifdef MMPS_USE_OWNER_ID
+        if (thisBuffer->ownerId == MMPS_NO_OWNER)
+        {
+            ReportError("[MMPS] " \
+                    "Trying to poke buffer %u to bank %u that was not peeked",
+                    thisBuffer->bufferId,
+                    thisBuffer->bank->bankId);
+
+            break;
+        }
+#endif
+
+        nextBuffer = thisBuffer->next;
+
+        if ((nextBuffer != NULL) && (nextBuffer->prev != thisBuffer))
+        {
+            ReportError("[MMPS] " \
+                    "Detected broken buffer chain for buffers %u and %u",
+                    thisBuffer->bufferId,
+                    nextBuffer->bufferId);
+
+            nextBuffer = NULL;
+        }
+
+        // Buffer is still touched by other members - drop the touch
+        // of the caller only and leave the buffer and its chaining as is.
+        //
+        if (DropTouch(thisBuffer) != 0)
+        {
+            thisBuffer = nextBuffer;
+            continue;
+        }
+
+        // Buffer shares its data block with spliced buffers. Data block
+        // goes back to the bank only with the last buffer referencing it.
+        //
+        if ((thisBuffer->origin != NULL) || (thisBuffer->references != 0))
+        {
+            dataOwner = (thisBuffer->origin != NULL)
+                ? thisBuffer->origin
+                : thisBuffer;
+
+            if (thisBuffer->origin != NULL)
+            {
+                GiveSpliceDescriptor(bank->pool, thisBuffer);
+            }
+            else
+            {
+                thisBuffer->prev = NULL;
+                thisBuffer->next = NULL;
+            }
+
+            if (ReleaseDataBlock(dataOwner) != 0)
+            {
+                thisBuffer = nextBuffer;
+                continue;
+            }
+
+            thisBuffer = dataOwner;
+            thisBuffer->bufferSize = bank->bufferSize;
+        }
+
+        // For buffers of the bank with the 'alloc on demand' flag set on,
+        // release memory resources used for data.
+        //
+        if (bank->allocateOnDemand == TRUE)
+        {
+            ReleaseSlabChunk(thisBuffer->data, thisBuffer->bufferSize);
+            thisBuffer->data = NULL;
+            thisBuffer->cursor = NULL;
+        }
+
+        thisBuffer->prev = NULL;
+        thisBuffer->next = NULL;
+        thisBuffer->dataSize = 0;
+        thisBuffer->cursor = thisBuffer->data;
+        thisBuffer->touches = 1;
+#ifdef MMPS_USE_OWNER_ID
+        thisBuffer->ownerId = MMPS_NO_OWNER;
+#endif
+
+        pokedBanks[numberOfPokedIds] = bank;
+        pokedIds[numberOfPokedIds] = thisBuffer->bufferId;
+
+        numberOfPokedIds++;
+        if (numberOfPokedIds == MMPS_POKE_BATCH_SIZE)
+        {
+            PokeBufferIdsByBank(pokedBanks, pokedIds, numberOfPokedIds);
+
+            numberOfPokedIds = 0;
+        }
+
+        thisBuffer = nextBuffer;
+
+#ifdef MMPS_PEEK_POKE
+        if (thisBuffer != NULL)
+        {
+            ReportDebug("[MMPS] ... next buffer %u",
+                    thisBuffer->bufferId);
+        }
+#endif
+    } while (thisBuffer != NULL);
+
+    if (numberOfPokedIds != 0)
+        PokeBufferIdsByBank(pokedBanks, pokedIds, numberOfPokedIds);
+
+    CountEvent(chainBank, chainLengths[ChainLengthClass(chainLength)], 1);
+}
+
+/*
+ * @brief   Increment the number of touches of MMPS buffer.
+ *
+ * Peeked buffer is touched once by the peeking member. Each additional touch
+ * lets one more member share the buffer read-only and poke it when done.
+ * The buffer goes back to the pool only when the last touch is dropped.
+ *
+ * @param   buffer      Pointer to a buffer descriptor or a chain
+ *                      of buffer descriptors to be touched.
+ */
+void
+MMPS_TouchBuffer(struct MMPS_Buffer *buffer)
+{
+    struct MMPS_Buffer  *thisBuffer;
+
+    for (thisBuffer = buffer;
+         thisBuffer != NULL;
+         thisBuffer = thisBuffer->next)
+    {
+#ifdef LINUX
+        __atomic_add_fetch(&thisBuffer->touches, 1, __ATOMIC_RELAXED);
+#else
+        atomic_add(&thisBuffer->touches, 1);
+#endif
+    }
+}
+
+/*
+ * @brief   Decrement the number of touches of MMPS buffer.
+ *
+ * When last member absolves the MMPS buffer it is automatically
+ * poked back to the pool. Same as MMPS_PokeBuffer().
+ *
+ * @param   buffer      Pointer to a buffer descriptor or a chain
+ *                      of buffer descriptors to be absolved.
+ */
+void
+MMPS_AbsolveBuffer(struct MMPS_Buffer *buffer)
+{
+    MMPS_PokeBuffer(buffer);
+}
+
+/*
+ * @brief   Get buffer from a chain, which precedes the referencing buffer.
+ *
+ * @param   buffer      Pointer to the referencing MMPS buffer descriptor.
+ *
+ * @return  Pointer to MMPS buffer descriptor of the preceding buffer in a chain.
+ * @return  NULL if referencing buffer is the first buffer in a chain.
+ */
+inline struct MMPS_Buffer *
+MMPS_PreviousBuffer(struct MMPS_Buffer *buffer)
+{
+    return buffer->prev;
+}
+
+/*
+ * @brief   Get buffer from a chain, which succeeds the referencing buffer.
+ *
+ * @param   buffer      Pointer to the referencing MMPS buffer descriptor.
+ *
+ * @return  Pointer to MMPS buffer descriptor of the succeeding buffer in a chain.
+ * @return  NULL if referencing buffer is the last buffer in a chain.
+ */
+inline struct MMPS_Buffer *
+MMPS_NextBuffer(struct MMPS_Buffer *buffer)
+{
+    return buffer->next;
+}
+
+/*
+ * @brief   Get first buffer of a chain.
+ *
+ * @param   chain       Pointer to the referencing MMPS buffer descriptor.
+ *
+ * @return  Pointer to MMPS buffer descriptor of the first buffer in a chain.
+ */
+inline struct MMPS_Buffer *
+MMPS_FirstBuffer(struct MMPS_Buffer *chain)
+{
+    struct MMPS_Buffer *firstBuffer;
+
+    firstBuffer = chain;
+
+    while (firstBuffer->prev != NULL)
+        firstBuffer = firstBuffer->prev;
+
+    return firstBuffer;
+}
+
+/*
+ * @brief   Get last buffer of a chain.
+ *
+ * @param   chain       Pointer to the referencing MMPS buffer descriptor.
+ *
+ * @return  Pointer to MMPS buffer descriptor of the last buffer in a chain.
+ */
+inline struct MMPS_Buffer *
+MMPS_LastBuffer(struct MMPS_Buffer *chain)
+{
+    struct MMPS_Buffer *lastBuffer;
+
+    lastBuffer = chain;
+
+    while (lastBuffer->next != NULL)
+        lastBuffer = lastBuffer->next;
+
+    return lastBuffer;
+}
+
+/*
+ * @brief   Extend a chain with one more buffer.
+ *
+ * Peek one more buffer from the MMPS pool and append it at the end
+ * of a specified chain of buffers. MMPS will try to peek a buffer
+ * from the same bank, the referencing buffer belongs to.
+ * If there no buffers available in that bank,
+ * MMPS will search through all other banks for a free buffer.
+ *
+ * @param   buffer      Buffer to append a new buffer to.
+ *
+ * @return  Pointer to MMPS buffer descriptor of the attached buffer.
+ *          If referenced buffer did already have a succeeding buffer (chain),
+ *          then the pointer to MMPS buffer descriptor of the succeeding buffer
+ *          will be returned.
+ * @return  NULL if MMPS was not able to find any free buffer in a pool.
+ */
+struct MMPS_Buffer *
+MMPS_ExtendBuffer(struct MMPS_Buffer *origBuffer)
+{
+    struct MMPS_Buffer *nextBuffer;
+
+    nextBuffer = MMPS_PeekBufferFromBank(
+            origBuffer->bank->pool,
+            origBuffer->bank->bankId,
+#ifdef MMPS_USE_OWNER_ID
+            origBuffer->ownerId
+#else
+            MMPS_NO_OWNER
+#endif
+    );
+
+    if (nextBuffer == NULL)
+    {
+        nextBuffer = MMPS_PeekBufferOfSize(
+                origBuffer->bank->pool,
+                origBuffer->bufferSize,
+#ifdef MMPS_USE_OWNER_ID
+                origBuffer->ownerId
+#else
+                MMPS_NO_OWNER
+#endif
+        );
+    }
+
+    if (nextBuffer == NULL)
+        return NULL;
 
     origBuffer->next = nextBuffer;
     nextBuffer->prev = origBuffer;
 
-    return nextBuffer;
+    return nextBuffer;
+}
+
+/*
+ * @brief   Append a buffer at the end of a chain.
+ *
+ * Append buffer or a chain of buffers to another buffer
+ * or another chain of buffers.
+ *
+ * @param   destination Pointer to MMPS buffer descriptor from the chain
+ *                      to append new buffer to.
+ * @param   appendage   Pointer to MMPS buffer descriptor
+ *                      that has to be appended at the end of a chain.
+ *
+ * @return  If a valid pointer to MMPS buffer descriptor is provided
+ *          as destination reference, then the same pointer is returned.
+ *          If destination is referenced as NULL, then the appendage reference
+ *          is returned.
+ */
+struct MMPS_Buffer *
+MMPS_AppendBuffer(
+    struct MMPS_Buffer *destination,
+    struct MMPS_Buffer *appendage)
+{
+    struct MMPS_Buffer *buffer;
+
+    if (destination == NULL)
+    {
+        return appendage;
+    }
+    else
+    {
+        buffer = MMPS_LastBuffer(destination);
+        buffer->next = appendage;
+        appendage->prev = buffer;
+        return destination;
+    }
+}
+
+/*
+ * @brief   Remove buffer from a chain of buffers.
+ *
+ * @param   anchor      Pointer to MMPS buffer chan anchor.
+ * @param   removal     Pointer to MMPS buffer to be removed from a chain.
+ *
+ * @return  Pointer to MMPS buffer descriptor that is a new anchor of a chain.
+ */
+struct MMPS_Buffer *
+MMPS_RemoveFromChain(
+    struct MMPS_Buffer *anchor,
+    struct MMPS_Buffer *removal)
+{
+    struct MMPS_Buffer *newAnchor;
+
+    if (anchor == removal)
+    {
+        // MMPS buffer to be removed from the chain is actually the chain anchor.
+        // Set new chain anchor .
+
+        newAnchor = removal->next;
+
+        if (removal->next != NULL)
+        {
+            removal->next->prev = NULL;
+            removal->next = NULL;
+        }
+
+        return newAnchor;
+    }
+    else
+    {
+        if (removal->prev != NULL)
+        {
+            removal->prev->next = removal->next;
+            removal->prev = NULL;
+        }
+
+        if (removal->next != NULL)
+        {
+            removal->next->prev = removal->prev;
+            removal->next = NULL;
+        }
+
+        return anchor;
+    }
+}
+
+/*
+ * @brief   Truncate buffers at the end of a chain.
+ *
+ * Cut buffers chained on a referenced buffer and give the cut buffers
+ * back to the pool. All buffers, succeeding the referenced buffer,
+ * will be removed from the chain and put back to the MMPS pool.
+ * If referenced buffer is the first buffer in a chain, then after completion
+ * of MMPS_TruncateBuffer() this buffer will be a standalone buffer
+ * (not chained buffer). If referenced buffer is not the first buffer
+ * in a chain, then after completion of MMPS_TruncateBuffer() this buffer
+ * will be the last buffer of a chain.
+ *
+ * @param   tailingBuffer   Pointer to MMPS buffer descriptor of the buffer,
+ *                          which must be the tailing buffer after the trancate.
+ */
+void
+MMPS_TruncateChain(struct MMPS_Buffer *tailingBuffer)
+{
+    struct MMPS_Buffer  *bufferToPurge;
+
+    bufferToPurge = MMPS_NextBuffer(tailingBuffer);
+    if (bufferToPurge != NULL)
+    {
+        tailingBuffer->next = NULL;
+        bufferToPurge->prev = NULL;
+        MMPS_PokeBuffer(bufferToPurge);
+    }
+}
+
+/*
+ * @brief   Split buffer at an offset of its data without copying the data.
+ *
+ * Data behind the offset is handed over to a new buffer descriptor,
+ * which references the same data block. Data block goes back to its bank
+ * only when the buffer and all buffers spliced off it have been poked.
+ * Chaining of the referenced buffer is not changed.
+ *
+ * @param   buffer      Pointer to MMPS buffer descriptor to be split.
+ * @param   offset      Offset in data of the buffer to split at.
+ *
+ * @return  Pointer to MMPS buffer descriptor (not chained) holding data
+ *          behind the offset.
+ * @return  NULL if offset is beyond data or descriptor cannot be allocated.
+ */
+struct MMPS_Buffer *
+MMPS_SpliceBuffer(
+    struct MMPS_Buffer  *buffer,
+    unsigned int        offset)
+{
+    struct MMPS_Buffer  *owner;
+    struct MMPS_Buffer  *splice;
+
+    if (offset > buffer->dataSize)
+        return NULL;
+
+    splice = TakeSpliceDescriptor(buffer->bank->pool);
+    if (splice == NULL)
+        return NULL;
+
+    owner = (buffer->origin != NULL) ? buffer->origin : buffer;
+
+    ShareDataBlock(owner);
+
+    splice->bufferId      = owner->bufferId;
+    splice->bank          = owner->bank;
+    splice->prev          = NULL;
+    splice->next          = NULL;
+#ifdef MMPS_USE_OWNER_ID
+    splice->ownerId       = buffer->ownerId;
+#else
+    splice->ownerId       = MMPS_NO_OWNER;
+#endif
+    splice->touches       = 1;
+    splice->origin        = owner;
+    splice->references    = 0;
+    splice->bufferSize    = buffer->bufferSize - offset;
+    splice->dataSize      = buffer->dataSize - offset;
+    splice->followerSize  = 0;
+    splice->data          = buffer->data + offset;
+    splice->follower      = NULL;
+    splice->dmaAddress    = (buffer->dmaAddress != NULL)
+        ? buffer->dmaAddress + offset
+        : NULL;
+    splice->cursor        = splice->data;
+
+    // Buffer must not grow into the data block part of the splice.
+    //
+    buffer->bufferSize = offset;
+    buffer->dataSize = offset;
+    if (buffer->cursor > buffer->data + offset)
+        buffer->cursor = buffer->data + offset;
+
+    return splice;
+}
+
+/*
+ * @brief   Transfer data behind an offset of a chain to a new chain.
+ *
+ * The buffer, the offset falls into, is split with MMPS_SpliceBuffer(),
+ * so that no data is copied. After completion the referenced chain holds
+ * exactly offset bytes of data.
+ *
+ * @param   chain       Pointer to MMPS buffer descriptor of the chain.
+ * @param   offset      Offset in total data of the chain to split at.
+ *
+ * @return  Pointer to MMPS buffer descriptor of the chain holding data
+ *          behind the offset.
+ * @return  NULL if there are no buffers behind the offset
+ *          or descriptor cannot be allocated.
+ */
+struct MMPS_Buffer *
+MMPS_SplitChain(
+    struct MMPS_Buffer  *chain,
+    unsigned int        offset)
+{
+    struct MMPS_Buffer  *buffer;
+    struct MMPS_Buffer  *rest;
+
+    buffer = chain;
+    while (offset > buffer->dataSize)
+    {
+        offset -= buffer->dataSize;
+
+        buffer = buffer->next;
+        if (buffer == NULL)
+            return NULL;
+    }
+
+    // Offset is at the end of data of a buffer - no need to split it,
+    // the rest of the chain is just cut off.
+    //
+    if (offset == buffer->dataSize)
+    {
+        rest = buffer->next;
+        if (rest != NULL)
+        {
+            buffer->next = NULL;
+            rest->prev = NULL;
+        }
+
+        return rest;
+    }
+
+    rest = MMPS_SpliceBuffer(buffer, offset);
+    if (rest == NULL)
+        return NULL;
+
+    rest->next = buffer->next;
+    if (rest->next != NULL)
+        rest->next->prev = rest;
+
+    buffer->next = NULL;
+
+    return rest;
+}
+
+/*
+ * @brief   Copy data from one buffer chain to another.
+ *
+ * If destination chain of buffers is smaller than the source
+ * then only a part of data will be copied.
+ *
+ * @param   destination Pointer to MMPS buffer descriptor
+ *                      of the destination buffer chain.
+ * @param   source      Pointer to MMPS buffer descriptor
+ *                      of the source buffer chain.
+ *
+ * @return  Number of bytes being copied.
+ */
+unsigned int
+MMPS_CopyBuffer(struct MMPS_Buffer *destination, struct MMPS_Buffer *source)
+{
+    char            *destinationCursor;
+    char            *sourceCursor;
+    unsigned int    destinationBytes;
+    unsigned int    sourceBytes;
+    unsigned int    bytesToCopy;
+    unsigned int    totalCopiedBytes;
+
+    totalCopiedBytes = 0;
+
+    destinationCursor = destination->data;
+    sourceCursor = source->data;
+
+    destinationBytes = destination->bufferSize;
+    sourceBytes = source->dataSize;
+
+    while (destination != NULL)
+    {
+        // If current destination buffer is full, then switch
+        // to the next buffer in a destination chain.
+        // If there are no other buffers in a destination chain
+        // then the job is done
+        //
+        if (destinationBytes == 0)
+        {
+            destination = MMPS_NextBuffer(destination);
+            if (destination == NULL)
+                break;
+
+            destinationCursor = destination->data;
+            destinationBytes = destination->bufferSize;
+        }
+
+        // If current source buffer is copied completely, then switch
+        // to the next buffer in a source chain. If there are no other buffers
+        // in a source chain then the job is done
+        //
+        if (sourceBytes == 0)
+        {
+            source = MMPS_NextBuffer(source);
+            if (source == NULL)
+                break;
+
+            sourceCursor = source->data;
+            sourceBytes = source->dataSize;
+        }
+
+        if (destinationBytes < sourceBytes) {
+            //
+            // Either copy as much as may fit in a current destination buffer ...
+            //
+            bytesToCopy = destinationBytes;
+        } else {
+            //
+            // ... or as much as is left in a current source buffer.
+            //
+            bytesToCopy = sourceBytes;
+        }
+
+        destination->dataSize += bytesToCopy;
+
+        // Copy piece of data.
+        //
+        memcpy(destinationCursor, sourceCursor, bytesToCopy);
+
+        totalCopiedBytes += bytesToCopy;
+
+        // Move both cursors forwards.
+        //
+        destinationCursor += bytesToCopy;
+        sourceCursor += bytesToCopy;
+
+        // And decrease both bytes counters.
+        //
+        destinationBytes -= bytesToCopy;
+        sourceBytes -= bytesToCopy;
+    }
+
+    return totalCopiedBytes;
+}
+
+/*
+ * @brief   Get total data size summarized for all buffers in a chain.
+ *
+ * The buffers in a chain may belong to different banks and be of different size.
+ *
+ * @param   firstBuffer Pointer to MMPS buffer descriptor of the first buffer
+ *                      in a chain to begin counting from.
+ *
+ * @return  Total data size in bytes.
+ */
+inline unsigned int
+MMPS_TotalDataSize(struct MMPS_Buffer *firstBuffer)
+{
+    unsigned int        totalDataSize;
+    struct MMPS_Buffer  *buffer;
+
+    totalDataSize = 0;
+    for (buffer = firstBuffer; buffer != NULL; buffer = buffer->next)
+        totalDataSize += buffer->dataSize;
+
+    return totalDataSize;
+}
+
+/*
+ * @brief   Reset data size to 0.
+ *
+ * Reset data size to 0 for referencing buffer or, if a chain of buffers
+ * is referenced, for all buffers in a chain.
+ *
+ * @param   buffer      Pointer to MMPS buffer descriptor or anchor
+ *                      of a chain of buffers.
+ */
+inline void
+MMPS_ResetBufferData(struct MMPS_Buffer *buffer)
+{
+    while (buffer != NULL)
+    {
+        buffer->cursor = buffer->data;
+        buffer->dataSize = 0;
+        buffer = buffer->next;
+    }
+}
+
+/*
+ * @brief   Reset cursor to the beginning of data.
+ *
+ * Reset cursor to position to the beginning of data for referencing buffer or,
+ * if a chain of buffers is referenced, for all buffers in a chain.
+ *
+ * @param   buffer      Pointer to MMPS buffer descriptor.
+ */
+inline void
+MMPS_ResetCursor(struct MMPS_Buffer *buffer)
+{
+    while (buffer != NULL)
+    {
+        buffer->cursor = buffer->data;
+        buffer = buffer->next;
+    }
+}
+
+/*
+ * @brief   Move cursor forwards for specified amount of bytes.
+ *
+ * If new absolute offset is located in another buffer of a chain then switch
+ * from the referencing buffer to succeeding buffers through the chain
+ * until a proper buffer is reached.
+ *
+ * @param   buffer          Pointer to MMPS buffer descriptor.
+ * @param   relativeOffset  Number of bytes to move cursor forwards.
+ *
+ * @return  Pointer to MMPS buffer descriptor of a buffer where the cursor
+ *          is positioned after the move operation. If new the absolute
+ *          position, calculated by current cursor position and relative offset,
+ *          is out of range of the referencing buffer or chain of buffers,
+ *          then a NULL pointer is returned.
+ */
+struct MMPS_Buffer *
+MMPS_MoveCursorRelative(
+    struct MMPS_Buffer  *buffer,
+    unsigned int        relativeOffset)
+{
+    int bytesThatWouldFit;
+
+    // Find out how many bytes would fit in the current buffer.
+    //
+    bytesThatWouldFit =
+        buffer->dataSize - (buffer->cursor - buffer->data) - relativeOffset;
+
+    // Delta equal 0 means that the new cursor position would point to the
+    // beginning of next buffer. Extend the chain by one buffer if needed.
+    // Delta greater than 0 means that the new data will fit
+    // in the current buffer and there will be still free space left.
+    // Negative value shows how many bytes would not fit in the current buffer.
+    // In such case the chain has to be extended.
+    //
+    if (bytesThatWouldFit == 0)
+    {
+        if (buffer->next != NULL)
+        {
+            buffer = buffer->next;
+
+            buffer->cursor = buffer->data;
+        }
+        else
+        {
+            buffer = MMPS_ExtendBuffer(buffer);
+        }
+
+        return buffer;
+    }
+    else if (bytesThatWouldFit > 0)
+    {
+        buffer->cursor += relativeOffset;
+
+        return buffer;
+    }
+    else
+    {
+        relativeOffset -= buffer->dataSize - (buffer->cursor - buffer->data);
+
+        if (buffer->next != NULL)
+        {
+            buffer = buffer->next;
+        }
+        else
+        {
+            buffer = MMPS_ExtendBuffer(buffer);
+        }
+
+        buffer = MMPS_MoveCursorRelative(buffer, relativeOffset);
+
+        return buffer;
+    }
+}
+
+/*
+ * @brief   Find out whether cursor is pointing to the end of data.
+ *
+ * Only current buffer is examined - not the other buffers in a chain.
+ *
+ * @param   buffer      Pointer to MMPS buffer descriptor.
+ *
+ * @return  Boolean true if cursor is pointing to the last byte, or false if not.
+ */
+boolean
+MMPS_IsCursorAtTheEndOfData(struct MMPS_Buffer *buffer)
+{
+    // TODO
+
+    if (buffer->next)
+        return false;
+
+    if (buffer->cursor < (buffer->data + buffer->dataSize)) {
+        return false;
+    } else {
+        return true;
+    }
+}
+
+/*
+ * @brief   Receive data from a socket straight into a buffer chain.
+ *
+ * @param   sockFD      Socket file descriptor.
+ * @param   chain       Pointer to MMPS buffer descriptor of the first buffer
+ *                      of a chain.
+ * @param   bytes       Number of bytes to receive.
+ *
+ * @return  Number of bytes received upon successful completion.
+ * @return  Error code (negative value), in case of error.
+ */
+ssize_t
+MMPS_ReceiveIntoChain(
+    int                 sockFD,
+    struct MMPS_Buffer  *chain,
+    size_t              bytes)
+{
+    return MMPS_ReceiveIntoChainWithFlags(sockFD, chain, bytes, 0);
+}
+
+/*
+ * @brief   Receive data from a socket straight into a buffer chain,
+ *          with flags for recvmsg().
+ *
+ * @param   sockFD      Socket file descriptor.
+ * @param   chain       Pointer to MMPS buffer descriptor of the first buffer
+ *                      of a chain.
+ * @param   bytes       Number of bytes to receive.
+ * @param   flags       Flags for recvmsg().
+ *
+ * @return  Number of bytes received upon successful completion.
+ * @return  Error code (negative value), in case of error.
+ */
+ssize_t
+MMPS_ReceiveIntoChainWithFlags(
+    int                 sockFD,
+    struct MMPS_Buffer  *chain,
+    size_t              bytes,
+    int                 flags)
+{
+    struct msghdr       message;
+    struct iovec        iov[MMPS_NUMBER_OF_VECTORS];
+    struct MMPS_Buffer  *firstBuffer;
+    struct MMPS_Buffer  *lastBuffer;
+    struct MMPS_Buffer  *buffer;
+    size_t              capacity;
+    size_t              received;
+    size_t              vectorSize;
+    size_t              rest;
+    ssize_t             receivedPerStep;
+
+    // Data is appended behind the last buffer of a chain that holds data.
+    //
+    firstBuffer = chain;
+    lastBuffer = chain;
+    for (buffer = chain; buffer != NULL; buffer = buffer->next)
+    {
+        if (buffer->dataSize != 0)
+            firstBuffer = buffer;
+
+        lastBuffer = buffer;
+    }
+
+    capacity = 0;
+    for (buffer = firstBuffer; buffer != NULL; buffer = buffer->next)
+        capacity += buffer->bufferSize - buffer->dataSize;
+
+    // Extend the chain until it can hold all data.
+    //
+    while (capacity < bytes)
+    {
+        buffer = MMPS_PeekBufferOfSize(
+                lastBuffer->bank->pool,
+                bytes - capacity,
+#ifdef MMPS_USE_OWNER_ID
+                lastBuffer->ownerId
+#else
+                MMPS_NO_OWNER
+#endif
+        );
+        if (buffer == NULL)
+            return MMPS_OUT_OF_MEMORY;
+
+        lastBuffer->next = buffer;
+        buffer->prev = lastBuffer;
+
+        for (; buffer != NULL; buffer = buffer->next)
+        {
+            capacity += buffer->bufferSize;
+            lastBuffer = buffer;
+        }
+    }
+
+    message.msg_name       = NULL;
+    message.msg_namelen    = 0;
+    message.msg_iov        = iov;
+    message.msg_control    = NULL;
+    message.msg_controllen = 0;
+    message.msg_flags      = 0;
+
+    received = 0;
+
+    while (received < bytes)
+    {
+        // Skip buffers that are full already.
+        //
+        while (firstBuffer->dataSize == firstBuffer->bufferSize)
+            firstBuffer = firstBuffer->next;
+
+        // Scatter the rest of data over all buffers still to be filled.
+        //
+        message.msg_iovlen = 0;
+        rest = bytes - received;
+        for (buffer = firstBuffer;
+             (buffer != NULL) && (rest != 0) &&
+                (message.msg_iovlen < MMPS_NUMBER_OF_VECTORS);
+             buffer = buffer->next)
+        {
+            vectorSize = buffer->bufferSize - buffer->dataSize;
+            if (vectorSize == 0)
+                continue;
+
+            if (vectorSize > rest)
+                vectorSize = rest;
+
+            iov[message.msg_iovlen].iov_base = buffer->data + buffer->dataSize;
+            iov[message.msg_iovlen].iov_len = vectorSize;
+            message.msg_iovlen++;
+
+            rest -= vectorSize;
+        }
+
+        receivedPerStep = recvmsg(sockFD, &message, flags);
+        if (receivedPerStep < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            // Nothing at all without blocking must not look like
+            // a connection closed by the peer.
+            //
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+            {
+                if (received == 0)
+                    return MMPS_SOCKET_ERROR;
+
+                break;
+            }
+
+            return MMPS_SOCKET_ERROR;
+        }
+
+        // Connection is closed by the peer.
+        //
+        if (receivedPerStep == 0)
+            break;
+
+        received += receivedPerStep;
+
+        // Account received data to the buffers in the order they were filled.
+        //
+        rest = receivedPerStep;
+        for (buffer = firstBuffer; rest != 0; buffer = buffer->next)
+        {
+            vectorSize = buffer->bufferSize - buffer->dataSize;
+            if (vectorSize > rest)
+                vectorSize = rest;
+
+            buffer->dataSize += vectorSize;
+            rest -= vectorSize;
+        }
+    }
+
+    return received;
+}
+
+/*
+ * @brief   Send data of a buffer chain to a socket.
+ *
+ * @param   sockFD      Socket file descriptor.
+ * @param   chain       Pointer to MMPS buffer descriptor of the first buffer
+ *                      of a chain.
+ *
+ * @return  Number of bytes sent upon successful completion.
+ * @return  Error code (negative value), in case of error.
+ */
+ssize_t
+MMPS_SendChain(
+    int                 sockFD,
+    struct MMPS_Buffer  *chain)
+{
+    return MMPS_SendChainWithHeader(sockFD, NULL, 0, chain);
+}
+
+/*
+ * @brief   Send a header followed by data of a buffer chain to a socket.
+ *
+ * @param   sockFD      Socket file descriptor.
+ * @param   header      Pointer to header or NULL.
+ * @param   headerSize  Size of header.
+ * @param   chain       Pointer to MMPS buffer descriptor of the first buffer
+ *                      of a chain or NULL.
+ *
+ * @return  Number of bytes sent including header upon successful completion.
+ * @return  Error code (negative value), in case of error.
+ */
+ssize_t
+MMPS_SendChainWithHeader(
+    int                 sockFD,
+    const void          *header,
+    size_t              headerSize,
+    struct MMPS_Buffer  *chain)
+{
+    struct msghdr       message;
+    struct iovec        iov[MMPS_NUMBER_OF_VECTORS];
+    struct MMPS_Buffer  *buffer;
+    struct MMPS_Buffer  *nextBuffer;
+    size_t              headerOffset;
+    size_t              offset;
+    size_t              nextOffset;
+    size_t              sent;
+    size_t              rest;
+    size_t              step;
+    ssize_t             sentPerStep;
+    int                 flags;
+
+    if (header == NULL)
+        headerSize = 0;
+
+#ifdef MSG_NOSIGNAL
+    flags = MSG_NOSIGNAL;
+#else
+    flags = 0;
+#endif
+
+    message.msg_name       = NULL;
+    message.msg_namelen    = 0;
+    message.msg_iov        = iov;
+    message.msg_control    = NULL;
+    message.msg_controllen = 0;
+    message.msg_flags      = 0;
+
+    sent = 0;
+
+    // Header offset and offset in the current buffer tell how much
+    // of the header and of the current buffer is sent already.
+    //
+    headerOffset = 0;
+    buffer = chain;
+    offset = 0;
+
+    for (;;)
+    {
+        // Skip buffers that are sent completely.
+        //
+        while ((buffer != NULL) && (offset == buffer->dataSize))
+        {
+            buffer = buffer->next;
+            offset = 0;
+        }
+
+        // Gather all data still to be sent.
+        //
+        message.msg_iovlen = 0;
+
+        if (headerOffset < headerSize)
+        {
+            iov[0].iov_base = (char *) header + headerOffset;
+            iov[0].iov_len = headerSize - headerOffset;
+            message.msg_iovlen = 1;
+        }
+
+        nextOffset = offset;
+        for (nextBuffer = buffer;
+             (nextBuffer != NULL) && (message.msg_iovlen < MMPS_NUMBER_OF_VECTORS);
+             nextBuffer = nextBuffer->next)
+        {
+            if (nextBuffer->dataSize > nextOffset)
+            {
+                iov[message.msg_iovlen].iov_base = nextBuffer->data + nextOffset;
+                iov[message.msg_iovlen].iov_len = nextBuffer->dataSize - nextOffset;
+                message.msg_iovlen++;
+            }
+
+            nextOffset = 0;
+        }
+
+        if (message.msg_iovlen == 0)
+            break;
+
+        sentPerStep = sendmsg(sockFD, &message, flags);
+        if (sentPerStep < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+                break;
+
+            return MMPS_SOCKET_ERROR;
+        }
+
+        sent += sentPerStep;
+
+        // Move past the data that is sent.
+        //
+        rest = sentPerStep;
+
+        if (headerOffset < headerSize)
+        {
+            step = headerSize - headerOffset;
+            if (step > rest)
+                step = rest;
+
+            headerOffset += step;
+            rest -= step;
+        }
+
+        while (rest != 0)
+        {
+            step = buffer->dataSize - offset;
+            if (step > rest)
+                step = rest;
+
+            offset += step;
+            rest -= step;
+
+            if (offset == buffer->dataSize)
+            {
+                buffer = buffer->next;
+                offset = 0;
+            }
+        }
+    }
+
+    return sent;
+}
+
+/*
+ * @brief   Put (write) data to a buffer chain under cursor - slow path
+ *          of MMPS_PutData().
+ *
+ * Data is spread over the buffers of a chain, new buffers are appended
+ * if necessary.
+ *
+ * @param   buffer          Pointer to MMPS buffer descriptor.
+ * @param   sourceData      Pointer to memory area to copy data from.
+ * @param   sourceDataSize  Size of data to copy.
+ *
+ * @return  Pointer to MMPS buffer descriptor of a buffer in which a cursor
+ *          is pointing to, after write is complete.
+ */
+struct MMPS_Buffer *
+MMPS_PutDataToChain(
+    struct MMPS_Buffer  *buffer,
+    const char* const   sourceData,
+    unsigned int        sourceDataSize)
+{
+    unsigned int    sourceDataOffset;
+    int             freeSpaceInBuffer;
+    int             bytesPerBuffer;
+
+    sourceDataOffset = 0;
+    while (sourceDataOffset < sourceDataSize)
+    {
+        freeSpaceInBuffer =
+                buffer->bufferSize - (buffer->cursor - buffer->data);
+
+        // Calculate the amount of data to be written to the current buffer.
+        //
+        bytesPerBuffer = sourceDataSize - sourceDataOffset;
+        if (bytesPerBuffer > freeSpaceInBuffer)
+            bytesPerBuffer = freeSpaceInBuffer;
+
+        // Copy data or a portion of data that may fit in current buffer.
+        //
+        memcpy(
+            buffer->cursor,
+            sourceData + sourceDataOffset,
+            bytesPerBuffer);
+
+        buffer->cursor += bytesPerBuffer;
+
+        if (buffer->dataSize < (buffer->cursor - buffer->data + sizeof(char)))
+            buffer->dataSize = buffer->cursor - buffer->data;
+
+        sourceDataOffset += bytesPerBuffer;
+
+        // If free space in current buffer was not enough
+        // to write complete data ...
+        //
+        if (sourceDataOffset < sourceDataSize)
+        {
+            // ... then switch to next buffer in a chain
+            // or append a new buffer if necessary.
+            //
+            if (buffer->next != NULL) {
+                //
+                // Switch to next buffer.
+                //
+                buffer = buffer->next;
+            } else {
+                buffer = MMPS_ExtendBuffer(buffer);
+                if (buffer == NULL)
+                    return NULL;
+            }
+
+            MMPS_ResetCursor(buffer);
+        }
+    }
+
+    return buffer;
+}
+
+/*
+ * @brief   Get (read) data from a buffer chain under cursor - slow path
+ *          of MMPS_GetData().
+ *
+ * @param   buffer      Pointer to MMPS buffer descriptor.
+ * @param   destData    Pointer to memory area to copy data to.
+ * @param   destDataSize Size of data to copy.
+ * @param   bytesCopied If not NULL the it points to location
+ *                      in user memory space where the actually copied
+ *                      amount of bytes should be stored.
+ *
+ * @return  Pointer to MMPS buffer descriptor of a buffer in which a cursor
+ *          is pointing to, after read is complete.
+ * @return  NULL in case the last byte of the last buffer of a chain
+ *          has been read.
+ */
+struct MMPS_Buffer *
+MMPS_GetDataFromChain(
+    struct MMPS_Buffer  *buffer,
+    char* const         destData,
+    unsigned int        destDataSize,
+    unsigned int        *bytesCopied)
+{
+    unsigned int    destDataOffset;
+    int             bytesPerBuffer;
+    int             leftSpaceInBuffer;
+
+    if (bytesCopied != NULL)
+        *bytesCopied = 0;
+
+    destDataOffset = 0;
+    while (destDataOffset < destDataSize)
+    {
+        leftSpaceInBuffer = buffer->dataSize - (buffer->cursor - buffer->data);
+
+        // Calculate the amount of data to be read from the current buffer.
+        //
+        bytesPerBuffer = destDataSize - destDataOffset;
+        if (bytesPerBuffer > leftSpaceInBuffer)
+            bytesPerBuffer = leftSpaceInBuffer;
+
+        // Copy data or a portion of data from current buffer.
+        //
+        memcpy(destData + destDataOffset, buffer->cursor, bytesPerBuffer);
+
+        // Notify the amount of copied bytes.
+        //
+        if (bytesCopied != NULL)
+            *bytesCopied += bytesPerBuffer;
+
+        buffer->cursor += bytesPerBuffer;
+
+        destDataOffset += bytesPerBuffer;
+
+        // In case more data has to be read from buffer chain ...
+        //
+        if (destDataOffset < destDataSize)
+        {
+            // ... then switch to next buffer in a chain.
+            // Quit, if not all data was read and there are no other buffers
+            // in a chain.
+            //
+            if (buffer->next == NULL)
+                break;
+
+            // Switch to next buffer.
+            //
+            buffer = buffer->next;
+
+            MMPS_ResetCursor(buffer);
+        }
+    }
+
+    if (MMPS_IsCursorAtTheEndOfData(buffer) == false) {
+        return buffer;
+    } else {
+        return MMPS_NextBuffer(buffer);
+    }
+}
+
+/*
+ * @brief   Reserve contiguous space in the buffer behind the buffer
+ *          under cursor of a writer - slow path of MMPS_Reserve().
+ *
+ * Next buffer of a chain is used if it is large enough, otherwise a new one
+ * is peeked and inserted into the chain behind the buffer under cursor.
+ * Free space left in the buffer under cursor stays unused.
+ *
+ * @param   writer      Pointer to MMPS writer descriptor.
+ * @param   size        Number of bytes to reserve.
+ *
+ * @return  Pointer to reserved space upon successful completion.
+ * @return  NULL if there is no buffer large enough.
+ */
+char *
+MMPS_ReserveInNextBuffer(
+    struct MMPS_Writer  *writer,
+    unsigned int        size)
+{
+    struct MMPS_Buffer  *buffer;
+    struct MMPS_Buffer  *nextBuffer;
+
+    buffer = writer->buffer;
+    nextBuffer = buffer->next;
+
+    if ((nextBuffer == NULL) || (nextBuffer->bufferSize < size))
+    {
+        nextBuffer = MMPS_PeekBufferOfSizeWithPolicy(
+                buffer->bank->pool,
+                size,
+                MMPS_EXHAUSTION_LARGER,
+#ifdef MMPS_USE_OWNER_ID
+                buffer->ownerId
+#else
+                MMPS_NO_OWNER
+#endif
+        );
+
+        if (nextBuffer == NULL)
+            return NULL;
+
+        if (nextBuffer->bufferSize < size)
+        {
+            MMPS_PokeBuffer(nextBuffer);
+
+            return NULL;
+        }
+
+        nextBuffer->next = buffer->next;
+        if (nextBuffer->next != NULL)
+            nextBuffer->next->prev = nextBuffer;
+
+        buffer->next = nextBuffer;
+        nextBuffer->prev = buffer;
+    }
+
+    nextBuffer->cursor = nextBuffer->data;
+
+    writer->buffer = nextBuffer;
+
+    return nextBuffer->cursor;
+}
+
+#if 0
+/*
+ * @brief   Put one 32-bit floating-point value (four bytes)
+ *
+ * Put one 32-bit floating-point value (four bytes)
+ * to buffer chain under cursor. Do endian conversion if needed.
+ *
+ * @param   buffer      Pointer to MMPS buffer descriptor.
+ * @param   sourceData  Pointer to memory area to copy data from.
+ *
+ * @return  Pointer to MMPS buffer descriptor of a buffer in which a cursor
+ *          is pointing to, after write is complete.
+ *
+ * @warning Always care about return value - it may be another buffer
+ *          than a referenced buffer.
+ */
+struct MMPS_Buffer *
+MMPS_PutFloat32(
+    struct MMPS_Buffer  *buffer,
+    float32             *sourceData)
+{
+    float32 value = (float32) htobe32(*sourceData);
+    buffer = MMPS_PutData(buffer, (char *) &value, sizeof(value));
+    return buffer;
+}
+
+/*
+ * @brief   Get one 32-bit floating-point value (four bytes)
+ *
+ * Get one 32-bit floating-point value (four bytes)
+ * from buffer chain under cursor. Do endian conversion if needed.
+ *
+ * @param   buffer      Pointer to MMPS buffer descriptor.
+ * @param   destData    Pointer to memory area to copy data to.
+ *
+ * @return  Pointer to MMPS buffer descriptor of a buffer in which a cursor
+ *          is pointing to, after read is complete.
+ * @return  NULL in case the last byte of the last buffer of a chain
+ *          has been read.
+ *
+ * @warning Always care about return value - it may be another buffer
+ *          than a referenced buffer.
+ */
+struct MMPS_Buffer *
+MMPS_GetFloat32(
+    struct MMPS_Buffer  *buffer,
+    float32             *destData)
+{
+    float32 value;
+    buffer = MMPS_GetData(buffer, (char *) &value, sizeof(value), NULL);
+    value = (float32) be64toh((uint32) value);
+    *destData = value;
+    return buffer;
+}
+
+/*
+ * @brief   Put one 64-bit double precision floating-point value (eight bytes)
+ *
+ * Put one 64-bit double precision floating-point value (eight bytes)
+ * to buffer chain under cursor. Do endian conversion if needed.
+ *
+ * @param   buffer      Pointer to MMPS buffer descriptor.
+ * @param   sourceData  Pointer to memory area to copy data from.
+ *
+ * @return  Pointer to MMPS buffer descriptor of a buffer in which a cursor
+ *          is pointing to, after write is complete.
+ *
+ * @warning Always care about return value - it may be another buffer
+ *          than a referenced buffer.
+ */
+struct MMPS_Buffer *
+MMPS_PutFloat64(
+    struct MMPS_Buffer  *buffer,
+    float64             *sourceData)
+{
+    float64 value = (float64) htobe64(*sourceData);
+    buffer = MMPS_PutData(buffer, (char *) &value, sizeof(value));
+    return buffer;
+}
+
+/*
+ * @brief   Get one 64-bit double precision floating-point value (eight bytes)
+ *
+ * Get one 64-bit double precision floating-point value (eight bytes)
+ * from buffer chain under cursor. Do endian conversion if needed.
+ *
+ * @param   buffer      Pointer to MMPS buffer descriptor.
+ * @param   destData    Pointer to memory area to copy data to.
+ *
+ * @return  Pointer to MMPS buffer descriptor of a buffer in which a cursor
+ *          is pointing to, after read is complete.
+ * @return  NULL in case the last byte of the last buffer of a chain
+ *          has been read.
+ *
+ * @warning Always care about return value - it may be another buffer
+ *          than a referenced buffer.
+ */
+struct MMPS_Buffer *
+MMPS_GetFloat64(
+    struct MMPS_Buffer  *buffer,
+    float64             *destData)
+{
+    float64 value;
+    buffer = MMPS_GetData(buffer, (char *) &value, sizeof(value), NULL);
+    value = (float64) be64toh((uint64) value);
+    *destData = value;
+    return buffer;
+}
+#endif
+
+/*
+ * @brief   Put string.
+ *
+ * @param   buffer      Pointer to MMPS buffer descriptor.
+ * @param   string      Pointer to a string.
+ * @param   length      Length of string.
+ *
+ * @return  Pointer to MMPS buffer descriptor of a buffer in which a cursor
+ *          is pointing to, after write is complete.
+ *
+ * @warning Always care about return value - it may be another buffer
+ *          than a referenced buffer.
+ */
+struct MMPS_Buffer *
+MMPS_PutString(
+    struct MMPS_Buffer  *buffer,
+    char                *string,
+    unsigned int        length)
+{
+    uint32 swapped = htobe32(length);
+    buffer = MMPS_PutData(buffer, (char *)&swapped, sizeof(swapped));
+    if (length != 0)
+        buffer = MMPS_PutData(buffer, string, length);
+    return buffer;
+}
+
+/**
+ * @brief   Get number of used MMPS buffers for the specified buffer bank.
+ *
+ * This function may be used for debugging purposes to check
+ * periodically how many MMPS buffers are in use (peeked out of the bank).
+ *
+ * @param   pool        Pointer to MMPS pool descriptor.
+ *                      to get statistical information for.
+ * @param   bankId      Buffer bank id.
+ *
+ * @return  The number of buffers 'in use'.
+ *
+ * @warning Do not use this function in a production code
+ *          as it may cause performance degradation.
+ */
+unsigned int
+MMPS_NumberOfBuffersInUse(
+    struct MMPS_Pool    *pool,
+    unsigned int        bankId)
+{
+    struct MMPS_Bank    *bank;
+    unsigned int        buffersInUse;
+    unsigned int        node;
+
+    bank = pool->banks[bankId];
+
+    buffersInUse = 0;
+
+    for (node = 0; node < bank->numa.numberOfNodes; node++)
+        buffersInUse += MMPS_NumberOfBuffersInUseOnNode(pool, bankId, node);
+
+    return buffersInUse;
+}
+
+/*
+ * @brief   Get number of NUMA nodes the specified buffer bank is spread over.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   bankId      Buffer bank id.
+ *
+ * @return  Number of NUMA nodes, 1 for banks without MMPS_BANK_NUMA option.
+ */
+unsigned int
+MMPS_NumberOfNodes(
+    struct MMPS_Pool    *pool,
+    unsigned int        bankId)
+{
+    return pool->banks[bankId]->numa.numberOfNodes;
+}
+
+/*
+ * @brief   Get number of used MMPS buffers of the specified buffer bank
+ *          on the specified NUMA node.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   bankId      Buffer bank id.
+ * @param   node        NUMA node.
+ *
+ * @return  The number of buffers 'in use' on the node.
+ */
+unsigned int
+MMPS_NumberOfBuffersInUseOnNode(
+    struct MMPS_Pool    *pool,
+    unsigned int        bankId,
+    unsigned int        node)
+{
+    struct MMPS_Bank    *bank;
+
+    bank = pool->banks[bankId];
+    if (node >= bank->numa.numberOfNodes)
+        return 0;
+
+    bank = NodeBank(bank, node);
+
+    return NumberOfCommittedBuffers(bank) - NumberOfFreeBufferIds(bank);
+}
+
+/*
+ * @brief   Take a snapshot of statistics of the specified buffer bank.
+ *
+ * Counters of all stripes of all NUMA nodes of the bank are summed up.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   bankId      Buffer bank id.
+ * @param   statistics  Pointer to the structure to fill in.
+ *
+ * @return  MMPS_OK upon successful completion.
+ * @return  MMPS_WRONG_BANK_ID if the bank does not exist.
+ */
+int
+MMPS_GetBankStatistics(
+    struct MMPS_Pool            *pool,
+    unsigned int                bankId,
+    struct MMPS_BankStatistics  *statistics)
+{
+    struct MMPS_Bank        *bank;
+    struct MMPS_Counters    *counters;
+    unsigned int            node;
+    unsigned int            stripeId;
+    unsigned int            classId;
+
+    if ((bankId + 1) > pool->numberOfBanks)
+        return MMPS_WRONG_BANK_ID;
+
+    if (pool->banks[bankId] == NULL)
+        return MMPS_WRONG_BANK_ID;
+
+    memset(statistics, 0, sizeof(struct MMPS_BankStatistics));
+
+    statistics->bankId = bankId;
+    statistics->bufferSize = pool->banks[bankId]->bufferSize;
+
+    for (node = 0; node < pool->banks[bankId]->numa.numberOfNodes; node++)
+    {
+        bank = NodeBank(pool->banks[bankId], node);
+
+        statistics->numberOfBuffers += NumberOfCommittedBuffers(bank);
+        statistics->buffersInUse +=
+                NumberOfCommittedBuffers(bank) - NumberOfFreeBufferIds(bank);
+        statistics->highWaterMark +=
+                __atomic_load_n(&bank->highWaterMark, __ATOMIC_RELAXED);
+
+        for (stripeId = 0; stripeId < MMPS_NUMBER_OF_COUNTER_STRIPES; stripeId++)
+        {
+            counters = &bank->counters[stripeId];
+
+            statistics->peeks +=
+                    __atomic_load_n(&counters->peeks, __ATOMIC_RELAXED);
+            statistics->pokes +=
+                    __atomic_load_n(&counters->pokes, __ATOMIC_RELAXED);
+            statistics->failures +=
+                    __atomic_load_n(&counters->failures, __ATOMIC_RELAXED);
+            statistics->contentions +=
+                    __atomic_load_n(&counters->contentions, __ATOMIC_RELAXED);
+            statistics->waits +=
+                    __atomic_load_n(&counters->waits, __ATOMIC_RELAXED);
+            statistics->timeouts +=
+                    __atomic_load_n(&counters->timeouts, __ATOMIC_RELAXED);
+
+            for (classId = 0; classId < MMPS_CHAIN_HISTOGRAM_SIZE; classId++)
+            {
+                statistics->chainLengths[classId] +=
+                        __atomic_load_n(&counters->chainLengths[classId],
+                                __ATOMIC_RELAXED);
+            }
+        }
+    }
+
+    return MMPS_OK;
+}
+
+/*
+ * @brief   Write statistics of all banks of a pool to a file descriptor.
+ *
+ * Banks that were not initialized are skipped.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   poolName    Name of the pool to be written into each line.
+ * @param   fd          File descriptor to write to.
+ *
+ * @return  MMPS_OK upon successful completion.
+ * @return  MMPS_WRITE_ERROR if writing has failed.
+ */
+int
+MMPS_DumpStatistics(
+    struct MMPS_Pool    *pool,
+    const char          *poolName,
+    int                 fd)
+{
+    struct MMPS_BankStatistics  statistics;
+    unsigned int                bankId;
+    int                         rc;
+
+    for (bankId = 0; bankId < pool->numberOfBanks; bankId++)
+    {
+        rc = MMPS_GetBankStatistics(pool, bankId, &statistics);
+        if (rc != MMPS_OK)
+            continue;
+
+        rc = DumpBankStatistics(fd, poolName, &statistics);
+        if (rc != MMPS_OK)
+            return rc;
+    }
+
+    return MMPS_OK;
+}
+
+#ifdef MMPS_LOCKFREE
+
+/*
+ * @brief   Take up to the specified number of buffer ids out of the queue
+ *          of "free" buffers of a bank.
+ *
+ * Lock-free version: each buffer id is taken by claiming the slot under
+ * the peek cursor with compare-and-swap, once the sequence number
+ * of the slot shows that the slot has been filled. A slot that is claimed
+ * by a poke, but not filled yet, ends the take early, so that a preempted
+ * poke never holds peeks up.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor.
+ * @param   ids         Array where the buffer ids should be stored.
+ * @param   numberOfIds Maximal number of buffer ids to take.
+ * @param   numberOfQueuedIds   Where to store the number of buffer ids
+ *                      left in the queue, or NULL.
+ *
+ * @return  Number of buffer ids actually taken.
+ */
+static unsigned int
+PullBufferIds(
+    struct MMPS_Bank    *bank,
+    unsigned int        *ids,
+    unsigned int        numberOfIds,
+    unsigned int        *numberOfQueuedIds)
+{
+    unsigned int        pulled;
+    unsigned long       peek;
+    unsigned long       poke;
+    unsigned long       slotId;
+    unsigned long       sequence;
+    long                difference;
+
+    if (bank->sharedBank != NULL)
+    {
+        return PullShMemBufferIds(bank->sharedBank,
+                ids,
+                numberOfIds,
+                numberOfQueuedIds);
+    }
+
+    for (pulled = 0; pulled < numberOfIds; pulled++)
+    {
+        peek = __atomic_load_n(&bank->cursor.peek, __ATOMIC_RELAXED);
+
+        for (;;)
+        {
+            slotId = peek % bank->numberOfBuffers;
+
+            sequence = __atomic_load_n(&bank->sequences[slotId], __ATOMIC_ACQUIRE);
+
+            difference = (long) sequence - (long) (peek + 1);
+            if (difference == 0) {
+                if (__atomic_compare_exchange_n(&bank->cursor.peek,
+                        &peek,
+                        peek + 1,
+                        TRUE,
+                        __ATOMIC_RELAXED,
+                        __ATOMIC_RELAXED))
+                {
+                    break;
+                }
+
+                CountEvent(bank, contentions, 1);
+            } else if (difference < 0) {
+                // Either all buffers are in use (peek cursor has reached
+                // the poke cursor), or the slot has been claimed by a poke
+                // that has not yet filled it. Do not wait for that poke,
+                // which may have been preempted - the caller takes buffers
+                // elsewhere or waits for them.
+                //
+                poke = __atomic_load_n(&bank->cursor.poke, __ATOMIC_RELAXED);
+                if (poke != peek)
+                    CountEvent(bank, contentions, 1);
+
+                if (numberOfQueuedIds != NULL)
+                    *numberOfQueuedIds = (poke <= peek) ? 0 : poke - peek;
+
+                return pulled;
+            } else {
+                CountEvent(bank, contentions, 1);
+
+                peek = __atomic_load_n(&bank->cursor.peek, __ATOMIC_RELAXED);
+            }
+        }
+
+        ids[pulled] = bank->ids[slotId];
+
+#ifdef MMPS_PEEK_POKE
+        ReportDebug("[MMPS] ... bank->peekCursor=%lu bufferId=%u",
+                peek,
+                ids[pulled]);
+#endif
+
+        // Release the slot for the poke that comes one round later.
+        //
+        __atomic_store_n(&bank->sequences[slotId],
+                peek + bank->numberOfBuffers,
+                __ATOMIC_RELEASE);
+    }
+
+    if (numberOfQueuedIds != NULL)
+    {
+        peek = __atomic_load_n(&bank->cursor.peek, __ATOMIC_RELAXED);
+        poke = __atomic_load_n(&bank->cursor.poke, __ATOMIC_RELAXED);
+
+        *numberOfQueuedIds = (poke <= peek) ? 0 : poke - peek;
+    }
+
+    return pulled;
+}
+
+/*
+ * @brief   Put buffer ids back to the queue of "free" buffers of a bank.
+ *
+ * Lock-free version: each buffer id is put by claiming the slot under
+ * the poke cursor with compare-and-swap, once the sequence number
+ * of the slot shows that the slot has been emptied.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor.
+ * @param   ids         Array of buffer ids to put back.
+ * @param   numberOfIds Number of buffer ids in the array.
+ */
+static void
+PushBufferIds(
+    struct MMPS_Bank    *bank,
+    unsigned int        *ids,
+    unsigned int        numberOfIds)
+{
+    unsigned int        pushed;
+    unsigned long       poke;
+    unsigned long       slotId;
+    unsigned long       sequence;
+    long                difference;
+
+    if (bank->sharedBank != NULL)
+    {
+        PushShMemBufferIds(bank->sharedBank, ids, numberOfIds);
+
+        return;
+    }
+
+    for (pushed = 0; pushed < numberOfIds; pushed++)
+    {
+        poke = __atomic_load_n(&bank->cursor.poke, __ATOMIC_RELAXED);
+
+        for (;;)
+        {
+            slotId = poke % bank->numberOfBuffers;
+
+            sequence = __atomic_load_n(&bank->sequences[slotId], __ATOMIC_ACQUIRE);
+
+            difference = (long) sequence - (long) poke;
+            if (difference == 0) {
+                if (__atomic_compare_exchange_n(&bank->cursor.poke,
+                        &poke,
+                        poke + 1,
+                        TRUE,
+                        __ATOMIC_RELAXED,
+                        __ATOMIC_RELAXED))
+                {
+                    break;
+                }
+
+                CountEvent(bank, contentions, 1);
+            } else {
+                // The queue can hold all buffers of the bank, so it is never
+                // full. The slot is either taken by another poke, or it has
+                // been claimed by a peek that has not yet emptied it - retry.
+                //
+                CountEvent(bank, contentions, 1);
+
+                poke = __atomic_load_n(&bank->cursor.poke, __ATOMIC_RELAXED);
+            }
+        }
+
+        bank->ids[slotId] = ids[pushed];
+
+        __atomic_store_n(&bank->sequences[slotId], poke + 1, __ATOMIC_RELEASE);
+    }
+}
+
+/*
+ * @brief   Count buffers that are not in use - those in the queue
+ *          of "free" buffers and those cached in magazines.
+ *
+ * Lock-free version: the result is a snapshot of both cursors
+ * and may be slightly off while peeks and pokes are in progress.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor.
+ *
+ * @return  Number of free buffers.
+ */
+static unsigned int
+NumberOfFreeBufferIds(struct MMPS_Bank *bank)
+{
+    unsigned int        magazineId;
+    unsigned long       peek;
+    unsigned long       poke;
+    unsigned int        freeIds;
+
+    if (bank->sharedBank != NULL)
+        return NumberOfFreeShMemBufferIds(bank->sharedBank);
+
+    for (magazineId = 0; magazineId < bank->numberOfMagazines; magazineId++)
+        pthread_spin_lock(&MagazineById(bank, magazineId)->lock);
+
+    peek = __atomic_load_n(&bank->cursor.peek, __ATOMIC_ACQUIRE);
+    poke = __atomic_load_n(&bank->cursor.poke, __ATOMIC_ACQUIRE);
+
+    if (poke <= peek) {
+        freeIds = 0;
+    } else if ((poke - peek) > bank->numberOfBuffers) {
+        freeIds = bank->numberOfBuffers;
+    } else {
+        freeIds = poke - peek;
+    }
+
+    for (magazineId = 0; magazineId < bank->numberOfMagazines; magazineId++)
+    {
+        freeIds += MagazineById(bank, magazineId)->numberOfIds;
+
+        pthread_spin_unlock(&MagazineById(bank, magazineId)->lock);
+    }
+
+    return freeIds;
+}
+
+#else // MMPS_LOCKFREE
+
+/*
+ * @brief   Take up to the specified number of buffer ids out of the queue
+ *          of "free" buffers of a bank.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor.
+ * @param   ids         Array where the buffer ids should be stored.
+ * @param   numberOfIds Maximal number of buffer ids to take.
+ * @param   numberOfQueuedIds   Where to store the number of buffer ids
+ *                      left in the queue, or NULL.
+ *
+ * @return  Number of buffer ids actually taken.
+ */
+static unsigned int
+PullBufferIds(
+    struct MMPS_Bank    *bank,
+    unsigned int        *ids,
+    unsigned int        numberOfIds,
+    unsigned int        *numberOfQueuedIds)
+{
+    unsigned int        pulled;
+
+    if (bank->sharedBank != NULL)
+    {
+        return PullShMemBufferIds(bank->sharedBank,
+                ids,
+                numberOfIds,
+                numberOfQueuedIds);
+    }
+
+    BankLock(bank);
+
+    for (pulled = 0; pulled < numberOfIds; pulled++)
+    {
+#ifdef MMPS_PEEK_POKE
+        ReportDebug("[MMPS] ... bank->peekCursor=%u bank->pokeCursor=%u bufferId=%u",
+                bank->cursor.peek,
+                bank->cursor.poke,
+                bank->ids[bank->cursor.peek]);
+#endif
+
+        // All buffers are in use (peek cursor has reached the poke cursor
+        // and there are no buffers behind the poke cursor in the buffer bank).
+        //
+        if (bank->ids[bank->cursor.peek] == NOTHING)
+            break;
+
+        ids[pulled] = bank->ids[bank->cursor.peek];
+
+        bank->ids[bank->cursor.peek] = NOTHING;
+
+        bank->cursor.peek++;
+        if (bank->cursor.peek == bank->numberOfBuffers)
+            bank->cursor.peek = 0;
+    }
+
+    if (numberOfQueuedIds != NULL)
+    {
+        if (bank->cursor.poke > bank->cursor.peek) {
+            *numberOfQueuedIds = bank->cursor.poke - bank->cursor.peek;
+        } else if (bank->cursor.poke < bank->cursor.peek) {
+            *numberOfQueuedIds = bank->numberOfBuffers -
+                    (bank->cursor.peek - bank->cursor.poke);
+        } else if (bank->ids[bank->cursor.peek] == NOTHING) {
+            *numberOfQueuedIds = 0;
+        } else {
+            *numberOfQueuedIds = bank->numberOfBuffers;
+        }
+    }
+
+    BankUnlock(bank);
+
+    return pulled;
+}
+
+/*
+ * @brief   Put buffer ids back to the queue of "free" buffers of a bank.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor.
+ * @param   ids         Array of buffer ids to put back.
+ * @param   numberOfIds Number of buffer ids in the array.
+ */
+static void
+PushBufferIds(
+    struct MMPS_Bank    *bank,
+    unsigned int        *ids,
+    unsigned int        numberOfIds)
+{
+    unsigned int        pushed;
+
+    if (bank->sharedBank != NULL)
+    {
+        PushShMemBufferIds(bank->sharedBank, ids, numberOfIds);
+
+        return;
+    }
+
+    BankLock(bank);
+
+    for (pushed = 0; pushed < numberOfIds; pushed++)
+    {
+        bank->ids[bank->cursor.poke] = ids[pushed];
+
+        bank->cursor.poke++;
+        if (bank->cursor.poke == bank->numberOfBuffers)
+            bank->cursor.poke = 0;
+    }
+
+    BankUnlock(bank);
+}
+
+/*
+ * @brief   Count buffers that are not in use - those in the queue
+ *          of "free" buffers and those cached in magazines.
+ *
+ * All magazines are locked in the order of their ids before the bank lock
+ * is taken, so that the result is consistent with concurrent peeks and pokes.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor.
+ *
+ * @return  Number of free buffers.
+ */
+static unsigned int
+NumberOfFreeBufferIds(struct MMPS_Bank *bank)
+{
+    unsigned int        magazineId;
+    unsigned int        freeIds;
+
+    if (bank->sharedBank != NULL)
+        return NumberOfFreeShMemBufferIds(bank->sharedBank);
+
+    for (magazineId = 0; magazineId < bank->numberOfMagazines; magazineId++)
+        pthread_spin_lock(&MagazineById(bank, magazineId)->lock);
+
+    BankLock(bank);
+
+    // Peek cursor is equal to poke cursor either when all buffers are free
+    // or when all of them are in use. Slot under the peek cursor tells which.
+    //
+    if (bank->cursor.poke > bank->cursor.peek) {
+        freeIds = bank->cursor.poke - bank->cursor.peek;
+    } else if (bank->cursor.poke < bank->cursor.peek) {
+        freeIds = bank->numberOfBuffers - (bank->cursor.peek - bank->cursor.poke);
+    } else if (bank->ids[bank->cursor.peek] == NOTHING) {
+        freeIds = 0;
+    } else {
+        freeIds = bank->numberOfBuffers;
+    }
+
+    BankUnlock(bank);
+
+    for (magazineId = 0; magazineId < bank->numberOfMagazines; magazineId++)
+    {
+        freeIds += MagazineById(bank, magazineId)->numberOfIds;
+
+        pthread_spin_unlock(&MagazineById(bank, magazineId)->lock);
+    }
+
+    return freeIds;
+}
+
+#endif // MMPS_LOCKFREE
+
+static struct MMPS_Magazine *
+MagazineById(
+    struct MMPS_Bank    *bank,
+    unsigned int        magazineId)
+{
+    return (struct MMPS_Magazine *) ((unsigned long) bank->magazines +
+            (unsigned long) (magazineId * bank->magazineStride));
+}
+
+/*
+ * @brief   Get magazine of the CPU the calling thread is running on.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor with magazines.
+ *
+ * @return  Pointer to magazine descriptor.
+ */
+static struct MMPS_Magazine *
+LocalMagazine(struct MMPS_Bank *bank)
+{
+    unsigned long       magazineId;
+#ifdef LINUX
+    int                 cpu;
+#endif
+
+#ifdef LINUX
+    cpu = sched_getcpu();
+    magazineId = (cpu < 0) ? 0 : (unsigned long) cpu;
+#else
+    magazineId = (unsigned long) pthread_self() >> 12;
+#endif
+
+    return MagazineById(bank, magazineId % bank->numberOfMagazines);
+}
+
+/*
+ * @brief   Take one free buffer id, from the local magazine if possible.
+ *
+ * When the local magazine is empty, it is refilled with half a magazine
+ * of buffer ids under one bank lock. When the queue of "free" buffers
+ * is empty as well, the remaining free buffers may still be cached
+ * in magazines of other CPUs - then one of them is taken from there.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor.
+ *
+ * @return  Buffer id or NOTHING if all buffers are in use.
+ */
+static unsigned int
+TakeBufferId(struct MMPS_Bank *bank)
+{
+    struct MMPS_Magazine    *localMagazine;
+    struct MMPS_Magazine    *magazine;
+    unsigned int            magazineId;
+    unsigned int            bufferId;
+    unsigned int            numberOfQueuedIds;
+
+    if (bank->numberOfMagazines == 0)
+    {
+        if (PullBufferIds(bank, &bufferId, 1, &numberOfQueuedIds) == 0)
+            bufferId = NOTHING;
+
+        RaiseHighWaterMark(bank, numberOfQueuedIds);
+
+        return bufferId;
+    }
+
+    localMagazine = LocalMagazine(bank);
+
+    pthread_spin_lock(&localMagazine->lock);
+
+    if (localMagazine->numberOfIds == 0)
+    {
+        localMagazine->numberOfIds = PullBufferIds(bank,
+                localMagazine->ids,
+                bank->magazineSize / 2,
+                &numberOfQueuedIds);
+
+        RaiseHighWaterMark(bank, numberOfQueuedIds);
+    }
+
+    bufferId = (localMagazine->numberOfIds == 0)
+        ? NOTHING
+        : localMagazine->ids[--localMagazine->numberOfIds];
+
+    pthread_spin_unlock(&localMagazine->lock);
+
+    if (bufferId != NOTHING)
+        return bufferId;
+
+    for (magazineId = 0; magazineId < bank->numberOfMagazines; magazineId++)
+    {
+        magazine = MagazineById(bank, magazineId);
+        if (magazine == localMagazine)
+            continue;
+
+        pthread_spin_lock(&magazine->lock);
+
+        if (magazine->numberOfIds != 0)
+            bufferId = magazine->ids[--magazine->numberOfIds];
+
+        pthread_spin_unlock(&magazine->lock);
+
+        if (bufferId != NOTHING)
+            break;
+    }
+
+    return bufferId;
+}
+
+/*
+ * @brief   Take several free buffer ids at once.
+ *
+ * Buffer ids are taken from the local magazine first, the rest is pulled
+ * from the queue of "free" buffers under one bank lock.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor.
+ * @param   ids         Array where the buffer ids should be stored.
+ * @param   numberOfIds Number of buffer ids to take.
+ *
+ * @return  Number of buffer ids actually taken.
+ */
+static unsigned int
+TakeBufferIds(
+    struct MMPS_Bank    *bank,
+    unsigned int        *ids,
+    unsigned int        numberOfIds)
+{
+    struct MMPS_Magazine    *magazine;
+    unsigned int            peeked;
+    unsigned int            bufferId;
+    unsigned int            numberOfQueuedIds;
+
+    peeked = 0;
+
+    if (bank->numberOfMagazines != 0)
+    {
+        magazine = LocalMagazine(bank);
+
+        pthread_spin_lock(&magazine->lock);
+
+        while ((peeked < numberOfIds) && (magazine->numberOfIds != 0))
+            ids[peeked++] = magazine->ids[--magazine->numberOfIds];
+
+        pthread_spin_unlock(&magazine->lock);
+    }
+
+    if (peeked < numberOfIds)
+    {
+        peeked += PullBufferIds(bank,
+                &ids[peeked],
+                numberOfIds - peeked,
+                &numberOfQueuedIds);
+
+        RaiseHighWaterMark(bank, numberOfQueuedIds);
+    }
+
+    // Whatever is still missing may be cached in magazines of other CPUs.
+    //
+    while ((peeked < numberOfIds) && (bank->numberOfMagazines != 0))
+    {
+        bufferId = TakeBufferId(bank);
+        if (bufferId == NOTHING)
+            break;
+
+        ids[peeked++] = bufferId;
+    }
+
+    return peeked;
+}
+
+/*
+ * @brief   Peek one free buffer id.
+ *
+ * Elastic banks commit one more block when no free buffer is left.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor.
+ *
+ * @return  Buffer id or NOTHING if all buffers are in use.
+ */
+static unsigned int
+PeekBufferId(struct MMPS_Bank *bank)
+{
+    unsigned int        numberOfCommittedBlocks;
+    unsigned int        bufferId;
+
+    for (;;)
+    {
+        numberOfCommittedBlocks = __atomic_load_n(
+                &bank->elastic.numberOfCommittedBlocks,
+                __ATOMIC_ACQUIRE);
+
+        bufferId = TakeBufferId(bank);
+        if (bufferId != NOTHING)
+            break;
+
+        if ((bank->options & MMPS_BANK_ELASTIC) == 0)
+            break;
+
+        if (CommitNextBlock(bank, numberOfCommittedBlocks) != MMPS_OK)
+            break;
+    }
+
+    if (bufferId == NOTHING)
+        CountEvent(bank, failures, 1);
+    else
+        CountEvent(bank, peeks, 1);
+
+    return bufferId;
+}
+
+/*
+ * @brief   Peek several free buffer ids at once.
+ *
+ * Elastic banks commit more blocks as long as free buffers are missing.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor.
+ * @param   ids         Array where the buffer ids should be stored.
+ * @param   numberOfIds Number of buffer ids to take.
+ *
+ * @return  Number of buffer ids actually taken.
+ */
+static unsigned int
+PeekBufferIds(
+    struct MMPS_Bank    *bank,
+    unsigned int        *ids,
+    unsigned int        numberOfIds)
+{
+    unsigned int        numberOfCommittedBlocks;
+    unsigned int        peeked;
+
+    peeked = 0;
+
+    for (;;)
+    {
+        numberOfCommittedBlocks = __atomic_load_n(
+                &bank->elastic.numberOfCommittedBlocks,
+                __ATOMIC_ACQUIRE);
+
+        peeked += TakeBufferIds(bank, &ids[peeked], numberOfIds - peeked);
+        if (peeked == numberOfIds)
+            break;
+
+        if ((bank->options & MMPS_BANK_ELASTIC) == 0)
+            break;
+
+        if (CommitNextBlock(bank, numberOfCommittedBlocks) != MMPS_OK)
+            break;
+    }
+
+    if (peeked < numberOfIds)
+        CountEvent(bank, failures, 1);
+
+    CountEvent(bank, peeks, peeked);
+
+    return peeked;
+}
+
+/*
+ * @brief   Give back buffer ids, to the local magazine if possible.
+ *
+ * When the local magazine gets full, the older half of it is flushed
+ * to the queue of "free" buffers under one bank lock. Buffer ids that
+ * would not fit even in the flushed magazine go directly to the queue.
+ * Callers waiting in MMPS_PeekBufferTimed() are woken up afterwards,
+ * they reach the ids in any magazine.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor.
+ * @param   ids         Array of buffer ids to give back.
+ * @param   numberOfIds Number of buffer ids in the array.
+ */
+static void
+PokeBufferIds(
+    struct MMPS_Bank    *bank,
+    unsigned int        *ids,
+    unsigned int        numberOfIds)
+{
+    struct MMPS_Magazine    *magazine;
+    unsigned int            numberOfIdsToFlush;
+    unsigned int            numberOfIdsToKeep;
+
+    CountEvent(bank, pokes, numberOfIds);
+
+    if (bank->numberOfMagazines == 0)
+    {
+        PushBufferIds(bank, ids, numberOfIds);
+
+        WakeWaiters(bank);
+
+        return;
+    }
+
+    magazine = LocalMagazine(bank);
+
+    pthread_spin_lock(&magazine->lock);
+
+    if ((magazine->numberOfIds + numberOfIds) > bank->magazineSize)
+    {
+        numberOfIdsToKeep = bank->magazineSize / 2;
+        if (magazine->numberOfIds > numberOfIdsToKeep)
+        {
+            numberOfIdsToFlush = magazine->numberOfIds - numberOfIdsToKeep;
+
+            PushBufferIds(bank, magazine->ids, numberOfIdsToFlush);
+
+            magazine->numberOfIds -= numberOfIdsToFlush;
+
+            memmove(magazine->ids,
+                    &magazine->ids[numberOfIdsToFlush],
+                    magazine->numberOfIds * sizeof(unsigned int));
+        }
+
+        if ((magazine->numberOfIds + numberOfIds) > bank->magazineSize)
+        {
+            numberOfIdsToFlush =
+                    magazine->numberOfIds + numberOfIds - bank->magazineSize;
+
+            PushBufferIds(bank, ids, numberOfIdsToFlush);
+
+            ids += numberOfIdsToFlush;
+            numberOfIds -= numberOfIdsToFlush;
+        }
+    }
+
+    memcpy(&magazine->ids[magazine->numberOfIds],
+            ids,
+            numberOfIds * sizeof(unsigned int));
+
+    magazine->numberOfIds += numberOfIds;
+
+    pthread_spin_unlock(&magazine->lock);
+
+    WakeWaiters(bank);
+}
+
+/*
+ * @brief   Give back buffer ids collected from a chain of buffers.
+ *
+ * Buffer ids are grouped by the bank they belong to, so that each bank
+ * is visited only once for the whole group.
+ *
+ * @param   banks       Array of pointers to bank descriptors, one per buffer id.
+ *                      Entries are cleared on return.
+ * @param   ids         Array of buffer ids to give back.
+ * @param   numberOfIds Number of buffer ids in the arrays.
+ */
+static void
+PokeBufferIdsByBank(
+    struct MMPS_Bank    **banks,
+    unsigned int        *ids,
+    unsigned int        numberOfIds)
+{
+    struct MMPS_Bank    *bank;
+    unsigned int        groupIds[MMPS_POKE_BATCH_SIZE];
+    unsigned int        numberOfGroupIds;
+    unsigned int        i;
+    unsigned int        j;
+
+    for (i = 0; i < numberOfIds; i++)
+    {
+        bank = banks[i];
+        if (bank == NULL)
+            continue;
+
+        numberOfGroupIds = 0;
+
+        for (j = i; j < numberOfIds; j++)
+        {
+            if (banks[j] == bank)
+            {
+                groupIds[numberOfGroupIds++] = ids[j];
+                banks[j] = NULL;
+            }
+        }
+
+        PokeBufferIds(bank, groupIds, numberOfGroupIds);
+    }
+}
+
+/*
+ * @brief   Create buffer bank or one NUMA sub-bank of a buffer bank.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   bankId      Bank id of the bank to be created.
+ * @param   bufferSize  Size of buffers in a bank or 0 (see MMPS_InitBank()).
+ * @param   followerSize    Size of the follower or 0.
+ * @param   numberOfBuffers Maximal number of buffer descriptors in the bank.
+ * @param   options     Combination of MMPS_BANK_* options or 0.
+ * @param   node        NUMA node memory of the bank should be placed on
+ *                      (only for MMPS_BANK_NUMA).
+ * @param   createdBank Where to store pointer to created bank descriptor.
+ *
+ * @return  0 upon successful completion.
+ * @return  Error code (negative value), if bank cannot be created.
+ */
+static int
+CreateBank(
+    struct MMPS_Pool    *pool,
+    unsigned int        bankId,
+    unsigned int        bufferSize,
+    unsigned int        followerSize,
+    unsigned int        numberOfBuffers,
+    unsigned int        options,
+    unsigned int        node,
+    struct MMPS_Bank    **createdBank)
+{
+    size_t              maxBlockSize;
+    long long           totalBlockSize;
+    unsigned int        numberOfBlocks;
+    size_t              eachBlockSize;
+    size_t              lastBlockSize;
+    unsigned int        buffersPerBlock;
+    size_t              bankAllocSize;
+
+    struct MMPS_Bank    *bank;
+    struct MMPS_Buffer  *buffer;
+    pthread_condattr_t  conditionAttr;
+
+    unsigned int        blockId;
+    unsigned int        blockSize;
+    void                *block;
+    unsigned int        bufferIdSequential;
+    unsigned int        bufferIdInBlock;
+    unsigned int        numberOfBuffersToAllocate;
+    void                *descriptors;
+    int                 rc;
+
+#ifdef MMPS_INIT_BANK
+    ReportDebug("[MMPS] Create bank %u with %u buffers of size %u",
+        bankId,
+        numberOfBuffers,
+        bufferSize);
+#endif
+
+    // Calculate parameters needed to allocate the memory structures
+    // to store the buffer queue.
+
+    maxBlockSize = MAX_BLOCK_SIZE - MAX_BLOCK_SIZE % sizeof(struct MMPS_Buffer);
+
+    buffersPerBlock = maxBlockSize / sizeof(struct MMPS_Buffer);
+
+    totalBlockSize = (long) numberOfBuffers * (long)sizeof(struct MMPS_Buffer);
+    if (totalBlockSize <= maxBlockSize)
+    {
+        numberOfBlocks = 1;
+        eachBlockSize = totalBlockSize;
+        lastBlockSize = 0;
+    }
+    else
+    {
+        if ((totalBlockSize % maxBlockSize) == 0)
+        {
+            numberOfBlocks = totalBlockSize / maxBlockSize;
+            eachBlockSize = maxBlockSize;
+            lastBlockSize = 0;
+        }
+        else
+        {
+            numberOfBlocks = (totalBlockSize / maxBlockSize) + 1;
+            eachBlockSize = maxBlockSize;
+            lastBlockSize = totalBlockSize % maxBlockSize;
+        }
+    }
+
+#ifdef MMPS_INIT_BANK
+    ReportDebug("[MMPS] " \
+            "... maxBlockSize=%lu buffersPerBlock=%u numberOfBlocks=%u " \
+            "eachBlockSize=%lu lastBlockSize=%lu",
+            maxBlockSize,
+            buffersPerBlock,
+            numberOfBlocks,
+            eachBlockSize,
+            lastBlockSize);
+#endif
+
+    // Calculate amount of memory to be allocated for the bank.
+    //
+    bankAllocSize = sizeof(struct MMPS_Bank);
+    bankAllocSize += numberOfBuffers * sizeof(unsigned int);
+    bankAllocSize += numberOfBlocks * sizeof(void *);
+
+    bank = malloc(bankAllocSize);
+    if (bank == NULL)
+    {
+        ReportSoftAlert("[MMPS] Out of memory");
+
+        return MMPS_OUT_OF_MEMORY;
+    }
+
+#ifdef MMPS_EYECATCHER
+    strncpy(bank->eyeCatcher, EYECATCHER_BANK, EYECATCHER_SIZE);
+#endif
+
+    // Initialize bank values.
+
+#ifdef MMPS_MUTEX
+    pthread_mutexattr_init(&bank->mutex.attr);
+
+    pthread_mutexattr_setpshared(&bank->mutex.attr, PTHREAD_PROCESS_PRIVATE);
+
+    pthread_mutex_init(&bank->mutex.lock, &bank->mutex.attr);
+#else
+    pthread_spin_init(&bank->lock, PTHREAD_PROCESS_PRIVATE);
+#endif
+
+    bank->bankId              = bankId;
+    bank->allocateOnDemand    = FALSE;
+    bank->pool                = pool;
+    bank->sharedMemoryHandle  = 0;
+    bank->sharedMemoryAddress = NULL;
+    bank->sharedBank          = NULL;
+    bank->numberOfBuffers     = numberOfBuffers;
+    bank->bufferSize          = bufferSize;
+    bank->followerSize        = followerSize;
+    bank->numberOfBlocks      = numberOfBlocks;
+    bank->eachBlockSize       = eachBlockSize;
+    bank->lastBlockSize       = lastBlockSize;
+    bank->buffersPerBlock     = buffersPerBlock;
+    bank->cursor.peek         = 0;
+#ifdef MMPS_LOCKFREE
+    bank->cursor.poke         = numberOfBuffers;
+#else
+    bank->cursor.poke         = 0;
+#endif
+    bank->numberOfMagazines   = 0;
+    bank->magazineSize        = 0;
+    bank->magazineStride      = 0;
+    bank->magazines           = NULL;
+    bank->options             = options;
+    bank->pageSize.descriptors = sysconf(_SC_PAGESIZE);
+    bank->pageSize.data        = sysconf(_SC_PAGESIZE);
+    bank->numa.node            = node;
+    bank->numa.numberOfNodes   = 1;
+    bank->numa.banks           = NULL;
+
+    pthread_mutex_init(&bank->elastic.lock, NULL);
+
+    pthread_condattr_init(&conditionAttr);
+    pthread_condattr_setclock(&conditionAttr, CLOCK_MONOTONIC);
+
+    pthread_mutex_init(&bank->waiters.lock, NULL);
+    pthread_cond_init(&bank->waiters.condition, &conditionAttr);
+
+    pthread_condattr_destroy(&conditionAttr);
+
+    bank->waiters.numberOfWaiters = 0;
+    bank->waiters.numberOfWakeups = 0;
+    bank->waiters.first           = NULL;
+    bank->waiters.last            = NULL;
+
+    if (posix_memalign((void **) &bank->counters,
+            MMPS_CACHE_LINE_SIZE,
+            MMPS_NUMBER_OF_COUNTER_STRIPES * sizeof(struct MMPS_Counters)) != 0)
+    {
+        free(bank);
+
+        ReportSoftAlert("[MMPS] Out of memory");
+
+        return MMPS_OUT_OF_MEMORY;
+    }
+
+    memset(bank->counters,
+            0,
+            MMPS_NUMBER_OF_COUNTER_STRIPES * sizeof(struct MMPS_Counters));
+
+    bank->highWaterMark = 0;
+
+    bank->elastic.numberOfCommittedBlocks = 0;
+    bank->elastic.numberOfInitialBlocks   = 0;
+    bank->elastic.descriptors             = NULL;
+    bank->elastic.data                    = NULL;
+    bank->elastic.followers               = NULL;
+
+    bank->blocks = (void *) (
+        (unsigned long) bank +
+        (unsigned long) (bankAllocSize - numberOfBlocks * sizeof(void *))
+    );
+
+    for (blockId = 0; blockId < numberOfBlocks; blockId++)
+        bank->blocks[blockId] = NULL;
+
+    bank->descriptors = NULL;
+
+#ifdef MMPS_INIT_BANK
+    ReportDebug("[MMPS] ... bank=0x%016lX (%lu bytes) bank->blocks=0x%016lX",
+            (unsigned long) bank,
+            bankAllocSize,
+            (unsigned long) bank->blocks);
+#endif
+
+#ifdef MMPS_LOCKFREE
+    bank->sequences = malloc(numberOfBuffers * sizeof(unsigned long));
+    if (bank->sequences == NULL)
+    {
+        free(bank->counters);
+        free(bank);
+
+        ReportSoftAlert("[MMPS] Out of memory");
+
+        return MMPS_OUT_OF_MEMORY;
+    }
+#endif
+
+    blockId = 0;
+    bufferIdSequential = 0;
+    bufferIdInBlock = buffersPerBlock;
+
+    // Set block to null to omit compiler messages like 'block may be used
+    // uninitialized'.
+    //
+    block = NULL;
+
+    // Elastic banks allocate nothing here - their blocks are committed
+    // on demand.
+    //
+    numberOfBuffersToAllocate = (options & MMPS_BANK_ELASTIC)
+        ? 0
+        : numberOfBuffers;
+
+    // Banks with huge pages or on a NUMA node get all descriptor blocks
+    // in one mapping.
+    //
+    descriptors = NULL;
+    if ((numberOfBuffersToAllocate != 0) &&
+        (options & (MMPS_BANK_HUGEPAGES | MMPS_BANK_NUMA)))
+    {
+        descriptors = MapRange(
+                bank,
+                numberOfBlocks * eachBlockSize,
+                "descriptors",
+                &bank->pageSize.descriptors);
+
+        bank->descriptors = descriptors;
+    }
+
+    // Allocate all parts of buffer queue, allocate all buffers
+    // and put them in a queue.
+    //
+    while (bufferIdSequential < numberOfBuffersToAllocate)
+    {
+        // Is it time to allocate new block for buffer queue?
+        //
+        if (bufferIdInBlock == buffersPerBlock)
+        {
+            bufferIdInBlock = 0;
+
+            if ((blockId + 1) < numberOfBlocks) {
+                blockSize = eachBlockSize;
+            } else {
+                blockSize = (lastBlockSize == 0) ? eachBlockSize : lastBlockSize;
+            }
+
+            block = (descriptors != NULL)
+                ? (void *) ((unsigned long) descriptors +
+                    (unsigned long) (blockId * eachBlockSize))
+                : AllocateDescriptors(blockSize);
+            if (block == NULL)
+            {
+                DestroyBank(bank);
+
+                ReportSoftAlert("[MMPS] Out of memory");
+
+                return MMPS_OUT_OF_MEMORY;
+            }
+
+#ifdef MMPS_INIT_BANK_DEEP
+            ReportDebug("[MMPS]   > allocated block=0x%016lX",
+                    (unsigned long) block);
+#endif
+
+            bank->blocks[blockId] = block;
+            blockId++;
+        }
+
+        bank->ids[bufferIdSequential] = bufferIdSequential;
+#ifdef MMPS_LOCKFREE
+        bank->sequences[bufferIdSequential] = bufferIdSequential + 1;
+#endif
+
+        buffer = (void *)
+            ((unsigned long) block +
+            (unsigned long) (bufferIdInBlock * sizeof(struct MMPS_Buffer)));
+
+        InitBuffer(bank, buffer, bufferIdSequential);
+
+        bufferIdSequential++;
+        bufferIdInBlock++;
+    }
+
+    if (options & MMPS_BANK_ELASTIC)
+    {
+        rc = InitElasticBank(bank);
+        if (rc != MMPS_OK)
+        {
+            DestroyBank(bank);
+
+            return rc;
+        }
+    }
+
+    *createdBank = bank;
+
+#ifdef MMPS_INIT_BANK
+    ReportDebug("[MMPS] Created bank %u with %u buffers of size %u, " \
+            "with total bank size %lld MB",
+            bankId,
+            bank->numberOfBuffers,
+            bufferSize,
+            totalBlockSize >> 20);
+
+    ReportDebug("[MMPS] There are %u block(s) of size %lu KB each and %lu KB last",
+            bank->numberOfBlocks,
+            bank->eachBlockSize >> 10,
+            bank->lastBlockSize >> 10);
+
+    ReportDebug("[MMPS] Descriptors of bank %u use pages of %lu KB",
+            bankId,
+            bank->pageSize.descriptors >> 10);
+#endif
+
+    return MMPS_OK;
+}
+
+/*
+ * @brief   Release a bank which is not yet in use.
+ *
+ * Used to unwind a bank (or a NUMA sub-bank) that cannot be completely
+ * initialized. Data and followers of buffers must not be allocated yet.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor.
+ */
+static void
+DestroyBank(struct MMPS_Bank *bank)
+{
+    unsigned int        blockId;
+
+    if (bank->options & MMPS_BANK_ELASTIC)
+    {
+        if (bank->elastic.descriptors != NULL)
+        {
+            munmap(bank->elastic.descriptors,
+                    bank->numberOfBlocks * bank->elastic.descriptorsStride);
+        }
+    }
+    else if (bank->descriptors != NULL)
+    {
+        munmap(bank->descriptors,
+                PageAlignedSize(bank, bank->numberOfBlocks * bank->eachBlockSize));
+    }
+    else
+    {
+        for (blockId = 0; blockId < bank->numberOfBlocks; blockId++)
+            free(bank->blocks[blockId]);
+    }
+
+    pthread_cond_destroy(&bank->waiters.condition);
+    pthread_mutex_destroy(&bank->waiters.lock);
+    pthread_mutex_destroy(&bank->elastic.lock);
+
+#ifdef MMPS_MUTEX
+    pthread_mutex_destroy(&bank->mutex.lock);
+    pthread_mutexattr_destroy(&bank->mutex.attr);
+#else
+    pthread_spin_destroy(&bank->lock);
+#endif
+
+#ifdef MMPS_LOCKFREE
+    free(bank->sequences);
+#endif
+
+    free(bank->counters);
+    free(bank);
+}
+
+/*
+ * @brief   Rebuild size class table of a pool.
+ *
+ * Called whenever a bank is initialized. Banks with buffers of different
+ * sizes (buffer size 0) are not part of the table.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor.
+ */
+static void
+BuildSizeClasses(struct MMPS_Pool *pool)
+{
+    struct MMPS_Bank    *bank;
+    unsigned int        *bankIds;
+    unsigned int        numberOfBanks;
+    unsigned int        bankId;
+    unsigned int        sizeClass;
+    unsigned int        minimalSize;
+    unsigned int        position;
+
+    bankIds = pool->sizeClasses.bankIds;
+    numberOfBanks = 0;
+
+    // Insert banks ordered by buffer size.
+    //
+    for (bankId = 0; bankId < pool->numberOfBanks; bankId++)
+    {
+        bank = pool->banks[bankId];
+        if ((bank == NULL) || (bank->bufferSize == 0))
+            continue;
+
+        for (position = numberOfBanks; position > 0; position--)
+        {
+            if (pool->banks[bankIds[position - 1]]->bufferSize <= bank->bufferSize)
+                break;
+
+            bankIds[position] = bankIds[position - 1];
+        }
+
+        bankIds[position] = bankId;
+        numberOfBanks++;
+    }
+
+    // For each size class find the first bank with buffers large enough
+    // for the smallest size of the class.
+    //
+    position = 0;
+    for (sizeClass = 0; sizeClass < MMPS_NUMBER_OF_SIZE_CLASSES; sizeClass++)
+    {
+        minimalSize = (sizeClass == 0) ? 0 : (1U << (sizeClass - 1)) + 1;
+
+        while ((position < numberOfBanks) &&
+               (pool->banks[bankIds[position]]->bufferSize < minimalSize))
+        {
+            position++;
+        }
+
+        pool->sizeClasses.first[sizeClass] = position;
+    }
+
+    pool->sizeClasses.numberOfBanks = numberOfBanks;
+}
+
+/*
+ * @brief   Get size class of a buffer size.
+ *
+ * Size class N holds sizes from 2^(N-1)+1 to 2^N. Sizes 0 and 1
+ * are in size class 0.
+ *
+ * @param   size        Buffer size.
+ *
+ * @return  Size class.
+ */
+static unsigned int
+SizeClass(unsigned int size)
+{
+    return (size <= 1) ? 0 : 32 - __builtin_clz(size - 1);
+}
+
+/*
+ * @brief   Find the bank of the smallest buffers that fit the requested size.
+ *
+ * Starts at the first bank of the size class and only has to skip banks
+ * of the same size class with buffers smaller than requested.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   size        Requested size.
+ *
+ * @return  Position of the bank in size class table of the pool.
+ * @return  Number of banks in size class table if no bank has buffers
+ *          large enough.
+ */
+static unsigned int
+PositionOfSize(
+    struct MMPS_Pool    *pool,
+    unsigned int        size)
+{
+    unsigned int        position;
+
+    position = pool->sizeClasses.first[SizeClass(size)];
+
+    while ((position < pool->sizeClasses.numberOfBanks) &&
+           (pool->banks[pool->sizeClasses.bankIds[position]]->bufferSize < size))
+    {
+        position++;
+    }
+
+    return position;
+}
+
+/*
+ * @brief   Peek an unused buffer from the specified MMPS bank without
+ *          complaining if the bank is exhausted.
+ *
+ * For a bank spread over NUMA nodes the sub-bank of the local node
+ * is tried first.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   bankId      Bank id to search for unused buffer.
+ * @param   ownerId     Owner id or application id the buffer
+ *                      will be associated with.
+ *
+ * @return  Pointer to MMPS buffer descriptor upon successful completion.
+ * @return  NULL if there are no free buffers available in a specified bank.
+ */
+static struct MMPS_Buffer *
+PeekBufferFromBank(
+    struct MMPS_Pool    *pool,
+    unsigned int        bankId,
+    const unsigned int  ownerId)
+{
+    struct MMPS_Bank    *bank;
+    struct MMPS_Buffer  *buffer;
+    unsigned int        bufferId;
+    unsigned int        localNode;
+    unsigned int        node;
+
+    bank = pool->banks[bankId];
+
+    bufferId = NOTHING;
+
+    localNode = LocalNode(bank);
+    for (node = 0; node < bank->numa.numberOfNodes; node++)
+    {
+        bank = NodeBank(
+                pool->banks[bankId],
+                (localNode + node) % pool->banks[bankId]->numa.numberOfNodes);
+
+        bufferId = PeekBufferId(bank);
+        if (bufferId != NOTHING)
+            break;
+    }
+
+    if (bufferId == NOTHING)
+    {
+        //
+        // All buffers are in use (peek cursor has reached the poke cursor
+        // and there are no buffers behind the poke cursor in the buffer bank).
+        //
+        return NULL;
+    }
+
+    buffer = BufferOfBank(bank, bufferId);
+
+#ifdef MMPS_USE_OWNER_ID
+    if (buffer->ownerId != MMPS_NO_OWNER)
+    {
+        ReportError("[MMPS] Got buffer that already belongs to 0x%08X",
+                ownerId);
+
+        return NULL;
+    }
+
+    buffer->ownerId = ownerId;
+#endif
+
+    // For buffers of the bank with the 'alloc on demand' flag set on,
+    // allocate memory resources for data each time when the buffer is peeked.
+    //
+    if (bank->allocateOnDemand == TRUE)
+    {
+        buffer->data = AllocateSlabChunk(buffer->bufferSize);
+        if (buffer->data == NULL)
+        {
+            MMPS_PokeBuffer(buffer);
+
+            ReportSoftAlert("[MMPS] Out of memory");
+
+            return NULL;
+        }
+
+        buffer->cursor = buffer->data;
+    }
+
+    return buffer;
+}
+
+/*
+ * @brief   Peek a chain of buffers smaller than requested size that together
+ *          hold the requested size.
+ *
+ * Buffers are taken from the bank of the largest buffers first and only
+ * when it is exhausted from the banks of smaller ones.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   position    Position of the bank in size class table, only banks
+ *                      before this position are used.
+ * @param   size        Requested size.
+ * @param   ownerId     Owner id or application id the buffers
+ *                      will be associated with.
+ *
+ * @return  Pointer to MMPS buffer descriptor of the first buffer of a chain
+ *          upon successful completion.
+ * @return  NULL if there are not enough free buffers available.
+ */
+static struct MMPS_Buffer *
+PeekChainOfSize(
+    struct MMPS_Pool    *pool,
+    unsigned int        position,
+    unsigned int        size,
+    const unsigned int  ownerId)
+{
+    struct MMPS_Buffer  *chain;
+    struct MMPS_Buffer  *lastBuffer;
+    struct MMPS_Buffer  *buffer;
+    unsigned long       chainSize;
+
+    chain = NULL;
+    lastBuffer = NULL;
+    chainSize = 0;
+
+    while ((chainSize < size) && (position > 0))
+    {
+        buffer = PeekBufferFromBank(
+                pool,
+                pool->sizeClasses.bankIds[position - 1],
+                ownerId);
+        if (buffer == NULL)
+        {
+            position--;
+            continue;
+        }
+
+        if (chain == NULL) {
+            chain = buffer;
+        } else {
+            lastBuffer->next = buffer;
+            buffer->prev = lastBuffer;
+        }
+
+        lastBuffer = buffer;
+        chainSize += buffer->bufferSize;
+    }
+
+    if (chainSize < size)
+    {
+        if (chain != NULL)
+            MMPS_PokeBuffer(chain);
+
+        return NULL;
+    }
+
+    return chain;
+}
+
+/*
+ * @brief   Allocate data memory blocks for all buffers of a bank
+ *          or of one NUMA sub-bank.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor.
+ *
+ * @return  0 upon successful completion.
+ * @return  Error code (negative value), in case of error.
+ */
+static int
+AllocateBankData(struct MMPS_Bank *bank)
+{
+    struct MMPS_Buffer  *buffer;
+    unsigned int        bufferId;
+    void                *data;
+
+    // Elastic banks reserve data for all buffers at once and commit it
+    // together with descriptor blocks.
+    //
+    if (bank->options & MMPS_BANK_ELASTIC)
+        return ReserveElasticPayload(bank, FALSE);
+
+    // Banks with huge pages or on a NUMA node get data of all buffers
+    // in one mapping.
+    //
+    if ((bank->options & (MMPS_BANK_HUGEPAGES | MMPS_BANK_NUMA)) &&
+        (bank->bufferSize != 0))
+    {
+        data = MapRange(
+                bank,
+                (size_t) bank->numberOfBuffers * bank->bufferSize,
+                "data",
+                &bank->pageSize.data);
+    }
+    else
+    {
+        data = NULL;
+    }
+
+    for (bufferId = 0; bufferId < bank->numberOfBuffers; bufferId++)
+    {
+        buffer = BufferOfBank(bank, bufferId);
+
+        buffer->data = (data != NULL)
+            ? (void *) ((unsigned long) data +
+                (unsigned long) bufferId * bank->bufferSize)
+            : malloc(buffer->bufferSize);
+        if (buffer->data == NULL)
+        {
+            ReportSoftAlert("[MMPS] Out of memory");
+
+            return MMPS_OUT_OF_MEMORY;
+        }
+
+        MMPS_ResetCursor(buffer);
+    }
+
+    return MMPS_OK;
+}
+
+/*
+ * @brief   Allocate follower memory blocks for all buffers of a bank
+ *          or of one NUMA sub-bank.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor.
+ *
+ * @return  0 upon successful completion.
+ * @return  Error code (negative value), in case of error.
+ */
+static int
+AllocateBankFollowers(struct MMPS_Bank *bank)
+{
+    struct MMPS_Buffer  *buffer;
+    unsigned int        bufferId;
+    void                *followers;
+    size_t              pageSize;
+
+    // Elastic banks reserve followers for all buffers at once and commit
+    // them together with descriptor blocks.
+    //
+    if (bank->options & MMPS_BANK_ELASTIC)
+        return ReserveElasticPayload(bank, TRUE);
+
+    // Banks on a NUMA node get followers of all buffers in one mapping.
+    //
+    if ((bank->options & MMPS_BANK_NUMA) && (bank->followerSize != 0))
+    {
+        followers = MapRange(
+                bank,
+                (size_t) bank->numberOfBuffers * bank->followerSize,
+                "followers",
+                &pageSize);
+    }
+    else
+    {
+        followers = NULL;
+    }
+
+    for (bufferId = 0; bufferId < bank->numberOfBuffers; bufferId++)
+    {
+        buffer = BufferOfBank(bank, bufferId);
+
+        buffer->follower = (followers != NULL)
+            ? (void *) ((unsigned long) followers +
+                (unsigned long) bufferId * bank->followerSize)
+            : malloc(buffer->followerSize);
+        if (buffer->follower == NULL)
+        {
+            ReportSoftAlert("[MMPS] Out of memory");
+
+            return MMPS_OUT_OF_MEMORY;
+        }
+    }
+
+    return MMPS_OK;
+}
+
+/*
+ * @brief   Put per-CPU magazines in front of the queue of "free" buffers
+ *          of a bank or of one NUMA sub-bank.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor.
+ * @param   magazineSize    Maximal number of buffer ids in each magazine.
+ *
+ * @return  0 upon successful completion.
+ * @return  Error code (negative value), in case of error.
+ */
+static int
+InitBankMagazines(
+    struct MMPS_Bank    *bank,
+    unsigned int        magazineSize)
+{
+    struct MMPS_Magazine    *magazine;
+    long                    numberOfCPUs;
+    unsigned int            magazineId;
+    size_t                  magazineStride;
+    void                    *magazines;
+
+    numberOfCPUs = sysconf(_SC_NPROCESSORS_CONF);
+    if (numberOfCPUs < 1)
+        numberOfCPUs = 1;
+
+    // Round each magazine up to a cache line, so that magazines
+    // of different CPUs never share a line.
+    //
+    magazineStride = sizeof(struct MMPS_Magazine) + magazineSize * sizeof(unsigned int);
+    magazineStride = (magazineStride + MMPS_CACHE_LINE_SIZE - 1) &
+            ~((size_t) MMPS_CACHE_LINE_SIZE - 1);
+
+    if (posix_memalign(&magazines,
+            MMPS_CACHE_LINE_SIZE,
+            numberOfCPUs * magazineStride) != 0)
+    {
+        ReportSoftAlert("[MMPS] Out of memory");
+
+        return MMPS_OUT_OF_MEMORY;
+    }
+
+    for (magazineId = 0; magazineId < numberOfCPUs; magazineId++)
+    {
+        magazine = (void *) ((unsigned long) magazines +
+                (unsigned long) (magazineId * magazineStride));
+
+        pthread_spin_init(&magazine->lock, PTHREAD_PROCESS_PRIVATE);
+
+        magazine->numberOfIds = 0;
+    }
+
+#ifdef MMPS_INIT_BANK
+    ReportDebug("[MMPS] Bank %u got %ld magazines of %u buffer ids",
+            bank->bankId,
+            numberOfCPUs,
+            magazineSize);
+#endif
+
+    bank->magazineSize      = magazineSize;
+    bank->magazineStride    = magazineStride;
+    bank->magazines         = magazines;
+    bank->numberOfMagazines = numberOfCPUs;
+
+    return MMPS_OK;
+}
+
+/*
+ * @brief   Give back memory of elastic blocks of a bank or of one NUMA
+ *          sub-bank that are not in use.
+ *
+ * Only buffer ids of the block being released are kept out of circulation,
+ * all other free buffer ids are put back to the queue right away, so that
+ * concurrent peeks are not starved while the bank is being shrunk.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor of an elastic bank.
+ *
+ * @return  Number of released blocks upon successful completion.
+ * @return  Error code (negative value), in case of error.
+ */
+static int
+ShrinkElasticBank(struct MMPS_Bank *bank)
+{
+    unsigned int        *blockIds;
+    unsigned int        numberOfBlockIds;
+    unsigned int        blockId;
+    unsigned int        firstBufferId;
+    unsigned int        numberOfBuffersInBlock;
+    int                 releasedBlocks;
+
+    pthread_mutex_lock(&bank->elastic.lock);
+
+    blockIds = malloc(bank->buffersPerBlock * sizeof(unsigned int));
+    if (blockIds == NULL)
+    {
+        pthread_mutex_unlock(&bank->elastic.lock);
+
+        ReportSoftAlert("[MMPS] Out of memory");
+
+        return MMPS_OUT_OF_MEMORY;
+    }
+
+    releasedBlocks = 0;
+
+    while (bank->elastic.numberOfCommittedBlocks > bank->elastic.numberOfInitialBlocks)
+    {
+        blockId = bank->elastic.numberOfCommittedBlocks - 1;
+        firstBufferId = blockId * bank->buffersPerBlock;
+        numberOfBuffersInBlock = NumberOfBuffersInBlock(bank, blockId);
+
+        // Do not disturb peeks at all if the block cannot be free.
+        //
+        if (NumberOfFreeBufferIds(bank) < numberOfBuffersInBlock)
+            break;
+
+        numberOfBlockIds = CollectBlockIds(bank, firstBufferId, blockIds);
+        if (numberOfBlockIds < numberOfBuffersInBlock)
+        {
+            // Some buffers of the block are still in use - give back
+            // those that have been collected.
+            //
+            PushBufferIds(bank, blockIds, numberOfBlockIds);
+
+            break;
+        }
+
+        __atomic_store_n(&bank->elastic.numberOfCommittedBlocks,
+                blockId,
+                __ATOMIC_RELEASE);
+
+        bank->blocks[blockId] = NULL;
+
+        DecommitRange(
+                (void *) ((unsigned long) bank->elastic.descriptors +
+                    (unsigned long) (blockId * bank->elastic.descriptorsStride)),
+                bank->elastic.descriptorsStride);
+
+        if (bank->elastic.data != NULL)
+        {
+            DecommitRange(
+                    (void *) ((unsigned long) bank->elastic.data +
+                        (unsigned long) (blockId * bank->elastic.dataStride)),
+                    bank->elastic.dataStride);
+        }
+
+        if (bank->elastic.followers != NULL)
+        {
+            DecommitRange(
+                    (void *) ((unsigned long) bank->elastic.followers +
+                        (unsigned long) (blockId * bank->elastic.followersStride)),
+                    bank->elastic.followersStride);
+        }
+
+        releasedBlocks++;
+    }
+
+    free(blockIds);
+
+    pthread_mutex_unlock(&bank->elastic.lock);
+
+#ifdef MMPS_INIT_BANK
+    if (releasedBlocks != 0)
+    {
+        ReportDebug("[MMPS] Released %d block(s) of bank %u, %u block(s) left",
+                releasedBlocks,
+                bank->bankId,
+                bank->elastic.numberOfCommittedBlocks);
+    }
+#endif
+
+    return releasedBlocks;
+}
+
+/*
+ * @brief   Take free buffer ids of the last committed block of an elastic
+ *          bank out of circulation.
+ *
+ * Buffer ids of the block are taken out of all magazines, then the queue
+ * of "free" buffers is passed once in batches - buffer ids of other blocks
+ * are put back immediately after each batch. Buffer ids that are poked
+ * while the queue is being passed may be missed, then the block is simply
+ * not released this time.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor of an elastic bank.
+ * @param   firstBufferId   Buffer id of the first buffer of the block.
+ * @param   blockIds    Array where the buffer ids of the block should be
+ *                      stored, large enough for all buffers of a block.
+ *
+ * @return  Number of buffer ids of the block taken out of circulation.
+ */
+static unsigned int
+CollectBlockIds(
+    struct MMPS_Bank    *bank,
+    unsigned int        firstBufferId,
+    unsigned int        *blockIds)
+{
+    struct MMPS_Magazine    *magazine;
+    unsigned int            ids[MMPS_POKE_BATCH_SIZE];
+    unsigned int            numberOfIds;
+    unsigned int            numberOfIdsToKeep;
+    unsigned int            numberOfBlockIds;
+    unsigned int            numberOfQueuedIds;
+    unsigned int            magazineId;
+    unsigned int            i;
+
+    numberOfBlockIds = 0;
+
+    for (magazineId = 0; magazineId < bank->numberOfMagazines; magazineId++)
+    {
+        magazine = MagazineById(bank, magazineId);
+
+        pthread_spin_lock(&magazine->lock);
+
+        numberOfIdsToKeep = 0;
+        for (i = 0; i < magazine->numberOfIds; i++)
+        {
+            if (magazine->ids[i] >= firstBufferId)
+                blockIds[numberOfBlockIds++] = magazine->ids[i];
+            else
+                magazine->ids[numberOfIdsToKeep++] = magazine->ids[i];
+        }
+
+        magazine->numberOfIds = numberOfIdsToKeep;
+
+        pthread_spin_unlock(&magazine->lock);
+    }
+
+    PullBufferIds(bank, ids, 0, &numberOfQueuedIds);
+
+    while (numberOfQueuedIds != 0)
+    {
+        numberOfIds = PullBufferIds(bank,
+                ids,
+                MIN(numberOfQueuedIds, MMPS_POKE_BATCH_SIZE),
+                NULL);
+        if (numberOfIds == 0)
+            break;
+
+        numberOfQueuedIds -= numberOfIds;
+
+        numberOfIdsToKeep = 0;
+        for (i = 0; i < numberOfIds; i++)
+        {
+            if (ids[i] >= firstBufferId)
+                blockIds[numberOfBlockIds++] = ids[i];
+            else
+                ids[numberOfIdsToKeep++] = ids[i];
+        }
+
+        PushBufferIds(bank, ids, numberOfIdsToKeep);
+    }
+
+    return numberOfBlockIds;
+}
+
+/*
+ * @brief   Get buffer of a bank or of one NUMA sub-bank by its buffer id.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor.
+ * @param   bufferId    Buffer id within the bank.
+ *
+ * @return  Pointer to MMPS buffer descriptor.
+ */
+static struct MMPS_Buffer *
+BufferOfBank(
+    struct MMPS_Bank    *bank,
+    unsigned int        bufferId)
+{
+    void                *block;
+    unsigned int        blockId;
+    unsigned int        bufferIdInBlock;
+    struct MMPS_Buffer  *buffer;
+
+    blockId = bufferId / bank->buffersPerBlock;
+    bufferIdInBlock = bufferId % bank->buffersPerBlock;
+    block = bank->blocks[blockId];
+
+    buffer = (void *)
+        ((unsigned long) block +
+        (unsigned long) (bufferIdInBlock * sizeof(struct MMPS_Buffer)));
+
+#ifdef MMPS_PEEK_POKE
+    ReportDebug("[MMPS] " \
+            "... bufferId=%u bufferIdInBlock=%u block=0x%016lX " \
+            "buffer=0x%016lX data=0x%016lX",
+            bufferId,
+            bufferIdInBlock,
+            (unsigned long) block,
+            (unsigned long) buffer,
+            (unsigned long) buffer->data);
+#endif
+
+    return buffer;
+}
+
+/*
+ * @brief   Peek several unused buffers from a bank or from one NUMA sub-bank
+ *          without complaining if there are not enough of them.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor.
+ * @param   numberOfBuffers Number of buffers to peek.
+ * @param   ownerId     Owner id or application id the buffers
+ *                      will be associated with.
+ *
+ * @return  Pointer to MMPS buffer descriptor of the first buffer of a chain
+ *          upon successful completion.
+ * @return  NULL if there are not enough free buffers available.
+ */
+static struct MMPS_Buffer *
+PeekBuffersFromBank(
+    struct MMPS_Bank    *bank,
+    unsigned int        numberOfBuffers,
+    const unsigned int  ownerId)
+{
+    struct MMPS_Buffer  *chain;
+    struct MMPS_Buffer  *prevBuffer;
+    struct MMPS_Buffer  *buffer;
+    unsigned int        ids[MMPS_POKE_BATCH_SIZE];
+    unsigned int        numberOfIds;
+    unsigned int        peekedIds;
+    unsigned int        i;
+
+    chain = NULL;
+    prevBuffer = NULL;
+
+    // Peek buffer ids in batches, so that the bank is visited once per batch.
+    //
+    while (numberOfBuffers != 0)
+    {
+        numberOfIds = (numberOfBuffers < MMPS_POKE_BATCH_SIZE)
+            ? numberOfBuffers
+            : MMPS_POKE_BATCH_SIZE;
+
+        peekedIds = PeekBufferIds(bank, ids, numberOfIds);
+
+        for (i = 0; i < peekedIds; i++)
+        {
+            buffer = BufferOfBank(bank, ids[i]);
+
+            // For buffers of the bank with the 'alloc on demand' flag set on,
+            // allocate memory resources for data each time when the buffer
+            // is peeked.
+            //
+            if (bank->allocateOnDemand == TRUE)
+            {
+                buffer->data = AllocateSlabChunk(buffer->bufferSize);
+                if (buffer->data == NULL)
+                {
+                    ReportSoftAlert("[MMPS] Out of memory");
+
+                    PokeBufferIds(bank, &ids[i], peekedIds - i);
+
+                    peekedIds = i;
+
+                    break;
+                }
+
+                buffer->cursor = buffer->data;
+            }
+
+#ifdef MMPS_USE_OWNER_ID
+            buffer->ownerId = ownerId;
+#endif
+
+            buffer->prev = prevBuffer;
+            buffer->next = NULL;
+
+            if (prevBuffer == NULL) {
+                chain = buffer;
+            } else {
+                prevBuffer->next = buffer;
+            }
+
+            prevBuffer = buffer;
+        }
+
+        // Either all requested buffers are peeked or none.
+        //
+        if (peekedIds < numberOfIds)
+        {
+            if (chain != NULL)
+                MMPS_PokeBuffer(chain);
+
+            return NULL;
+        }
+
+        numberOfBuffers -= numberOfIds;
+    }
+
+    return chain;
+}
+
+/*
+ * @brief   Get the sub-bank of a bank on the specified NUMA node.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor.
+ * @param   node        NUMA node, less than number of nodes of the bank.
+ *
+ * @return  Pointer to MMPS bank descriptor of the sub-bank,
+ *          the bank itself for banks without MMPS_BANK_NUMA option.
+ */
+static struct MMPS_Bank *
+NodeBank(
+    struct MMPS_Bank    *bank,
+    unsigned int        node)
+{
+    return (bank->numa.banks == NULL) ? bank : bank->numa.banks[node];
+}
+
+/*
+ * @brief   Get NUMA node of the CPU the caller is running on.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor.
+ *
+ * @return  NUMA node, 0 for banks without MMPS_BANK_NUMA option.
+ */
+static unsigned int
+LocalNode(struct MMPS_Bank *bank)
+{
+#ifdef LINUX
+    int                 cpu;
+
+    if (bank->numa.numberOfNodes == 1)
+        return 0;
+
+    cpu = sched_getcpu();
+    if ((cpu < 0) || (cpu >= numberOfCpuNodes))
+        return 0;
+
+    return cpuNodes[cpu] % bank->numa.numberOfNodes;
+#else
+    return 0;
+#endif
+}
+
+/*
+ * @brief   Get number of NUMA nodes in the system.
+ *
+ * On first call NUMA node of each CPU is looked up as well.
+ *
+ * @return  Number of NUMA nodes, at least 1.
+ */
+static unsigned int
+NumberOfNodes(void)
+{
+#ifdef LINUX
+    char                path[64];
+    unsigned int        node;
+    long                cpu;
+
+    if (numberOfNumaNodes != 0)
+        return numberOfNumaNodes;
+
+    for (node = 0; node < MMPS_MAX_NUMA_NODES; node++)
+    {
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%u", node);
+        if (access(path, F_OK) != 0)
+            break;
+    }
+
+    numberOfNumaNodes = (node == 0) ? 1 : node;
+
+    if (numberOfNumaNodes > 1)
+    {
+        numberOfCpuNodes = sysconf(_SC_NPROCESSORS_CONF);
+
+        cpuNodes = calloc(numberOfCpuNodes, sizeof(unsigned int));
+        if (cpuNodes == NULL)
+        {
+            numberOfCpuNodes = 0;
+
+            return numberOfNumaNodes;
+        }
+
+        for (cpu = 0; cpu < numberOfCpuNodes; cpu++)
+        {
+            for (node = 0; node < numberOfNumaNodes; node++)
+            {
+                snprintf(path, sizeof(path),
+                        "/sys/devices/system/node/node%u/cpu%ld",
+                        node,
+                        cpu);
+                if (access(path, F_OK) == 0)
+                {
+                    cpuNodes[cpu] = node;
+                    break;
+                }
+            }
+        }
+    }
+
+    return numberOfNumaNodes;
+#else
+    return 1;
+#endif
+}
+
+/*
+ * @brief   Place memory of a NUMA sub-bank on its node.
+ *
+ * The node is preferred rather than enforced, so that memory can still
+ * be committed when the node runs out of it. Does nothing for banks
+ * without MMPS_BANK_NUMA option.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor.
+ * @param   address     Beginning of memory range, not touched yet.
+ * @param   size        Size of memory range.
+ */
+static void
+BindToNode(
+    struct MMPS_Bank    *bank,
+    void                *address,
+    size_t              size)
+{
+#ifdef LINUX
+    unsigned long       nodeMask;
+
+    if ((bank->options & MMPS_BANK_NUMA) == 0)
+        return;
+
+    nodeMask = 1UL << bank->numa.node;
+
+    if (syscall(SYS_mbind,
+            address,
+            size,
+            MPOL_PREFERRED,
+            &nodeMask,
+            sizeof(nodeMask) * 8 + 1,
+            0) != 0)
+    {
+        ReportWarning("[MMPS] Cannot bind memory of bank %u to NUMA node %u: errno=%d",
+                bank->bankId,
+                bank->numa.node,
+                errno);
+    }
+#endif
+}
+
+/*
+ * @brief   Initialize descriptor of a buffer.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor the buffer belongs to.
+ * @param   buffer      Pointer to MMPS buffer descriptor to initialize.
+ * @param   bufferId    Buffer id.
+ */
+static void
+InitBuffer(
+    struct MMPS_Bank    *bank,
+    struct MMPS_Buffer  *buffer,
+    unsigned int        bufferId)
+{
+#ifdef MMPS_EYECATCHER
+    strncpy(buffer->eyeCatcher, EYECATCHER_BUFFER, EYECATCHER_SIZE);
+#endif
+
+#ifdef MMPS_INIT_BANK_DEEP
+    ReportDebug("[MMPS]     > buffer=0x%016lX bufferId=%u",
+            (unsigned long) buffer,
+            bufferId);
+#endif
+
+    // Initialize buffer values.
+
+    buffer->bufferId      = bufferId;
+    buffer->bank          = bank;
+    buffer->prev          = NULL;
+    buffer->next          = NULL;
+    buffer->ownerId       = MMPS_NO_OWNER;
+    buffer->touches       = 1;
+    buffer->origin        = NULL;
+    buffer->references    = 0;
+    buffer->bufferSize    = bank->bufferSize;
+    buffer->followerSize  = bank->followerSize;
+    buffer->dataSize      = 0;
+    buffer->data          = NULL;
+    buffer->cursor        = NULL;
+    buffer->dmaAddress    = NULL;
+}
+
+static unsigned int
+NumberOfBuffersInBlock(
+    struct MMPS_Bank    *bank,
+    unsigned int        blockId)
+{
+    unsigned int        firstBufferId;
+
+    firstBufferId = blockId * bank->buffersPerBlock;
+
+    return ((bank->numberOfBuffers - firstBufferId) < bank->buffersPerBlock)
+        ? bank->numberOfBuffers - firstBufferId
+        : bank->buffersPerBlock;
+}
+
+/*
+ * @brief   Get number of buffers, that have descriptors in place.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor.
+ *
+ * @return  Number of all buffers of a bank, or number of buffers
+ *          in committed blocks for elastic banks.
+ */
+static unsigned int
+NumberOfCommittedBuffers(struct MMPS_Bank *bank)
+{
+    unsigned int        numberOfCommittedBlocks;
+
+    if ((bank->options & MMPS_BANK_ELASTIC) == 0)
+        return bank->numberOfBuffers;
+
+    numberOfCommittedBlocks = __atomic_load_n(
+            &bank->elastic.numberOfCommittedBlocks,
+            __ATOMIC_ACQUIRE);
+
+    if (numberOfCommittedBlocks == 0)
+        return 0;
+
+    return (numberOfCommittedBlocks - 1) * bank->buffersPerBlock +
+        NumberOfBuffersInBlock(bank, numberOfCommittedBlocks - 1);
+}
+
+/*
+ * @brief   Get size of huge pages supported by the system.
+ *
+ * @return  Huge page size as reported by the kernel, or 2 MB if unknown.
+ */
+static size_t
+HugePageSize(void)
+{
+    static size_t       hugePageSize = 0;
+    FILE                *meminfo;
+    char                line[128];
+    unsigned long       sizeInKB;
+
+    if (hugePageSize != 0)
+        return hugePageSize;
+
+    sizeInKB = 2 * 1024;
+
+    meminfo = fopen("/proc/meminfo", "r");
+    if (meminfo != NULL)
+    {
+        while (fgets(line, sizeof(line), meminfo) != NULL)
+        {
+            if (sscanf(line, "Hugepagesize: %lu kB", &sizeInKB) == 1)
+                break;
+        }
+
+        fclose(meminfo);
+    }
+
+    hugePageSize = sizeInKB * KB;
+
+    return hugePageSize;
+}
+
+/*
+ * @brief   Round size up to the page size used for blocks of a bank.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor.
+ * @param   size        Size to round up.
+ *
+ * @return  Rounded size - multiple of huge page size for banks with huge pages,
+ *          multiple of regular page size otherwise.
+ */
+static size_t
+PageAlignedSize(
+    struct MMPS_Bank    *bank,
+    size_t              size)
+{
+    size_t              pageSize;
+
+    pageSize = (bank->options & MMPS_BANK_HUGEPAGES)
+        ? HugePageSize()
+        : (size_t) sysconf(_SC_PAGESIZE);
+
+    return (size + pageSize - 1) & ~(pageSize - 1);
 }
 
 /*
- * @brief   Append a buffer at the end of a chain.
+ * @brief   Map and commit memory for descriptors, data or followers of a bank.
  *
- * Append buffer or a chain of buffers to another buffer
- * or another chain of buffers.
+ * For banks with huge pages explicit huge pages (MAP_HUGETLB) are tried
+ * first. If the system has no huge pages reserved, memory is mapped
+ * with regular pages aligned to huge page size and advised for transparent
+ * huge pages. Memory of NUMA sub-banks is placed on their node.
  *
- * @param   destination Pointer to MMPS buffer descriptor from the chain
- *                      to append new buffer to.
- * @param   appendage   Pointer to MMPS buffer descriptor
- *                      that has to be appended at the end of a chain.
+ * @param   bank        Pointer to MMPS bank descriptor.
+ * @param   size        Size of memory to map.
+ * @param   purpose     What the memory is used for (diagnostics only).
+ * @param   pageSize    Where to store the effective page size.
  *
- * @return  If a valid pointer to MMPS buffer descriptor is provided
- *          as destination reference, then the same pointer is returned.
- *          If destination is referenced as NULL, then the appendage reference
- *          is returned.
+ * @return  Pointer to mapped memory.
+ * @return  NULL if memory cannot be mapped.
  */
-struct MMPS_Buffer *
-MMPS_AppendBuffer(
-    struct MMPS_Buffer *destination,
-    struct MMPS_Buffer *appendage)
+static void *
+MapRange(
+    struct MMPS_Bank    *bank,
+    size_t              size,
+    const char          *purpose,
+    size_t              *pageSize)
 {
-    struct MMPS_Buffer *buffer;
+    size_t              hugePageSize;
+    void                *address;
+    boolean             hugetlb;
 
-    if (destination == NULL)
+    hugePageSize = HugePageSize();
+    size = PageAlignedSize(bank, size);
+
+    address = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+    if (bank->options & MMPS_BANK_HUGEPAGES)
     {
-        return appendage;
+        address = mmap(
+                NULL,
+                size,
+                PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+                -1,
+                0);
+    }
+#endif
+
+    hugetlb = (address != MAP_FAILED) ? TRUE : FALSE;
+    if (hugetlb == TRUE)
+    {
+        *pageSize = hugePageSize;
+
+        BindToNode(bank, address, size);
     }
     else
     {
-        buffer = MMPS_LastBuffer(destination);
-        buffer->next = appendage;
-        appendage->prev = buffer;
-        return destination;
+        address = ReserveRange(bank, size, pageSize);
+        if (address == NULL)
+            return NULL;
+
+        if (CommitRange(address, size) != MMPS_OK)
+        {
+            munmap(address, size);
+
+            return NULL;
+        }
     }
+
+#ifdef MMPS_INIT_BANK
+    ReportDebug("[MMPS] Bank %u %s: %lu KB at 0x%016lX with %s of %lu KB",
+            bank->bankId,
+            purpose,
+            size >> 10,
+            (unsigned long) address,
+            (hugetlb == TRUE)
+                ? "huge pages"
+                : (*pageSize == hugePageSize)
+                    ? "transparent huge pages"
+                    : "regular pages",
+            *pageSize >> 10);
+#endif
+
+    return address;
 }
 
 /*
- * @brief   Remove buffer from a chain of buffers.
+ * @brief   Reserve address range without committing memory for it.
  *
- * @param   anchor      Pointer to MMPS buffer chan anchor.
- * @param   removal     Pointer to MMPS buffer to be removed from a chain.
+ * For banks with huge pages the range is aligned to huge page size
+ * and advised for transparent huge pages. The range of a NUMA sub-bank
+ * is bound to its node, so that memory committed later is placed there.
  *
- * @return  Pointer to MMPS buffer descriptor that is a new anchor of a chain.
+ * @param   bank        Pointer to MMPS bank descriptor.
+ * @param   size        Size of address range (see PageAlignedSize()).
+ * @param   pageSize    Where to store the effective page size.
+ *
+ * @return  Pointer to the beginning of address range.
+ * @return  NULL if address range cannot be reserved.
  */
-struct MMPS_Buffer *
-MMPS_RemoveFromChain(
-    struct MMPS_Buffer *anchor,
-    struct MMPS_Buffer *removal)
+static void *
+ReserveRange(
+    struct MMPS_Bank    *bank,
+    size_t              size,
+    size_t              *pageSize)
 {
-    struct MMPS_Buffer *newAnchor;
+    size_t              alignment;
+    void                *address;
+    unsigned long       alignedAddress;
 
-    if (anchor == removal)
+    *pageSize = sysconf(_SC_PAGESIZE);
+
+    alignment = (bank->options & MMPS_BANK_HUGEPAGES) ? HugePageSize() : 0;
+
+    address = mmap(
+            NULL,
+            size + alignment,
+            PROT_NONE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+            -1,
+            0);
+
+    if (address == MAP_FAILED)
     {
-        // MMPS buffer to be removed from the chain is actually the chain anchor.
-        // Set new chain anchor .
+        ReportError("[MMPS] Cannot reserve %lu bytes of address space: errno=%d",
+                size,
+                errno);
 
-        newAnchor = removal->next;
+        return NULL;
+    }
 
-        if (removal->next != NULL)
+    if (alignment != 0)
+    {
+        // Cut off the unaligned head and the rest of the tail.
+        //
+        alignedAddress = ((unsigned long) address + alignment - 1) & ~(alignment - 1);
+
+        if (alignedAddress != (unsigned long) address)
+            munmap(address, alignedAddress - (unsigned long) address);
+
+        munmap((void *) (alignedAddress + size),
+                (unsigned long) address + alignment - alignedAddress);
+
+        address = (void *) alignedAddress;
+
+#ifdef MADV_HUGEPAGE
+        if (madvise(address, size, MADV_HUGEPAGE) == 0)
+            *pageSize = alignment;
+#endif
+    }
+
+    BindToNode(bank, address, size);
+
+    return address;
+}
+
+static int
+CommitRange(
+    void                *address,
+    size_t              size)
+{
+    if (mprotect(address, size, PROT_READ | PROT_WRITE) != 0)
+    {
+        ReportSoftAlert("[MMPS] Cannot commit %lu bytes: errno=%d",
+                size,
+                errno);
+
+        return MMPS_OUT_OF_MEMORY;
+    }
+
+    return MMPS_OK;
+}
+
+static void
+DecommitRange(
+    void                *address,
+    size_t              size)
+{
+    madvise(address, size, MADV_DONTNEED);
+    mprotect(address, size, PROT_NONE);
+}
+
+/*
+ * @brief   Reserve descriptor blocks of an elastic bank and commit
+ *          the first one.
+ *
+ * The queue of "free" buffers starts empty and only buffers
+ * of committed blocks are put into it.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor.
+ *
+ * @return  0 upon successful completion.
+ * @return  Error code (negative value), in case of error.
+ */
+static int
+InitElasticBank(struct MMPS_Bank *bank)
+{
+    unsigned int        blockId;
+    unsigned int        slotId;
+
+    bank->elastic.descriptorsStride =
+            PageAlignedSize(bank, bank->buffersPerBlock * sizeof(struct MMPS_Buffer));
+
+    bank->elastic.descriptors = ReserveRange(
+            bank,
+            bank->numberOfBlocks * bank->elastic.descriptorsStride,
+            &bank->pageSize.descriptors);
+    if (bank->elastic.descriptors == NULL)
+        return MMPS_OUT_OF_MEMORY;
+
+    for (blockId = 0; blockId < bank->numberOfBlocks; blockId++)
+        bank->blocks[blockId] = NULL;
+
+    for (slotId = 0; slotId < bank->numberOfBuffers; slotId++)
+    {
+        bank->ids[slotId] = NOTHING;
+#ifdef MMPS_LOCKFREE
+        bank->sequences[slotId] = slotId;
+#endif
+    }
+
+    bank->cursor.peek = 0;
+    bank->cursor.poke = 0;
+
+    bank->elastic.numberOfInitialBlocks = 1;
+
+    return CommitNextBlock(bank, 0);
+}
+
+/*
+ * @brief   Commit next block of an elastic bank and put its buffers
+ *          to the queue of "free" buffers.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor.
+ * @param   numberOfCommittedBlocks Number of committed blocks as seen
+ *                      by the caller. If another thread has changed it
+ *                      in the meantime, then nothing is committed and the
+ *                      caller should simply try to peek again.
+ *
+ * @return  0 upon successful completion.
+ * @return  Error code (negative value), if all blocks are already committed
+ *          or memory cannot be committed.
+ */
+static int
+CommitNextBlock(
+    struct MMPS_Bank    *bank,
+    unsigned int        numberOfCommittedBlocks)
+{
+    struct MMPS_Buffer  *buffer;
+    unsigned int        ids[MMPS_POKE_BATCH_SIZE];
+    unsigned int        numberOfIds;
+    unsigned int        blockId;
+    unsigned int        firstBufferId;
+    unsigned int        numberOfBuffersInBlock;
+    unsigned int        bufferIdInBlock;
+    void                *block;
+    void                *data;
+    void                *followers;
+    int                 rc;
+
+    pthread_mutex_lock(&bank->elastic.lock);
+
+    blockId = bank->elastic.numberOfCommittedBlocks;
+    if (blockId != numberOfCommittedBlocks)
+    {
+        pthread_mutex_unlock(&bank->elastic.lock);
+
+        return MMPS_OK;
+    }
+
+    if (blockId == bank->numberOfBlocks)
+    {
+        pthread_mutex_unlock(&bank->elastic.lock);
+
+        return MMPS_BANK_EXHAUSTED;
+    }
+
+    firstBufferId = blockId * bank->buffersPerBlock;
+    numberOfBuffersInBlock = NumberOfBuffersInBlock(bank, blockId);
+
+    block = (void *) ((unsigned long) bank->elastic.descriptors +
+            (unsigned long) (blockId * bank->elastic.descriptorsStride));
+
+    data = (bank->elastic.data == NULL)
+        ? NULL
+        : (void *) ((unsigned long) bank->elastic.data +
+            (unsigned long) (blockId * bank->elastic.dataStride));
+
+    followers = (bank->elastic.followers == NULL)
+        ? NULL
+        : (void *) ((unsigned long) bank->elastic.followers +
+            (unsigned long) (blockId * bank->elastic.followersStride));
+
+    rc = CommitRange(block, bank->elastic.descriptorsStride);
+    if ((rc == MMPS_OK) && (data != NULL))
+        rc = CommitRange(data, bank->elastic.dataStride);
+    if ((rc == MMPS_OK) && (followers != NULL))
+        rc = CommitRange(followers, bank->elastic.followersStride);
+
+    if (rc != MMPS_OK)
+    {
+        DecommitRange(block, bank->elastic.descriptorsStride);
+        if (data != NULL)
+            DecommitRange(data, bank->elastic.dataStride);
+        if (followers != NULL)
+            DecommitRange(followers, bank->elastic.followersStride);
+
+        pthread_mutex_unlock(&bank->elastic.lock);
+
+        return rc;
+    }
+
+    for (bufferIdInBlock = 0;
+         bufferIdInBlock < numberOfBuffersInBlock;
+         bufferIdInBlock++)
+    {
+        buffer = (void *)
+            ((unsigned long) block +
+            (unsigned long) (bufferIdInBlock * sizeof(struct MMPS_Buffer)));
+
+        InitBuffer(bank, buffer, firstBufferId + bufferIdInBlock);
+
+        if (data != NULL)
         {
-            removal->next->prev = NULL;
-            removal->next = NULL;
+            buffer->data = (void *) ((unsigned long) data +
+                    (unsigned long) (bufferIdInBlock * bank->bufferSize));
+            buffer->cursor = buffer->data;
         }
 
-        return newAnchor;
+        if (followers != NULL)
+        {
+            buffer->follower = (void *) ((unsigned long) followers +
+                    (unsigned long) (bufferIdInBlock * bank->followerSize));
+        }
     }
-    else
+
+    bank->blocks[blockId] = block;
+
+    __atomic_store_n(&bank->elastic.numberOfCommittedBlocks,
+            blockId + 1,
+            __ATOMIC_RELEASE);
+
+    // Make the buffers of the new block available.
+    //
+    for (bufferIdInBlock = 0;
+         bufferIdInBlock < numberOfBuffersInBlock;
+         bufferIdInBlock += numberOfIds)
     {
-        if (removal->prev != NULL)
+        for (numberOfIds = 0;
+             (numberOfIds < MMPS_POKE_BATCH_SIZE) &&
+             (bufferIdInBlock + numberOfIds < numberOfBuffersInBlock);
+             numberOfIds++)
         {
-            removal->prev->next = removal->next;
-            removal->prev = NULL;
+            ids[numberOfIds] = firstBufferId + bufferIdInBlock + numberOfIds;
         }
 
-        if (removal->next != NULL)
+        PushBufferIds(bank, ids, numberOfIds);
+    }
+
+    pthread_mutex_unlock(&bank->elastic.lock);
+
+#ifdef MMPS_INIT_BANK
+    ReportDebug("[MMPS] Committed block %u of bank %u with %u buffers",
+            blockId,
+            bank->bankId,
+            numberOfBuffersInBlock);
+#endif
+
+    return MMPS_OK;
+}
+
+/*
+ * @brief   Reserve data or followers for all buffers of an elastic bank.
+ *
+ * Memory for blocks, that are already committed, is committed immediately.
+ * Memory for other blocks is committed together with their descriptors.
+ *
+ * @param   bank        Pointer to MMPS bank descriptor.
+ * @param   followers   TRUE to reserve followers, FALSE to reserve data.
+ *
+ * @return  0 upon successful completion.
+ * @return  Error code (negative value), in case of error.
+ */
+static int
+ReserveElasticPayload(
+    struct MMPS_Bank    *bank,
+    boolean             followers)
+{
+    struct MMPS_Buffer  *buffer;
+    unsigned int        blockId;
+    unsigned int        bufferIdInBlock;
+    unsigned int        numberOfBuffersInBlock;
+    size_t              itemSize;
+    size_t              stride;
+    size_t              pageSize;
+    void                *range;
+    void                *items;
+    int                 rc;
+
+    itemSize = (followers == TRUE) ? bank->followerSize : bank->bufferSize;
+    stride = PageAlignedSize(bank, bank->buffersPerBlock * itemSize);
+
+    pthread_mutex_lock(&bank->elastic.lock);
+
+    range = ReserveRange(
+            bank,
+            bank->numberOfBlocks * stride,
+            (followers == TRUE) ? &pageSize : &bank->pageSize.data);
+    if (range == NULL)
+    {
+        pthread_mutex_unlock(&bank->elastic.lock);
+
+        return MMPS_OUT_OF_MEMORY;
+    }
+
+    rc = MMPS_OK;
+
+    for (blockId = 0; blockId < bank->elastic.numberOfCommittedBlocks; blockId++)
+    {
+        items = (void *) ((unsigned long) range +
+                (unsigned long) (blockId * stride));
+
+        rc = CommitRange(items, stride);
+        if (rc != MMPS_OK)
+            break;
+
+        numberOfBuffersInBlock = NumberOfBuffersInBlock(bank, blockId);
+
+        for (bufferIdInBlock = 0;
+             bufferIdInBlock < numberOfBuffersInBlock;
+             bufferIdInBlock++)
         {
-            removal->next->prev = removal->prev;
-            removal->next = NULL;
+            buffer = (void *)
+                ((unsigned long) bank->blocks[blockId] +
+                (unsigned long) (bufferIdInBlock * sizeof(struct MMPS_Buffer)));
+
+            if (followers == TRUE) {
+                buffer->follower = (void *) ((unsigned long) items +
+                        (unsigned long) (bufferIdInBlock * itemSize));
+            } else {
+                buffer->data = (void *) ((unsigned long) items +
+                        (unsigned long) (bufferIdInBlock * itemSize));
+                buffer->cursor = buffer->data;
+            }
         }
+    }
 
-        return anchor;
+    if (followers == TRUE) {
+        bank->elastic.followers = range;
+        bank->elastic.followersStride = stride;
+    } else {
+        bank->elastic.data = range;
+        bank->elastic.dataStride = stride;
     }
+
+    pthread_mutex_unlock(&bank->elastic.lock);
+
+#ifdef MMPS_INIT_BANK
+    ReportDebug("[MMPS] Bank %u %s: %lu KB reserved with pages of %lu KB",
+            bank->bankId,
+            (followers == TRUE) ? "followers" : "data",
+            (bank->numberOfBlocks * stride) >> 10,
+            ((followers == TRUE) ? pageSize : bank->pageSize.data) >> 10);
+#endif
+
+    return rc;
 }
 
 /*
- * @brief   Truncate buffers at the end of a chain.
+ * @brief   Allocate memory for a block of buffer descriptors that are not
+ *          part of a mapped range.
  *
- * Cut buffers chained on a referenced buffer and give the cut buffers
- * back to the pool. All buffers, succeeding the referenced buffer,
- * will be removed from the chain and put back to the MMPS pool.
- * If referenced buffer is the first buffer in a chain, then after completion
- * of MMPS_TruncateBuffer() this buffer will be a standalone buffer
- * (not chained buffer). If referenced buffer is not the first buffer
- * in a chain, then after completion of MMPS_TruncateBuffer() this buffer
- * will be the last buffer of a chain.
+ * The block starts on a cache line boundary, as required by descriptors
+ * built with MMPS_ALIGN_DESCRIPTORS.
  *
- * @param   tailingBuffer   Pointer to MMPS buffer descriptor of the buffer,
- *                          which must be the tailing buffer after the trancate.
+ * @param   size        Size of the block in bytes.
+ *
+ * @return  Pointer to the block upon successful completion.
+ * @return  NULL if there is not enough memory.
  */
-void
-MMPS_TruncateChain(struct MMPS_Buffer *tailingBuffer)
+static void *
+AllocateDescriptors(size_t size)
 {
-    struct MMPS_Buffer  *bufferToPurge;
+    void                *block;
+
+    if (posix_memalign(&block, MMPS_CACHE_LINE_SIZE, size) != 0)
+        return NULL;
+
+    return block;
+}
+
+static struct MMPS_Buffer *
+TakeSpliceDescriptor(struct MMPS_Pool *pool)
+{
+    struct MMPS_Buffer  *batch;
+    struct MMPS_Buffer  *buffer;
+    unsigned int        i;
+
+    pthread_spin_lock(&pool->splices.lock);
+
+    buffer = pool->splices.spares;
+    if (buffer != NULL)
+        pool->splices.spares = buffer->next;
+
+    pthread_spin_unlock(&pool->splices.lock);
+
+    if (buffer != NULL)
+        return buffer;
+
+    // Stash is empty - allocate a batch of descriptors, take the first
+    // of them and put the others to the stash.
+    //
+    batch = AllocateDescriptors(MMPS_SPLICES_PER_BATCH * sizeof(struct MMPS_Buffer));
+    if (batch == NULL)
+    {
+        ReportSoftAlert("[MMPS] Out of memory");
+
+        return NULL;
+    }
+
+    memset(batch, 0, MMPS_SPLICES_PER_BATCH * sizeof(struct MMPS_Buffer));
 
-    bufferToPurge = MMPS_NextBuffer(tailingBuffer);
-    if (bufferToPurge != NULL)
+    for (i = 1; i < MMPS_SPLICES_PER_BATCH; i++)
     {
-        tailingBuffer->next = NULL;
-        bufferToPurge->prev = NULL;
-        MMPS_PokeBuffer(bufferToPurge);
+#ifdef MMPS_EYECATCHER
+        strncpy(batch[i].eyeCatcher, EYECATCHER_BUFFER, EYECATCHER_SIZE);
+#endif
+        batch[i].next = (i < MMPS_SPLICES_PER_BATCH - 1)
+            ? &batch[i + 1]
+            : NULL;
     }
-}
 
-/*
- * @brief   Copy data from one buffer chain to another.
- *
- * If destination chain of buffers is smaller than the source
- * then only a part of data will be copied.
- *
- * @param   destination Pointer to MMPS buffer descriptor
- *                      of the destination buffer chain.
- * @param   source      Pointer to MMPS buffer descriptor
- *                      of the source buffer chain.
- *
- * @return  Number of bytes being copied.
- */
-unsigned int
-MMPS_CopyBuffer(struct MMPS_Buffer *destination, struct MMPS_Buffer *source)
-{
-    char            *destinationCursor;
-    char            *sourceCursor;
-    unsigned int    destinationBytes;
-    unsigned int    sourceBytes;
-    unsigned int    bytesToCopy;
-    unsigned int    totalCopiedBytes;
+#ifdef MMPS_EYECATCHER
+    strncpy(batch[0].eyeCatcher, EYECATCHER_BUFFER, EYECATCHER_SIZE);
+#endif
 
-    totalCopiedBytes = 0;
+    pthread_spin_lock(&pool->splices.lock);
 
-    destinationCursor = destination->data;
-    sourceCursor = source->data;
+    batch[MMPS_SPLICES_PER_BATCH - 1].next = pool->splices.spares;
+    pool->splices.spares = &batch[1];
 
-    destinationBytes = destination->bufferSize;
-    sourceBytes = source->dataSize;
+    pthread_spin_unlock(&pool->splices.lock);
 
-    while (destination != NULL)
-    {
-        // If current destination buffer is full, then switch
-        // to the next buffer in a destination chain.
-        // If there are no other buffers in a destination chain
-        // then the job is done
-        //
-        if (destinationBytes == 0)
-        {
-            destination = MMPS_NextBuffer(destination);
-            if (destination == NULL)
-                break;
+    return &batch[0];
+}
 
-            destinationCursor = destination->data;
-            destinationBytes = destination->bufferSize;
-        }
+static void
+GiveSpliceDescriptor(
+    struct MMPS_Pool    *pool,
+    struct MMPS_Buffer  *buffer)
+{
+    buffer->prev = NULL;
+    buffer->origin = NULL;
+    buffer->data = NULL;
+    buffer->cursor = NULL;
+    buffer->dataSize = 0;
+#ifdef MMPS_USE_OWNER_ID
+    buffer->ownerId = MMPS_NO_OWNER;
+#endif
 
-        // If current source buffer is copied completely, then switch
-        // to the next buffer in a source chain. If there are no other buffers
-        // in a source chain then the job is done
-        //
-        if (sourceBytes == 0)
-        {
-            source = MMPS_NextBuffer(source);
-            if (source == NULL)
-                break;
+    pthread_spin_lock(&pool->splices.lock);
 
-            sourceCursor = source->data;
-            sourceBytes = source->dataSize;
-        }
+    buffer->next = pool->splices.spares;
+    pool->splices.spares = buffer;
 
-        if (destinationBytes < sourceBytes) {
-            //
-            // Either copy as much as may fit in a current destination buffer ...
-            //
-            bytesToCopy = destinationBytes;
-        } else {
-            //
-            // ... or as much as is left in a current source buffer.
-            //
-            bytesToCopy = sourceBytes;
-        }
+    pthread_spin_unlock(&pool->splices.lock);
+}
 
-        destination->dataSize += bytesToCopy;
+/*
+ * @brief   Count one more buffer referencing the data block of a buffer.
+ *
+ * Data block that was never spliced is referenced by its own buffer only,
+ * so on first splice the number of references goes from 0 to 2.
+ */
+static void
+ShareDataBlock(struct MMPS_Buffer *owner)
+{
+#if defined(MMPS_LOCKFREE)
 
-        // Copy piece of data.
-        //
-        memcpy(destinationCursor, sourceCursor, bytesToCopy);
+    unsigned            expected;
 
-        totalCopiedBytes += bytesToCopy;
+    expected = 0;
+    if (__atomic_compare_exchange_n(&owner->references, &expected, 2,
+            FALSE, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED) == FALSE)
+    {
+        __atomic_add_fetch(&owner->references, 1, __ATOMIC_RELAXED);
+    }
 
-        // Move both cursors forwards.
-        //
-        destinationCursor += bytesToCopy;
-        sourceCursor += bytesToCopy;
+#else
 
-        // And decrease both bytes counters.
-        //
-        destinationBytes -= bytesToCopy;
-        sourceBytes -= bytesToCopy;
-    }
+    BankLock(owner->bank);
 
-    return totalCopiedBytes;
+    owner->references = (owner->references == 0) ? 2 : owner->references + 1;
+
+    BankUnlock(owner->bank);
+
+#endif
 }
 
 /*
- * @brief   Get total data size summarized for all buffers in a chain.
- *
- * The buffers in a chain may belong to different banks and be of different size.
- *
- * @param   firstBuffer Pointer to MMPS buffer descriptor of the first buffer
- *                      in a chain to begin counting from.
+ * @brief   Count one buffer less referencing the data block of a buffer.
  *
- * @return  Total data size in bytes.
+ * @return  Number of buffers still referencing the data block.
  */
-inline unsigned int
-MMPS_TotalDataSize(struct MMPS_Buffer *firstBuffer)
+static unsigned int
+ReleaseDataBlock(struct MMPS_Buffer *owner)
 {
-    unsigned int        totalDataSize;
-    struct MMPS_Buffer  *buffer;
+    unsigned int        references;
 
-    totalDataSize = 0;
-    for (buffer = firstBuffer; buffer != NULL; buffer = buffer->next)
-        totalDataSize += buffer->dataSize;
+#if defined(MMPS_LOCKFREE)
 
-    return totalDataSize;
+    references = __atomic_sub_fetch(&owner->references, 1, __ATOMIC_ACQ_REL);
+
+#else
+
+    BankLock(owner->bank);
+
+    references = --owner->references;
+
+    BankUnlock(owner->bank);
+
+#endif
+
+    return references;
 }
 
 /*
- * @brief   Reset data size to 0.
- *
- * Reset data size to 0 for referencing buffer or, if a chain of buffers
- * is referenced, for all buffers in a chain.
+ * @brief   Drop one touch of a buffer.
  *
- * @param   buffer      Pointer to MMPS buffer descriptor or anchor
- *                      of a chain of buffers.
+ * @return  Number of touches left. Buffer may go back to its bank
+ *          only if it is 0.
  */
-inline void
-MMPS_ResetBufferData(struct MMPS_Buffer *buffer)
+static unsigned int
+DropTouch(struct MMPS_Buffer *buffer)
 {
-    while (buffer != NULL)
-    {
-        buffer->cursor = buffer->data;
-        buffer->dataSize = 0;
-        buffer = buffer->next;
-    }
+#ifdef LINUX
+    return __atomic_sub_fetch(&buffer->touches, 1, __ATOMIC_ACQ_REL);
+#else
+    return atomic_sub_value(&buffer->touches, 1) - 1;
+#endif
 }
 
 /*
- * @brief   Reset cursor to the beginning of data.
+ * @brief   Wake up callers waiting in MMPS_PeekBufferTimed() for buffers
+ *          of a bank, after buffer ids were given back to it.
  *
- * Reset cursor to position to the beginning of data for referencing buffer or,
- * if a chain of buffers is referenced, for all buffers in a chain.
+ * Waiters always wait on the top level bank, also for banks spread
+ * over NUMA nodes. The check for waiters is lock-free, so that pokes
+ * to a bank nobody waits on cost only a memory fence.
  *
- * @param   buffer      Pointer to MMPS buffer descriptor.
+ * @param   bank        Pointer to MMPS bank descriptor.
  */
-inline void
-MMPS_ResetCursor(struct MMPS_Buffer *buffer)
+static void
+WakeWaiters(struct MMPS_Bank *bank)
 {
-    while (buffer != NULL)
+    bank = bank->pool->banks[bank->bankId];
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&bank->waiters.numberOfWaiters, __ATOMIC_RELAXED) == 0)
+        return;
+
+    pthread_mutex_lock(&bank->waiters.lock);
+
+    bank->waiters.numberOfWakeups++;
+
+    pthread_cond_broadcast(&bank->waiters.condition);
+
+    pthread_mutex_unlock(&bank->waiters.lock);
+}
+
+static void
+InitSlabs(void)
+{
+    unsigned int        slabClass;
+
+    for (slabClass = 0; slabClass < MMPS_SLAB_NUMBER_OF_CLASSES; slabClass++)
     {
-        buffer->cursor = buffer->data;
-        buffer = buffer->next;
+        pthread_spin_init(&slabClasses[slabClass].lock, PTHREAD_PROCESS_PRIVATE);
+        slabClasses[slabClass].slabs = NULL;
+        slabClasses[slabClass].numberOfEmptySlabs = 0;
     }
+
+    pthread_key_create(&slabCacheKey, FlushSlabCache);
 }
 
 /*
- * @brief   Move cursor forwards for specified amount of bytes.
- *
- * If new absolute offset is located in another buffer of a chain then switch
- * from the referencing buffer to succeeding buffers through the chain
- * until a proper buffer is reached.
- *
- * @param   buffer          Pointer to MMPS buffer descriptor.
- * @param   relativeOffset  Number of bytes to move cursor forwards.
+ * @brief   Get slab cache of the calling thread, create it on first use.
  *
- * @return  Pointer to MMPS buffer descriptor of a buffer where the cursor
- *          is positioned after the move operation. If new the absolute
- *          position, calculated by current cursor position and relative offset,
- *          is out of range of the referencing buffer or chain of buffers,
- *          then a NULL pointer is returned.
+ * @return  Pointer to slab cache or NULL if it cannot be created.
  */
-struct MMPS_Buffer *
-MMPS_MoveCursorRelative(
-    struct MMPS_Buffer  *buffer,
-    unsigned int        relativeOffset)
+static struct SlabCache *
+LocalSlabCache(void)
 {
-    int bytesThatWouldFit;
+    if (slabCache != NULL)
+        return slabCache;
 
-    // Find out how many bytes would fit in the current buffer.
-    //
-    bytesThatWouldFit =
-        buffer->dataSize - (buffer->cursor - buffer->data) - relativeOffset;
+    slabCache = malloc(sizeof(struct SlabCache));
+    if (slabCache == NULL)
+        return NULL;
 
-    // Delta equal 0 means that the new cursor position would point to the
-    // beginning of next buffer. Extend the chain by one buffer if needed.
-    // Delta greater than 0 means that the new data will fit
-    // in the current buffer and there will be still free space left.
-    // Negative value shows how many bytes would not fit in the current buffer.
-    // In such case the chain has to be extended.
+    memset(slabCache->numberOfChunks, 0, sizeof(slabCache->numberOfChunks));
+
+    // Chunks cached by a thread go back to the free lists when it exits.
     //
-    if (bytesThatWouldFit == 0)
-    {
-        if (buffer->next != NULL)
-        {
-            buffer = buffer->next;
+    pthread_setspecific(slabCacheKey, slabCache);
 
-            buffer->cursor = buffer->data;
-        }
-        else
-        {
-            buffer = MMPS_ExtendBuffer(buffer);
-        }
+    return slabCache;
+}
 
-        return buffer;
-    }
-    else if (bytesThatWouldFit > 0)
-    {
-        buffer->cursor += relativeOffset;
+/*
+ * @brief   Give all chunks of a slab cache back to the free lists
+ *          and release the cache. Called on exit of the thread.
+ */
+static void
+FlushSlabCache(void *arg)
+{
+    struct SlabCache    *cache = arg;
+    unsigned int        slabClass;
 
-        return buffer;
-    }
-    else
+    for (slabClass = 0; slabClass < MMPS_SLAB_NUMBER_OF_CLASSES; slabClass++)
     {
-        relativeOffset -= buffer->dataSize - (buffer->cursor - buffer->data);
+        GiveSlabChunks(slabClass,
+                cache->chunks[slabClass],
+                cache->numberOfChunks[slabClass]);
+    }
 
-        if (buffer->next != NULL)
-        {
-            buffer = buffer->next;
-        }
-        else
-        {
-            buffer = MMPS_ExtendBuffer(buffer);
-        }
+    free(cache);
 
-        buffer = MMPS_MoveCursorRelative(buffer, relativeOffset);
+    slabCache = NULL;
+}
 
-        return buffer;
-    }
+/*
+ * @brief   Get size of slabs of a size class.
+ */
+static size_t
+SlabSize(unsigned int slabClass)
+{
+    size_t              chunkSize;
+
+    chunkSize = 1UL << (slabClass + MMPS_SLAB_MIN_CLASS);
+
+    return (chunkSize * MMPS_SLAB_MIN_CHUNKS > MMPS_SLAB_SIZE)
+        ? chunkSize * MMPS_SLAB_MIN_CHUNKS
+        : MMPS_SLAB_SIZE;
 }
 
 /*
- * @brief   Find out whether cursor is pointing to the end of data.
- *
- * Only current buffer is examined - not the other buffers in a chain.
- *
- * @param   buffer      Pointer to MMPS buffer descriptor.
+ * @brief   Map a new slab aligned to its size and put all its chunks
+ *          but the first one (which holds slab descriptor) to its free list.
  *
- * @return  Boolean true if cursor is pointing to the last byte, or false if not.
+ * @return  Pointer to slab descriptor or NULL if slab cannot be mapped.
  */
-boolean
-MMPS_IsCursorAtTheEndOfData(struct MMPS_Buffer *buffer)
+static struct Slab *
+MapSlab(unsigned int slabClass)
 {
-    // TODO
+    size_t              chunkSize;
+    size_t              slabSize;
+    char                *address;
+    unsigned long       alignedAddress;
+    struct Slab         *slab;
+    char                *chunk;
+
+    chunkSize = 1UL << (slabClass + MMPS_SLAB_MIN_CLASS);
+    slabSize = SlabSize(slabClass);
+
+    address = mmap(NULL,
+            slabSize * 2,
+            PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS,
+            -1,
+            0);
+    if (address == MAP_FAILED)
+        return NULL;
 
-    if (buffer->next)
-        return false;
+    // Cut off the unaligned head and the rest of the tail.
+    //
+    alignedAddress = ((unsigned long) address + slabSize - 1) & ~(slabSize - 1);
+
+    if (alignedAddress != (unsigned long) address)
+        munmap(address, alignedAddress - (unsigned long) address);
+
+    munmap((void *) (alignedAddress + slabSize),
+            (unsigned long) address + slabSize - alignedAddress);
+
+    slab = (struct Slab *) alignedAddress;
+    slab->next = NULL;
+    slab->prev = NULL;
+    slab->chunks = NULL;
+    slab->numberOfChunks = slabSize / chunkSize - 1;
+    slab->numberOfFreeChunks = slab->numberOfChunks;
 
-    if (buffer->cursor < (buffer->data + buffer->dataSize)) {
-        return false;
-    } else {
-        return true;
+    for (chunk = (char *) alignedAddress + slabSize - chunkSize;
+         chunk != (char *) alignedAddress;
+         chunk -= chunkSize)
+    {
+        *(void **) chunk = slab->chunks;
+        slab->chunks = chunk;
     }
+
+    return slab;
 }
 
 /*
- * @brief   Put (write) data to a buffer chain under cursor.
- *
- * Append new buffer if necessary.
- *
- * @param   buffer          Pointer to MMPS buffer descriptor.
- * @param   sourceData      Pointer to memory area to copy data from.
- * @param   sourceDataSize  Size of data to copy.
- *
- * @return  Pointer to MMPS buffer descriptor of a buffer in which a cursor
- *          is pointing to, after write is complete.
+ * @brief   Take chunks from slabs of a size class. If no slab has free
+ *          chunks, then a new slab is mapped.
  *
- * @warning Always care about return value - it may be another buffer
- *          than a referenced buffer.
+ * @return  Number of chunks taken, 0 if a new slab cannot be mapped.
  */
-struct MMPS_Buffer *
-MMPS_PutData(
-    struct MMPS_Buffer  *buffer,
-    const char* const   sourceData,
-    unsigned int        sourceDataSize)
+static unsigned int
+TakeSlabChunks(
+    unsigned int        slabClass,
+    void                **chunks,
+    unsigned int        numberOfChunks)
 {
-    unsigned int    sourceDataOffset;
-    int             freeSpaceInBuffer;
-    int             bytesPerBuffer;
+    struct Slab         *slab;
+    struct Slab         *newSlab;
+    unsigned int        numberOfTakenChunks;
 
-    sourceDataOffset = 0;
-    while (sourceDataOffset < sourceDataSize)
-    {
-        freeSpaceInBuffer =
-                buffer->bufferSize - (buffer->cursor - buffer->data);
+    newSlab = NULL;
 
-        // Calculate the amount of data to be written to the current buffer.
-        //
-        bytesPerBuffer = sourceDataSize - sourceDataOffset;
-        if (bytesPerBuffer > freeSpaceInBuffer)
-            bytesPerBuffer = freeSpaceInBuffer;
+    pthread_spin_lock(&slabClasses[slabClass].lock);
 
-        // Copy data or a portion of data that may fit in current buffer.
+    if (slabClasses[slabClass].slabs == NULL)
+    {
+        // No slab has free chunks - map a new one outside the lock.
         //
-        memcpy(
-            buffer->cursor,
-            sourceData + sourceDataOffset,
-            bytesPerBuffer);
+        pthread_spin_unlock(&slabClasses[slabClass].lock);
 
-        buffer->cursor += bytesPerBuffer;
+        newSlab = MapSlab(slabClass);
+        if (newSlab == NULL)
+            return 0;
 
-        if (buffer->dataSize < (buffer->cursor - buffer->data + sizeof(char)))
-            buffer->dataSize = buffer->cursor - buffer->data;
+        pthread_spin_lock(&slabClasses[slabClass].lock);
 
-        sourceDataOffset += bytesPerBuffer;
+        newSlab->next = slabClasses[slabClass].slabs;
+        if (newSlab->next != NULL)
+            newSlab->next->prev = newSlab;
 
-        // If free space in current buffer was not enough
-        // to write complete data ...
+        slabClasses[slabClass].slabs = newSlab;
+        slabClasses[slabClass].numberOfEmptySlabs++;
+    }
+
+    numberOfTakenChunks = 0;
+
+    while ((numberOfTakenChunks < numberOfChunks) &&
+            (slabClasses[slabClass].slabs != NULL))
+    {
+        slab = slabClasses[slabClass].slabs;
+
+        if (slab->numberOfFreeChunks == slab->numberOfChunks)
+            slabClasses[slabClass].numberOfEmptySlabs--;
+
+        while ((numberOfTakenChunks < numberOfChunks) && (slab->chunks != NULL))
+        {
+            chunks[numberOfTakenChunks++] = slab->chunks;
+            slab->chunks = *(void **) slab->chunks;
+            slab->numberOfFreeChunks--;
+        }
+
+        // Slab without free chunks leaves the list until a chunk
+        // is given back.
         //
-        if (sourceDataOffset < sourceDataSize)
+        if (slab->chunks == NULL)
         {
-            // ... then switch to next buffer in a chain
-            // or append a new buffer if necessary.
-            //
-            if (buffer->next != NULL) {
-                //
-                // Switch to next buffer.
-                //
-                buffer = buffer->next;
-            } else {
-                buffer = MMPS_ExtendBuffer(buffer);
-                if (buffer == NULL)
-                    return NULL;
-            }
+            slabClasses[slabClass].slabs = slab->next;
+            if (slab->next != NULL)
+                slab->next->prev = NULL;
 
-            MMPS_ResetCursor(buffer);
+            slab->next = NULL;
         }
     }
 
-    return buffer;
+    pthread_spin_unlock(&slabClasses[slabClass].lock);
+
+    return numberOfTakenChunks;
 }
 
 /*
- * @brief   Get (read) data from a buffer chain under cursor.
- *
- * @param   buffer      Pointer to MMPS buffer descriptor.
- * @param   destData    Pointer to memory area to copy data to.
- * @param   destDataSize Size of data to copy.
- * @param   bytesCopied If not NULL the it points to location
- *                      in user memory space where the actually copied
- *                      amount of bytes should be stored.
- *
- * @return  Pointer to MMPS buffer descriptor of a buffer in which a cursor
- *          is pointing to, after read is complete.
- * @return  NULL in case the last byte of the last buffer of a chain
- *          has been read.
- *
- * @warning Always care about return value - it may be another buffer
- *          than a referenced buffer.
+ * @brief   Give chunks back to their slabs at once. Slabs whose chunks
+ *          all become free are unmapped, except for one per size class.
  */
-struct MMPS_Buffer *
-MMPS_GetData(
-    struct MMPS_Buffer  *buffer,
-    char* const         destData,
-    unsigned int        destDataSize,
-    unsigned int        *bytesCopied)
+static void
+GiveSlabChunks(
+    unsigned int        slabClass,
+    void                **chunks,
+    unsigned int        numberOfChunks)
 {
-    unsigned int    destDataOffset;
-    int             bytesPerBuffer;
-    int             leftSpaceInBuffer;
+    struct Slab         *slab;
+    struct Slab         *releasedSlabs;
+    size_t              slabSize;
+    unsigned int        i;
 
-    if (bytesCopied != NULL)
-        *bytesCopied = 0;
+    if (numberOfChunks == 0)
+        return;
 
-    destDataOffset = 0;
-    while (destDataOffset < destDataSize)
+    slabSize = SlabSize(slabClass);
+
+    releasedSlabs = NULL;
+
+    pthread_spin_lock(&slabClasses[slabClass].lock);
+
+    for (i = 0; i < numberOfChunks; i++)
     {
-        leftSpaceInBuffer = buffer->dataSize - (buffer->cursor - buffer->data);
+        slab = (struct Slab *) ((unsigned long) chunks[i] & ~(slabSize - 1));
 
-        // Calculate the amount of data to be read from the current buffer.
+        // Slab without free chunks is not in the list - put it back.
         //
-        bytesPerBuffer = destDataSize - destDataOffset;
-        if (bytesPerBuffer > leftSpaceInBuffer)
-            bytesPerBuffer = leftSpaceInBuffer;
+        if (slab->chunks == NULL)
+        {
+            slab->prev = NULL;
+            slab->next = slabClasses[slabClass].slabs;
+            if (slab->next != NULL)
+                slab->next->prev = slab;
 
-        // Copy data or a portion of data from current buffer.
-        //
-        memcpy(destData + destDataOffset, buffer->cursor, bytesPerBuffer);
+            slabClasses[slabClass].slabs = slab;
+        }
 
-        // Notify the amount of copied bytes.
-        //
-        if (bytesCopied != NULL)
-            *bytesCopied += bytesPerBuffer;
+        *(void **) chunks[i] = slab->chunks;
+        slab->chunks = chunks[i];
+        slab->numberOfFreeChunks++;
 
-        buffer->cursor += bytesPerBuffer;
+        if (slab->numberOfFreeChunks < slab->numberOfChunks)
+            continue;
 
-        destDataOffset += bytesPerBuffer;
+        if (slabClasses[slabClass].numberOfEmptySlabs == 0)
+        {
+            slabClasses[slabClass].numberOfEmptySlabs++;
+            continue;
+        }
 
-        // In case more data has to be read from buffer chain ...
+        // There is already an empty slab in this size class - unlink this
+        // one and unmap it outside the lock.
         //
-        if (destDataOffset < destDataSize)
-        {
-            // ... then switch to next buffer in a chain.
-            // Quit, if not all data was read and there are no other buffers
-            // in a chain.
-            //
-            if (buffer->next == NULL)
-                break;
+        if (slab->prev != NULL)
+            slab->prev->next = slab->next;
+        else
+            slabClasses[slabClass].slabs = slab->next;
 
-            // Switch to next buffer.
-            //
-            buffer = buffer->next;
+        if (slab->next != NULL)
+            slab->next->prev = slab->prev;
 
-            MMPS_ResetCursor(buffer);
-        }
+        slab->next = releasedSlabs;
+        releasedSlabs = slab;
     }
 
-    if (MMPS_IsCursorAtTheEndOfData(buffer) == false) {
-        return buffer;
-    } else {
-        return MMPS_NextBuffer(buffer);
+    pthread_spin_unlock(&slabClasses[slabClass].lock);
+
+    while (releasedSlabs != NULL)
+    {
+        slab = releasedSlabs;
+        releasedSlabs = slab->next;
+
+        munmap(slab, slabSize);
     }
 }
 
 /*
- * @brief   Put one byte to buffer chain under cursor.
- *
- * @param   buffer      Pointer to MMPS buffer descriptor.
- * @param   sourceData  Pointer to memory area to copy data from.
+ * @brief   Allocate memory for data of a buffer of 'allocate on demand' bank.
  *
- * @return  Pointer to MMPS buffer descriptor of a buffer in which a cursor
- *          is pointing to, after write is complete.
- *
- * @warning Always care about return value - it may be another buffer
- *          than a referenced buffer.
+ * @return  Pointer to allocated memory or NULL if there is no memory.
  */
-struct MMPS_Buffer *
-MMPS_PutInt8(
-    struct MMPS_Buffer  *buffer,
-    uint8               *sourceData)
+static void *
+AllocateSlabChunk(unsigned int size)
 {
-    buffer = MMPS_PutData(buffer, (char *) sourceData, sizeof(uint8));
-    return buffer;
-}
+    struct SlabCache    *cache;
+    unsigned int        slabClass;
+    void                *chunk;
 
-/*
- * @brief   Get one byte from buffer chain under cursor.
- *
- * @param   buffer      Pointer to MMPS buffer descriptor.
- * @param   destData    Pointer to memory area to copy data to.
- *
- * @return  Pointer to MMPS buffer descriptor of a buffer in which a cursor
- *          is pointing to, after read is complete.
- * @return  NULL in case the last byte of the last buffer of a chain
- *          has been read.
- *
- * @warning Always care about return value - it may be another buffer
- *          than a referenced buffer.
- */
-struct MMPS_Buffer *
-MMPS_GetInt8(
-    struct MMPS_Buffer  *buffer,
-    uint8               *destData)
-{
-    buffer = MMPS_GetData(buffer, (char *) destData, sizeof(uint8), NULL);
-    return buffer;
-}
+    slabClass = SizeClass(size);
+    if (slabClass > MMPS_SLAB_MAX_CLASS)
+        return malloc(size);
 
-/*
- * @brief   Put one word (two bytes) to buffer chain under cursor.
- *
- * Do endian conversion if needed.
- *
- * @param   buffer      Pointer to MMPS buffer descriptor.
- * @param   sourceData  Pointer to memory area to copy data from.
- *
- * @return  Pointer to MMPS buffer descriptor of a buffer in which a cursor
- *          is pointing to, after write is complete.
- *
- * @warning Always care about return value - it may be another buffer
- *          than a referenced buffer.
- */
-struct MMPS_Buffer *
-MMPS_PutInt16(
-    struct MMPS_Buffer  *buffer,
-    uint16              *sourceData)
-{
-    uint16 value = htobe16(*sourceData);
-    buffer = MMPS_PutData(buffer, (char *) &value, sizeof(value));
-    return buffer;
-}
+    slabClass = (slabClass < MMPS_SLAB_MIN_CLASS)
+        ? 0
+        : slabClass - MMPS_SLAB_MIN_CLASS;
 
-/*
- * @brief   Get one word (two bytes) from buffer chain under cursor.
- *
- * Do endian conversion if needed.
- *
- * @param   buffer      Pointer to MMPS buffer descriptor.
- * @param   destData    Pointer to memory area to copy data to.
- *
- * @return  Pointer to MMPS buffer descriptor of a buffer in which a cursor
- *          is pointing to, after read is complete.
- * @return  NULL in case the last byte of the last buffer of a chain
- *          has been read.
- *
- * @warning Always care about return value - it may be another buffer
- *          than a referenced buffer.
- */
-struct MMPS_Buffer *
-MMPS_GetInt16(
-    struct MMPS_Buffer  *buffer,
-    uint16              *destData)
-{
-    uint16 value;
-    buffer = MMPS_GetData(buffer, (char *) &value, sizeof(value), NULL);
-    *destData = be16toh(value);
-    return buffer;
+    pthread_once(&slabOnce, InitSlabs);
+
+    cache = LocalSlabCache();
+    if (cache == NULL)
+    {
+        return (TakeSlabChunks(slabClass, &chunk, 1) == 1)
+            ? chunk
+            : NULL;
+    }
+
+    if (cache->numberOfChunks[slabClass] == 0)
+    {
+        cache->numberOfChunks[slabClass] = TakeSlabChunks(slabClass,
+                cache->chunks[slabClass],
+                MMPS_SLAB_CACHE_SIZE / 2);
+
+        if (cache->numberOfChunks[slabClass] == 0)
+            return NULL;
+    }
+
+    return cache->chunks[slabClass][--cache->numberOfChunks[slabClass]];
 }
 
 /*
- * @brief   Put one double word (four bytes) to buffer chain under cursor.
- *
- * Do endian conversion if needed
- *
- * @param   buffer      Pointer to MMPS buffer descriptor.
- * @param   sourceData  Pointer to memory area to copy data from.
- *
- * @return  Pointer to MMPS buffer descriptor of a buffer in which a cursor
- *          is pointing to, after write is complete.
- *
- * @warning Always care about return value - it may be another buffer
- *          than a referenced buffer.
+ * @brief   Release memory allocated with AllocateSlabChunk().
  */
-struct MMPS_Buffer *
-MMPS_PutInt32(
-    struct MMPS_Buffer  *buffer,
-    uint32              *sourceData)
+static void
+ReleaseSlabChunk(
+    void                *chunk,
+    unsigned int        size)
 {
-    uint32 value = htobe32(*sourceData);
-    buffer = MMPS_PutData(buffer, (char *) &value, sizeof(value));
-    return buffer;
+    struct SlabCache    *cache;
+    unsigned int        slabClass;
+
+    if (chunk == NULL)
+        return;
+
+    slabClass = SizeClass(size);
+    if (slabClass > MMPS_SLAB_MAX_CLASS)
+    {
+        free(chunk);
+        return;
+    }
+
+    slabClass = (slabClass < MMPS_SLAB_MIN_CLASS)
+        ? 0
+        : slabClass - MMPS_SLAB_MIN_CLASS;
+
+    cache = LocalSlabCache();
+    if (cache == NULL)
+    {
+        GiveSlabChunks(slabClass, &chunk, 1);
+        return;
+    }
+
+    // Cache is full - flush the older half of it to the free list.
+    //
+    if (cache->numberOfChunks[slabClass] == MMPS_SLAB_CACHE_SIZE)
+    {
+        GiveSlabChunks(slabClass,
+                cache->chunks[slabClass],
+                MMPS_SLAB_CACHE_SIZE / 2);
+
+        memmove(cache->chunks[slabClass],
+                &cache->chunks[slabClass][MMPS_SLAB_CACHE_SIZE / 2],
+                (MMPS_SLAB_CACHE_SIZE / 2) * sizeof(void *));
+
+        cache->numberOfChunks[slabClass] = MMPS_SLAB_CACHE_SIZE / 2;
+    }
+
+    cache->chunks[slabClass][cache->numberOfChunks[slabClass]++] = chunk;
 }
 
-/*
- * @brief   Get one double word (four bytes) from buffer chain under cursor.
- *
- * Do endian conversion if needed.
- *
- * @param   buffer      Pointer to MMPS buffer descriptor.
- * @param   destData    Pointer to memory area to copy data to.
- *
- * @return  Pointer to MMPS buffer descriptor of a buffer in which a cursor
- *          is pointing to, after read is complete.
- * @return  NULL in case the last byte of the last buffer of a chain
- *          has been read.
+/*
+ * @brief   Compute absolute CLOCK_MONOTONIC time for timed waits.
  *
- * @warning Always care about return value - it may be another buffer
- *          than a referenced buffer.
+ * @param   deadline    Pointer to where the deadline should be stored.
+ * @param   timeout     Timeout in milliseconds from now.
  */
-struct MMPS_Buffer *
-MMPS_GetInt32(
-    struct MMPS_Buffer  *buffer,
-    uint32              *destData)
+static void
+DeadlineAfter(
+    struct timespec     *deadline,
+    unsigned int        timeout)
 {
-    uint32 value;
-    buffer = MMPS_GetData(buffer, (char *) &value, sizeof(value), NULL);
-    *destData = be32toh(value);
-    return buffer;
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+
+    deadline->tv_sec  += timeout / 1000;
+    deadline->tv_nsec += (timeout % 1000) * 1000000L;
+    if (deadline->tv_nsec >= 1000000000L)
+    {
+        deadline->tv_sec  += 1;
+        deadline->tv_nsec -= 1000000000L;
+    }
 }
 
 /*
- * @brief   Put one quad word (eight bytes) to buffer chain under cursor.
+ * @brief   Size of the part of a shared memory segment before buffer data.
  *
- * Do endian conversion if needed.
- *
- * @param   buffer      Pointer to MMPS buffer descriptor.
- * @param   sourceData  Pointer to memory area to copy data from.
+ * Header is followed by the queue of "free" buffers and by entries
+ * of all channels. Data starts on a page boundary.
  *
- * @return  Pointer to MMPS buffer descriptor of a buffer in which a cursor
- *          is pointing to, after write is complete.
+ * @param   bank        Pointer to MMPS bank descriptor.
  *
- * @warning Always care about return value - it may be another buffer
- *          than a referenced buffer.
+ * @return  Size in bytes.
  */
-struct MMPS_Buffer *
-MMPS_PutInt64(
-    struct MMPS_Buffer  *buffer,
-    uint64              *sourceData)
+static size_t
+ShMemHeaderSize(struct MMPS_Bank *bank)
 {
-    uint64 value = htobe64(*sourceData);
-    buffer = MMPS_PutData(buffer, (char *) &value, sizeof(value));
-    return buffer;
+    size_t              headerSize;
+    size_t              pageSize;
+
+    headerSize = sizeof(struct MMPS_ShMemBank) +
+            bank->numberOfBuffers * sizeof(unsigned int);
+
+    headerSize = (headerSize + sizeof(struct MMPS_ShMemEntry) - 1) &
+            ~(sizeof(struct MMPS_ShMemEntry) - 1);
+
+    headerSize += MMPS_SHM_NUMBER_OF_CHANNELS *
+            bank->numberOfBuffers * sizeof(struct MMPS_ShMemEntry);
+
+    pageSize = sysconf(_SC_PAGESIZE);
+
+    return (headerSize + pageSize - 1) & ~(pageSize - 1);
 }
 
-/**
- * @brief   Get one quad word (eight bytes) from buffer chain under cursor.
- *
- * Do endian conversion if needed.
- *
- * @param   buffer      Pointer to MMPS buffer descriptor.
- * @param   destData    Pointer to memory area to copy data to.
+/*
+ * @brief   Initialize a freshly created shared memory segment of a bank.
  *
- * @return  Pointer to MMPS buffer descriptor of a buffer in which a cursor
- *          is pointing to, after read is complete.
- * @return  NULL in case the last byte of the last buffer of a chain
- *          has been read.
+ * Locks are process-shared and robust, so that a process that dies
+ * while holding one of them does not block all the others. All buffers
+ * are put to the queue of "free" buffers. Segment is marked as ready
+ * for other processes as the very last step.
  *
- * @warning Always care about return value - it may be another buffer
- *          than a referenced buffer.
+ * @param   bank        Pointer to MMPS bank descriptor.
+ * @param   sharedBank  Pointer to the beginning of the segment.
+ * @param   headerSize  Size of the segment before buffer data.
  */
-struct MMPS_Buffer *
-MMPS_GetInt64(
-    struct MMPS_Buffer  *buffer,
-    uint64              *destData)
+static void
+InitShMemBank(
+    struct MMPS_Bank        *bank,
+    struct MMPS_ShMemBank   *sharedBank,
+    size_t                  headerSize)
 {
-    uint64 value;
-    buffer = MMPS_GetData(buffer, (char *) &value, sizeof(value), NULL);
-    *destData = be64toh(value);
-    return buffer;
+    pthread_mutexattr_t     mutexAttr;
+    pthread_condattr_t      conditionAttr;
+    unsigned long           entriesOffset;
+    unsigned int            channel;
+    unsigned int            bufferId;
+
+    pthread_mutexattr_init(&mutexAttr);
+    pthread_mutexattr_setpshared(&mutexAttr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&mutexAttr, PTHREAD_MUTEX_ROBUST);
+
+    pthread_condattr_init(&conditionAttr);
+    pthread_condattr_setpshared(&conditionAttr, PTHREAD_PROCESS_SHARED);
+    pthread_condattr_setclock(&conditionAttr, CLOCK_MONOTONIC);
+
+    sharedBank->magic           = MMPS_SHM_MAGIC;
+    sharedBank->bufferSize      = bank->bufferSize;
+    sharedBank->numberOfBuffers = bank->numberOfBuffers;
+    sharedBank->dataOffset      = headerSize;
+
+    pthread_mutex_init(&sharedBank->lock, &mutexAttr);
+
+    for (bufferId = 0; bufferId < bank->numberOfBuffers; bufferId++)
+        sharedBank->ids[bufferId] = bufferId;
+
+    sharedBank->peek            = 0;
+    sharedBank->poke            = 0;
+    sharedBank->numberOfFreeIds = bank->numberOfBuffers;
+
+    entriesOffset = sizeof(struct MMPS_ShMemBank) +
+            bank->numberOfBuffers * sizeof(unsigned int);
+
+    entriesOffset = (entriesOffset + sizeof(struct MMPS_ShMemEntry) - 1) &
+            ~(sizeof(struct MMPS_ShMemEntry) - 1);
+
+    for (channel = 0; channel < MMPS_SHM_NUMBER_OF_CHANNELS; channel++)
+    {
+        pthread_mutex_init(&sharedBank->channels[channel].lock, &mutexAttr);
+        pthread_cond_init(&sharedBank->channels[channel].condition, &conditionAttr);
+
+        sharedBank->channels[channel].head            = 0;
+        sharedBank->channels[channel].tail            = 0;
+        sharedBank->channels[channel].numberOfEntries = 0;
+        sharedBank->channels[channel].entriesOffset   = entriesOffset;
+
+        entriesOffset += bank->numberOfBuffers * sizeof(struct MMPS_ShMemEntry);
+    }
+
+    pthread_condattr_destroy(&conditionAttr);
+    pthread_mutexattr_destroy(&mutexAttr);
+
+    __atomic_store_n(&sharedBank->ready, 1, __ATOMIC_RELEASE);
 }
 
-#if 0
 /*
- * @brief   Put one 32-bit floating-point value (four bytes)
- *
- * Put one 32-bit floating-point value (four bytes)
- * to buffer chain under cursor. Do endian conversion if needed.
- *
- * @param   buffer      Pointer to MMPS buffer descriptor.
- * @param   sourceData  Pointer to memory area to copy data from.
+ * @brief   Lock a robust process-shared lock of a shared memory segment.
  *
- * @return  Pointer to MMPS buffer descriptor of a buffer in which a cursor
- *          is pointing to, after write is complete.
+ * If the previous holder has died, the lock is taken over as is.
  *
- * @warning Always care about return value - it may be another buffer
- *          than a referenced buffer.
+ * @param   lock        Pointer to the lock.
  */
-struct MMPS_Buffer *
-MMPS_PutFloat32(
-    struct MMPS_Buffer  *buffer,
-    float32             *sourceData)
+static void
+LockShMem(pthread_mutex_t *lock)
 {
-    float32 value = (float32) htobe32(*sourceData);
-    buffer = MMPS_PutData(buffer, (char *) &value, sizeof(value));
-    return buffer;
+    if (pthread_mutex_lock(lock) == EOWNERDEAD)
+    {
+        ReportWarning("[MMPS] Process holding shared memory lock has died");
+
+        pthread_mutex_consistent(lock);
+    }
+}
+
+static struct MMPS_ShMemEntry *
+ShMemEntries(
+    struct MMPS_ShMemBank       *sharedBank,
+    struct MMPS_ShMemChannel    *sharedChannel)
+{
+    return (struct MMPS_ShMemEntry *)
+            ((char *) sharedBank + sharedChannel->entriesOffset);
+}
+
+static unsigned int
+PullShMemBufferIds(
+    struct MMPS_ShMemBank   *sharedBank,
+    unsigned int            *ids,
+    unsigned int            numberOfIds,
+    unsigned int            *numberOfQueuedIds)
+{
+    unsigned int            pulled;
+
+    LockShMem(&sharedBank->lock);
+
+    for (pulled = 0;
+         (pulled < numberOfIds) && (sharedBank->numberOfFreeIds != 0);
+         pulled++)
+    {
+        ids[pulled] = sharedBank->ids[sharedBank->peek];
+
+        sharedBank->peek++;
+        if (sharedBank->peek == sharedBank->numberOfBuffers)
+            sharedBank->peek = 0;
+
+        sharedBank->numberOfFreeIds--;
+    }
+
+    if (numberOfQueuedIds != NULL)
+        *numberOfQueuedIds = sharedBank->numberOfFreeIds;
+
+    pthread_mutex_unlock(&sharedBank->lock);
+
+    return pulled;
+}
+
+static void
+PushShMemBufferIds(
+    struct MMPS_ShMemBank   *sharedBank,
+    unsigned int            *ids,
+    unsigned int            numberOfIds)
+{
+    unsigned int            pushed;
+
+    LockShMem(&sharedBank->lock);
+
+    for (pushed = 0; pushed < numberOfIds; pushed++)
+    {
+        sharedBank->ids[sharedBank->poke] = ids[pushed];
+
+        sharedBank->poke++;
+        if (sharedBank->poke == sharedBank->numberOfBuffers)
+            sharedBank->poke = 0;
+
+        sharedBank->numberOfFreeIds++;
+    }
+
+    pthread_mutex_unlock(&sharedBank->lock);
+}
+
+static unsigned int
+NumberOfFreeShMemBufferIds(struct MMPS_ShMemBank *sharedBank)
+{
+    unsigned int            freeIds;
+
+    LockShMem(&sharedBank->lock);
+
+    freeIds = sharedBank->numberOfFreeIds;
+
+    pthread_mutex_unlock(&sharedBank->lock);
+
+    return freeIds;
 }
 
 /*
- * @brief   Get one 32-bit floating-point value (four bytes)
- *
- * Get one 32-bit floating-point value (four bytes)
- * from buffer chain under cursor. Do endian conversion if needed.
+ * @brief   Get the stripe of statistics counters of the calling thread.
  *
- * @param   buffer      Pointer to MMPS buffer descriptor.
- * @param   destData    Pointer to memory area to copy data to.
- *
- * @return  Pointer to MMPS buffer descriptor of a buffer in which a cursor
- *          is pointing to, after read is complete.
- * @return  NULL in case the last byte of the last buffer of a chain
- *          has been read.
+ * @param   bank        Pointer to MMPS bank descriptor.
  *
- * @warning Always care about return value - it may be another buffer
- *          than a referenced buffer.
+ * @return  Pointer to statistics counters.
  */
-struct MMPS_Buffer *
-MMPS_GetFloat32(
-    struct MMPS_Buffer  *buffer,
-    float32             *destData)
+static struct MMPS_Counters *
+LocalCounters(struct MMPS_Bank *bank)
 {
-    float32 value;
-    buffer = MMPS_GetData(buffer, (char *) &value, sizeof(value), NULL);
-    value = (float32) be64toh((uint32) value);
-    *destData = value;
-    return buffer;
+    if (counterStripe == 0)
+    {
+        counterStripe = 1 + __atomic_fetch_add(&numberOfCounterStripeUsers,
+                1,
+                __ATOMIC_RELAXED) % MMPS_NUMBER_OF_COUNTER_STRIPES;
+    }
+
+    return &bank->counters[counterStripe - 1];
 }
 
 /*
- * @brief   Put one 64-bit double precision floating-point value (eight bytes)
- *
- * Put one 64-bit double precision floating-point value (eight bytes)
- * to buffer chain under cursor. Do endian conversion if needed.
- *
- * @param   buffer      Pointer to MMPS buffer descriptor.
- * @param   sourceData  Pointer to memory area to copy data from.
+ * @brief   Raise high-water mark of a bank to the number of buffers
+ *          that are not in the queue of "free" buffers.
  *
- * @return  Pointer to MMPS buffer descriptor of a buffer in which a cursor
- *          is pointing to, after write is complete.
- *
- * @warning Always care about return value - it may be another buffer
- *          than a referenced buffer.
+ * @param   bank        Pointer to MMPS bank descriptor.
+ * @param   numberOfQueuedIds   Number of buffer ids left in the queue.
  */
-struct MMPS_Buffer *
-MMPS_PutFloat64(
-    struct MMPS_Buffer  *buffer,
-    float64             *sourceData)
+static void
+RaiseHighWaterMark(
+    struct MMPS_Bank    *bank,
+    unsigned int        numberOfQueuedIds)
 {
-    float64 value = (float64) htobe64(*sourceData);
-    buffer = MMPS_PutData(buffer, (char *) &value, sizeof(value));
-    return buffer;
+    unsigned int        numberOfCommittedBuffers;
+    unsigned int        buffersInUse;
+    unsigned int        highWaterMark;
+
+    numberOfCommittedBuffers = NumberOfCommittedBuffers(bank);
+    if (numberOfQueuedIds > numberOfCommittedBuffers)
+        return;
+
+    buffersInUse = numberOfCommittedBuffers - numberOfQueuedIds;
+
+    highWaterMark = __atomic_load_n(&bank->highWaterMark, __ATOMIC_RELAXED);
+
+    while (buffersInUse > highWaterMark)
+    {
+        if (__atomic_compare_exchange_n(&bank->highWaterMark,
+                &highWaterMark,
+                buffersInUse,
+                TRUE,
+                __ATOMIC_RELAXED,
+                __ATOMIC_RELAXED))
+        {
+            break;
+        }
+    }
 }
 
 /*
- * @brief   Get one 64-bit double precision floating-point value (eight bytes)
- *
- * Get one 64-bit double precision floating-point value (eight bytes)
- * from buffer chain under cursor. Do endian conversion if needed.
- *
- * @param   buffer      Pointer to MMPS buffer descriptor.
- * @param   destData    Pointer to memory area to copy data to.
+ * @brief   Get class of chain-length histogram for a chain.
  *
- * @return  Pointer to MMPS buffer descriptor of a buffer in which a cursor
- *          is pointing to, after read is complete.
- * @return  NULL in case the last byte of the last buffer of a chain
- *          has been read.
+ * @param   chainLength Number of buffers in a chain, at least 1.
  *
- * @warning Always care about return value - it may be another buffer
- *          than a referenced buffer.
+ * @return  Class id, less than MMPS_CHAIN_HISTOGRAM_SIZE.
  */
-struct MMPS_Buffer *
-MMPS_GetFloat64(
-    struct MMPS_Buffer  *buffer,
-    float64             *destData)
+static unsigned int
+ChainLengthClass(unsigned int chainLength)
 {
-    float64 value;
-    buffer = MMPS_GetData(buffer, (char *) &value, sizeof(value), NULL);
-    value = (float64) be64toh((uint64) value);
-    *destData = value;
-    return buffer;
+    unsigned int        classId;
+
+    classId = 31 - __builtin_clz(chainLength);
+
+    return (classId < MMPS_CHAIN_HISTOGRAM_SIZE)
+        ? classId
+        : MMPS_CHAIN_HISTOGRAM_SIZE - 1;
 }
-#endif
 
 /*
- * @brief   Put string.
+ * @brief   Write one line of statistics of a bank to a file descriptor.
  *
- * @param   buffer      Pointer to MMPS buffer descriptor.
- * @param   string      Pointer to a string.
- * @param   length      Length of string.
- *
- * @return  Pointer to MMPS buffer descriptor of a buffer in which a cursor
- *          is pointing to, after write is complete.
+ * @param   fd          File descriptor to write to.
+ * @param   poolName    Name of the pool of the bank.
+ * @param   statistics  Statistics of the bank.
  *
- * @warning Always care about return value - it may be another buffer
- *          than a referenced buffer.
+ * @return  MMPS_OK upon successful completion.
+ * @return  MMPS_WRITE_ERROR if writing has failed.
  */
-struct MMPS_Buffer *
-MMPS_PutString(
-    struct MMPS_Buffer  *buffer,
-    char                *string,
-    unsigned int        length)
+static int
+DumpBankStatistics(
+    int                         fd,
+    const char                  *poolName,
+    struct MMPS_BankStatistics  *statistics)
 {
-    uint32 swapped = htobe32(length);
-    buffer = MMPS_PutData(buffer, (char *)&swapped, sizeof(swapped));
-    if (length != 0)
-        buffer = MMPS_PutData(buffer, string, length);
-    return buffer;
+    char                line[1024];
+    int                 length;
+    unsigned int        classId;
+
+    length = snprintf(line, sizeof(line),
+            "pool=%s bank=%u size=%u buffers=%u inuse=%u hwm=%u " \
+            "peeks=%lu pokes=%lu failures=%lu contentions=%lu " \
+            "waits=%lu timeouts=%lu chains=",
+            poolName,
+            statistics->bankId,
+            statistics->bufferSize,
+            statistics->numberOfBuffers,
+            statistics->buffersInUse,
+            statistics->highWaterMark,
+            statistics->peeks,
+            statistics->pokes,
+            statistics->failures,
+            statistics->contentions,
+            statistics->waits,
+            statistics->timeouts);
+
+    for (classId = 0; classId < MMPS_CHAIN_HISTOGRAM_SIZE; classId++)
+    {
+        length += snprintf(&line[length], sizeof(line) - length,
+                (classId == 0) ? "%lu" : ",%lu",
+                statistics->chainLengths[classId]);
+    }
+
+    length += snprintf(&line[length], sizeof(line) - length, "\n");
+
+    if (write(fd, line, length) != length)
+        return MMPS_WRITE_ERROR;
+
+    return MMPS_OK;
 }
 
-/**
- * @brief   Get number of used MMPS buffers for the specified buffer bank.
+#ifdef MMPS_IO_URING
+
+/*
+ * @brief   Put a buffer into the next entry of the buffer ring.
  *
- * This function may be used for debugging purposes to check
- * periodically how many MMPS buffers are in use (peeked out of the bank).
+ * Entry becomes visible to the kernel only when the tail of the ring
+ * is published by RefillBufferRing().
  *
- * @param   pool        Pointer to MMPS pool descriptor.
- *                      to get statistical information for.
- * @param   bankId      Buffer bank id.
+ * @param   ring        Pointer to MMPS buffer ring descriptor.
+ * @param   ringBufferId Buffer id of io_uring for this buffer.
+ * @param   buffer      Pointer to MMPS buffer descriptor.
+ */
+static void
+LendToBufferRing(
+    struct MMPS_BufferRing  *ring,
+    unsigned int            ringBufferId,
+    struct MMPS_Buffer      *buffer)
+{
+    struct io_uring_buf     *entry;
+
+    entry = &ring->entries->bufs[ring->tail & (ring->numberOfEntries - 1)];
+
+    entry->addr = (unsigned long) buffer->data;
+    entry->len  = buffer->bufferSize;
+    entry->bid  = ringBufferId;
+
+    ring->buffers[ringBufferId] = buffer;
+
+    ring->tail++;
+}
+
+/*
+ * @brief   Lend a buffer of the bank for each empty slot of the buffer ring
+ *          and publish the new tail of the ring to the kernel.
  *
- * @return  The number of buffers 'in use'.
+ * Ring lock has to be held (or the ring not yet be visible to other threads).
  *
- * @warning Do not use this function in a production code
- *          as it may cause performance degradation.
+ * @param   ring        Pointer to MMPS buffer ring descriptor.
  */
-unsigned int
-MMPS_NumberOfBuffersInUse(
-    struct MMPS_Pool    *pool,
-    unsigned int        bankId)
+static void
+RefillBufferRing(struct MMPS_BufferRing *ring)
 {
-    struct MMPS_Bank    *bank;
-    unsigned int        buffersInUse;
+    struct MMPS_Buffer      *buffer;
+    unsigned int            tail;
 
-    bank = pool->banks[bankId];
+    tail = ring->tail;
 
-#ifdef MMPS_MUTEX
-    pthread_mutex_lock(&bank->mutex.lock);
-#else
-    pthread_spin_lock(&bank->lock);
-#endif
+    while (ring->numberOfMissingIds > 0)
+    {
+        buffer = PeekBufferFromBank(ring->pool, ring->bankId, ring->ownerId);
+        if (buffer == NULL)
+            break;
 
-    buffersInUse = (bank->cursor.peek >= bank->cursor.poke)
-        ? bank->cursor.peek - bank->cursor.poke
-        : bank->numberOfBuffers - (bank->cursor.poke - bank->cursor.peek);
+        ring->numberOfMissingIds--;
 
-#ifdef MMPS_MUTEX
-    pthread_mutex_unlock(&bank->mutex.lock);
-#else
-    pthread_spin_unlock(&bank->lock);
-#endif
+        LendToBufferRing(ring,
+                ring->missingIds[ring->numberOfMissingIds],
+                buffer);
+    }
 
-    return buffersInUse;
+    if (ring->tail != tail)
+        __atomic_store_n(&ring->entries->tail,
+                (unsigned short) ring->tail,
+                __ATOMIC_RELEASE);
 }
+
+#endif // MMPS_IO_URING
@@ -12,6 +12,12 @@
  *     If set, then mutex is used for synchronizing the access to the MMPS.
  *     Otherwise, spinlock is used.
  *
+ *   MMPS_LOCKFREE
+ *     If set, then the queue of "free" buffers of each bank is a bounded
+ *     lock-free multi-producer/multi-consumer ring with a sequence number
+ *     per slot, and peek and poke never wait for a lock held by another
+ *     thread. Takes precedence over MMPS_MUTEX for the queue.
+ *
  *   MMPS_USE_OWNER_ID
  *     Use buffer owner management. When MMPS buffer is peeked from the pool
  *     the peeking member must specify his id that will be set as owner id
@@ -19,24 +25,32 @@
  *     buffer is moved from one member to another. Owner id makes it easier
  *     to find out which member owns it at some particular point of time.
  *
- *   MMPS_USE_TOUCHING
- *     Implement mechanism of touch counter. MMPS buffer could be touched
- *     and touched by several members. MMPS buffer could be poked
- *     back to the pool only when it is not touched by any member.
- *
  *   MMPS_EYECATCHER
  *     If set, then each MMPS descriptor will begin with an eye catcher,
  *     which may help analysing memory contents during debugging.
  *
+ *   MMPS_ALIGN_DESCRIPTORS
+ *     If set, then buffer descriptors are aligned and padded to the size
+ *     of a cache line, so that descriptors of neighbouring buffers used
+ *     by different threads never share a cache line. Costs up to one
+ *     cache line of memory per buffer.
+ *
  *   MMPS_USE_64BIT_MMAP
  *     If set, mmap64() instead of mmap() will be used to map memory blocks.
  *
  *   MMPS_SHM
  *     If set, then using shared memory data blocks will be enabled.
+ *     Banks mapped to shared memory may be used by several processes
+ *     at once, with buffers handed between processes by id.
  *
  *   MMPS_DMA
  *     If set, then DMA specific functions will be included to the API.
  *
+ *   MMPS_IO_URING
+ *     If set, then buffers of a bank may be lent to the kernel as an io_uring
+ *     provided buffer ring (see MMPS_InitBufferRing()), so that the kernel
+ *     takes a buffer only when data actually arrives. Linux only.
+ *
  *   MMPS_INIT_BANK
  *     If set, then verbose information about initialization
  *     of MMPS descriptors will be printed (debugging and performance
@@ -80,8 +94,10 @@
 
 // System definition files.
 //
+#include <endian.h>
 #include <pthread.h>
 #include <stdint.h>
+#include <string.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <sys/types.h>
@@ -91,20 +107,126 @@
 
 #define MAX_BLOCK_SIZE                  MB
 
+#define MMPS_CACHE_LINE_SIZE            64
+
 #define MMPS_NO_OWNER                   0
 
+/**
+ * Bank options for MMPS_InitBankWithOptions().
+ *
+ * MMPS_BANK_ELASTIC
+ *   Reserve address ranges for all buffers of a bank up front, but commit
+ *   memory for descriptors, data and followers block by block - when
+ *   the queue of "free" buffers runs dry. Blocks that are completely free
+ *   again may be given back with MMPS_ShrinkBank().
+ *
+ * MMPS_BANK_HUGEPAGES
+ *   Back descriptor blocks and data of a bank with huge pages - explicit
+ *   huge pages (MAP_HUGETLB) if the system has them reserved, transparent
+ *   huge pages otherwise. Falls back to regular pages if neither is
+ *   available. Effective page size is reported with MMPS_INIT_BANK.
+ *
+ * MMPS_BANK_NUMA
+ *   Split a bank into one sub-bank per NUMA node, with memory of each
+ *   sub-bank placed on its own node. Buffers are peeked from the sub-bank
+ *   of the node the caller is running on, and from sub-banks of other nodes
+ *   only when the local one is exhausted. Has no effect on a system
+ *   with a single node. Banks mapped to shared memory or for DMA
+ *   should not use it.
+ *
+ * MMPS_BANK_FIFO
+ *   Serve callers blocked in MMPS_PeekBufferTimed() in the order they
+ *   started to wait. A timed peek does not overtake waiters that are
+ *   already queued, even if a buffer is available at the moment.
+ *   Other peek functions are not affected.
+ */
+#define MMPS_BANK_ELASTIC               0x00000001
+#define MMPS_BANK_HUGEPAGES             0x00000002
+#define MMPS_BANK_NUMA                  0x00000004
+#define MMPS_BANK_FIFO                  0x00000008
+
+// Maximal number of NUMA nodes MMPS_BANK_NUMA can spread a bank over.
+//
+#define MMPS_MAX_NUMA_NODES             64
+
+// Number of channels of a bank mapped to shared memory, over which buffers
+// are handed from one process to another (see MMPS_SendShMemBuffer()).
+//
+#define MMPS_SHM_NUMBER_OF_CHANNELS     4
+
+// Maximal time in milliseconds MMPS_MapShMemBufferBank() waits for another
+// process to finish initialization of a shared memory segment.
+//
+#define MMPS_SHM_ATTACH_TIMEOUT         5000
+
+// Timeout for MMPS_PeekBufferTimed() to wait until a buffer is available.
+//
+#define MMPS_WAIT_FOREVER               0xFFFFFFFF
+
+// Maximal number of entries of io_uring provided buffer ring, buffer ids
+// of io_uring are 16 bits wide (see MMPS_InitBufferRing()).
+//
+#define MMPS_MAX_RING_ENTRIES           32768
+
+// Number of cache line sized sets of statistics counters of a bank.
+// Threads are spread over them, so that counting peeks and pokes
+// does not make CPUs fight for one cache line.
+//
+#define MMPS_NUMBER_OF_COUNTER_STRIPES  16
+
+// Number of classes of chain-length histogram. Class n counts chains
+// of 2^n up to 2^(n+1)-1 buffers, the last class counts all longer chains.
+//
+#define MMPS_CHAIN_HISTOGRAM_SIZE       8
+
+/**
+ * Exhaustion policies for MMPS_PeekBufferOfSize().
+ *
+ * MMPS_EXHAUSTION_LARGER
+ *   If the bank of the smallest buffers that fit the requested size
+ *   is exhausted, then go on with banks of larger buffers.
+ *
+ * MMPS_EXHAUSTION_FAIL
+ *   Only try the bank of the smallest buffers that fit the requested size.
+ *
+ * MMPS_EXHAUSTION_CHAIN
+ *   If the bank of the smallest buffers that fit the requested size
+ *   is exhausted, then return a chain of smaller buffers that together
+ *   hold the requested size.
+ *
+ * A request for more than buffers of any bank can hold fails with
+ * MMPS_EXHAUSTION_FAIL. With MMPS_EXHAUSTION_LARGER and MMPS_EXHAUSTION_CHAIN
+ * it is served with a chain, starting with buffers of the largest bank.
+ */
+#define MMPS_EXHAUSTION_LARGER          0
+#define MMPS_EXHAUSTION_FAIL            1
+#define MMPS_EXHAUSTION_CHAIN           2
+
+// One size class per power of two of a 32-bit buffer size, plus sizes 0 and 1.
+//
+#define MMPS_NUMBER_OF_SIZE_CLASSES     33
+
 #define MMPS_OK                          0
 #define MMPS_OUT_OF_MEMORY              -1
 #define MMPS_WRONG_BANK_ID              -100
+#define MMPS_BANK_EXHAUSTED             -101
+#define MMPS_WRONG_POLICY               -102
 #define MMPS_SHM_ERROR                  -200
 #define MMPS_CANNOT_MAP_TO_SHM          -201
 #define MMPS_CANNOT_UNMAP_FROM_SHM      -202
 #define MMPS_ALREADY_MAPPED_TO_SHM      -203
 #define MMPS_NOT_MAPPED_TO_SHM          -204
+#define MMPS_SHM_MISMATCH               -205
+#define MMPS_WRONG_CHANNEL              -206
+#define MMPS_NOT_IN_SHM                 -207
 #define MMPS_CANNOT_MAP_TO_DMA          -301
 #define MMPS_CANNOT_UNMAP_FROM_DMA      -302
 #define MMPS_ALREADY_MAPPED_TO_DMA      -303
 #define MMPS_NOT_MAPPED_TO_DMA          -304
+#define MMPS_SOCKET_ERROR               -400
+#define MMPS_WRITE_ERROR                -401
+#define MMPS_RING_ERROR                 -500
+#define MMPS_CANNOT_REGISTER_RING       -501
 
 #ifdef MMPS_EYECATCHER
 #define EYECATCHER_SIZE                 16
@@ -128,6 +250,36 @@ struct MMPS_Pool
      */
     unsigned int        numberOfBanks;
 
+    /**
+     * What MMPS_PeekBufferOfSize() does when the bank of requested size
+     * is exhausted (one of MMPS_EXHAUSTION_*).
+     */
+    unsigned int        exhaustionPolicy;
+
+    /**
+     * Internally used size class table. Banks with fixed buffer size
+     * are kept in bankIds ordered by buffer size, and for each size class
+     * (power of two) first points to the first of them with buffers
+     * large enough for the smallest size of the class.
+     */
+    struct
+    {
+        unsigned int    numberOfBanks;
+        unsigned int    *bankIds;
+        unsigned int    first[MMPS_NUMBER_OF_SIZE_CLASSES];
+    } sizeClasses;
+
+    /**
+     * Internally used stash of spare buffer descriptors for spliced buffers
+     * (see MMPS_SpliceBuffer()). Descriptors are allocated in batches
+     * when the stash runs empty and are reused afterwards.
+     */
+    struct
+    {
+        pthread_spinlock_t  lock;
+        struct MMPS_Buffer  *spares;
+    } splices;
+
     /**
      * Internally used array of pointers to banks.
      */
@@ -181,6 +333,15 @@ struct MMPS_Bank
     int                 sharedMemoryHandle;
     void                *sharedMemoryAddress;
 
+    /**
+     * Header of the shared memory segment of a bank mapped to shared memory
+     * with MMPS_MapShMemBufferBank(), otherwise NULL. For such a bank
+     * the queue of "free" buffers in the segment is used instead of
+     * the queue of the bank, so that buffers are shared by all processes
+     * which have mapped the segment.
+     */
+    struct MMPS_ShMemBank   *sharedBank;
+
     /**
      * Total number of buffers in a bank. All buffers must have the same size.
      * Several banks have to be defines in case buffers of different sizes
@@ -208,10 +369,25 @@ struct MMPS_Bank
      */
     struct
     {
+#ifdef MMPS_LOCKFREE
+        unsigned long   peek;
+        unsigned long   poke;
+#else
         unsigned int    peek;
         unsigned int    poke;
+#endif
     } cursor;
 
+#ifdef MMPS_LOCKFREE
+    /**
+     * Sequence number of each slot of the queue of "free" buffers.
+     * Slot holds a buffer id that may be peeked when its sequence number
+     * is one ahead of the peek cursor, and is empty and may be poked to
+     * when its sequence number is equal to the poke cursor.
+     */
+    unsigned long       *sequences;
+#endif
+
     /**
      * Internally used values that are needed only for destructor
      * (to release allocated ressources).
@@ -221,6 +397,91 @@ struct MMPS_Bank
     size_t              lastBlockSize;
     unsigned int        buffersPerBlock;
     void                **blocks;
+    void                *descriptors;
+
+    /**
+     * Optional per-CPU magazines of free buffer ids (see MMPS_InitMagazines()).
+     * If number of magazines is 0, then all peeks and pokes go directly
+     * to the queue of "free" buffers.
+     */
+    unsigned int        numberOfMagazines;
+    unsigned int        magazineSize;
+    size_t              magazineStride;
+    void                *magazines;
+
+    /**
+     * Bank options (MMPS_BANK_*) the bank was initialized with.
+     */
+    unsigned int        options;
+
+    /**
+     * Effective page size of memory backing descriptor blocks and data
+     * of a bank.
+     */
+    struct
+    {
+        size_t          descriptors;
+        size_t          data;
+    } pageSize;
+
+    /**
+     * Used only by elastic banks. Reserved address ranges for descriptor
+     * blocks, data and followers, with page aligned distance between
+     * neighbouring blocks in each range. Blocks are committed in the order
+     * of their ids, so that blocks[] entries below the number of committed
+     * blocks are always valid.
+     */
+    struct
+    {
+        pthread_mutex_t lock;
+        unsigned int    numberOfCommittedBlocks;
+        unsigned int    numberOfInitialBlocks;
+        void            *descriptors;
+        void            *data;
+        void            *followers;
+        size_t          descriptorsStride;
+        size_t          dataStride;
+        size_t          followersStride;
+    } elastic;
+
+    /**
+     * Internally used sub-banks of a bank with MMPS_BANK_NUMA option.
+     * All sub-banks share the array of pointers to sub-banks, indexed
+     * by NUMA node. For other banks banks is NULL.
+     */
+    struct
+    {
+        unsigned int        node;
+        unsigned int        numberOfNodes;
+        struct MMPS_Bank    **banks;
+    } numa;
+
+    /**
+     * Callers blocked in MMPS_PeekBufferTimed() on an exhausted bank.
+     * Waiters are queued in order of arrival, the queue is used
+     * by banks with MMPS_BANK_FIFO option. Each poke to the bank
+     * with waiters increments the number of wakeups, so that a waiter
+     * does not miss a buffer given back between its last peek attempt
+     * and going asleep.
+     */
+    struct
+    {
+        pthread_mutex_t     lock;
+        pthread_cond_t      condition;
+        unsigned int        numberOfWaiters;
+        unsigned long       numberOfWakeups;
+        struct MMPS_Waiter  *first;
+        struct MMPS_Waiter  *last;
+    } waiters;
+
+    /**
+     * Statistics counters (see MMPS_GetBankStatistics()), one set
+     * per stripe. High-water mark is the largest number of buffers
+     * found out of the queue of "free" buffers - buffers cached
+     * in magazines count as in use.
+     */
+    struct MMPS_Counters    *counters;
+    unsigned int            highWaterMark;
 
     /**
      * Internally used queue of "free" buffers.
@@ -228,8 +489,227 @@ struct MMPS_Bank
     unsigned int        ids[];
 };
 
+/**
+ * MMPS shared memory channel.
+ *
+ * Bounded queue of buffers handed from one process to another, with room
+ * for all buffers of a bank, so that it never overflows. Entries are kept
+ * in the segment at the given offset.
+ */
+struct MMPS_ShMemChannel
+{
+    pthread_mutex_t     lock;
+    pthread_cond_t      condition;
+    unsigned int        head;
+    unsigned int        tail;
+    unsigned int        numberOfEntries;
+    unsigned long       entriesOffset;
+};
+
+/**
+ * Entry of MMPS shared memory channel.
+ */
+struct MMPS_ShMemEntry
+{
+    unsigned int        bufferId;
+    unsigned int        dataSize;
+};
+
+/**
+ * Header of MMPS shared memory segment.
+ *
+ * Segment holds the header, the queue of "free" buffers, entries
+ * of all channels and - page aligned - data of all buffers. Nothing
+ * in the segment is a pointer, buffers are addressed by their ids,
+ * since each process maps the segment at its own address and builds
+ * its own buffer descriptors over it.
+ */
+struct MMPS_ShMemBank
+{
+    unsigned int        magic;
+    unsigned int        ready;
+    unsigned int        bufferSize;
+    unsigned int        numberOfBuffers;
+    unsigned long       dataOffset;
+
+    /**
+     * Queue of "free" buffers, a ring of buffer ids.
+     */
+    pthread_mutex_t     lock;
+    unsigned int        peek;
+    unsigned int        poke;
+    unsigned int        numberOfFreeIds;
+
+    struct MMPS_ShMemChannel    channels[MMPS_SHM_NUMBER_OF_CHANNELS];
+
+    unsigned int        ids[];
+};
+
+#ifdef MMPS_IO_URING
+
+/**
+ * MMPS buffer ring descriptor.
+ *
+ * Buffers of a bank lent to the kernel as an io_uring provided buffer ring.
+ * Each entry of the ring has io_uring buffer id equal to its slot
+ * in the table of buffers, so that a completion maps back to MMPS buffer
+ * descriptor by the buffer id it carries.
+ */
+struct MMPS_BufferRing
+{
+    struct MMPS_Pool    *pool;
+    unsigned int        bankId;
+    unsigned int        ownerId;
+
+    /**
+     * File descriptor of io_uring instance and buffer group id
+     * the ring is registered with.
+     */
+    int                 ringFd;
+    unsigned int        groupId;
+
+    unsigned int        numberOfEntries;
+
+    /**
+     * Lock to be held while entries are added to the ring, since buffers
+     * may be taken out of the ring by several threads at once.
+     */
+    pthread_spinlock_t  lock;
+
+    /**
+     * Ring shared with the kernel and the local copy of its tail.
+     */
+    struct io_uring_buf_ring    *entries;
+    size_t              entriesSize;
+    unsigned int        tail;
+
+    /**
+     * Buffer ids of io_uring whose slots are empty, because the bank
+     * was exhausted when they had to be refilled.
+     */
+    unsigned int        numberOfMissingIds;
+    unsigned short      *missingIds;
+
+    /**
+     * Buffer currently lent to the kernel under each buffer id of io_uring.
+     */
+    struct MMPS_Buffer  *buffers[];
+};
+
+#endif // MMPS_IO_URING
+
+/**
+ * MMPS waiter descriptor.
+ *
+ * Placed on the stack of a caller blocked in MMPS_PeekBufferTimed()
+ * and linked into the queue of waiters of a bank.
+ */
+struct MMPS_Waiter
+{
+    struct MMPS_Waiter  *next;
+};
+
+/**
+ * MMPS statistics counters.
+ *
+ * One stripe of counters of a bank. Counters are incremented
+ * with relaxed atomics by all threads that share the stripe.
+ */
+struct MMPS_Counters
+{
+    unsigned long       peeks;
+    unsigned long       pokes;
+    unsigned long       failures;
+    unsigned long       contentions;
+    unsigned long       waits;
+    unsigned long       timeouts;
+    unsigned long       chainLengths[MMPS_CHAIN_HISTOGRAM_SIZE];
+} __attribute__((aligned(MMPS_CACHE_LINE_SIZE)));
+
+/**
+ * MMPS bank statistics.
+ *
+ * Snapshot of statistics of a bank summed over all its NUMA nodes,
+ * filled in by MMPS_GetBankStatistics(). Counters are taken one after
+ * another while peeks and pokes go on, so they may be slightly
+ * inconsistent with each other.
+ */
+struct MMPS_BankStatistics
+{
+    unsigned int        bankId;
+    unsigned int        bufferSize;
+
+    /**
+     * Number of buffers the bank has memory for at the moment
+     * and how many of them are in use.
+     */
+    unsigned int        numberOfBuffers;
+    unsigned int        buffersInUse;
+
+    /**
+     * Largest number of buffers that were in use at once
+     * (see MMPS_Bank.highWaterMark).
+     */
+    unsigned int        highWaterMark;
+
+    /**
+     * Number of buffers peeked and poked, and number of peeks
+     * that found the bank (or one of its NUMA nodes) exhausted.
+     */
+    unsigned long       peeks;
+    unsigned long       pokes;
+    unsigned long       failures;
+
+    /**
+     * Number of times the bank lock was found taken,
+     * or an update of a lock-free queue cursor had to be retried.
+     */
+    unsigned long       contentions;
+
+    /**
+     * Number of callers of MMPS_PeekBufferTimed() that had to wait
+     * for a buffer, and how many of them gave up.
+     */
+    unsigned long       waits;
+    unsigned long       timeouts;
+
+    /**
+     * Histogram of lengths of chains poked back to the bank
+     * (see MMPS_CHAIN_HISTOGRAM_SIZE).
+     */
+    unsigned long       chainLengths[MMPS_CHAIN_HISTOGRAM_SIZE];
+};
+
+/**
+ * MMPS magazine descriptor.
+ *
+ * Magazine is a small stack of free buffer ids, that belongs to one CPU.
+ * It is refilled from and flushed to the queue of "free" buffers of its bank
+ * in batches, so that the bank lock is taken once per batch
+ * and not once per peek or poke.
+ */
+struct MMPS_Magazine
+{
+    pthread_spinlock_t  lock;
+
+    /**
+     * Number of buffer ids currently held in a magazine.
+     */
+    unsigned int        numberOfIds;
+
+    /**
+     * Stack of buffer ids, the top of stack is ids[numberOfIds - 1].
+     */
+    unsigned int        ids[];
+};
+
 /**
  * MMPS buffer descriptor.
+ *
+ * Fields touched on every peek, put, get and poke come first, so that
+ * they share one cache line. Fields used only by chaining of followers,
+ * splicing, owner management and DMA follow them. With MMPS_ALIGN_DESCRIPTORS
+ * each descriptor starts on a cache line of its own.
  */
 struct MMPS_Buffer
 {
@@ -238,14 +718,27 @@ struct MMPS_Buffer
 #endif
 
     /**
-     * Buffer id to be used internally by this module.
+     * Pointer to data memory block.
      */
-    unsigned int        bufferId;
+    char                *data;
 
     /**
-     * Pointer to the bank the buffer belongs to.
+     * Pointer, that is used as a cursor in a data memory block.
+     * Each time a buffer is peeked from the bank the cursor is reset
+     * to the beginning of data.
      */
-    struct MMPS_Bank    *bank;
+    char                *cursor;
+
+    /**
+     * Specifies the maximum amount of data that may fit in a buffer.
+     */
+    unsigned int        bufferSize;
+
+    /**
+     * Amount of data actually being written in a buffer.
+     * 0 <= dataSize <= bufferSize
+     */
+    unsigned int        dataSize;
 
     /**
      * Chaining information in case buffer is part of a chain.
@@ -257,36 +750,43 @@ struct MMPS_Buffer
     struct MMPS_Buffer  *next;
 
     /**
-     * User defined 32-bit value specified who is using this buffer.
+     * Pointer to the bank the buffer belongs to.
      */
-    unsigned int        ownerId;
+    struct MMPS_Bank    *bank;
+
+    /**
+     * Buffer id to be used internally by this module.
+     */
+    unsigned int        bufferId;
 
     /**
-     * Number of touches. Shows how many members have buffer in touch.
+     * Number of touches. Shows how many members have buffer in touch,
+     * including the member that has peeked it. Changed atomically.
      */
     unsigned            touches;
 
     /**
-     * Specifies the maximum amount of data that may fit in a buffer.
+     * User defined 32-bit value specified who is using this buffer.
      */
-    unsigned int        bufferSize;
+    unsigned int        ownerId;
 
     /**
-     * Amount of data actually being written in a buffer.
-     * 0 <= dataSize <= bufferSize
+     * Number of buffers sharing the data block of this buffer, including
+     * this buffer itself, or 0 if the data block has never been spliced.
      */
-    unsigned int        dataSize;
+    unsigned            references;
 
     /**
-     * Size of the follower - an optional piece of data that could be used
-     * to provide a kind of object description or header for dnetwork datagrams.
+     * Buffer whose data block is referenced by this buffer, if this buffer
+     * was spliced off another one, otherwise NULL.
      */
-    unsigned int        followerSize;
+    struct MMPS_Buffer  *origin;
 
     /**
-     * Pointer to data memory block.
+     * Size of the follower - an optional piece of data that could be used
+     * to provide a kind of object description or header for dnetwork datagrams.
      */
-    char                *data;
+    unsigned int        followerSize;
 
     /**
      * Pointer to follower.
@@ -298,14 +798,11 @@ struct MMPS_Buffer
      * otherwise null.
      */
     char                *dmaAddress;
-
-    /**
-     * Pointer, that is used as a cursor in a data memory block.
-     * Each time a buffer is peeked from the bank the cursor is reset
-     * to the beginning of data.
-     */
-    char                *cursor;
-};
+}
+#ifdef MMPS_ALIGN_DESCRIPTORS
+__attribute__((aligned(MMPS_CACHE_LINE_SIZE)))
+#endif
+;
 
 /**
  * MMPS network vector descriptor.
@@ -322,6 +819,21 @@ struct MMPS_NetVector
     struct iovec        iov[];
 };
 
+/**
+ * MMPS writer descriptor.
+ *
+ * Keeps track of the buffer of an output chain, where the next piece of data
+ * has to be written to, so that the caller does not have to thread it
+ * through every write (see MMPS_Reserve() and MMPS_Commit()).
+ */
+struct MMPS_Writer
+{
+    /**
+     * Buffer under cursor.
+     */
+    struct MMPS_Buffer  *buffer;
+};
+
 /**
  * @brief   Allocate and initialize buffer pool.
  *
@@ -369,6 +881,54 @@ MMPS_InitBank(
     unsigned int        followerSize,
     unsigned int        numberOfBuffers);
 
+/**
+ * @brief   Initialize buffer bank with options - MMPS pool must be
+ *          already initialized.
+ *
+ * Same as MMPS_InitBank(), but allows to choose how the memory
+ * of the bank is obtained.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor - already initialized
+ *                      with MMPS_InitPool().
+ * @param   bankId      Bank id of the bank to be initialized.
+ * @param   bufferSize  Size of buffers in a bank or 0 (see MMPS_InitBank()).
+ * @param   followerSize    Size of the follower or 0 if buffers in this bank
+ *                          are not supposed to have followers.
+ * @param   numberOfBuffers Maximal number of buffer descriptors
+ *                          in the specified bank.
+ * @param   options     Combination of MMPS_BANK_* options or 0.
+ *
+ * @return  0 upon successful completion.
+ * @return  Error code (negative value), if bank cannot be created.
+ */
+extern int
+MMPS_InitBankWithOptions(
+    struct MMPS_Pool    *pool,
+    unsigned int        bankId,
+    unsigned int        bufferSize,
+    unsigned int        followerSize,
+    unsigned int        numberOfBuffers,
+    unsigned int        options);
+
+/**
+ * @brief   Give back memory of elastic bank blocks that are not in use.
+ *
+ * Blocks are released from the highest committed block downwards,
+ * as long as all buffers of a block are free (in the queue of "free"
+ * buffers or in magazines).
+ * The block committed at initialization is never released.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   bankId      Bank id of an elastic bank.
+ *
+ * @return  Number of released blocks upon successful completion.
+ * @return  Error code (negative value), in case of error.
+ */
+extern int
+MMPS_ShrinkBank(
+    struct MMPS_Pool    *pool,
+    unsigned int        bankId);
+
 /**
  * @brief   Allocate data memory blocks for all buffers of the specified bank.
  *
@@ -402,6 +962,10 @@ MMPS_AllocateFollowers(
 /**
  * @brief   Set the 'allocate on demand' flag for the specified bank.
  *
+ * Data of buffers is allocated on each peek and released on each poke.
+ * Memory comes from slabs with free lists per size class and per-thread
+ * caches in front of them, so that peek and poke do not go to malloc().
+ *
  * @param   pool        Pointer to MMPS pool descriptor - already initialized
  *                      with MMPS_InitPool().
  * @param   bankId      Bank id of the bank set as 'allocate on demand'.
@@ -414,11 +978,42 @@ MMPS_AllocateOnDemand(
     struct MMPS_Pool    *pool,
     unsigned int        bankId);
 
+/**
+ * @brief   Put per-CPU magazines in front of the queue of "free" buffers.
+ *
+ * Each CPU gets its own magazine of free buffer ids. Peeks and pokes
+ * are served from the magazine of the CPU the caller is running on,
+ * and only refill or flush half a magazine at once against the bank.
+ * Must be called during initialization, before the bank is used
+ * by more than one thread.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor - already initialized
+ *                      with MMPS_InitPool().
+ * @param   bankId      Bank id of the bank to put magazines in front of.
+ * @param   magazineSize    Maximal number of buffer ids in each magazine.
+ *
+ * @return  0 upon successful completion.
+ * @return  Error code (negative value), in case of error.
+ */
+extern int
+MMPS_InitMagazines(
+    struct MMPS_Pool    *pool,
+    unsigned int        bankId,
+    unsigned int        magazineSize);
+
 /**
  * @brief   Map data blocks to shared memory.
  *
  * Map data blocks of all buffer descriptor of the specified bank
- * to shared memory.
+ * to a named shared memory segment, which is created by the first process
+ * and attached to by all others. Besides the data, the segment holds
+ * the queue of "free" buffers and channels, so that buffers peeked
+ * in one process may be handed to another one by id with
+ * MMPS_SendShMemBuffer() and MMPS_ReceiveShMemBuffer().
+ *
+ * Bank must be initialized in each process with the same buffer size
+ * and number of buffers, without options, magazines and followers,
+ * and must not be used before it is mapped.
  *
  * @param   pool        Pointer to MMPS pool descriptor.
  * @param   bankId      Bank id.
@@ -433,6 +1028,24 @@ MMPS_MapShMemBufferBank(
     unsigned int        bankId,
     const char          *sharedMemoryName);
 
+/**
+ * @brief   Release shared memory of a bank.
+ *
+ * Data blocks of all buffers of the specified bank are detached
+ * and the whole shared memory segment is unmapped at once. The bank
+ * must not be used afterwards.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   bankId      Bank id of a bank mapped with MMPS_MapShMemBufferBank().
+ *
+ * @return  0 upon successful completion.
+ * @return  Error code (negative value), if cannot release shared memory mapping.
+ */
+extern int
+MMPS_UnmapShMemBufferBank(
+    struct MMPS_Pool    *pool,
+    unsigned int        bankId);
+
 /**
  * @brief   Map single data block to shared memory.
  *
@@ -450,7 +1063,8 @@ MMPS_MapShMemBuffer(struct MMPS_Buffer *buffer);
 /**
  * @brief   Release single data block from shared memory.
  *
- * Release data block of a single MMPS buffer descriptor from shared memory.
+ * Detach data block of a single MMPS buffer descriptor from shared memory.
+ * The segment itself stays mapped until MMPS_UnmapShMemBufferBank().
  *
  * @param   buffer      Pointer to MMPS buffer descriptor those data block
  *                      needs to be unmapped from shared memory.
@@ -461,6 +1075,136 @@ MMPS_MapShMemBuffer(struct MMPS_Buffer *buffer);
 extern int
 MMPS_UnmapShMemBuffer(struct MMPS_Buffer *buffer);
 
+/**
+ * @brief   Hand a buffer over to another process.
+ *
+ * Buffer id and data size are put to the specified channel of the shared
+ * memory segment of the bank. The caller gives up the buffer - it must
+ * neither use nor poke it afterwards.
+ *
+ * @param   buffer      Pointer to MMPS buffer descriptor of a bank mapped
+ *                      to shared memory. Must not be part of a chain,
+ *                      touched or spliced.
+ * @param   channel     Channel id, less than MMPS_SHM_NUMBER_OF_CHANNELS.
+ *
+ * @return  0 upon successful completion.
+ * @return  Error code (negative value), in case of error.
+ */
+extern int
+MMPS_SendShMemBuffer(
+    struct MMPS_Buffer  *buffer,
+    unsigned int        channel);
+
+/**
+ * @brief   Take over a buffer handed by another process.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   bankId      Bank id of a bank mapped to shared memory.
+ * @param   channel     Channel id, less than MMPS_SHM_NUMBER_OF_CHANNELS.
+ * @param   ownerId     Owner id or application id the buffer
+ *                      will be associated with.
+ * @param   timeout     Maximal time to wait in milliseconds, 0 not to wait
+ *                      at all or MMPS_WAIT_FOREVER.
+ *
+ * @return  Pointer to MMPS buffer descriptor, with cursor at the beginning
+ *          of data and data size set by the sender.
+ * @return  NULL if nothing was received within the timeout.
+ */
+extern struct MMPS_Buffer *
+MMPS_ReceiveShMemBuffer(
+    struct MMPS_Pool    *pool,
+    unsigned int        bankId,
+    unsigned int        channel,
+    const unsigned int  ownerId,
+    unsigned int        timeout);
+
+#ifdef MMPS_IO_URING
+
+/**
+ * @brief   Lend buffers of the specified bank to the kernel as an io_uring
+ *          provided buffer ring.
+ *
+ * Ring is filled with buffers peeked from the bank and registered
+ * with the io_uring instance under the given buffer group id. Receive
+ * requests submitted with IOSQE_BUFFER_SELECT for this group take
+ * a buffer out of the ring only when data arrives. Buffers of banks
+ * with 'allocate on demand' cannot be lent, their data is not there
+ * before peek.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   bankId      Bank id to peek buffers from.
+ * @param   ringFd      File descriptor of io_uring instance.
+ * @param   groupId     Buffer group id to register the ring with.
+ * @param   numberOfEntries Number of entries, a power of two not larger
+ *                      than MMPS_MAX_RING_ENTRIES.
+ * @param   ownerId     Owner id the buffers will be associated with.
+ * @param   ring        Where to store the pointer to buffer ring descriptor.
+ *
+ * @return  MMPS_OK upon successful completion.
+ * @return  MMPS_WRONG_BANK_ID if the bank does not exist.
+ * @return  MMPS_RING_ERROR if the ring cannot be built for the bank.
+ * @return  MMPS_CANNOT_REGISTER_RING if the kernel refused the ring.
+ * @return  MMPS_OUT_OF_MEMORY if memory for the ring cannot be allocated.
+ */
+extern int
+MMPS_InitBufferRing(
+    struct MMPS_Pool        *pool,
+    unsigned int            bankId,
+    int                     ringFd,
+    unsigned int            groupId,
+    unsigned int            numberOfEntries,
+    const unsigned int      ownerId,
+    struct MMPS_BufferRing  **ring);
+
+/**
+ * @brief   Take the buffer the kernel has filled out of the buffer ring.
+ *
+ * The slot of the buffer in the ring is refilled with another buffer
+ * of the bank. If the bank is exhausted, the slot stays empty until
+ * MMPS_ReplenishBufferRing() or another completion refills it.
+ *
+ * @param   ring        Pointer to MMPS buffer ring descriptor.
+ * @param   flags       Flags of io_uring completion.
+ * @param   result      Result of io_uring completion (number of bytes
+ *                      received).
+ *
+ * @return  Pointer to MMPS buffer descriptor with data size set
+ *          to the number of bytes received and cursor at the beginning.
+ * @return  NULL if the completion does not carry a buffer.
+ */
+extern struct MMPS_Buffer *
+MMPS_TakeFromBufferRing(
+    struct MMPS_BufferRing  *ring,
+    unsigned int            flags,
+    int                     result);
+
+/**
+ * @brief   Refill slots of the buffer ring that were left empty.
+ *
+ * @param   ring        Pointer to MMPS buffer ring descriptor.
+ *
+ * @return  Number of slots that are still empty.
+ */
+extern unsigned int
+MMPS_ReplenishBufferRing(struct MMPS_BufferRing *ring);
+
+/**
+ * @brief   Unregister the buffer ring and give all its buffers back
+ *          to their bank.
+ *
+ * No receive request using the buffer group may be pending.
+ *
+ * @param   ring        Pointer to MMPS buffer ring descriptor.
+ *
+ * @return  MMPS_OK upon successful completion.
+ * @return  MMPS_CANNOT_REGISTER_RING if the kernel refused to unregister
+ *          the ring, the ring is left as is then.
+ */
+extern int
+MMPS_ReleaseBufferRing(struct MMPS_BufferRing *ring);
+
+#endif // MMPS_IO_URING
+
 #ifdef MMPS_DMA
 
 /**
@@ -536,41 +1280,85 @@ MMPS_BufferById(
 /**
  * @brief   Peek buffer from the first bank of the MMPS pool.
  *
- * @param   pool        Pointer to MMPS pool descriptor.
- * @param   ownerId     Owner id or application id the buffer
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   ownerId     Owner id or application id the buffer
+ *                      will be associated with.
+ *                      This value will be stored in buffer descriptor.
+ *
+ * @return  Pointer to MMPS buffer descriptor upon successful completion.
+ * @return  NULL if there are no free buffers available in a specified pool.
+ */
+extern struct MMPS_Buffer *
+MMPS_PeekBuffer(
+    struct MMPS_Pool    *pool,
+    const unsigned int  ownerId);
+
+/**
+ * @brief   Peek a buffer of preferred size from of the specified MMPS pool.
+ *
+ * The bank of the smallest buffers that fit the preferred size is looked up
+ * in the size class table of the pool. What happens if that bank
+ * is exhausted depends on exhaustion policy of the pool
+ * (see MMPS_SetExhaustionPolicy()).
+ *
+ * @param   pool:       Pointer to MMPS pool descriptor.
+ * @param   preferredSize Preferred/minimum size of requested buffer.
+ * @param   ownerId:    Owner id or application id the buffer
  *                      will be associated with.
  *                      This value will be stored in buffer descriptor.
  *
  * @return  Pointer to MMPS buffer descriptor upon successful completion.
+ *          It may be the first buffer of a chain if no single buffer
+ *          can hold the preferred size (see MMPS_EXHAUSTION_*).
  * @return  NULL if there are no free buffers available in a specified pool.
  */
 extern struct MMPS_Buffer *
-MMPS_PeekBuffer(
+MMPS_PeekBufferOfSize(
     struct MMPS_Pool    *pool,
+    unsigned int        preferredSize,
     const unsigned int  ownerId);
 
 /**
- * @brief   Peek a buffer of preferred size from of the specified MMPS pool.
+ * @brief   Peek a buffer of preferred size with explicit exhaustion policy.
  *
- * MMPS will go through all banks until unused buffer is found.
- * If no buffer of a preferred size can be found,
- * a smaller buffer can be returned.
+ * Same as MMPS_PeekBufferOfSize(), but ignores exhaustion policy of the pool.
  *
  * @param   pool:       Pointer to MMPS pool descriptor.
  * @param   preferredSize Preferred/minimum size of requested buffer.
+ * @param   policy      One of MMPS_EXHAUSTION_*.
  * @param   ownerId:    Owner id or application id the buffer
  *                      will be associated with.
  *                      This value will be stored in buffer descriptor.
  *
  * @return  Pointer to MMPS buffer descriptor upon successful completion.
- * @return  NULL if there are no free buffers available in a specified pool.
+ *          It may be the first buffer of a chain if no single buffer
+ *          can hold the preferred size (see MMPS_EXHAUSTION_*).
+ * @return  NULL if there are no free buffers available in a specified pool
+ *          or, with MMPS_EXHAUSTION_FAIL, if no bank has buffers large enough.
  */
 extern struct MMPS_Buffer *
-MMPS_PeekBufferOfSize(
+MMPS_PeekBufferOfSizeWithPolicy(
     struct MMPS_Pool    *pool,
     unsigned int        preferredSize,
+    unsigned int        policy,
     const unsigned int  ownerId);
 
+/**
+ * @brief   Choose what MMPS_PeekBufferOfSize() does when the bank
+ *          of requested size is exhausted.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   policy      One of MMPS_EXHAUSTION_* (default is
+ *                      MMPS_EXHAUSTION_LARGER).
+ *
+ * @return  0 upon successful completion.
+ * @return  Error code (negative value), in case of error.
+ */
+extern int
+MMPS_SetExhaustionPolicy(
+    struct MMPS_Pool    *pool,
+    unsigned int        policy);
+
 /**
  * @brief   Peek an unused buffer from the specified MMPS bank.
  *
@@ -589,11 +1377,69 @@ MMPS_PeekBufferFromBank(
     unsigned int        bankId,
     const unsigned int  ownerId);
 
+/**
+ * @brief   Peek an unused buffer from the specified MMPS bank, waiting
+ *          for a buffer to be given back if the bank is exhausted.
+ *
+ * The caller is put asleep until some other thread pokes a buffer
+ * to the bank or until the timeout expires. With MMPS_BANK_FIFO option
+ * waiters are served in the order they started to wait.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   bankId      Bank id to search for unused buffer.
+ * @param   ownerId     Owner id or application id the buffer
+ *                      will be associated with.
+ *                      This value will be stored in buffer descriptor.
+ * @param   timeout     Maximal time to wait in milliseconds, 0 not to wait
+ *                      at all or MMPS_WAIT_FOREVER.
+ *
+ * @return  Pointer to MMPS buffer descriptor upon successful completion.
+ * @return  NULL if no buffer became available within the timeout.
+ */
+extern struct MMPS_Buffer *
+MMPS_PeekBufferTimed(
+    struct MMPS_Pool    *pool,
+    unsigned int        bankId,
+    const unsigned int  ownerId,
+    unsigned int        timeout);
+
+/**
+ * @brief   Peek several unused buffers from the specified MMPS bank at once.
+ *
+ * Buffers are returned as a chain linked in the order they were peeked.
+ * Either all requested buffers are peeked or none.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   bankId      Bank id to search for unused buffers.
+ * @param   numberOfBuffers Number of buffers to peek.
+ * @param   ownerId     Owner id or application id the buffers
+ *                      will be associated with.
+ *                      This value will be stored in buffer descriptors.
+ *
+ * @return  Pointer to MMPS buffer descriptor of the first buffer of a chain
+ *          upon successful completion.
+ * @return  NULL if there are not enough free buffers available
+ *          in a specified bank.
+ */
+extern struct MMPS_Buffer *
+MMPS_PeekBuffers(
+    struct MMPS_Pool    *pool,
+    unsigned int        bankId,
+    unsigned int        numberOfBuffers,
+    const unsigned int  ownerId);
+
 /**
  * @brief   Poke buffer or buffer chain back to MMPS pool.
  *
  * In case of chain of buffers, the chain will be disassembled and each buffer
- * will be put back to a corresponding bank.
+ * will be put back to a corresponding bank. Buffers of a chain are given back
+ * in batches grouped by bank, so that each bank is locked once per batch
+ * and not once per buffer.
+ *
+ * A buffer touched by several members (see MMPS_TouchBuffer()) only loses
+ * one touch, and goes back to its bank with the last touch. Its chaining
+ * is left intact until then, so that a shared chain could be poked
+ * by each of its members.
  *
  * @param   buffer      Pointer to a buffer descriptor or a chain
  *                      of buffer descriptors to be put back to MMPS pool.
@@ -604,8 +1450,9 @@ MMPS_PokeBuffer(struct MMPS_Buffer *buffer);
 /**
  * @brief   Increment the number of touches of MMPS buffer.
  *
- * As long the number of touches is more than zero the MMPS buffer
- * could be poked back to the pool.
+ * Peeked buffer is touched once by the peeking member. Each additional touch
+ * lets one more member share the buffer read-only and poke it when done.
+ * The buffer goes back to the pool only when the last touch is dropped.
  *
  * @param   buffer      Pointer to a buffer descriptor or a chain
  *                      of buffer descriptors to be touched.
@@ -616,10 +1463,8 @@ MMPS_TouchBuffer(struct MMPS_Buffer *buffer);
 /**
  * @brief   Decrement the number of touches of MMPS buffer.
  *
- * MMPS buffer could be poked back to the pool only when the number of touches
- * is equal zero. When last member absolves the MMPS buffer it is automatically
- * poked back to the pool - in such case there is no need to call
- * MMPS_PokeBuffer().
+ * When last member absolves the MMPS buffer it is automatically
+ * poked back to the pool. Same as MMPS_PokeBuffer().
  *
  * @param   buffer      Pointer to a buffer descriptor or a chain
  *                      of buffer descriptors to be absolved.
@@ -741,6 +1586,46 @@ MMPS_RemoveFromChain(
 extern void
 MMPS_TruncateChain(struct MMPS_Buffer *tailingBuffer);
 
+/**
+ * @brief   Split buffer at an offset of its data without copying the data.
+ *
+ * Data behind the offset is handed over to a new buffer descriptor,
+ * which references the same data block. Data block goes back to its bank
+ * only when the buffer and all buffers spliced off it have been poked.
+ * Chaining of the referenced buffer is not changed.
+ *
+ * @param   buffer      Pointer to MMPS buffer descriptor to be split.
+ * @param   offset      Offset in data of the buffer to split at.
+ *
+ * @return  Pointer to MMPS buffer descriptor (not chained) holding data
+ *          behind the offset.
+ * @return  NULL if offset is beyond data or descriptor cannot be allocated.
+ */
+extern struct MMPS_Buffer *
+MMPS_SpliceBuffer(
+    struct MMPS_Buffer  *buffer,
+    unsigned int        offset);
+
+/**
+ * @brief   Transfer data behind an offset of a chain to a new chain.
+ *
+ * The buffer, the offset falls into, is split with MMPS_SpliceBuffer(),
+ * so that no data is copied. After completion the referenced chain holds
+ * exactly offset bytes of data.
+ *
+ * @param   chain       Pointer to MMPS buffer descriptor of the chain.
+ * @param   offset      Offset in total data of the chain to split at.
+ *
+ * @return  Pointer to MMPS buffer descriptor of the chain holding data
+ *          behind the offset.
+ * @return  NULL if there are no buffers behind the offset
+ *          or descriptor cannot be allocated.
+ */
+extern struct MMPS_Buffer *
+MMPS_SplitChain(
+    struct MMPS_Buffer  *chain,
+    unsigned int        offset);
+
 /**
  * @brief   Copy data from one buffer chain to another.
  *
@@ -826,27 +1711,110 @@ MMPS_MoveCursorRelative(
 extern boolean
 MMPS_IsCursorAtTheEndOfData(struct MMPS_Buffer *buffer);
 
-#if 0
+/**
+ * @brief   Receive data from a socket straight into a buffer chain.
+ *
+ * Data is appended behind the data the chain already holds. The chain
+ * is extended with buffers of the same pool beforehand, if it cannot hold
+ * the requested amount of data. Each recvmsg() call gets a scatter list
+ * of all buffers still to be filled, so that it takes as much data
+ * as the socket has at once. Partial receives are continued until
+ * the requested amount of data is received.
+ *
+ * @param   sockFD      Socket file descriptor.
+ * @param   chain       Pointer to MMPS buffer descriptor of the first buffer
+ *                      of a chain.
+ * @param   bytes       Number of bytes to receive.
+ *
+ * @return  Number of bytes received upon successful completion. Less than
+ *          requested if the connection was closed by the peer or if
+ *          a non-blocking socket has no more data.
+ * @return  MMPS_SOCKET_ERROR with errno set to EAGAIN, if a non-blocking
+ *          socket has no data at all.
+ * @return  Error code (negative value), in case of error (errno is kept
+ *          for MMPS_SOCKET_ERROR).
+ */
+extern ssize_t
+MMPS_ReceiveIntoChain(
+    int                 sockFD,
+    struct MMPS_Buffer  *chain,
+    size_t              bytes);
 
 /**
- * @brief   Prepare MMPS buffer descriptor for use for network communication.
+ * @brief   Receive data from a socket straight into a buffer chain,
+ *          with flags for recvmsg().
+ *
+ * Same as MMPS_ReceiveIntoChain(). With MSG_DONTWAIT an event loop may
+ * take whatever a blocking socket has without waiting for the rest.
+ *
+ * @param   sockFD      Socket file descriptor.
+ * @param   chain       Pointer to MMPS buffer descriptor of the first buffer
+ *                      of a chain.
+ * @param   bytes       Number of bytes to receive.
+ * @param   flags       Flags for recvmsg().
+ *
+ * @return  Number of bytes received upon successful completion. Less than
+ *          requested if the connection was closed by the peer or if
+ *          no more data is available without blocking.
+ * @return  MMPS_SOCKET_ERROR with errno set to EAGAIN, if nothing at all
+ *          is available without blocking.
+ * @return  Error code (negative value), in case of error (errno is kept
+ *          for MMPS_SOCKET_ERROR).
+ */
+extern ssize_t
+MMPS_ReceiveIntoChainWithFlags(
+    int                 sockFD,
+    struct MMPS_Buffer  *chain,
+    size_t              bytes,
+    int                 flags);
+
+/**
+ * @brief   Send data of a buffer chain to a socket.
  *
- * Prepare MMPS buffer descriptor for use for network communication
- * with scatter-gather list.
+ * Each sendmsg() call gets a gather list of all buffers still to be sent.
+ * Partial sends are continued until all data is sent.
  *
- * @param   buffer      Pointer to MMPS buffer descriptor.
+ * @param   sockFD      Socket file descriptor.
+ * @param   chain       Pointer to MMPS buffer descriptor of the first buffer
+ *                      of a chain.
  *
- * @return  Pointer to the beginning of the scatter-gather list.
+ * @return  Number of bytes sent upon successful completion. Less than
+ *          data size of the chain if a non-blocking socket cannot take more.
+ * @return  Error code (negative value), in case of error (errno is kept).
  */
-extern struct MMPS_Vector *
-MMPS_PrepareScatterGather(struct MMPS_Buffer *buffer);
+extern ssize_t
+MMPS_SendChain(
+    int                 sockFD,
+    struct MMPS_Buffer  *chain);
 
-#endif
+/**
+ * @brief   Send a header followed by data of a buffer chain to a socket.
+ *
+ * Same as MMPS_SendChain(), but the header goes in front of the data
+ * with the same sendmsg() call.
+ *
+ * @param   sockFD      Socket file descriptor.
+ * @param   header      Pointer to header or NULL.
+ * @param   headerSize  Size of header.
+ * @param   chain       Pointer to MMPS buffer descriptor of the first buffer
+ *                      of a chain or NULL.
+ *
+ * @return  Number of bytes sent including header upon successful completion.
+ * @return  Error code (negative value), in case of error (errno is kept).
+ */
+extern ssize_t
+MMPS_SendChainWithHeader(
+    int                 sockFD,
+    const void          *header,
+    size_t              headerSize,
+    struct MMPS_Buffer  *chain);
 
 /**
- * @brief   Put (write) data to a buffer chain under cursor.
+ * @brief   Put (write) data to a buffer chain under cursor - slow path
+ *          of MMPS_PutData().
  *
- * Append new buffer if necessary.
+ * Data is spread over the buffers of a chain, new buffers are appended
+ * if necessary.
  *
  * @param   buffer          Pointer to MMPS buffer descriptor.
  * @param   sourceData      Pointer to memory area to copy data from.
@@ -854,18 +1822,16 @@ MMPS_PrepareScatterGather(struct MMPS_Buffer *buffer);
  *
  * @return  Pointer to MMPS buffer descriptor of a buffer in which a cursor
  *          is pointing to, after write is complete.
- *
- * @warning Always care about return value - it may be another buffer
- *          than a referenced buffer.
  */
 extern struct MMPS_Buffer *
-MMPS_PutData(
+MMPS_PutDataToChain(
     struct MMPS_Buffer  *buffer,
     const char* const   sourceData,
     unsigned int        sourceDataSize);
 
 /**
- * @brief   Get (read) data from a buffer chain under cursor.
+ * @brief   Get (read) data from a buffer chain under cursor - slow path
+ *          of MMPS_GetData().
  *
  * @param   buffer      Pointer to MMPS buffer descriptor.
  * @param   destData    Pointer to memory area to copy data to.
@@ -878,22 +1844,23 @@ MMPS_PutData(
  *          is pointing to, after read is complete.
  * @return  NULL in case the last byte of the last buffer of a chain
  *          has been read.
- *
- * @warning Always care about return value - it may be another buffer
- *          than a referenced buffer.
  */
 extern struct MMPS_Buffer *
-MMPS_GetData(
+MMPS_GetDataFromChain(
     struct MMPS_Buffer  *buffer,
     char* const         destData,
     unsigned int        destDataSize,
     unsigned int        *bytesCopied);
 
 /**
- * @brief   Put one byte to buffer chain under cursor.
+ * @brief   Put (write) data to a buffer chain under cursor.
  *
- * @param   buffer      Pointer to MMPS buffer descriptor.
- * @param   sourceData  Pointer to memory area to copy data from.
+ * Append new buffer if necessary. If data fits in the buffer under cursor,
+ * then it is stored directly, otherwise MMPS_PutDataToChain() is called.
+ *
+ * @param   buffer          Pointer to MMPS buffer descriptor.
+ * @param   sourceData      Pointer to memory area to copy data from.
+ * @param   sourceDataSize  Size of data to copy.
  *
  * @return  Pointer to MMPS buffer descriptor of a buffer in which a cursor
  *          is pointing to, after write is complete.
@@ -901,16 +1868,38 @@ MMPS_GetData(
  * @warning Always care about return value - it may be another buffer
  *          than a referenced buffer.
  */
-extern struct MMPS_Buffer *
-MMPS_PutInt8(
+static inline struct MMPS_Buffer *
+MMPS_PutData(
     struct MMPS_Buffer  *buffer,
-    uint8               *sourceData);
+    const char* const   sourceData,
+    unsigned int        sourceDataSize)
+{
+    if (buffer->cursor + sourceDataSize > buffer->data + buffer->bufferSize)
+        return MMPS_PutDataToChain(buffer, sourceData, sourceDataSize);
+
+    memcpy(buffer->cursor, sourceData, sourceDataSize);
+
+    buffer->cursor += sourceDataSize;
+
+    if (buffer->dataSize < buffer->cursor - buffer->data)
+        buffer->dataSize = buffer->cursor - buffer->data;
+
+    return buffer;
+}
 
 /**
- * @brief   Get one byte from buffer chain under cursor.
+ * @brief   Get (read) data from a buffer chain under cursor.
+ *
+ * If data is available in the buffer under cursor and does not end
+ * at its end of data, then it is loaded directly, otherwise
+ * MMPS_GetDataFromChain() is called.
  *
  * @param   buffer      Pointer to MMPS buffer descriptor.
  * @param   destData    Pointer to memory area to copy data to.
+ * @param   destDataSize Size of data to copy.
+ * @param   bytesCopied If not NULL the it points to location
+ *                      in user memory space where the actually copied
+ *                      amount of bytes should be stored.
  *
  * @return  Pointer to MMPS buffer descriptor of a buffer in which a cursor
  *          is pointing to, after read is complete.
@@ -920,15 +1909,137 @@ MMPS_PutInt8(
  * @warning Always care about return value - it may be another buffer
  *          than a referenced buffer.
  */
-extern struct MMPS_Buffer *
-MMPS_GetInt8(
+static inline struct MMPS_Buffer *
+MMPS_GetData(
     struct MMPS_Buffer  *buffer,
-    uint8               *destData);
+    char* const         destData,
+    unsigned int        destDataSize,
+    unsigned int        *bytesCopied)
+{
+    if (buffer->cursor + destDataSize >= buffer->data + buffer->dataSize)
+        return MMPS_GetDataFromChain(buffer, destData, destDataSize, bytesCopied);
+
+    memcpy(destData, buffer->cursor, destDataSize);
+
+    buffer->cursor += destDataSize;
+
+    if (bytesCopied != NULL)
+        *bytesCopied = destDataSize;
+
+    return buffer;
+}
+
+/**
+ * @brief   Reserve contiguous space in the buffer behind the buffer
+ *          under cursor of a writer - slow path of MMPS_Reserve().
+ *
+ * Next buffer of a chain is used if it is large enough, otherwise a new one
+ * is peeked and inserted into the chain behind the buffer under cursor.
+ * Free space left in the buffer under cursor stays unused.
+ *
+ * @param   writer      Pointer to MMPS writer descriptor.
+ * @param   size        Number of bytes to reserve.
+ *
+ * @return  Pointer to reserved space upon successful completion.
+ * @return  NULL if there is no buffer large enough.
+ */
+extern char *
+MMPS_ReserveInNextBuffer(
+    struct MMPS_Writer  *writer,
+    unsigned int        size);
 
 /**
- * @brief   Put one word (two bytes) to buffer chain under cursor.
+ * @brief   Start writing to a buffer chain at the cursor of a buffer.
  *
- * Do endian conversion if needed.
+ * @param   writer      Pointer to MMPS writer descriptor.
+ * @param   buffer      Pointer to MMPS buffer descriptor to write to.
+ */
+static inline void
+MMPS_InitWriter(
+    struct MMPS_Writer  *writer,
+    struct MMPS_Buffer  *buffer)
+{
+    writer->buffer = buffer;
+}
+
+/**
+ * @brief   Reserve contiguous space under cursor of a writer.
+ *
+ * Space is reserved in the buffer under cursor if it fits there, otherwise
+ * in the next buffer of a chain (see MMPS_ReserveInNextBuffer()).
+ * Reserved space has to be filled and then taken into data
+ * with MMPS_Commit().
+ *
+ * @param   writer      Pointer to MMPS writer descriptor.
+ * @param   size        Number of bytes to reserve.
+ *
+ * @return  Pointer to reserved space upon successful completion.
+ * @return  NULL if space cannot be reserved.
+ */
+static inline char *
+MMPS_Reserve(
+    struct MMPS_Writer  *writer,
+    unsigned int        size)
+{
+    struct MMPS_Buffer  *buffer = writer->buffer;
+
+    if (buffer->cursor + size <= buffer->data + buffer->bufferSize)
+        return buffer->cursor;
+
+    return MMPS_ReserveInNextBuffer(writer, size);
+}
+
+/**
+ * @brief   Take bytes written to reserved space into data
+ *          and move cursor of a writer behind them.
+ *
+ * @param   writer      Pointer to MMPS writer descriptor.
+ * @param   used        Number of bytes written, not more than reserved.
+ */
+static inline void
+MMPS_Commit(
+    struct MMPS_Writer  *writer,
+    unsigned int        used)
+{
+    struct MMPS_Buffer  *buffer = writer->buffer;
+
+    buffer->cursor += used;
+
+    if (buffer->dataSize < buffer->cursor - buffer->data)
+        buffer->dataSize = buffer->cursor - buffer->data;
+}
+
+/**
+ * @brief   Write data of any size under cursor of a writer.
+ *
+ * Data may be spread over several buffers, as with MMPS_PutData().
+ *
+ * @param   writer          Pointer to MMPS writer descriptor.
+ * @param   sourceData      Pointer to memory area to copy data from.
+ * @param   sourceDataSize  Size of data to copy.
+ *
+ * @return  0 upon successful completion.
+ * @return  MMPS_OUT_OF_MEMORY if chain cannot be extended.
+ */
+static inline int
+MMPS_WriteData(
+    struct MMPS_Writer  *writer,
+    const char* const   sourceData,
+    unsigned int        sourceDataSize)
+{
+    struct MMPS_Buffer  *buffer;
+
+    buffer = MMPS_PutData(writer->buffer, sourceData, sourceDataSize);
+    if (buffer == NULL)
+        return MMPS_OUT_OF_MEMORY;
+
+    writer->buffer = buffer;
+
+    return MMPS_OK;
+}
+
+/**
+ * @brief   Put one byte to buffer chain under cursor.
  *
  * @param   buffer      Pointer to MMPS buffer descriptor.
  * @param   sourceData  Pointer to memory area to copy data from.
@@ -939,15 +2050,16 @@ MMPS_GetInt8(
  * @warning Always care about return value - it may be another buffer
  *          than a referenced buffer.
  */
-extern struct MMPS_Buffer *
-MMPS_PutInt16(
+static inline struct MMPS_Buffer *
+MMPS_PutInt8(
     struct MMPS_Buffer  *buffer,
-    uint16              *sourceData);
+    uint8               *sourceData)
+{
+    return MMPS_PutData(buffer, (char *) sourceData, sizeof(uint8));
+}
 
 /**
- * @brief   Get one word (two bytes) from buffer chain under cursor.
- *
- * Do endian conversion if needed.
+ * @brief   Get one byte from buffer chain under cursor.
  *
  * @param   buffer      Pointer to MMPS buffer descriptor.
  * @param   destData    Pointer to memory area to copy data to.
@@ -960,18 +2072,20 @@ MMPS_PutInt16(
  * @warning Always care about return value - it may be another buffer
  *          than a referenced buffer.
  */
-extern struct MMPS_Buffer *
-MMPS_GetInt16(
+static inline struct MMPS_Buffer *
+MMPS_GetInt8(
     struct MMPS_Buffer  *buffer,
-    uint16              *destData);
+    uint8               *destData)
+{
+    return MMPS_GetData(buffer, (char *) destData, sizeof(uint8), NULL);
+}
 
 /**
- * @brief   Put one double word (four bytes) to buffer chain under cursor.
- *
- * Do endian conversion if needed
+ * @brief   Put 16, 32 or 64-bit value given in host byte order
+ *          to buffer chain under cursor in big-endian (network) byte order.
  *
  * @param   buffer      Pointer to MMPS buffer descriptor.
- * @param   sourceData  Pointer to memory area to copy data from.
+ * @param   value       Value in host byte order.
  *
  * @return  Pointer to MMPS buffer descriptor of a buffer in which a cursor
  *          is pointing to, after write is complete.
@@ -979,18 +2093,39 @@ MMPS_GetInt16(
  * @warning Always care about return value - it may be another buffer
  *          than a referenced buffer.
  */
-extern struct MMPS_Buffer *
-MMPS_PutInt32(
+static inline struct MMPS_Buffer *
+MMPS_PutBE16(
+    struct MMPS_Buffer  *buffer,
+    uint16              value)
+{
+    value = htobe16(value);
+    return MMPS_PutData(buffer, (char *) &value, sizeof(value));
+}
+
+static inline struct MMPS_Buffer *
+MMPS_PutBE32(
     struct MMPS_Buffer  *buffer,
-    uint32              *sourceData);
+    uint32              value)
+{
+    value = htobe32(value);
+    return MMPS_PutData(buffer, (char *) &value, sizeof(value));
+}
+
+static inline struct MMPS_Buffer *
+MMPS_PutBE64(
+    struct MMPS_Buffer  *buffer,
+    uint64              value)
+{
+    value = htobe64(value);
+    return MMPS_PutData(buffer, (char *) &value, sizeof(value));
+}
 
 /**
- * @brief   Get one double word (four bytes) from buffer chain under cursor.
- *
- * Do endian conversion if needed.
+ * @brief   Get 16, 32 or 64-bit value stored in big-endian (network)
+ *          byte order from buffer chain under cursor in host byte order.
  *
  * @param   buffer      Pointer to MMPS buffer descriptor.
- * @param   destData    Pointer to memory area to copy data to.
+ * @param   destData    Pointer to memory area to store value to.
  *
  * @return  Pointer to MMPS buffer descriptor of a buffer in which a cursor
  *          is pointing to, after read is complete.
@@ -1000,15 +2135,43 @@ MMPS_PutInt32(
  * @warning Always care about return value - it may be another buffer
  *          than a referenced buffer.
  */
-extern struct MMPS_Buffer *
-MMPS_GetInt32(
+static inline struct MMPS_Buffer *
+MMPS_GetBE16(
+    struct MMPS_Buffer  *buffer,
+    uint16              *destData)
+{
+    uint16 value;
+    buffer = MMPS_GetData(buffer, (char *) &value, sizeof(value), NULL);
+    *destData = be16toh(value);
+    return buffer;
+}
+
+static inline struct MMPS_Buffer *
+MMPS_GetBE32(
+    struct MMPS_Buffer  *buffer,
+    uint32              *destData)
+{
+    uint32 value;
+    buffer = MMPS_GetData(buffer, (char *) &value, sizeof(value), NULL);
+    *destData = be32toh(value);
+    return buffer;
+}
+
+static inline struct MMPS_Buffer *
+MMPS_GetBE64(
     struct MMPS_Buffer  *buffer,
-    uint32              *destData);
+    uint64              *destData)
+{
+    uint64 value;
+    buffer = MMPS_GetData(buffer, (char *) &value, sizeof(value), NULL);
+    *destData = be64toh(value);
+    return buffer;
+}
 
 /**
- * @brief   Put one quad word (eight bytes) to buffer chain under cursor.
- *
- * Do endian conversion if needed.
+ * @brief   Put one word, double word or quad word to buffer chain
+ *          under cursor. Same as MMPS_PutBE16(), MMPS_PutBE32()
+ *          and MMPS_PutBE64() with value referenced by pointer.
  *
  * @param   buffer      Pointer to MMPS buffer descriptor.
  * @param   sourceData  Pointer to memory area to copy data from.
@@ -1019,15 +2182,34 @@ MMPS_GetInt32(
  * @warning Always care about return value - it may be another buffer
  *          than a referenced buffer.
  */
-extern struct MMPS_Buffer *
+static inline struct MMPS_Buffer *
+MMPS_PutInt16(
+    struct MMPS_Buffer  *buffer,
+    uint16              *sourceData)
+{
+    return MMPS_PutBE16(buffer, *sourceData);
+}
+
+static inline struct MMPS_Buffer *
+MMPS_PutInt32(
+    struct MMPS_Buffer  *buffer,
+    uint32              *sourceData)
+{
+    return MMPS_PutBE32(buffer, *sourceData);
+}
+
+static inline struct MMPS_Buffer *
 MMPS_PutInt64(
     struct MMPS_Buffer  *buffer,
-    uint64              *sourceData);
+    uint64              *sourceData)
+{
+    return MMPS_PutBE64(buffer, *sourceData);
+}
 
 /**
- * @brief   Get one quad word (eight bytes) from buffer chain under cursor.
- *
- * Do endian conversion if needed.
+ * @brief   Get one word, double word or quad word from buffer chain
+ *          under cursor. Same as MMPS_GetBE16(), MMPS_GetBE32()
+ *          and MMPS_GetBE64().
  *
  * @param   buffer      Pointer to MMPS buffer descriptor.
  * @param   destData    Pointer to memory area to copy data to.
@@ -1040,10 +2222,29 @@ MMPS_PutInt64(
  * @warning Always care about return value - it may be another buffer
  *          than a referenced buffer.
  */
-extern struct MMPS_Buffer *
+static inline struct MMPS_Buffer *
+MMPS_GetInt16(
+    struct MMPS_Buffer  *buffer,
+    uint16              *destData)
+{
+    return MMPS_GetBE16(buffer, destData);
+}
+
+static inline struct MMPS_Buffer *
+MMPS_GetInt32(
+    struct MMPS_Buffer  *buffer,
+    uint32              *destData)
+{
+    return MMPS_GetBE32(buffer, destData);
+}
+
+static inline struct MMPS_Buffer *
 MMPS_GetInt64(
     struct MMPS_Buffer  *buffer,
-    uint64              *destData);
+    uint64              *destData)
+{
+    return MMPS_GetBE64(buffer, destData);
+}
 
 #if 0
 
@@ -1171,3 +2372,75 @@ extern unsigned int
 MMPS_NumberOfBuffersInUse(
     struct MMPS_Pool    *pool,
     unsigned int        bankId);
+
+/**
+ * @brief   Get number of NUMA nodes the specified buffer bank is spread over.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   bankId      Buffer bank id.
+ *
+ * @return  Number of NUMA nodes, 1 for banks without MMPS_BANK_NUMA option.
+ */
+extern unsigned int
+MMPS_NumberOfNodes(
+    struct MMPS_Pool    *pool,
+    unsigned int        bankId);
+
+/**
+ * @brief   Get number of used MMPS buffers of the specified buffer bank
+ *          on the specified NUMA node.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   bankId      Buffer bank id.
+ * @param   node        NUMA node (see MMPS_NumberOfNodes()).
+ *
+ * @return  The number of buffers 'in use' on the node.
+ *
+ * @warning Do not use this function in a production code
+ *          as it may cause performance degradation.
+ */
+extern unsigned int
+MMPS_NumberOfBuffersInUseOnNode(
+    struct MMPS_Pool    *pool,
+    unsigned int        bankId,
+    unsigned int        node);
+
+/**
+ * @brief   Take a snapshot of statistics of the specified buffer bank.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   bankId      Buffer bank id.
+ * @param   statistics  Pointer to the structure to fill in.
+ *
+ * @return  MMPS_OK upon successful completion.
+ * @return  MMPS_WRONG_BANK_ID if the bank does not exist.
+ *
+ * @warning Number of buffers in use is counted the same way
+ *          as by MMPS_NumberOfBuffersInUse(), do not call this function
+ *          on a hot path.
+ */
+extern int
+MMPS_GetBankStatistics(
+    struct MMPS_Pool            *pool,
+    unsigned int                bankId,
+    struct MMPS_BankStatistics  *statistics);
+
+/**
+ * @brief   Write statistics of all banks of a pool to a file descriptor.
+ *
+ * One line per bank of space separated "name=value" pairs,
+ * the chain-length histogram is a comma separated list of counters.
+ * Lines are prefixed by the given name of the pool.
+ *
+ * @param   pool        Pointer to MMPS pool descriptor.
+ * @param   poolName    Name of the pool to be written into each line.
+ * @param   fd          File descriptor to write to.
+ *
+ * @return  MMPS_OK upon successful completion.
+ * @return  MMPS_WRITE_ERROR if writing has failed.
+ */
+extern int
+MMPS_DumpStatistics(
+    struct MMPS_Pool    *pool,
+    const char          *poolName,
+    int                 fd);
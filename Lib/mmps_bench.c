@@ -0,0 +1,1063 @@
+/**
+ * @brief   Benchmark suite of MMPS.
+ *
+ * Standalone, needs nothing but MMPS itself. Measures:
+ *
+ *   fill/<options>     peek/put/poke of chains on a bank created
+ *                      with different bank options,
+ *   peekpoke           peek/poke throughput and latency percentiles
+ *                      at 1..N threads, with and without magazines,
+ *   neighbours         concurrent peek/put/poke of several threads that work
+ *                      on descriptors of neighbouring buffers,
+ *   ofsize             MMPS_PeekBufferOfSize() over the layout of banks
+ *                      of dynamic buffers of the Satellite,
+ *   typed/<type>       typed accessors MMPS_PutIntXX()/MMPS_GetIntXX()
+ *                      over chains,
+ *   putdata/<size>     MMPS_PutData() of records of the given size,
+ *                      extending a chain as it goes,
+ *   copy               MMPS_CopyBuffer() of one chain to another.
+ *
+ * Results are written to stdout as CSV, one line per case. Locking mode
+ * and descriptor size of the build are columns of their own, so that
+ * results of ./mmps_bench (spinlock), ./mmps_bench_mutex (MMPS_MUTEX),
+ * ./mmps_bench_lockfree (MMPS_LOCKFREE) and ./mmps_bench_aligned
+ * (MMPS_ALIGN_DESCRIPTORS) can be concatenated - "make csv" does that
+ * into mmps_bench.csv.
+ *
+ * Run with an optional number of rounds and maximal number of threads.
+ * Latency is measured on every n-th operation only, so that reading
+ * the clock does not dominate throughput.
+ */
+
+// System definition files.
+//
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Common definition files.
+//
+#include "Types.h"
+
+// Local definition files.
+//
+#include "mmps.h"
+
+#if defined(MMPS_LOCKFREE)
+#define BENCH_LOCKING                   "lockfree"
+#elif defined(MMPS_MUTEX)
+#define BENCH_LOCKING                   "mutex"
+#else
+#define BENCH_LOCKING                   "spinlock"
+#endif
+
+#define BENCH_BUFFER_SIZE               4 * KB
+#define BENCH_NUMBER_OF_BUFFERS         16384
+#define BENCH_CHAIN_LENGTH              64
+#define BENCH_CHAIN_SIZE                (BENCH_CHAIN_LENGTH * BENCH_BUFFER_SIZE)
+#define BENCH_DEFAULT_ROUNDS            1000
+#define BENCH_CONCURRENT_BUFFER_SIZE    64
+#define BENCH_CONCURRENT_PUTS           16
+#define BENCH_CONCURRENT_CYCLES         100000
+#define BENCH_MAX_THREADS               256
+#define BENCH_SAMPLES_PER_THREAD        65536
+#define BENCH_MAGAZINE_SIZE             64
+#define BENCH_NUMBER_OF_SIZES           4096
+#define BENCH_MAX_RECORD_SIZE           1500
+
+struct BenchCase
+{
+    const char          *name;
+    unsigned int        options;
+};
+
+static const struct BenchCase benchCases[] =
+{
+    { "fill/regular",           0 },
+    { "fill/hugepages",         MMPS_BANK_HUGEPAGES },
+    { "fill/elastic",           MMPS_BANK_ELASTIC },
+    { "fill/elastic+hugepages", MMPS_BANK_ELASTIC | MMPS_BANK_HUGEPAGES }
+};
+
+// Layout of banks of dynamic buffers of the Satellite, with fewer buffers.
+//
+struct BenchBank
+{
+    unsigned int        bufferSize;
+    unsigned int        numberOfBuffers;
+    unsigned int        options;
+    boolean             magazines;
+};
+
+static const struct BenchBank dynamicBanks[] =
+{
+    { 256,      4096,   MMPS_BANK_ELASTIC | MMPS_BANK_NUMA, TRUE },
+    { 512,      4096,   MMPS_BANK_ELASTIC | MMPS_BANK_NUMA, TRUE },
+    { KB,       4096,   MMPS_BANK_ELASTIC | MMPS_BANK_NUMA, TRUE },
+    { 4 * KB,   1024,   MMPS_BANK_ELASTIC | MMPS_BANK_NUMA, TRUE },
+    { MB,       16,     MMPS_BANK_ELASTIC,                  FALSE }
+};
+
+static const unsigned int recordSizes[] = { 13, 100, BENCH_MAX_RECORD_SIZE };
+
+struct BenchThread
+{
+    pthread_t           thread;
+    struct MMPS_Pool    *pool;
+    unsigned int        cpu;
+    unsigned long       cycles;
+    unsigned long       sampleStride;
+    unsigned long       numberOfSamples;
+    unsigned long       *samples;
+};
+
+struct BenchResult
+{
+    unsigned long       operations;
+    unsigned long       bytes;
+    double              seconds;
+    unsigned long       numberOfSamples;
+    unsigned long       *samples;
+};
+
+static double
+Now(void)
+{
+    struct timespec     now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+}
+
+static unsigned long
+NowNs(void)
+{
+    struct timespec     now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (unsigned long) now.tv_sec * 1000000000UL + (unsigned long) now.tv_nsec;
+}
+
+static void
+BindToCpu(unsigned int cpu)
+{
+    cpu_set_t           cpuSet;
+
+    CPU_ZERO(&cpuSet);
+    CPU_SET(cpu, &cpuSet);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+}
+
+static int
+CompareSamples(const void *a, const void *b)
+{
+    unsigned long       sampleA = *(const unsigned long *) a;
+    unsigned long       sampleB = *(const unsigned long *) b;
+
+    return (sampleA > sampleB) - (sampleA < sampleB);
+}
+
+static unsigned long
+Percentile(
+    unsigned long       *samples,
+    unsigned long       numberOfSamples,
+    unsigned int        perMille)
+{
+    return samples[(numberOfSamples - 1) * perMille / 1000];
+}
+
+/*
+ * @brief   Print header of CSV output.
+ */
+static void
+PrintHeader(void)
+{
+    printf("locking,descriptor_size,case,threads,operations,seconds," \
+            "ops_per_sec,mb_per_sec,p50_ns,p99_ns,p999_ns\n");
+}
+
+/*
+ * @brief   Print one CSV line with the result of a case.
+ *
+ * Throughput in MB/s is left empty for cases that do not move data,
+ * percentiles are left empty for cases without latency samples.
+ * Samples are sorted in place.
+ */
+static void
+PrintResult(
+    const char          *caseName,
+    unsigned int        numberOfThreads,
+    struct BenchResult  *result)
+{
+    printf("%s,%zu,%s,%u,%lu,%.6f,%.0f,",
+            BENCH_LOCKING,
+            sizeof(struct MMPS_Buffer),
+            caseName,
+            numberOfThreads,
+            result->operations,
+            result->seconds,
+            (double) result->operations / result->seconds);
+
+    if (result->bytes != 0)
+        printf("%.1f", (double) result->bytes / result->seconds / (MB));
+
+    if (result->numberOfSamples != 0)
+    {
+        qsort(result->samples,
+                result->numberOfSamples,
+                sizeof(unsigned long),
+                CompareSamples);
+
+        printf(",%lu,%lu,%lu\n",
+                Percentile(result->samples, result->numberOfSamples, 500),
+                Percentile(result->samples, result->numberOfSamples, 990),
+                Percentile(result->samples, result->numberOfSamples, 999));
+    }
+    else
+    {
+        printf(",,,\n");
+    }
+
+    fflush(stdout);
+}
+
+/*
+ * @brief   Create a pool with one bank, with all buffers allocated.
+ *
+ * @return  Pointer to MMPS pool descriptor.
+ * @return  NULL if the pool could not be created.
+ */
+static struct MMPS_Pool *
+CreatePool(
+    unsigned int        bufferSize,
+    unsigned int        numberOfBuffers,
+    unsigned int        options,
+    unsigned int        magazineSize)
+{
+    struct MMPS_Pool    *pool;
+
+    pool = MMPS_InitPool(1);
+    if (pool == NULL)
+        return NULL;
+
+    if (MMPS_InitBankWithOptions(pool,
+            0,
+            bufferSize,
+            0,
+            numberOfBuffers,
+            options) != MMPS_OK)
+        return NULL;
+
+    if (MMPS_AllocateImmediately(pool, 0) != MMPS_OK)
+        return NULL;
+
+    if (MMPS_InitMagazines(pool, 0, magazineSize) != MMPS_OK)
+        return NULL;
+
+    return pool;
+}
+
+/*
+ * @brief   Peek a chain of buffers, fill all of them with 32-bit values
+ *          and poke the chain back, for the given number of rounds.
+ *
+ * Every buffer of the bank is touched once per round
+ * BENCH_NUMBER_OF_BUFFERS / BENCH_CHAIN_LENGTH chains.
+ *
+ * @return  Number of buffers that went through peek/put/poke.
+ * @return  -1 if a chain could not be peeked.
+ */
+static long
+RunCase(
+    struct MMPS_Pool    *pool,
+    unsigned int        rounds)
+{
+    struct MMPS_Buffer  *chain;
+    struct MMPS_Buffer  *buffer;
+    unsigned int        round;
+    unsigned int        chainId;
+    unsigned int        valueId;
+    uint32              value;
+    long                numberOfBuffers;
+
+    numberOfBuffers = 0;
+
+    for (round = 0; round < rounds; round++)
+    {
+        for (chainId = 0;
+             chainId < BENCH_NUMBER_OF_BUFFERS / BENCH_CHAIN_LENGTH;
+             chainId++)
+        {
+            chain = MMPS_PeekBuffers(pool, 0, BENCH_CHAIN_LENGTH, 0);
+            if (chain == NULL)
+                return -1;
+
+            buffer = chain;
+            value = round;
+            for (valueId = 0;
+                 valueId < BENCH_CHAIN_SIZE / sizeof(value);
+                 valueId++)
+            {
+                buffer = MMPS_PutInt32(buffer, &value);
+                value++;
+            }
+
+            MMPS_PokeBuffer(chain);
+
+            numberOfBuffers += BENCH_CHAIN_LENGTH;
+        }
+    }
+
+    return numberOfBuffers;
+}
+
+/*
+ * @brief   Run peek/put/poke of chains on banks with each of bank options.
+ *
+ * @return  0 upon successful completion.
+ * @return  -1 if a pool could not be created or a chain could not be peeked.
+ */
+static int
+RunFillCases(unsigned int rounds)
+{
+    const struct BenchCase  *benchCase;
+    struct MMPS_Pool    *pool;
+    struct BenchResult  result;
+    unsigned int        caseId;
+    long                numberOfBuffers;
+    double              startTime;
+
+    for (caseId = 0;
+         caseId < sizeof(benchCases) / sizeof(benchCases[0]);
+         caseId++)
+    {
+        benchCase = &benchCases[caseId];
+
+        // Pools are never released by MMPS - each case gets its own.
+        //
+        pool = CreatePool(BENCH_BUFFER_SIZE,
+                BENCH_NUMBER_OF_BUFFERS,
+                benchCase->options,
+                0);
+        if (pool == NULL)
+            return -1;
+
+        // Warm up, so that elastic banks have all blocks committed
+        // and all pages are faulted in before measuring.
+        //
+        if (RunCase(pool, 1) < 0)
+            return -1;
+
+        startTime = Now();
+        numberOfBuffers = RunCase(pool, rounds);
+        result.seconds = Now() - startTime;
+
+        if (numberOfBuffers < 0)
+            return -1;
+
+        result.operations = numberOfBuffers;
+        result.bytes = numberOfBuffers * BENCH_BUFFER_SIZE;
+        result.numberOfSamples = 0;
+
+        PrintResult(benchCase->name, 1, &result);
+    }
+
+    return 0;
+}
+
+/*
+ * @brief   Peek a buffer and poke it back, for the given number of cycles,
+ *          taking the time of every sampleStride-th cycle.
+ */
+static void *
+RunPeekPokeThread(void *arg)
+{
+    struct BenchThread  *benchThread = arg;
+    struct MMPS_Buffer  *buffer;
+    unsigned long       cycle;
+    unsigned long       startTime;
+
+    BindToCpu(benchThread->cpu);
+
+    benchThread->numberOfSamples = 0;
+
+    for (cycle = 0; cycle < benchThread->cycles; cycle++)
+    {
+        if ((cycle % benchThread->sampleStride) != 0)
+        {
+            buffer = MMPS_PeekBufferFromBank(benchThread->pool, 0, 1);
+            if (buffer == NULL)
+                return (void *) -1;
+
+            MMPS_PokeBuffer(buffer);
+        }
+        else
+        {
+            startTime = NowNs();
+
+            buffer = MMPS_PeekBufferFromBank(benchThread->pool, 0, 1);
+            if (buffer == NULL)
+                return (void *) -1;
+
+            MMPS_PokeBuffer(buffer);
+
+            benchThread->samples[benchThread->numberOfSamples++] =
+                    NowNs() - startTime;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * @brief   Peek a buffer, fill it with 32-bit values and poke it back,
+ *          for the given number of cycles.
+ *
+ * Thread is bound to its own CPU and the bank has magazines of 2 ids,
+ * so each thread keeps cycling on the one buffer it has peeked first.
+ * These buffers were peeked one after another by all threads,
+ * so their descriptors are neighbours in a descriptor block.
+ */
+static void *
+RunNeighboursThread(void *arg)
+{
+    struct BenchThread  *benchThread = arg;
+    struct MMPS_Buffer  *buffer;
+    unsigned long       cycle;
+    unsigned int        valueId;
+    uint32              value;
+
+    BindToCpu(benchThread->cpu);
+
+    value = 0;
+
+    for (cycle = 0; cycle < benchThread->cycles; cycle++)
+    {
+        buffer = MMPS_PeekBufferFromBank(benchThread->pool, 0, 1);
+        if (buffer == NULL)
+            return (void *) -1;
+
+        for (valueId = 0; valueId < BENCH_CONCURRENT_PUTS; valueId++)
+        {
+            MMPS_PutInt32(buffer, &value);
+            value++;
+        }
+
+        MMPS_PokeBuffer(buffer);
+    }
+
+    return NULL;
+}
+
+/*
+ * @brief   Run a thread routine in the given number of threads,
+ *          each bound to a CPU of its own where possible.
+ *
+ * Latency samples of all threads are collected into the result.
+ *
+ * @return  0 upon successful completion.
+ * @return  -1 if a thread could not peek a buffer.
+ */
+static int
+RunThreads(
+    struct MMPS_Pool    *pool,
+    void                *(*routine)(void *),
+    unsigned int        numberOfThreads,
+    unsigned long       cycles,
+    struct BenchResult  *result)
+{
+    struct BenchThread  benchThreads[BENCH_MAX_THREADS];
+    unsigned int        numberOfCpus;
+    unsigned int        threadId;
+    unsigned long       sampleStride;
+    void                *threadResult;
+    double              startTime;
+    int                 rc;
+
+    numberOfCpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    sampleStride = cycles / BENCH_SAMPLES_PER_THREAD + 1;
+
+    result->samples = malloc(numberOfThreads *
+            (cycles / sampleStride + 1) * sizeof(unsigned long));
+    if (result->samples == NULL)
+        return -1;
+
+    for (threadId = 0; threadId < numberOfThreads; threadId++)
+    {
+        benchThreads[threadId].pool = pool;
+        benchThreads[threadId].cpu = threadId % numberOfCpus;
+        benchThreads[threadId].cycles = cycles;
+        benchThreads[threadId].sampleStride = sampleStride;
+        benchThreads[threadId].numberOfSamples = 0;
+        benchThreads[threadId].samples =
+                &result->samples[threadId * (cycles / sampleStride + 1)];
+    }
+
+    startTime = Now();
+
+    for (threadId = 0; threadId < numberOfThreads; threadId++)
+    {
+        pthread_create(&benchThreads[threadId].thread,
+                NULL,
+                routine,
+                &benchThreads[threadId]);
+    }
+
+    rc = 0;
+
+    for (threadId = 0; threadId < numberOfThreads; threadId++)
+    {
+        pthread_join(benchThreads[threadId].thread, &threadResult);
+
+        if (threadResult != NULL)
+            rc = -1;
+    }
+
+    result->seconds = Now() - startTime;
+    result->operations = numberOfThreads * cycles;
+    result->bytes = 0;
+
+    // Move samples of all threads together.
+    //
+    result->numberOfSamples = 0;
+
+    for (threadId = 0; threadId < numberOfThreads; threadId++)
+    {
+        memmove(&result->samples[result->numberOfSamples],
+                benchThreads[threadId].samples,
+                benchThreads[threadId].numberOfSamples * sizeof(unsigned long));
+
+        result->numberOfSamples += benchThreads[threadId].numberOfSamples;
+    }
+
+    return rc;
+}
+
+/*
+ * @brief   Run peek/poke at 1, 2, 4 ... up to the given number of threads,
+ *          on a bank with and without magazines.
+ *
+ * Without magazines every peek and poke goes through the bank lock,
+ * which shows the difference between locking modes of a build.
+ *
+ * @return  0 upon successful completion.
+ * @return  -1 if a pool could not be created or a buffer could not be peeked.
+ */
+static int
+RunPeekPokeCases(
+    unsigned int        maxThreads,
+    unsigned long       cycles)
+{
+    struct MMPS_Pool    *pool;
+    struct BenchResult  result;
+    unsigned int        numberOfThreads;
+    unsigned int        magazineSize;
+    int                 rc;
+
+    for (magazineSize = 0;
+         magazineSize <= BENCH_MAGAZINE_SIZE;
+         magazineSize += BENCH_MAGAZINE_SIZE)
+    {
+        pool = CreatePool(BENCH_CONCURRENT_BUFFER_SIZE,
+                maxThreads * BENCH_MAGAZINE_SIZE * 2,
+                0,
+                magazineSize);
+        if (pool == NULL)
+            return -1;
+
+        for (numberOfThreads = 1;
+             numberOfThreads <= maxThreads;
+             numberOfThreads = (numberOfThreads * 2 > maxThreads) &&
+                (numberOfThreads != maxThreads)
+                    ? maxThreads
+                    : numberOfThreads * 2)
+        {
+            rc = RunThreads(pool,
+                    RunPeekPokeThread,
+                    numberOfThreads,
+                    cycles,
+                    &result);
+
+            if (rc == 0)
+            {
+                PrintResult((magazineSize == 0)
+                            ? "peekpoke"
+                            : "peekpoke/magazines",
+                        numberOfThreads,
+                        &result);
+            }
+
+            free(result.samples);
+
+            if (rc != 0)
+                return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * @brief   Run concurrent peek/put/poke on neighbouring descriptors
+ *          in the given number of threads.
+ *
+ * @return  0 upon successful completion.
+ * @return  -1 if a pool could not be created or a buffer could not be peeked.
+ */
+static int
+RunNeighboursCase(
+    unsigned int        numberOfThreads,
+    unsigned long       cycles)
+{
+    struct MMPS_Pool    *pool;
+    struct BenchResult  result;
+    int                 rc;
+
+    pool = CreatePool(BENCH_CONCURRENT_BUFFER_SIZE,
+            numberOfThreads * 4,
+            0,
+            2);
+    if (pool == NULL)
+        return -1;
+
+    rc = RunThreads(pool,
+            RunNeighboursThread,
+            numberOfThreads,
+            cycles,
+            &result);
+
+    if (rc == 0)
+    {
+        result.numberOfSamples = 0;
+
+        PrintResult("neighbours", numberOfThreads, &result);
+    }
+
+    free(result.samples);
+
+    return rc;
+}
+
+/*
+ * @brief   Peek buffers of sizes of a typical mix of dynamic buffers
+ *          with MMPS_PeekBufferOfSize() and poke them back.
+ *
+ * Most requests go to the banks of smallest buffers, few of them
+ * to the bank of 1 MB buffers.
+ *
+ * @return  0 upon successful completion.
+ * @return  -1 if a pool could not be created or a buffer could not be peeked.
+ */
+static int
+RunOfSizeCase(unsigned long cycles)
+{
+    struct MMPS_Pool    *pool;
+    struct MMPS_Buffer  *buffer;
+    struct BenchResult  result;
+    unsigned int        sizes[BENCH_NUMBER_OF_SIZES];
+    unsigned int        bankId;
+    unsigned int        sizeId;
+    unsigned int        random;
+    unsigned int        percent;
+    unsigned int        maxSize;
+    unsigned long       cycle;
+    unsigned long       sampleStride;
+    unsigned long       startTime;
+    double              startSeconds;
+
+    pool = MMPS_InitPool(sizeof(dynamicBanks) / sizeof(dynamicBanks[0]));
+    if (pool == NULL)
+        return -1;
+
+    for (bankId = 0;
+         bankId < sizeof(dynamicBanks) / sizeof(dynamicBanks[0]);
+         bankId++)
+    {
+        if (MMPS_InitBankWithOptions(pool,
+                bankId,
+                dynamicBanks[bankId].bufferSize,
+                0,
+                dynamicBanks[bankId].numberOfBuffers,
+                dynamicBanks[bankId].options) != MMPS_OK)
+            return -1;
+
+        if (MMPS_AllocateImmediately(pool, bankId) != MMPS_OK)
+            return -1;
+
+        if (dynamicBanks[bankId].magazines == TRUE)
+        {
+            if (MMPS_InitMagazines(pool, bankId, BENCH_MAGAZINE_SIZE) != MMPS_OK)
+                return -1;
+        }
+    }
+
+    MMPS_SetExhaustionPolicy(pool, MMPS_EXHAUSTION_LARGER);
+
+    random = 2463534242U;
+
+    for (sizeId = 0; sizeId < BENCH_NUMBER_OF_SIZES; sizeId++)
+    {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+
+        // 60% up to 256 bytes, 20% up to 512 bytes, 10% up to 1 KB,
+        // 9% up to 4 KB and 1% up to 64 KB.
+        //
+        percent = random % 100;
+        if (percent < 60) {
+            maxSize = 256;
+        } else if (percent < 80) {
+            maxSize = 512;
+        } else if (percent < 90) {
+            maxSize = KB;
+        } else if (percent < 99) {
+            maxSize = 4 * KB;
+        } else {
+            maxSize = 64 * KB;
+        }
+
+        sizes[sizeId] = 1 + (random >> 8) % maxSize;
+    }
+
+    sampleStride = cycles / BENCH_SAMPLES_PER_THREAD + 1;
+
+    result.samples = malloc((cycles / sampleStride + 1) * sizeof(unsigned long));
+    if (result.samples == NULL)
+        return -1;
+
+    result.numberOfSamples = 0;
+
+    startSeconds = Now();
+
+    for (cycle = 0; cycle < cycles; cycle++)
+    {
+        startTime = NowNs();
+
+        buffer = MMPS_PeekBufferOfSize(pool,
+                sizes[cycle % BENCH_NUMBER_OF_SIZES],
+                1);
+        if (buffer == NULL)
+        {
+            free(result.samples);
+            return -1;
+        }
+
+        MMPS_PokeBuffer(buffer);
+
+        if ((cycle % sampleStride) == 0)
+            result.samples[result.numberOfSamples++] = NowNs() - startTime;
+    }
+
+    result.seconds = Now() - startSeconds;
+    result.operations = cycles;
+    result.bytes = 0;
+
+    PrintResult("ofsize", 1, &result);
+
+    free(result.samples);
+
+    return 0;
+}
+
+/*
+ * @brief   Put values of one of the typed accessors to a chain until it is
+ *          full, then get them all back, for the given number of rounds.
+ *
+ * @return  0 upon successful completion.
+ * @return  -1 if a chain could not be peeked or values do not match.
+ */
+static int
+RunTypedCases(
+    struct MMPS_Pool    *pool,
+    unsigned int        rounds)
+{
+    struct MMPS_Buffer  *chain;
+    struct MMPS_Buffer  *buffer;
+    struct BenchResult  result;
+    unsigned int        round;
+    unsigned int        valueId;
+    unsigned int        valueSize;
+    uint16              value16;
+    uint32              value32;
+    uint64              value64;
+    uint64              check;
+    double              startTime;
+
+    chain = MMPS_PeekBuffers(pool, 0, BENCH_CHAIN_LENGTH, 1);
+    if (chain == NULL)
+        return -1;
+
+    for (valueSize = sizeof(uint16); valueSize <= sizeof(uint64); valueSize *= 2)
+    {
+        check = 0;
+
+        startTime = Now();
+
+        for (round = 0; round < rounds; round++)
+        {
+            MMPS_ResetBufferData(chain);
+
+            buffer = chain;
+            for (valueId = 0; valueId < BENCH_CHAIN_SIZE / valueSize; valueId++)
+            {
+                switch (valueSize)
+                {
+                    case sizeof(uint16):
+                        value16 = valueId;
+                        buffer = MMPS_PutInt16(buffer, &value16);
+                        break;
+
+                    case sizeof(uint32):
+                        value32 = valueId;
+                        buffer = MMPS_PutInt32(buffer, &value32);
+                        break;
+
+                    default:
+                        value64 = valueId;
+                        buffer = MMPS_PutInt64(buffer, &value64);
+                        break;
+                }
+            }
+
+            MMPS_ResetCursor(chain);
+
+            buffer = chain;
+            for (valueId = 0; valueId < BENCH_CHAIN_SIZE / valueSize; valueId++)
+            {
+                switch (valueSize)
+                {
+                    case sizeof(uint16):
+                        buffer = MMPS_GetInt16(buffer, &value16);
+                        check += value16;
+                        break;
+
+                    case sizeof(uint32):
+                        buffer = MMPS_GetInt32(buffer, &value32);
+                        check += value32;
+                        break;
+
+                    default:
+                        buffer = MMPS_GetInt64(buffer, &value64);
+                        check += value64;
+                        break;
+                }
+            }
+        }
+
+        result.seconds = Now() - startTime;
+
+        if (check == 0)
+            return -1;
+
+        // Each value is put and got once.
+        //
+        result.operations = 2UL * rounds * (BENCH_CHAIN_SIZE / valueSize);
+        result.bytes = 2UL * rounds * BENCH_CHAIN_SIZE;
+        result.numberOfSamples = 0;
+
+        PrintResult((valueSize == sizeof(uint16))
+                    ? "typed/int16"
+                    : (valueSize == sizeof(uint32))
+                        ? "typed/int32"
+                        : "typed/int64",
+                1,
+                &result);
+    }
+
+    MMPS_PokeBuffer(chain);
+
+    return 0;
+}
+
+/*
+ * @brief   Put records of each of record sizes with MMPS_PutData()
+ *          to a single buffer, letting it grow to a chain of the size
+ *          of BENCH_CHAIN_LENGTH buffers, for the given number of rounds.
+ *
+ * @return  0 upon successful completion.
+ * @return  -1 if a buffer could not be peeked.
+ */
+static int
+RunPutDataCases(
+    struct MMPS_Pool    *pool,
+    unsigned int        rounds)
+{
+    struct MMPS_Buffer  *chain;
+    struct MMPS_Buffer  *buffer;
+    struct BenchResult  result;
+    char                record[BENCH_MAX_RECORD_SIZE];
+    char                caseName[32];
+    unsigned int        sizeId;
+    unsigned int        recordSize;
+    unsigned int        numberOfRecords;
+    unsigned int        round;
+    unsigned int        recordId;
+    double              startTime;
+
+    memset(record, 0x5A, sizeof(record));
+
+    for (sizeId = 0; sizeId < sizeof(recordSizes) / sizeof(recordSizes[0]); sizeId++)
+    {
+        recordSize = recordSizes[sizeId];
+        numberOfRecords = BENCH_CHAIN_SIZE / recordSize;
+
+        startTime = Now();
+
+        for (round = 0; round < rounds; round++)
+        {
+            chain = MMPS_PeekBufferFromBank(pool, 0, 1);
+            if (chain == NULL)
+                return -1;
+
+            buffer = chain;
+            for (recordId = 0; recordId < numberOfRecords; recordId++)
+            {
+                buffer = MMPS_PutData(buffer, record, recordSize);
+                if (buffer == NULL)
+                    return -1;
+            }
+
+            MMPS_PokeBuffer(chain);
+        }
+
+        result.seconds = Now() - startTime;
+        result.operations = (unsigned long) rounds * numberOfRecords;
+        result.bytes = result.operations * recordSize;
+        result.numberOfSamples = 0;
+
+        snprintf(caseName, sizeof(caseName), "putdata/%u", recordSize);
+
+        PrintResult(caseName, 1, &result);
+    }
+
+    return 0;
+}
+
+/*
+ * @brief   Copy a full chain to another one with MMPS_CopyBuffer(),
+ *          for the given number of rounds.
+ *
+ * @return  0 upon successful completion.
+ * @return  -1 if a chain could not be peeked or not everything was copied.
+ */
+static int
+RunCopyCase(
+    struct MMPS_Pool    *pool,
+    unsigned int        rounds)
+{
+    struct MMPS_Buffer  *source;
+    struct MMPS_Buffer  *destination;
+    struct MMPS_Buffer  *buffer;
+    struct BenchResult  result;
+    unsigned int        round;
+    unsigned int        valueId;
+    uint32              value;
+    double              startTime;
+
+    source = MMPS_PeekBuffers(pool, 0, BENCH_CHAIN_LENGTH, 1);
+    if (source == NULL)
+        return -1;
+
+    destination = MMPS_PeekBuffers(pool, 0, BENCH_CHAIN_LENGTH, 1);
+    if (destination == NULL)
+        return -1;
+
+    buffer = source;
+    for (valueId = 0; valueId < BENCH_CHAIN_SIZE / sizeof(value); valueId++)
+    {
+        value = valueId;
+        buffer = MMPS_PutInt32(buffer, &value);
+    }
+
+    startTime = Now();
+
+    for (round = 0; round < rounds; round++)
+    {
+        MMPS_ResetBufferData(destination);
+
+        if (MMPS_CopyBuffer(destination, source) != BENCH_CHAIN_SIZE)
+            return -1;
+    }
+
+    result.seconds = Now() - startTime;
+    result.operations = rounds;
+    result.bytes = (unsigned long) rounds * BENCH_CHAIN_SIZE;
+    result.numberOfSamples = 0;
+
+    PrintResult("copy", 1, &result);
+
+    MMPS_PokeBuffer(source);
+    MMPS_PokeBuffer(destination);
+
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    struct MMPS_Pool    *pool;
+    unsigned int        rounds;
+    unsigned int        numberOfThreads;
+    unsigned long       cycles;
+
+    rounds = (argc > 1) ? atoi(argv[1]) : BENCH_DEFAULT_ROUNDS;
+    if (rounds == 0)
+        rounds = 1;
+
+    numberOfThreads = (argc > 2) ? atoi(argv[2]) : sysconf(_SC_NPROCESSORS_ONLN);
+    if (numberOfThreads == 0)
+        numberOfThreads = 1;
+    if (numberOfThreads > BENCH_MAX_THREADS)
+        numberOfThreads = BENCH_MAX_THREADS;
+
+    // Cases that cycle on single buffers run a number of cycles
+    // proportional to the number of rounds.
+    //
+    cycles = (unsigned long) rounds * BENCH_CONCURRENT_CYCLES / BENCH_DEFAULT_ROUNDS;
+    if (cycles == 0)
+        cycles = 1;
+
+    PrintHeader();
+
+    if (RunFillCases(rounds) != 0)
+        return EXIT_FAILURE;
+
+    if (RunPeekPokeCases(numberOfThreads, cycles) != 0)
+        return EXIT_FAILURE;
+
+    if (RunNeighboursCase(numberOfThreads, cycles) != 0)
+        return EXIT_FAILURE;
+
+    if (RunOfSizeCase(cycles) != 0)
+        return EXIT_FAILURE;
+
+    pool = CreatePool(BENCH_BUFFER_SIZE,
+            BENCH_CHAIN_LENGTH * 4,
+            0,
+            0);
+    if (pool == NULL)
+        return EXIT_FAILURE;
+
+    if (RunTypedCases(pool, rounds) != 0)
+        return EXIT_FAILURE;
+
+    if (RunPutDataCases(pool, rounds) != 0)
+        return EXIT_FAILURE;
+
+    if (RunCopyCase(pool, rounds) != 0)
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
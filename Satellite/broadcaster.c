@@ -17,12 +17,15 @@
 #define TIMEOUT_DISCONNECT_IF_IDLE               300                // Seconds
 #define TIMEOUT_ON_WAIT_FOR_BEGIN_TO_TRANSMIT     10 * 1000 * 1000	// Milliseconds
 #define TIMEOUT_ON_POLL_FOR_RECEIPT                5 * 1000 * 1000	// Milliseconds
+#define BROADCASTER_SLEEP_ON_CANNOT_MAP_SHM        1 * 1000 * 1000  // Microseconds
 
 // Take a pointer to chalkboard. Chalkboard must be initialized
 // before any routine of this module could be called.
 //
 extern struct Chalkboard *chalkboard;
 
+#ifndef BROADCASTER_SHM
+
 static void
 BroadcasterDialog(int sockFD);
 
@@ -32,6 +35,82 @@ ReceiveSession(int sockFD, struct session *session);
 static int
 ConfirmSession(int sockFD, struct session *session);
 
+#endif
+
+static int
+ReviseSession(struct session *session);
+
+#ifdef BROADCASTER_SHM
+
+/**
+ * BroadcasterThread()
+ *
+ * Take over revised sessions the Broadcaster hands over in buffers
+ * of a bank mapped to shared memory.
+ *
+ * @arg:
+ */
+void *
+BroadcasterThread(void *arg)
+{
+	struct MMPS_Pool    *pool;
+	struct MMPS_Buffer  *buffer;
+	struct session      *session;
+	int                 rc;
+
+    pool = MMPS_InitPool(1);
+    if (pool == NULL) {
+        ReportError("Cannot create broadcaster pool");
+        pthread_exit(NULL);
+    }
+
+    rc = MMPS_InitBank(pool, 0,
+        sizeof(struct session),
+        0,
+        BROADCASTER_SHM_NUMBER_OF_BUFFERS);
+    if (rc != 0) {
+        ReportError("Cannot create broadcaster bank: rc=%d", rc);
+        pthread_exit(NULL);
+    }
+
+    while (1)
+    {
+        rc = MMPS_MapShMemBufferBank(pool, 0, BROADCASTER_SHM_NAME);
+        if (rc == 0)
+            break;
+
+        ReportError("Cannot map broadcaster bank, wait for %d microseconds: rc=%d",
+            BROADCASTER_SLEEP_ON_CANNOT_MAP_SHM, rc);
+        usleep(BROADCASTER_SLEEP_ON_CANNOT_MAP_SHM);
+    }
+
+    chalkboard->broadcaster.pool = pool;
+
+    session = &chalkboard->broadcaster.session;
+
+    while (1)
+    {
+        buffer = MMPS_ReceiveShMemBuffer(pool, 0,
+            BROADCASTER_SHM_CHANNEL_SESSIONS,
+            BUFFER_BROADCASTER,
+            MMPS_WAIT_FOREVER);
+        if (buffer == NULL)
+            continue;
+
+        MMPS_GetData(buffer, (char *) session, sizeof(struct session), NULL);
+
+        MMPS_PokeBuffer(buffer);
+
+        rc = ReviseSession(session);
+        if (rc != 0)
+            break;
+    }
+
+	pthread_exit(NULL);
+}
+
+#else
+
 /**
  * BroadcasterThread()
  *
@@ -104,8 +183,6 @@ static void
 BroadcasterDialog(int sockFD)
 {
 	struct session  *session;
-    uint64          satelliteTaskId;
-    struct Task     *task;
     int             rc;
 
     while (1)
@@ -116,63 +193,9 @@ BroadcasterDialog(int sockFD)
         if (rc != 0)
             break;
 
-        satelliteTaskId = be32toh(session->satelliteTaskId);
-
-        task = TaskListTaskById(satelliteTaskId);
-        if (task == NULL) {
-            ReportInfo("Task %lu is already closed", satelliteTaskId);
-        } else {
-            //
-            // Changing broadcast values has to be done inside of the broadcast lock.
-            //
-            rc = pthread_mutex_lock(&task->broadcast.editMutex);
-            if (rc != 0) {
-                ReportError("Error has occurred on mutex lock: rc=%d", rc);
-                break;
-            }
-
-            task->broadcast.currentRevision.onRadar = be32toh(session->onRadarRevision);
-            task->broadcast.currentRevision.inSight = be32toh(session->inSightRevision);
-            task->broadcast.currentRevision.onMap = be32toh(session->onMapRevision);
-
-            ReportInfo("Received revised session: receiptId=%lu sessionId=%lu, revisions=%u/%u/%u, taskId=%lu",
-                be64toh(session->receiptId),
-                be64toh(session->sessionId),
-                task->broadcast.currentRevision.onRadar,
-                task->broadcast.currentRevision.inSight,
-                task->broadcast.currentRevision.onMap,
-                satelliteTaskId);
-
-            if (task->broadcast.broadcastPaquet != NULL) {
-                rc = pthread_mutex_lock(&task->broadcast.waitMutex);
-                if (rc != 0) {
-                    pthread_mutex_unlock(&task->broadcast.editMutex);
-                    ReportError("Error has occurred on mutex lock: rc=%d", rc);
-                    break;
-                }
-
-                rc = pthread_cond_signal(&task->broadcast.waitCondition);
-                if (rc != 0) {
-                    pthread_mutex_unlock(&task->broadcast.waitMutex);
-                    pthread_mutex_unlock(&task->broadcast.editMutex);
-                    ReportError("Error has occurred on condition signal: rc=%d", rc);
-                    break;
-                }
-
-                rc = pthread_mutex_unlock(&task->broadcast.waitMutex);
-                if (rc != 0) {
-                    pthread_mutex_unlock(&task->broadcast.editMutex);
-                    ReportError("Error has occurred on mutex unlock: rc=%d", rc);
-                    break;
-                }
-            }
-
-            rc = pthread_mutex_unlock(&task->broadcast.editMutex);
-            if (rc != 0) {
-                ReportError("Error has occurred on mutex unlock: rc=%d", rc);
-                break;
-            }
-        }
+        rc = ReviseSession(session);
+        if (rc != 0)
+            break;
 
         rc = ConfirmSession(sockFD, session);
         if (rc != 0)
@@ -274,3 +297,83 @@ ConfirmSession(int sockFD, struct session *session)
 
 	return 0;
 }
+
+#endif
+
+/**
+ * ReviseSession()
+ *
+ * Take over new revisions of a session and wake up its broadcast
+ * paquet if there is one waiting.
+ *
+ * @session:    Revised session as received from the Broadcaster,
+ *              in network byte order.
+ */
+static int
+ReviseSession(struct session *session)
+{
+    uint64          satelliteTaskId;
+    struct Task     *task;
+    int             rc;
+
+    satelliteTaskId = be32toh(session->satelliteTaskId);
+
+    task = TaskListTaskById(satelliteTaskId);
+    if (task == NULL) {
+        ReportInfo("Task %lu is already closed", satelliteTaskId);
+        return 0;
+    }
+
+    //
+    // Changing broadcast values has to be done inside of the broadcast lock.
+    //
+    rc = pthread_mutex_lock(&task->broadcast.editMutex);
+    if (rc != 0) {
+        ReportError("Error has occurred on mutex lock: rc=%d", rc);
+        return -1;
+    }
+
+    task->broadcast.currentRevision.onRadar = be32toh(session->onRadarRevision);
+    task->broadcast.currentRevision.inSight = be32toh(session->inSightRevision);
+    task->broadcast.currentRevision.onMap = be32toh(session->onMapRevision);
+
+    ReportInfo("Received revised session: receiptId=%lu sessionId=%lu, revisions=%u/%u/%u, taskId=%lu",
+        be64toh(session->receiptId),
+        be64toh(session->sessionId),
+        task->broadcast.currentRevision.onRadar,
+        task->broadcast.currentRevision.inSight,
+        task->broadcast.currentRevision.onMap,
+        satelliteTaskId);
+
+    if (task->broadcast.broadcastPaquet != NULL) {
+        rc = pthread_mutex_lock(&task->broadcast.waitMutex);
+        if (rc != 0) {
+            pthread_mutex_unlock(&task->broadcast.editMutex);
+            ReportError("Error has occurred on mutex lock: rc=%d", rc);
+            return -1;
+        }
+
+        rc = pthread_cond_signal(&task->broadcast.waitCondition);
+        if (rc != 0) {
+            pthread_mutex_unlock(&task->broadcast.waitMutex);
+            pthread_mutex_unlock(&task->broadcast.editMutex);
+            ReportError("Error has occurred on condition signal: rc=%d", rc);
+            return -1;
+        }
+
+        rc = pthread_mutex_unlock(&task->broadcast.waitMutex);
+        if (rc != 0) {
+            pthread_mutex_unlock(&task->broadcast.editMutex);
+            ReportError("Error has occurred on mutex unlock: rc=%d", rc);
+            return -1;
+        }
+    }
+
+    rc = pthread_mutex_unlock(&task->broadcast.editMutex);
+    if (rc != 0) {
+        ReportError("Error has occurred on mutex unlock: rc=%d", rc);
+        return -1;
+    }
+
+    return 0;
+}
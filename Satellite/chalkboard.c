@@ -19,6 +19,11 @@ InitializeMMPS(void);
 static int
 InitializeListener(void);
 
+#ifdef IO_URING_RECEIVE
+static void
+InitializeUring(void);
+#endif
+
 /**
  * CreateChalkboard()
  * Allocate and initialize chalkboard.
@@ -49,6 +54,10 @@ CreateChalkboard(void)
     if (rc != 0)
         return -1;
 
+#ifdef IO_URING_RECEIVE
+    InitializeUring();
+#endif
+
     return 0;
 }
 
@@ -62,16 +71,18 @@ CreateChalkboard(void)
 static int
 InitializeMMPS(void)
 {
-	int rc;
+	unsigned int	bankId;
+	int				rc;
 
 	chalkboard->pools.task = MMPS_InitPool(1);
 	chalkboard->pools.paquet = MMPS_InitPool(1);
 	chalkboard->pools.dynamic = MMPS_InitPool(5);
 
-	rc = MMPS_InitBank(chalkboard->pools.task, 0,
+	rc = MMPS_InitBankWithOptions(chalkboard->pools.task, 0,
 		sizeof(struct Task),
 		0,
-		NUMBER_OF_BUFFERS_TASK);
+		NUMBER_OF_BUFFERS_TASK,
+		MMPS_BANK_ELASTIC);
 	if (rc != 0) {
 		ReportError("Cannot create buffer bank: rc=%d", rc);
         return -1;
@@ -79,10 +90,14 @@ InitializeMMPS(void)
 
     MMPS_AllocateImmediately(chalkboard->pools.task, 0);
 
-	rc = MMPS_InitBank(chalkboard->pools.paquet, 0,
+	// Paquets and small dynamic buffers are spread over NUMA nodes,
+	// so that paquet threads work with buffers of their own node.
+	//
+	rc = MMPS_InitBankWithOptions(chalkboard->pools.paquet, 0,
 		sizeof(struct Paquet),
         sizeof(struct PaquetPilot),
-		NUMBER_OF_BUFFERS_PAQUET);
+		NUMBER_OF_BUFFERS_PAQUET,
+		MMPS_BANK_ELASTIC | MMPS_BANK_NUMA | MMPS_BANK_FIFO);
 	if (rc != 0) {
 		ReportError("Cannot create buffer bank: rc=%d", rc);
         return -1;
@@ -91,10 +106,11 @@ InitializeMMPS(void)
     MMPS_AllocateImmediately(chalkboard->pools.paquet, 0);
     MMPS_AllocateFollowers(chalkboard->pools.paquet, 0);
 
-	rc = MMPS_InitBank(chalkboard->pools.dynamic, 0,
+	rc = MMPS_InitBankWithOptions(chalkboard->pools.dynamic, 0,
 		256,
         0,
-		NUMBER_OF_BUFFERS_256);
+		NUMBER_OF_BUFFERS_256,
+		MMPS_BANK_ELASTIC | MMPS_BANK_NUMA);
 	if (rc != 0) {
 		ReportError("Cannot create buffer bank: rc=%d", rc);
         return -1;
@@ -102,10 +118,11 @@ InitializeMMPS(void)
 
     MMPS_AllocateImmediately(chalkboard->pools.dynamic, 0);
 
-	rc = MMPS_InitBank(chalkboard->pools.dynamic, 1,
+	rc = MMPS_InitBankWithOptions(chalkboard->pools.dynamic, 1,
 		512,
         0,
-		NUMBER_OF_BUFFERS_512);
+		NUMBER_OF_BUFFERS_512,
+		MMPS_BANK_ELASTIC | MMPS_BANK_NUMA);
 	if (rc != 0) {
 		ReportError("Cannot create buffer bank: rc=%d", rc);
         return -1;
@@ -113,10 +130,11 @@ InitializeMMPS(void)
 
     MMPS_AllocateImmediately(chalkboard->pools.dynamic, 1);
 
-	rc = MMPS_InitBank(chalkboard->pools.dynamic, 2,
+	rc = MMPS_InitBankWithOptions(chalkboard->pools.dynamic, 2,
 		KB,
         0,
-		NUMBER_OF_BUFFERS_1K);
+		NUMBER_OF_BUFFERS_1K,
+		MMPS_BANK_ELASTIC | MMPS_BANK_NUMA);
 	if (rc != 0) {
 		ReportError("Cannot create buffer bank: rc=%d", rc);
         return -1;
@@ -124,10 +142,11 @@ InitializeMMPS(void)
 
     MMPS_AllocateImmediately(chalkboard->pools.dynamic, 2);
 
-	rc = MMPS_InitBank(chalkboard->pools.dynamic, 3,
+	rc = MMPS_InitBankWithOptions(chalkboard->pools.dynamic, 3,
 		4 * KB,
         0,
-		NUMBER_OF_BUFFERS_4K);
+		NUMBER_OF_BUFFERS_4K,
+		MMPS_BANK_ELASTIC | MMPS_BANK_NUMA);
 	if (rc != 0) {
 		ReportError("Cannot create buffer bank: rc=%d", rc);
         return -1;
@@ -135,10 +154,11 @@ InitializeMMPS(void)
 
     MMPS_AllocateImmediately(chalkboard->pools.dynamic, 3);
 
-	rc = MMPS_InitBank(chalkboard->pools.dynamic, 4,
+	rc = MMPS_InitBankWithOptions(chalkboard->pools.dynamic, 4,
 		MB,
 		0,
-		NUMBER_OF_BUFFERS_1M);
+		NUMBER_OF_BUFFERS_1M,
+		MMPS_BANK_ELASTIC);
 	if (rc != 0) {
 		ReportError("Cannot create buffer bank: rc=%d", rc);
         return -1;
@@ -146,9 +166,50 @@ InitializeMMPS(void)
 
     MMPS_AllocateImmediately(chalkboard->pools.dynamic, 4);
 
+	// A request for dynamic buffer of some size that cannot be served
+	// from its own bank is served with a larger buffer, never a smaller one.
+	//
+	MMPS_SetExhaustionPolicy(chalkboard->pools.dynamic, MMPS_EXHAUSTION_LARGER);
+
+	// Paquets and small dynamic buffers are peeked and poked by every
+	// paquet thread, so let them go through per-CPU magazines.
+	//
+	rc = MMPS_InitMagazines(chalkboard->pools.paquet, 0,
+		NUMBER_OF_IDS_PER_MAGAZINE);
+	if (rc != 0) {
+		ReportError("Cannot create buffer magazines: rc=%d", rc);
+        return -1;
+    }
+
+	for (bankId = 0; bankId <= 3; bankId++)
+	{
+		rc = MMPS_InitMagazines(chalkboard->pools.dynamic, bankId,
+			NUMBER_OF_IDS_PER_MAGAZINE);
+		if (rc != 0) {
+			ReportError("Cannot create buffer magazines: rc=%d", rc);
+			return -1;
+		}
+	}
+
     return 0;
 }
 
+/**
+ * ShrinkMMPS()
+ * Give back memory of MMPS banks that is not needed at current load.
+ */
+void
+ShrinkMMPS(void)
+{
+	unsigned int bankId;
+
+	MMPS_ShrinkBank(chalkboard->pools.task, 0);
+	MMPS_ShrinkBank(chalkboard->pools.paquet, 0);
+
+	for (bankId = 0; bankId < chalkboard->pools.dynamic->numberOfBanks; bankId++)
+		MMPS_ShrinkBank(chalkboard->pools.dynamic, bankId);
+}
+
 /**
  * InitializeListener()
  * Initialize network block of chalkboard.
@@ -164,3 +225,25 @@ InitializeListener(void)
 
     return 0;
 }
+
+#ifdef IO_URING_RECEIVE
+/**
+ * InitializeUring()
+ * Lend 1 KB buffers of dynamic pool to the kernel for io_uring receive.
+ * If io_uring is not available, chalkboard is left without it
+ * and receive goes the classic way.
+ */
+static void
+InitializeUring(void)
+{
+    chalkboard->uring = CreateUring(NUMBER_OF_URING_SUBMISSIONS,
+        NUMBER_OF_URING_COMPLETIONS,
+        URING_SQPOLL_IDLE,
+        chalkboard->pools.dynamic,
+        URING_RECEIVE_BANK,
+        NUMBER_OF_URING_BUFFERS,
+        BUFFER_DIALOGUE_FIRST);
+    if (chalkboard->uring == NULL)
+        ReportWarning("io_uring receive not available, use classic receive");
+}
+#endif
@@ -2,8 +2,12 @@
 
 #include "broadcaster_api.h"
 #include "db.h"
+#include "listener.h"
 #include "mmps.h"
+#include "paquet_workers.h"
+#include "reactor.h"
 #include "tasks.h"
+#include "uring.h"
 
 #undef SANDBOX
 
@@ -17,6 +21,16 @@
 #define NUMBER_OF_BUFFERS_4K            200L
 #define NUMBER_OF_BUFFERS_1M            200L
 
+#define NUMBER_OF_IDS_PER_MAGAZINE      8
+
+#define NUMBER_OF_URING_SUBMISSIONS     64
+#define NUMBER_OF_URING_COMPLETIONS     256
+#define NUMBER_OF_URING_BUFFERS         64
+#define URING_SQPOLL_IDLE               0
+
+#define NUMBER_OF_PAQUET_WORKERS        4
+#define PAQUET_WORKER_QUEUE_DEPTH       64
+
 #define NUMBER_OF_DBH_GUARDIANS         10
 #define NUMBER_OF_DBH_AUTHENTICATION    10
 #define NUMBER_OF_DBH_PLAQUES_SESSION   40
@@ -31,18 +45,55 @@
 #define NUMBER_OF_BUFFERS_4K              200000L
 #define NUMBER_OF_BUFFERS_1M                 200L
 
+#define NUMBER_OF_IDS_PER_MAGAZINE            64
+
+#define NUMBER_OF_URING_SUBMISSIONS          256
+#define NUMBER_OF_URING_COMPLETIONS        65536
+#define NUMBER_OF_URING_BUFFERS            32768
+#define URING_SQPOLL_IDLE                   2000
+
+#define NUMBER_OF_PAQUET_WORKERS             256
+#define PAQUET_WORKER_QUEUE_DEPTH           4096
+
 #define NUMBER_OF_DBH_GUARDIANS               50
 #define NUMBER_OF_DBH_AUTHENTICATION         200
 #define NUMBER_OF_DBH_PLAQUES_SESSION        600
 
 #endif
 
+// Interval in seconds between attempts to give back memory
+// of MMPS banks that is not needed at current load.
+//
+#define SHRINK_MMPS_INTERVAL        60
+
+// Largest payload a client may announce in the pilot of a paquet.
+// A connection announcing more is closed before the payload is received.
+//
+#define MAXIMAL_PAYLOAD_SIZE        MB
+
+// Time in milliseconds a session waits for a paquet buffer to be given back
+// when all of them are in use, before giving up.
+//
+#define PAQUET_BUFFER_WAIT_TIMEOUT  200
+
+// File statistics of MMPS pools are dumped to on SIGUSR1,
+// one line of "name=value" pairs per bank. Each dump is written
+// to a new file, which is then renamed to this name.
+//
+#define STATISTICS_DUMP_FILE        "/tmp/vp_satellite.stats"
+
+// Bank of dynamic pool whose buffers are lent to the kernel
+// for io_uring receive (1 KB buffers, where a dialogue starts).
+//
+#define URING_RECEIVE_BANK          2
+
 #define BUFFER_DIALOGUE_PAQUET      0xDD000000
 #define BUFFER_DIALOGUE_FIRST       0xDD000001
 #define BUFFER_DIALOGUE_FOLLOWING   0xDD000002
 #define BUFFER_XMIT                 0xEE000000
 #define BUFFER_TASK                 0x22000000
 #define BUFFER_BROADCAST            0xBB000000
+#define BUFFER_BROADCASTER          0xBB000001
 #define BUFFER_PROFILES             0xFF000000
 #define BUFFER_PLAQUES              0xAA000000
 
@@ -74,9 +125,43 @@ struct Chalkboard
     {
         uint16_t            portNumber;
         struct session      session;
+#ifdef BROADCASTER_SHM
+        struct MMPS_Pool    *pool;
+#endif
     }
     broadcaster;
 
+#ifdef TASK_REACTOR
+    struct
+    {
+        struct Reactor      *list;
+        unsigned int        numberOfReactors;
+        unsigned int        nextReactorId;
+    }
+    reactors;
+#endif
+
+#ifdef PAQUET_WORKERS
+    struct
+    {
+        struct PaquetWorker *list;
+        unsigned int        numberOfWorkers;
+        unsigned int        queueDepth;
+        unsigned int        nextWorkerId;
+        int                 numberOfQueuedPaquets;
+        unsigned int        numberOfIdleWorkers;
+        pthread_mutex_t     idleMutex;
+        pthread_cond_t      idleCondition;
+    }
+    paquetWorkers;
+#endif
+
+#ifdef IO_URING_RECEIVE
+    // NULL if io_uring is not available, receive goes the classic way then.
+    //
+    struct Uring            *uring;
+#endif
+
     struct
     {
         uint16_t            portNumber;
@@ -90,6 +175,15 @@ struct Chalkboard
         int                 listenSockFD;
     }
     listenerIPv6;
+
+#ifdef LISTENER_REUSEPORT
+    struct
+    {
+        struct Acceptor     *list;
+        unsigned int        numberOfAcceptors;
+    }
+    acceptors;
+#endif
 };
 
 /**
@@ -101,3 +195,10 @@ struct Chalkboard
  */
 int
 CreateChalkboard(void);
+
+/**
+ * ShrinkMMPS()
+ * Give back memory of MMPS banks that is not needed at current load.
+ */
+void
+ShrinkMMPS(void);
@@ -1,10 +1,19 @@
+// accept4() is a GNU extension.
+//
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <errno.h>
+#include <poll.h>
 #include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <sys/socket.h>
 
 #include "chalkboard.h"
 #include "listener.h"
@@ -23,6 +32,33 @@ IPv4ListenerCleanup(void *arg);
 void
 IPv6ListenerCleanup(void *arg);
 
+#ifdef LISTENER_REUSEPORT
+static void *
+AcceptorThread(void *arg);
+
+static void
+AcceptorCleanup(void *arg);
+
+static int
+OpenAcceptorSockets(struct Acceptor *acceptor);
+
+static int
+AddListenSocket(
+	struct Acceptor     *acceptor,
+	int                 family,
+	uint16_t            portNumber,
+	int                 dualStack);
+
+static int
+AcceptConnections(struct Acceptor *acceptor, int listenSockFD);
+
+static void
+ClientAddressToString(
+	struct sockaddr_storage *clientAddress,
+	char                *clientIP,
+	socklen_t           clientIPSize);
+#endif
+
 /**
  * IPv4ListenerThread()
  *
@@ -322,3 +358,398 @@ IPv6ListenerCleanup(void *arg)
     if (listenSockFD > 0)
         close(listenSockFD);
 }
+
+#ifdef LISTENER_REUSEPORT
+
+/**
+ * StartAcceptors()
+ * Start one acceptor thread per online CPU (per reactor in reactor mode).
+ *
+ * Returns 0 upon successful completion or -1, in case of error.
+ */
+int
+StartAcceptors(void)
+{
+	struct Acceptor     *acceptor;
+	long                numberOfAcceptors;
+	int                 acceptorId;
+	int                 rc;
+
+#ifdef TASK_REACTOR
+	numberOfAcceptors = chalkboard->reactors.numberOfReactors;
+#else
+	numberOfAcceptors = sysconf(_SC_NPROCESSORS_ONLN);
+	if (numberOfAcceptors < 1)
+		numberOfAcceptors = 1;
+#endif
+
+	chalkboard->acceptors.list = malloc(numberOfAcceptors * sizeof(struct Acceptor));
+	if (chalkboard->acceptors.list == NULL)
+	{
+		ReportSoftAlert("[Acceptor] Out of memory");
+		return -1;
+	}
+
+	chalkboard->acceptors.numberOfAcceptors = numberOfAcceptors;
+
+	for (acceptorId = 0; acceptorId < numberOfAcceptors; acceptorId++)
+	{
+		acceptor = &chalkboard->acceptors.list[acceptorId];
+
+		acceptor->acceptorId = acceptorId;
+#ifdef TASK_REACTOR
+		acceptor->reactorId = acceptorId;
+#else
+		acceptor->reactorId = -1;
+#endif
+		acceptor->numberOfSockets = 0;
+
+		rc = pthread_create(&acceptor->thread, NULL, &AcceptorThread, acceptor);
+		if (rc != 0)
+		{
+			ReportError("[Acceptor] Cannot create acceptor thread: rc=%d", rc);
+			return -1;
+		}
+	}
+
+	ReportInfo("[Acceptor] Started %ld acceptors", numberOfAcceptors);
+
+	return 0;
+}
+
+/**
+ * AcceptorThread()
+ * Open listen sockets of an acceptor and take connections from all of them.
+ * If a listen socket fails, all of them are reopened.
+ *
+ * @arg:		Pointer to acceptor.
+ */
+static void *
+AcceptorThread(void *arg)
+{
+	struct Acceptor     *acceptor = (struct Acceptor *)arg;
+	struct pollfd       pollFDs[MAX_ACCEPTOR_SOCKETS];
+	int                 socketIndex;
+	int                 reopen;
+	int                 rc;
+
+	pthread_cleanup_push(&AcceptorCleanup, acceptor);
+
+	for (;;)
+	{
+		rc = OpenAcceptorSockets(acceptor);
+		if (rc != 0)
+		{
+			ReportError("[Acceptor] Cannot open listen sockets, wait for %d milliseconds",
+				SLEEP_ON_CANNOT_BIND_SOCKET);
+
+			usleep(SLEEP_ON_CANNOT_BIND_SOCKET * 1000);
+
+			continue;
+		}
+
+		for (socketIndex = 0; socketIndex < acceptor->numberOfSockets; socketIndex++)
+		{
+			pollFDs[socketIndex].fd = acceptor->listenSockFD[socketIndex];
+			pollFDs[socketIndex].events = POLLIN;
+		}
+
+		reopen = 0;
+		while (reopen == 0)
+		{
+			rc = poll(pollFDs, acceptor->numberOfSockets, -1);
+			if (rc < 0)
+			{
+				if (errno == EINTR)
+					continue;
+
+				ReportError("[Acceptor] Poll error on listen sockets: errno=%d", errno);
+				break;
+			}
+
+			for (socketIndex = 0; socketIndex < acceptor->numberOfSockets; socketIndex++)
+			{
+				if (pollFDs[socketIndex].revents & (POLLERR | POLLHUP | POLLNVAL))
+				{
+					ReportError("[Acceptor] Poll error on listen socket: revents=0x%04X",
+						pollFDs[socketIndex].revents);
+					reopen = 1;
+					break;
+				}
+
+				if (pollFDs[socketIndex].revents & POLLIN)
+				{
+					rc = AcceptConnections(acceptor, pollFDs[socketIndex].fd);
+					if (rc != 0)
+					{
+						reopen = 1;
+						break;
+					}
+				}
+			}
+		}
+
+		AcceptorCleanup(acceptor);
+
+		usleep(SLEEP_ON_CANNOT_ACCEPT * 1000);
+	}
+
+	pthread_cleanup_pop(1);
+
+	pthread_exit(NULL);
+}
+
+/**
+ * AcceptorCleanup()
+ * Close listen sockets of an acceptor.
+ *
+ * @arg:		Pointer to acceptor.
+ */
+static void
+AcceptorCleanup(void *arg)
+{
+	struct Acceptor     *acceptor = (struct Acceptor *)arg;
+	int                 socketIndex;
+
+	for (socketIndex = 0; socketIndex < acceptor->numberOfSockets; socketIndex++)
+		close(acceptor->listenSockFD[socketIndex]);
+
+	acceptor->numberOfSockets = 0;
+}
+
+/**
+ * OpenAcceptorSockets()
+ * Open listen sockets of an acceptor for all configured ports.
+ *
+ * Returns 0 upon successful completion or -1, in case of error.
+ */
+static int
+OpenAcceptorSockets(struct Acceptor *acceptor)
+{
+	int                 rc = 0;
+
+	acceptor->numberOfSockets = 0;
+
+#ifdef LISTENER_DUAL_STACK
+	// One IPv6 socket per port takes connections of both protocols,
+	// IPv4 clients appear as IPv4-mapped IPv6 addresses.
+	//
+#ifdef IPV4
+	rc = AddListenSocket(acceptor, AF_INET6, chalkboard->listenerIPv4.portNumber, 1);
+#endif
+#ifdef IPV6
+#ifdef IPV4
+	if (chalkboard->listenerIPv6.portNumber != chalkboard->listenerIPv4.portNumber)
+#endif
+	if (rc == 0)
+		rc = AddListenSocket(acceptor, AF_INET6, chalkboard->listenerIPv6.portNumber, 1);
+#endif
+#else
+#ifdef IPV4
+	rc = AddListenSocket(acceptor, AF_INET, chalkboard->listenerIPv4.portNumber, 0);
+#endif
+#ifdef IPV6
+	if (rc == 0)
+		rc = AddListenSocket(acceptor, AF_INET6, chalkboard->listenerIPv6.portNumber, 0);
+#endif
+#endif
+
+	if ((rc != 0) || (acceptor->numberOfSockets == 0))
+	{
+		AcceptorCleanup(acceptor);
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * AddListenSocket()
+ * Open a non-blocking listen socket that shares its port with listen sockets
+ * of other acceptors, and add it to the acceptor.
+ *
+ * @acceptor:
+ * @family:			AF_INET or AF_INET6.
+ * @portNumber:
+ * @dualStack:		For AF_INET6, whether to take IPv4 connections as well.
+ *
+ * Returns 0 upon successful completion or -1, in case of error.
+ */
+static int
+AddListenSocket(
+	struct Acceptor     *acceptor,
+	int                 family,
+	uint16_t            portNumber,
+	int                 dualStack)
+{
+	struct sockaddr_storage serverAddress;
+	struct sockaddr_in  *serverAddressIPv4 = (struct sockaddr_in *) &serverAddress;
+	struct sockaddr_in6 *serverAddressIPv6 = (struct sockaddr_in6 *) &serverAddress;
+	socklen_t           serverAddressLength;
+	const int           socketValue = 1;
+	const int           v6Only = (dualStack == 0);
+	int                 listenSockFD;
+	int                 rc;
+
+	listenSockFD = socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (listenSockFD < 0)
+	{
+		ReportError("[Acceptor] Cannot open a socket: errno=%d", errno);
+		return -1;
+	}
+
+	// Every acceptor binds its own socket to the same port, the kernel
+	// spreads incoming connections over them by hash of the connection.
+	//
+	rc = setsockopt(listenSockFD, SOL_SOCKET, SO_REUSEADDR, &socketValue, sizeof(socketValue));
+	if (rc == 0)
+		rc = setsockopt(listenSockFD, SOL_SOCKET, SO_REUSEPORT, &socketValue, sizeof(socketValue));
+	if ((rc == 0) && (family == AF_INET6))
+		rc = setsockopt(listenSockFD, IPPROTO_IPV6, IPV6_V6ONLY, &v6Only, sizeof(v6Only));
+	if (rc != 0)
+	{
+		ReportError("[Acceptor] Cannot set socket options: errno=%d", errno);
+		close(listenSockFD);
+		return -1;
+	}
+
+	memset(&serverAddress, 0, sizeof(serverAddress));
+
+	if (family == AF_INET)
+	{
+		serverAddressIPv4->sin_family = AF_INET;
+		serverAddressIPv4->sin_addr.s_addr = htonl(INADDR_ANY);
+		serverAddressIPv4->sin_port = htons(portNumber);
+		serverAddressLength = sizeof(struct sockaddr_in);
+	}
+	else
+	{
+		serverAddressIPv6->sin6_family = AF_INET6;
+		serverAddressIPv6->sin6_addr = in6addr_any;
+		serverAddressIPv6->sin6_port = htons(portNumber);
+		serverAddressLength = sizeof(struct sockaddr_in6);
+	}
+
+	rc = bind(listenSockFD, (struct sockaddr *) &serverAddress, serverAddressLength);
+	if (rc != 0)
+	{
+		ReportError("[Acceptor] Cannot bind to port %u: errno=%d", portNumber, errno);
+		close(listenSockFD);
+		return -1;
+	}
+
+	rc = listen(listenSockFD, SOMAXCONN);
+	if (rc != 0)
+	{
+		ReportError("[Acceptor] Cannot listen on port %u: errno=%d", portNumber, errno);
+		close(listenSockFD);
+		return -1;
+	}
+
+	acceptor->listenSockFD[acceptor->numberOfSockets] = listenSockFD;
+	acceptor->numberOfSockets++;
+
+	return 0;
+}
+
+/**
+ * AcceptConnections()
+ * Accept all connections waiting on a listen socket and start a task
+ * for each of them.
+ *
+ * Returns 0 when the backlog is drained or -1, if the listen socket
+ * must be reopened.
+ */
+static int
+AcceptConnections(struct Acceptor *acceptor, int listenSockFD)
+{
+	struct sockaddr_storage clientAddress;
+	socklen_t           clientAddressLength;
+	char                clientIP[INET6_ADDRSTRLEN];
+	struct Task         *task;
+	int                 clientSockFD;
+
+	for (;;)
+	{
+		clientAddressLength = sizeof(clientAddress);
+
+		// Connections stay blocking, send path relies on it.
+		//
+		clientSockFD = accept4(listenSockFD,
+			(struct sockaddr *) &clientAddress,
+			&clientAddressLength,
+			SOCK_CLOEXEC);
+		if (clientSockFD < 0)
+		{
+			switch (errno)
+			{
+				case EAGAIN:
+					return 0;
+
+				case EINTR:
+				case ECONNABORTED:
+				case EPROTO:
+					continue;
+
+				case EMFILE:
+				case ENFILE:
+				case ENOBUFS:
+				case ENOMEM:
+					// Connections stay in the backlog until resources are given back.
+					//
+					ReportError("Cannot accept new socket, wait for %d milliseconds: errno=%d",
+						SLEEP_ON_CANNOT_ACCEPT, errno);
+
+					usleep(SLEEP_ON_CANNOT_ACCEPT * 1000);
+					return 0;
+
+				default:
+					ReportError("Cannot accept new socket: errno=%d", errno);
+					return -1;
+			}
+		}
+
+		ClientAddressToString(&clientAddress, clientIP, sizeof(clientIP));
+
+#ifdef TASK_REACTOR
+		task = StartTaskOnReactor(clientSockFD, clientIP, acceptor->reactorId);
+#else
+		task = StartTask(clientSockFD, clientIP);
+#endif
+		if (task == NULL)
+		{
+			ReportError("Cannot start new task");
+			close(clientSockFD);
+		}
+	}
+}
+
+/**
+ * ClientAddressToString()
+ * Print client address. IPv4-mapped IPv6 addresses of dual-stack sockets
+ * are printed as IPv4 addresses.
+ */
+static void
+ClientAddressToString(
+	struct sockaddr_storage *clientAddress,
+	char                *clientIP,
+	socklen_t           clientIPSize)
+{
+	struct sockaddr_in  *clientAddressIPv4 = (struct sockaddr_in *) clientAddress;
+	struct sockaddr_in6 *clientAddressIPv6 = (struct sockaddr_in6 *) clientAddress;
+
+	if (clientAddress->ss_family == AF_INET)
+	{
+		inet_ntop(AF_INET, &clientAddressIPv4->sin_addr, clientIP, clientIPSize);
+	}
+	else if (IN6_IS_ADDR_V4MAPPED(&clientAddressIPv6->sin6_addr))
+	{
+		inet_ntop(AF_INET, &clientAddressIPv6->sin6_addr.s6_addr[12], clientIP, clientIPSize);
+	}
+	else
+	{
+		inet_ntop(AF_INET6, &clientAddressIPv6->sin6_addr, clientIP, clientIPSize);
+	}
+}
+
+#endif
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <pthread.h>
+
 /**
  * Timeout values all multiplied by 1000 to give a better overview
  * over millisecond values.
@@ -9,6 +11,36 @@
 #define SLEEP_ON_CANNOT_ACCEPT                   500  /**< Milliseconds */
 #define SLEEP_ON_SET_SOCKET_OPTIONS              250  /**< Milliseconds */
 
+#ifdef LISTENER_REUSEPORT
+
+/**
+ * One listen socket per port at most: IPv4 and IPv6.
+ */
+#define MAX_ACCEPTOR_SOCKETS                       2
+
+struct Acceptor
+{
+	pthread_t           thread;
+	int                 acceptorId;
+	int                 reactorId;
+	int                 numberOfSockets;
+	int                 listenSockFD[MAX_ACCEPTOR_SOCKETS];
+};
+
+/**
+ * StartAcceptors()
+ * Start one acceptor thread per online CPU (per reactor in reactor mode).
+ * Each acceptor has listen sockets of its own bound with SO_REUSEPORT,
+ * so that the kernel spreads incoming connections over all acceptors.
+ * In reactor mode each acceptor hands its connections to its own reactor.
+ *
+ * Returns 0 upon successful completion or -1, in case of error.
+ */
+int
+StartAcceptors(void);
+
+#endif
+
 /**
  * IPv4ListenerThread()
  *
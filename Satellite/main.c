@@ -1,11 +1,14 @@
 #include <errno.h>
+#include <fcntl.h>
 #include <libpq-fe.h>
 #include <pthread.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <string.h>
 #include <syslog.h>
+#include <stdio.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 
 #include "broadcaster_api.h"
@@ -15,6 +18,8 @@
 #include "listener.h"
 #include "mmps.h"
 #include "paquet.h"
+#include "paquet_workers.h"
+#include "reactor.h"
 #include "report.h"
 #include "session.h"
 #include "tasks.h"
@@ -29,8 +34,14 @@ extern struct Chalkboard *chalkboard;
 
 #ifdef STATISTICS
 static pthread_t statisticsHandler;
+
+// Set on SIGUSR1, the statistics thread dumps statistics of all MMPS pools
+// to STATISTICS_DUMP_FILE on its next round.
+//
+static volatile sig_atomic_t dumpStatistics = 0;
 #endif
 
+#ifndef LISTENER_REUSEPORT
 #ifdef IPV4
 static pthread_t listenerIPv4Handler;
 #endif
@@ -38,15 +49,23 @@ static pthread_t listenerIPv4Handler;
 #ifdef IPV6
 static pthread_t listenerIPv6Handler;
 #endif
+#endif
 
 static pthread_t broadcasterHandler;
 
+static pthread_t shrinkHandler;
+
 static void
 RegisterSignalHandler(void);
 
 static void
 ConstructDB(void);
 
+#ifdef STATISTICS
+static void
+DumpStatistics(void);
+#endif
+
 static void
 DestructDB(void);
 
@@ -54,6 +73,8 @@ DestructDB(void);
 void *
 StatisticsThread(void *arg)
 {
+	unsigned int node;
+
 	while (1)
 	{
 		ReportDebug("STATISTICS  DBH: %-4d%-4d%-4d  TASK: %-4d  PAQUET: %-4d  256: %-4d  512: %-4d  1K: %-4d  4K: %-4d  1M: %-4d",
@@ -67,12 +88,44 @@ StatisticsThread(void *arg)
 			MMPS_NumberOfBuffersInUse(chalkboard->pools.dynamic, 2),
 			MMPS_NumberOfBuffersInUse(chalkboard->pools.dynamic, 3),
 			MMPS_NumberOfBuffersInUse(chalkboard->pools.dynamic, 4));
+
+		if (MMPS_NumberOfNodes(chalkboard->pools.paquet, 0) > 1)
+		{
+			for (node = 0; node < MMPS_NumberOfNodes(chalkboard->pools.paquet, 0); node++)
+			{
+				ReportDebug("STATISTICS  NODE: %-4u  PAQUET: %-4d  256: %-4d  512: %-4d  1K: %-4d  4K: %-4d",
+					node,
+					MMPS_NumberOfBuffersInUseOnNode(chalkboard->pools.paquet, 0, node),
+					MMPS_NumberOfBuffersInUseOnNode(chalkboard->pools.dynamic, 0, node),
+					MMPS_NumberOfBuffersInUseOnNode(chalkboard->pools.dynamic, 1, node),
+					MMPS_NumberOfBuffersInUseOnNode(chalkboard->pools.dynamic, 2, node),
+					MMPS_NumberOfBuffersInUseOnNode(chalkboard->pools.dynamic, 3, node));
+			}
+		}
+
+		if (dumpStatistics != 0)
+		{
+			dumpStatistics = 0;
+			DumpStatistics();
+		}
+
 		sleep(1);
 	}
 	pthread_exit(NULL);
 }
 #endif
 
+void *
+ShrinkThread(void *arg)
+{
+	while (1)
+	{
+		sleep(SHRINK_MMPS_INTERVAL);
+		ShrinkMMPS();
+	}
+	pthread_exit(NULL);
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -137,6 +190,29 @@ main(int argc, char *argv[])
     }
 #endif
 
+#ifdef PAQUET_WORKERS
+	rc = StartPaquetWorkers(NUMBER_OF_PAQUET_WORKERS, PAQUET_WORKER_QUEUE_DEPTH);
+    if (rc != 0) {
+        ReportError("Cannot start paquet workers");
+        goto quit;
+    }
+#endif
+
+#ifdef TASK_REACTOR
+	rc = StartReactors();
+    if (rc != 0) {
+        ReportError("Cannot start reactors");
+        goto quit;
+    }
+#endif
+
+#ifdef LISTENER_REUSEPORT
+	rc = StartAcceptors();
+    if (rc != 0) {
+        ReportError("Cannot start acceptors");
+        goto quit;
+    }
+#else
 #ifdef IPV4
 	rc = pthread_create(&listenerIPv4Handler, NULL, &IPv4ListenerThread, NULL);
     if (rc != 0) {
@@ -152,6 +228,13 @@ main(int argc, char *argv[])
         goto quit;
     }
 #endif
+#endif
+
+	rc = pthread_create(&shrinkHandler, NULL, &ShrinkThread, NULL);
+    if (rc != 0) {
+        ReportError("Cannot create shrink thread: errno=%d", errno);
+        goto quit;
+    }
 
 	rc = pthread_create(&broadcasterHandler, NULL, &BroadcasterThread, NULL);
     if (rc != 0) {
@@ -159,6 +242,7 @@ main(int argc, char *argv[])
         goto quit;
     }
 
+#ifndef LISTENER_REUSEPORT
 #ifdef IPV4
 	rc = pthread_join(listenerIPv4Handler, NULL);
     if (rc != 0) {
@@ -173,6 +257,7 @@ main(int argc, char *argv[])
         ReportError("Error has occurred while waiting for IPv6 listener thread: errno=%d", errno);
         goto quit;
     }
+#endif
 #endif
 
     rc = pthread_join(broadcasterHandler, NULL);
@@ -192,16 +277,26 @@ SignalHandler(int signal)
 {
 	ReportError("Received signal to quit: signal=%d", signal);
 
+#ifndef LISTENER_REUSEPORT
 #ifdef IPV4
     pthread_kill(listenerIPv4Handler, signal);
 #endif
 
 #ifdef IPV6
     pthread_kill(listenerIPv6Handler, signal);
+#endif
 #endif
     pthread_kill(broadcasterHandler, signal);
 }
 
+#ifdef STATISTICS
+void
+StatisticsSignalHandler(int signal)
+{
+	dumpStatistics = 1;
+}
+#endif
+
 static void
 RegisterSignalHandler(void)
 {
@@ -216,8 +311,61 @@ RegisterSignalHandler(void)
 
     sigaction(SIGHUP, &sa, NULL);
     sigaction(SIGINT, &sa, NULL);
+
+#ifdef STATISTICS
+    memset(&sa, 0, sizeof(struct sigaction));
+    sa.sa_handler = &StatisticsSignalHandler;
+
+	sa.sa_flags = SA_RESTART;
+
+    sigaction(SIGUSR1, &sa, NULL);
+#endif
 }
 
+#ifdef STATISTICS
+static void
+DumpStatistics(void)
+{
+	char path[] = STATISTICS_DUMP_FILE ".XXXXXX";
+	int fd;
+	int rc;
+
+	// Dump goes to a new file of its own, which then replaces the previous
+	// dump. Directory is shared, so an existing file or a link planted
+	// under the dump name must never be opened for writing.
+	//
+	fd = mkstemp(path);
+	if (fd < 0) {
+		ReportError("Cannot create statistics dump file %s: errno=%d",
+			path, errno);
+		return;
+	}
+
+	fchmod(fd, 0644);
+
+	rc = MMPS_DumpStatistics(chalkboard->pools.task, "task", fd);
+	if (rc == MMPS_OK)
+		rc = MMPS_DumpStatistics(chalkboard->pools.paquet, "paquet", fd);
+	if (rc == MMPS_OK)
+		rc = MMPS_DumpStatistics(chalkboard->pools.dynamic, "dynamic", fd);
+
+	close(fd);
+
+	if (rc != MMPS_OK) {
+		ReportError("Cannot write statistics dump file %s: rc=%d",
+			path, rc);
+		unlink(path);
+		return;
+	}
+
+	if (rename(path, STATISTICS_DUMP_FILE) != 0) {
+		ReportError("Cannot rename statistics dump file to %s: errno=%d",
+			STATISTICS_DUMP_FILE, errno);
+		unlink(path);
+	}
+}
+#endif
+
 static void
 ConstructDB(void)
 {
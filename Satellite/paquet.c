@@ -8,6 +8,7 @@
 #include "paquet.h"
 #include "paquet_broadcast.h"
 #include "paquet_displacement.h"
+#include "paquet_workers.h"
 #include "plaques_edit.h"
 #include "plaques_query.h"
 #include "profiles.h"
@@ -22,19 +23,59 @@ RejectPaquetAsBusy(struct Paquet *paquet);
 static void
 RejectPaquetAsError(struct Paquet *paquet);
 
-void
-PaquetCleanup(void *arg);
+int
+StartPaquet(struct Paquet *paquet)
+{
+#ifdef PAQUET_WORKERS
+	int rc;
+
+	paquet->cancelled = 0;
+
+	// Paquet is known to its task from now on, also while it waits in a queue,
+	// so that task cleanup waits until it is done with.
+	//
+	AppentPaquetToTask(paquet->task, paquet);
+
+	// Broadcast waits for new revisions as long as the session lives,
+	// so it keeps a thread of its own instead of holding a worker.
+	//
+	if (paquet->commandCode == API_PaquetBroadcast)
+		rc = pthread_create(&paquet->thread, NULL, &PaquetThread, paquet);
+	else
+		rc = SubmitPaquetToWorkers(paquet);
+
+	if (rc != 0)
+		RemovePaquetFromTask(paquet->task, paquet);
+
+	return rc;
+#else
+	return pthread_create(&paquet->thread, NULL, &PaquetThread, paquet);
+#endif
+}
 
 void *
 PaquetThread(void *arg)
 {
 	struct Paquet *paquet = (struct Paquet *)arg;
-	struct Task *task = paquet->task;
-	int rc;
 
     pthread_cleanup_push(&PaquetCleanup, paquet);
 
-	AppentPaquetToTask(task, paquet);
+#ifndef PAQUET_WORKERS
+	AppentPaquetToTask(paquet->task, paquet);
+#endif
+
+	ProcessPaquet(paquet);
+
+    pthread_cleanup_pop(1);
+
+	pthread_exit(NULL);
+}
+
+void
+ProcessPaquet(struct Paquet *paquet)
+{
+	struct Task *task = paquet->task;
+	int rc;
 
 	switch (paquet->commandCode)
 	{
@@ -118,14 +159,17 @@ PaquetThread(void *arg)
 			rc = -1;
 	}
 
+#ifdef PAQUET_WORKERS
+	// Task is being closed, there is nobody to answer to.
+	//
+	if (PaquetCancelled(paquet) != 0)
+		return;
+#endif
+
 	if (rc != 0)
 		RejectPaquetAsError(paquet);
 
 	SendPaquet(paquet);
-
-    pthread_cleanup_pop(1);
-
-	pthread_exit(NULL);
 }
 
 void
@@ -148,6 +192,39 @@ PaquetCleanup(void *arg)
     MMPS_PokeBuffer(paquet->containerBuffer);
 }
 
+#ifdef PAQUET_WORKERS
+
+void
+CancelPaquetsOfTask(struct Task *task)
+{
+	struct Paquet *paquet;
+
+	// A paquet may be waiting for broadcast. Flags are raised under the mutex
+	// of broadcast condition, so that the waiter either sees its flag before
+	// it starts to wait or gets woken up.
+	//
+	pthread_mutex_lock(&task->broadcast.waitMutex);
+
+	pthread_spin_lock(&task->paquet.chainLock);
+
+	for (paquet = task->paquet.chainAnchor; paquet != NULL; paquet = paquet->nextInChain)
+		__atomic_store_n(&paquet->cancelled, 1, __ATOMIC_RELEASE);
+
+	pthread_spin_unlock(&task->paquet.chainLock);
+
+	pthread_cond_broadcast(&task->broadcast.waitCondition);
+
+	pthread_mutex_unlock(&task->broadcast.waitMutex);
+}
+
+int
+PaquetCancelled(struct Paquet *paquet)
+{
+	return __atomic_load_n(&paquet->cancelled, __ATOMIC_ACQUIRE);
+}
+
+#else
+
 void
 PaquetCancel(struct Paquet *paquet)
 {
@@ -165,6 +242,8 @@ PaquetCancel(struct Paquet *paquet)
 	}
 }
 
+#endif
+
 int
 MinimumPayloadSize(struct Paquet *paquet, unsigned int minimumSize)
 {
@@ -27,6 +27,32 @@ struct PaquetBroadcast
 };
 #pragma pack(pop)
 
+#pragma pack(push, 1)
+struct PaquetPlaqueRecord
+{
+	uint32  		plaqueStrobe;
+	char			plaqueToken[API_TokenBinarySize];
+	uint32  		plaqueRevision;
+	char			profileToken[API_TokenBinarySize];
+	uint8			fortified;
+	char			dimension[2];
+	double			latitude;
+	double			longitude;
+	float			altitude;
+	uint8			directed;
+	float			direction;
+	uint8			tilted;
+	float			tilt;
+	float			width;
+	float			height;
+	uint32  		backgroundColor;
+	uint32  		foregroundColor;
+	float			fontSize;
+	uint32  		inscriptionLength;
+	char			inscription[];
+};
+#pragma pack(pop)
+
 #pragma pack(push, 1)
 struct PaquetDisplacement
 {
@@ -133,11 +159,28 @@ struct PaquetReport
 };
 #pragma pack(pop)
 
+int
+StartPaquet(struct Paquet *paquet);
+
 void *
 PaquetThread(void *arg);
 
+void
+ProcessPaquet(struct Paquet *paquet);
+
+void
+PaquetCleanup(void *arg);
+
+#ifdef PAQUET_WORKERS
+void
+CancelPaquetsOfTask(struct Task *task);
+
+int
+PaquetCancelled(struct Paquet *paquet);
+#else
 void
 PaquetCancel(struct Paquet *paquet);
+#endif
 
 int
 MinimumPayloadSize(struct Paquet *paquet, unsigned int minimumSize);
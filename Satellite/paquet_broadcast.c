@@ -44,13 +44,13 @@ HandleBroadcast(struct Paquet *paquet)
 		return -1;
 	}
 
-	MMPS_ResetCursor(paquet->inputBuffer);
+	struct MMPS_Buffer *inputBuffer = paquet->inputBuffer;
 
-	struct PaquetBroadcast *broadcast = (struct PaquetBroadcast *) paquet->inputBuffer->cursor;
+	MMPS_ResetCursor(inputBuffer);
 
-	lastKnownRevision->onRadar = be32toh(broadcast->lastKnownOnRadarRevision);
-	lastKnownRevision->inSight = be32toh(broadcast->lastKnownInSightRevision);
-	lastKnownRevision->onMap = be32toh(broadcast->lastKnownOnMapRevision);
+	inputBuffer = MMPS_GetBE32(inputBuffer, &lastKnownRevision->onRadar);
+	inputBuffer = MMPS_GetBE32(inputBuffer, &lastKnownRevision->inSight);
+	inputBuffer = MMPS_GetBE32(inputBuffer, &lastKnownRevision->onMap);
 
     rc = GetSessionRevisions(task, currentRevision);
     if (rc != 0) {
@@ -111,6 +111,12 @@ HandleBroadcast(struct Paquet *paquet)
             return -1;
         }
 
+#ifdef PAQUET_WORKERS
+        // Task cleanup raises cancel flag under this mutex before it wakes up
+        // the waiter, so that a cancel is never missed.
+        //
+        if (PaquetCancelled(paquet) == 0)
+#endif
         rc = pthread_cond_wait(&task->broadcast.waitCondition, &task->broadcast.waitMutex);
         if (rc != 0) {
             pthread_mutex_unlock(&task->broadcast.waitMutex);
@@ -129,6 +135,12 @@ HandleBroadcast(struct Paquet *paquet)
 
 	pthread_mutex_lock(&task->broadcast.editMutex);
 
+#ifdef PAQUET_WORKERS
+    if (PaquetCancelled(paquet) != 0) {
+        ReportInfo("Broadcast cancelled");
+        rc = -1;
+    } else
+#endif
     if (currentRevision->onRadar > lastKnownRevision->onRadar) {
         ReportInfo("Fetch 'on radar' for broadcast from revision %u to %u",
             lastKnownRevision->onRadar,
@@ -246,10 +258,9 @@ HandleBroadcastPlaquesOnRadar(struct Paquet *paquet)
 
 	MMPS_ResetBufferData(outputBuffer);
 
-    uint32 broadcastDestination = API_BroadcastDestinationOnRadar;
-	outputBuffer = MMPS_PutInt32(outputBuffer, &broadcastDestination);
+	outputBuffer = MMPS_PutBE32(outputBuffer, API_BroadcastDestinationOnRadar);
 
-	outputBuffer = MMPS_PutInt32(outputBuffer, &currentRevision);
+	outputBuffer = MMPS_PutBE32(outputBuffer, currentRevision);
 
 	uint32 numberOfPlaques = PQntuples(dbh->result);
 
@@ -258,7 +269,7 @@ HandleBroadcastPlaquesOnRadar(struct Paquet *paquet)
 	    currentRevision,
 	    task->broadcast.lastKnownRevision.onRadar);
 
-	outputBuffer = MMPS_PutInt32(outputBuffer, &numberOfPlaques);
+	outputBuffer = MMPS_PutBE32(outputBuffer, numberOfPlaques);
 
 	int rowNumber;
 	for (rowNumber = 0; rowNumber < numberOfPlaques; rowNumber++)
@@ -349,10 +360,9 @@ HandleBroadcastPlaquesInSight(struct Paquet *paquet)
 
 	MMPS_ResetBufferData(outputBuffer);
 
-    uint32 broadcastDestination = API_BroadcastDestinationInSight;
-	outputBuffer = MMPS_PutInt32(outputBuffer, &broadcastDestination);
+	outputBuffer = MMPS_PutBE32(outputBuffer, API_BroadcastDestinationInSight);
 
-	outputBuffer = MMPS_PutInt32(outputBuffer, &currentRevision);
+	outputBuffer = MMPS_PutBE32(outputBuffer, currentRevision);
 
 	uint32 numberOfPlaques = PQntuples(dbh->result);
 
@@ -361,7 +371,7 @@ HandleBroadcastPlaquesInSight(struct Paquet *paquet)
 	    currentRevision,
 	    task->broadcast.lastKnownRevision.inSight);
 
-	outputBuffer = MMPS_PutInt32(outputBuffer, &numberOfPlaques);
+	outputBuffer = MMPS_PutBE32(outputBuffer, numberOfPlaques);
 
 	int rowNumber;
 	for (rowNumber = 0; rowNumber < numberOfPlaques; rowNumber++)
@@ -450,10 +460,9 @@ HandleBroadcastPlaquesOnMap(struct Paquet *paquet)
 		return -1;
 	}
 
-    uint32 broadcastDestination = API_BroadcastDestinationOnMap;
-	outputBuffer = MMPS_PutInt32(outputBuffer, &broadcastDestination);
+	outputBuffer = MMPS_PutBE32(outputBuffer, API_BroadcastDestinationOnMap);
 
-	outputBuffer = MMPS_PutInt32(outputBuffer, &currentRevision);
+	outputBuffer = MMPS_PutBE32(outputBuffer, currentRevision);
 
 	uint32 numberOfPlaques = PQntuples(dbh->result);
 
@@ -462,7 +471,7 @@ HandleBroadcastPlaquesOnMap(struct Paquet *paquet)
 	    currentRevision,
 	    task->broadcast.lastKnownRevision.onMap);
 
-	outputBuffer = MMPS_PutInt32(outputBuffer, &numberOfPlaques);
+	outputBuffer = MMPS_PutBE32(outputBuffer, numberOfPlaques);
 
 	int rowNumber;
 	for (rowNumber = 0; rowNumber < numberOfPlaques; rowNumber++)
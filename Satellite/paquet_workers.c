@@ -0,0 +1,298 @@
+#ifdef PAQUET_WORKERS
+
+#include <c.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "chalkboard.h"
+#include "paquet.h"
+#include "paquet_workers.h"
+#include "report.h"
+#include "tasks.h"
+
+// Take a pointer to chalkboard. Chalkboard must be initialized
+// before any routine of this module could be called.
+//
+extern struct Chalkboard *chalkboard;
+
+static void *
+PaquetWorkerThread(void *arg);
+
+static struct Paquet *
+TakeOwnPaquet(struct PaquetWorker *worker);
+
+static struct Paquet *
+StealPaquet(struct PaquetWorker *thief);
+
+static void
+WaitForPaquets(void);
+
+/**
+ * StartPaquetWorkers()
+ * Allocate queues of all workers and start worker threads.
+ *
+ * Returns 0 upon successful completion or -1, in case of error.
+ */
+int
+StartPaquetWorkers(unsigned int numberOfWorkers, unsigned int queueDepth)
+{
+	struct PaquetWorker	*worker;
+	int					workerId;
+	int					rc;
+
+	if ((numberOfWorkers == 0) || (queueDepth == 0) || ((queueDepth & (queueDepth - 1)) != 0))
+	{
+		ReportError("[PaquetWorkers] Wrong configuration: numberOfWorkers=%u queueDepth=%u",
+			numberOfWorkers,
+			queueDepth);
+		return -1;
+	}
+
+	chalkboard->paquetWorkers.list = malloc(numberOfWorkers * sizeof(struct PaquetWorker));
+	if (chalkboard->paquetWorkers.list == NULL)
+	{
+		ReportSoftAlert("[PaquetWorkers] Out of memory");
+		return -1;
+	}
+
+	chalkboard->paquetWorkers.numberOfWorkers = numberOfWorkers;
+	chalkboard->paquetWorkers.queueDepth = queueDepth;
+	chalkboard->paquetWorkers.nextWorkerId = 0;
+	chalkboard->paquetWorkers.numberOfQueuedPaquets = 0;
+	chalkboard->paquetWorkers.numberOfIdleWorkers = 0;
+
+	rc = pthread_mutex_init(&chalkboard->paquetWorkers.idleMutex, NULL);
+	if (rc != 0)
+	{
+		ReportError("[PaquetWorkers] Cannot initialize mutex: rc=%d", rc);
+		return -1;
+	}
+
+	rc = pthread_cond_init(&chalkboard->paquetWorkers.idleCondition, NULL);
+	if (rc != 0)
+	{
+		ReportError("[PaquetWorkers] Cannot initialize condition variable: rc=%d", rc);
+		return -1;
+	}
+
+	// All queues must be ready before the first worker starts to steal.
+	//
+	for (workerId = 0; workerId < numberOfWorkers; workerId++)
+	{
+		worker = &chalkboard->paquetWorkers.list[workerId];
+
+		worker->workerId = workerId;
+		worker->queue.head = 0;
+		worker->queue.tail = 0;
+
+		worker->queue.paquets = malloc(queueDepth * sizeof(struct Paquet *));
+		if (worker->queue.paquets == NULL)
+		{
+			ReportSoftAlert("[PaquetWorkers] Out of memory");
+			return -1;
+		}
+
+		rc = pthread_spin_init(&worker->queue.lock, PTHREAD_PROCESS_PRIVATE);
+		if (rc != 0)
+		{
+			ReportError("[PaquetWorkers] Cannot initialize spinlock: rc=%d", rc);
+			return -1;
+		}
+	}
+
+	for (workerId = 0; workerId < numberOfWorkers; workerId++)
+	{
+		worker = &chalkboard->paquetWorkers.list[workerId];
+
+		rc = pthread_create(&worker->thread, NULL, &PaquetWorkerThread, worker);
+		if (rc != 0)
+		{
+			ReportError("[PaquetWorkers] Cannot create worker thread: rc=%d", rc);
+			return -1;
+		}
+	}
+
+	ReportInfo("[PaquetWorkers] Started %u workers with %u paquets per queue",
+		numberOfWorkers,
+		queueDepth);
+
+	return 0;
+}
+
+/**
+ * SubmitPaquetToWorkers()
+ * Put a paquet in the queue of the worker of its task and wake an idle
+ * worker. Paquets of a task never go to another queue, even if this one
+ * is full, as the order they are started in would get lost.
+ *
+ * Returns 0 upon successful completion or -1, if the queue is full.
+ */
+int
+SubmitPaquetToWorkers(struct Paquet *paquet)
+{
+	struct PaquetQueue	*queue;
+	unsigned int		queueDepth = chalkboard->paquetWorkers.queueDepth;
+
+	queue = &chalkboard->paquetWorkers.list[paquet->task->paquet.workerId].queue;
+
+	pthread_spin_lock(&queue->lock);
+
+	if (queue->tail - queue->head >= queueDepth)
+	{
+		pthread_spin_unlock(&queue->lock);
+		return -1;
+	}
+
+	queue->paquets[queue->tail & (queueDepth - 1)] = paquet;
+	queue->tail++;
+
+	pthread_spin_unlock(&queue->lock);
+
+	// Counter of queued paquets is raised before the number of idle workers
+	// is looked at, and an idle worker is counted before it looks at queued
+	// paquets, so that either the worker sees the paquet or it gets signaled.
+	//
+	__atomic_add_fetch(&chalkboard->paquetWorkers.numberOfQueuedPaquets, 1, __ATOMIC_SEQ_CST);
+
+	if (__atomic_load_n(&chalkboard->paquetWorkers.numberOfIdleWorkers, __ATOMIC_SEQ_CST) > 0)
+	{
+		pthread_mutex_lock(&chalkboard->paquetWorkers.idleMutex);
+		pthread_cond_signal(&chalkboard->paquetWorkers.idleCondition);
+		pthread_mutex_unlock(&chalkboard->paquetWorkers.idleMutex);
+	}
+
+	return 0;
+}
+
+/**
+ * PaquetWorkerThread()
+ * Process paquets of own queue, steal paquets of other workers when own queue
+ * is empty and sleep when there is nothing to do at all.
+ */
+static void *
+PaquetWorkerThread(void *arg)
+{
+	struct PaquetWorker	*worker = (struct PaquetWorker *)arg;
+	struct Paquet		*paquet;
+
+	for (;;)
+	{
+		paquet = TakeOwnPaquet(worker);
+		if (paquet == NULL)
+			paquet = StealPaquet(worker);
+
+		if (paquet == NULL)
+		{
+			WaitForPaquets();
+			continue;
+		}
+
+		__atomic_sub_fetch(&chalkboard->paquetWorkers.numberOfQueuedPaquets, 1, __ATOMIC_SEQ_CST);
+
+		// Task is being closed, do not start a paquet nobody waits for.
+		//
+		if (PaquetCancelled(paquet) == 0)
+			ProcessPaquet(paquet);
+
+		PaquetCleanup(paquet);
+	}
+
+	return NULL;
+}
+
+/**
+ * TakeOwnPaquet()
+ * Take the oldest paquet of own queue, so that paquets of a task are started
+ * in the order they were received. Paquets of a task may still run
+ * concurrently, if a thief takes the next one while this one is running.
+ *
+ * Returns pointer to paquet or NULL, if queue is empty.
+ */
+static struct Paquet *
+TakeOwnPaquet(struct PaquetWorker *worker)
+{
+	struct PaquetQueue	*queue = &worker->queue;
+	struct Paquet		*paquet = NULL;
+
+	pthread_spin_lock(&queue->lock);
+
+	if (queue->head != queue->tail)
+	{
+		paquet = queue->paquets[queue->head & (chalkboard->paquetWorkers.queueDepth - 1)];
+		queue->head++;
+	}
+
+	pthread_spin_unlock(&queue->lock);
+
+	return paquet;
+}
+
+/**
+ * StealPaquet()
+ * Take the oldest paquet of the first other worker that has one. Stealing
+ * from the same end as the owner keeps paquets of a task in order.
+ *
+ * Returns pointer to paquet or NULL, if all queues are empty.
+ */
+static struct Paquet *
+StealPaquet(struct PaquetWorker *thief)
+{
+	struct PaquetQueue	*queue;
+	struct Paquet		*paquet = NULL;
+	unsigned int		numberOfWorkers = chalkboard->paquetWorkers.numberOfWorkers;
+	unsigned int		workerId;
+	unsigned int		attempt;
+
+	workerId = thief->workerId;
+
+	for (attempt = 1; attempt < numberOfWorkers; attempt++)
+	{
+		workerId = (workerId + 1) % numberOfWorkers;
+
+		queue = &chalkboard->paquetWorkers.list[workerId].queue;
+
+		// Nothing to steal, do not disturb the owner.
+		//
+		if (__atomic_load_n(&queue->head, __ATOMIC_RELAXED) ==
+				__atomic_load_n(&queue->tail, __ATOMIC_RELAXED))
+			continue;
+
+		pthread_spin_lock(&queue->lock);
+
+		if (queue->head != queue->tail)
+		{
+			paquet = queue->paquets[queue->head & (chalkboard->paquetWorkers.queueDepth - 1)];
+			queue->head++;
+		}
+
+		pthread_spin_unlock(&queue->lock);
+
+		if (paquet != NULL)
+			break;
+	}
+
+	return paquet;
+}
+
+/**
+ * WaitForPaquets()
+ * Sleep until some paquet is queued.
+ */
+static void
+WaitForPaquets(void)
+{
+	pthread_mutex_lock(&chalkboard->paquetWorkers.idleMutex);
+
+	__atomic_add_fetch(&chalkboard->paquetWorkers.numberOfIdleWorkers, 1, __ATOMIC_SEQ_CST);
+
+	while (__atomic_load_n(&chalkboard->paquetWorkers.numberOfQueuedPaquets, __ATOMIC_SEQ_CST) <= 0)
+		pthread_cond_wait(&chalkboard->paquetWorkers.idleCondition,
+			&chalkboard->paquetWorkers.idleMutex);
+
+	__atomic_sub_fetch(&chalkboard->paquetWorkers.numberOfIdleWorkers, 1, __ATOMIC_SEQ_CST);
+
+	pthread_mutex_unlock(&chalkboard->paquetWorkers.idleMutex);
+}
+
+#endif
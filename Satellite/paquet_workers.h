@@ -0,0 +1,51 @@
+#pragma once
+
+#include <pthread.h>
+
+#include "tasks.h"
+
+/**
+ * Queue of paquets waiting for a worker. Each task has a worker whose queue
+ * takes all paquets of the task. The worker takes the oldest paquet from it,
+ * an idle worker steals the oldest paquet from the queue of another worker,
+ * so that paquets of a task are started in the order they were received.
+ */
+struct PaquetQueue
+{
+	pthread_spinlock_t	lock;
+	unsigned int		head;
+	unsigned int		tail;
+	struct Paquet		**paquets;
+};
+
+struct PaquetWorker
+{
+	pthread_t			thread;
+	int					workerId;
+	struct PaquetQueue	queue;
+};
+
+/**
+ * StartPaquetWorkers()
+ * Start a fixed number of worker threads which process all paquets
+ * of all tasks, instead of a thread per paquet.
+ *
+ * @numberOfWorkers:	Number of worker threads.
+ * @queueDepth:			Maximal number of paquets waiting in the queue
+ *						of one worker (power of two).
+ *
+ * Returns 0 upon successful completion or -1, in case of error.
+ */
+int
+StartPaquetWorkers(unsigned int numberOfWorkers, unsigned int queueDepth);
+
+/**
+ * SubmitPaquetToWorkers()
+ * Put a paquet in the queue of the worker of its task.
+ *
+ * @paquet:
+ *
+ * Returns 0 upon successful completion or -1, if the queue is full.
+ */
+int
+SubmitPaquetToWorkers(struct Paquet *paquet);
@@ -23,6 +23,11 @@ FROM surrounding.plaques \
 JOIN auth.profiles USING (profile_id) \
 WHERE plaque_token = $1"
 
+// Approximate number of bytes one plaque takes in a download response.
+// Used to pre-link output buffers for the whole response at once.
+//
+#define PLAQUE_EXPECTED_SIZE    160
+
 int
 HandleDownloadPlaques(struct Paquet *paquet)
 {
@@ -40,7 +45,7 @@ HandleDownloadPlaques(struct Paquet *paquet)
 
     MMPS_ResetCursor(inputBuffer);
 
-    inputBuffer = MMPS_GetInt32(inputBuffer, &numberOfPlaques);
+    inputBuffer = MMPS_GetBE32(inputBuffer, &numberOfPlaques);
 
     if (!ExpectedPayloadSize(paquet, sizeof(numberOfPlaques) + numberOfPlaques * API_TokenBinarySize))
     {
@@ -59,6 +64,25 @@ HandleDownloadPlaques(struct Paquet *paquet)
 
     MMPS_ResetBufferData(outputBuffer);
 
+    struct MMPS_Writer writer;
+    MMPS_InitWriter(&writer, outputBuffer);
+
+    // Pre-link buffers for the expected response in one go, instead of
+    // extending the chain buffer by buffer while writing. If there are
+    // not enough free buffers the chain will still be extended on demand.
+    //
+    unsigned int numberOfSpareBuffers =
+        (numberOfPlaques * PLAQUE_EXPECTED_SIZE) / outputBuffer->bufferSize;
+    if (numberOfSpareBuffers > 0) {
+        struct MMPS_Buffer *spareBuffers = MMPS_PeekBuffers(
+            chalkboard->pools.dynamic,
+            outputBuffer->bank->bankId,
+            numberOfSpareBuffers,
+            BUFFER_PLAQUES);
+        if (spareBuffers != NULL)
+            MMPS_AppendBuffer(outputBuffer, spareBuffers);
+    }
+
     struct dbh *dbh = DB_PeekHandle(chalkboard->db.plaque);
     if (dbh == NULL) {
         SetTaskStatus(task, TaskStatusNoDatabaseHandlers);
@@ -147,30 +171,51 @@ HandleDownloadPlaques(struct Paquet *paquet)
             return -1;
         }
 
-        uint32 plaqueStrobe = API_PaquetPlaqueStrobe;
-        outputBuffer = MMPS_PutInt32(outputBuffer, &plaqueStrobe);
-
-        outputBuffer = MMPS_PutData(outputBuffer, plaqueToken, API_TokenBinarySize);
-        outputBuffer = MMPS_PutData(outputBuffer, plaqueRevision, sizeof(uint32));
-        outputBuffer = MMPS_PutData(outputBuffer, profileToken, API_TokenBinarySize);
-        outputBuffer = MMPS_PutInt8(outputBuffer, &fortified);
-        outputBuffer = MMPS_PutData(outputBuffer, dimension, 2 * sizeof(char));
-        outputBuffer = MMPS_PutData(outputBuffer, latitude, sizeof(double));
-        outputBuffer = MMPS_PutData(outputBuffer, longitude, sizeof(double));
-        outputBuffer = MMPS_PutData(outputBuffer, altitude, sizeof(float));
-        outputBuffer = MMPS_PutInt8(outputBuffer, &directed);
-        outputBuffer = MMPS_PutData(outputBuffer, direction, sizeof(float));
-        outputBuffer = MMPS_PutInt8(outputBuffer, &tilted);
-        outputBuffer = MMPS_PutData(outputBuffer, tilt, sizeof(float));
-        outputBuffer = MMPS_PutData(outputBuffer, width, sizeof(float));
-        outputBuffer = MMPS_PutData(outputBuffer, height, sizeof(float));
-        outputBuffer = MMPS_PutData(outputBuffer, backgroundColor, sizeof(uint32));
-        outputBuffer = MMPS_PutData(outputBuffer, foregroundColor, sizeof(uint32));
-        outputBuffer = MMPS_PutData(outputBuffer, fontSize, sizeof(float));
-        outputBuffer = MMPS_PutString(outputBuffer, inscription, inscriptionSize);
+        // Fixed part of a plaque record is written with one reservation.
+        // Values from database are in network byte order already.
+        //
+        struct PaquetPlaqueRecord *record = (struct PaquetPlaqueRecord *)
+            MMPS_Reserve(&writer, sizeof(struct PaquetPlaqueRecord));
+        if (record == NULL) {
+            DB_PokeHandle(dbh);
+            SetTaskStatus(task, TaskStatusCannotAllocateBufferForOutput);
+            return -1;
+        }
+
+        record->plaqueStrobe = htobe32(API_PaquetPlaqueStrobe);
+        memcpy(record->plaqueToken, plaqueToken, sizeof(record->plaqueToken));
+        memcpy(&record->plaqueRevision, plaqueRevision, sizeof(record->plaqueRevision));
+        memcpy(record->profileToken, profileToken, sizeof(record->profileToken));
+        record->fortified = fortified;
+        memcpy(record->dimension, dimension, sizeof(record->dimension));
+        memcpy(&record->latitude, latitude, sizeof(record->latitude));
+        memcpy(&record->longitude, longitude, sizeof(record->longitude));
+        memcpy(&record->altitude, altitude, sizeof(record->altitude));
+        record->directed = directed;
+        memcpy(&record->direction, direction, sizeof(record->direction));
+        record->tilted = tilted;
+        memcpy(&record->tilt, tilt, sizeof(record->tilt));
+        memcpy(&record->width, width, sizeof(record->width));
+        memcpy(&record->height, height, sizeof(record->height));
+        memcpy(&record->backgroundColor, backgroundColor, sizeof(record->backgroundColor));
+        memcpy(&record->foregroundColor, foregroundColor, sizeof(record->foregroundColor));
+        memcpy(&record->fontSize, fontSize, sizeof(record->fontSize));
+        record->inscriptionLength = htobe32(inscriptionSize);
+
+        MMPS_Commit(&writer, sizeof(struct PaquetPlaqueRecord));
+
+        if (MMPS_WriteData(&writer, inscription, inscriptionSize) != MMPS_OK) {
+            DB_PokeHandle(dbh);
+            SetTaskStatus(task, TaskStatusCannotAllocateBufferForOutput);
+            return -1;
+        }
     }
 
     DB_PokeHandle(dbh);
 
+    // Give back pre-linked buffers that were not used.
+    //
+    MMPS_TruncateChain(writer.buffer);
+
     return 0;
 }
@@ -0,0 +1,748 @@
+#ifdef TASK_REACTOR
+
+#include <c.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include "anticipant.h"
+#include "chalkboard.h"
+#include "paquet.h"
+#include "reactor.h"
+#include "report.h"
+#include "session.h"
+#include "tasks.h"
+#include "task_kernel.h"
+#include "task_xmit.h"
+
+// Take a pointer to chalkboard. Chalkboard must be initialized
+// before any routine of this module could be called.
+//
+extern struct Chalkboard *chalkboard;
+
+// Sockets are armed for one event at a time, so that a task is never
+// served by its reactor and by a thread it has handed work to at once.
+//
+#define REACTOR_EVENTS          (EPOLLIN | EPOLLRDHUP | EPOLLONESHOT)
+
+// Payload is received in steps of at most this size, so that buffers
+// are taken only as data arrives.
+//
+#define PAYLOAD_RECEIVE_SIZE    16 * KB
+
+// What a reactor does with a task after serving its event.
+//
+#define ReactorRearm            1
+#define ReactorHandedOver       0
+#define ReactorClose           -1
+
+static void *
+ReactorThread(void *arg);
+
+static int
+ServeTask(struct Task *task);
+
+static int
+ReceiveFixedPart(struct Task *task);
+
+static void
+ExpectFixedPart(
+	struct Task		*task,
+	int				state,
+	void			*data,
+	size_t			size);
+
+static int
+NewPaquet(struct Task *task);
+
+static int
+DispatchPaquet(struct Task *task);
+
+static int
+ResumeTask(struct Task *task);
+
+static void
+DetachTask(struct Task *task);
+
+static int
+StartWorker(void *(*routine)(void *), struct Task *task);
+
+static void *
+AuthentifyThread(void *arg);
+
+static void *
+AnticipantThread(void *arg);
+
+static void *
+CloseThread(void *arg);
+
+static void
+CloseTask(struct Task *task);
+
+/**
+ * StartReactors()
+ * Start one reactor thread per online CPU.
+ *
+ * Returns 0 upon successful completion or -1, in case of error.
+ */
+int
+StartReactors(void)
+{
+	struct Reactor	*reactor;
+	long			numberOfReactors;
+	int				reactorId;
+	int				rc;
+
+	numberOfReactors = sysconf(_SC_NPROCESSORS_ONLN);
+	if (numberOfReactors < 1)
+		numberOfReactors = 1;
+
+	chalkboard->reactors.list = malloc(numberOfReactors * sizeof(struct Reactor));
+	if (chalkboard->reactors.list == NULL)
+	{
+        ReportSoftAlert("[Reactor] Out of memory");
+        return -1;
+    }
+
+	chalkboard->reactors.numberOfReactors = numberOfReactors;
+	chalkboard->reactors.nextReactorId = 0;
+
+	for (reactorId = 0; reactorId < numberOfReactors; reactorId++)
+	{
+		reactor = &chalkboard->reactors.list[reactorId];
+
+		reactor->reactorId = reactorId;
+
+		reactor->epollFD = epoll_create1(EPOLL_CLOEXEC);
+		if (reactor->epollFD < 0)
+		{
+			ReportError("[Reactor] Cannot create epoll instance: errno=%d", errno);
+			return -1;
+		}
+
+		rc = pthread_create(&reactor->thread, NULL, &ReactorThread, reactor);
+		if (rc != 0)
+		{
+			ReportError("[Reactor] Cannot create reactor thread: rc=%d", rc);
+			return -1;
+		}
+	}
+
+	ReportInfo("[Reactor] Started %ld reactors", numberOfReactors);
+
+	return 0;
+}
+
+/**
+ * AttachTaskToReactor()
+ * Hand the socket of a new task to a given reactor or to the next one.
+ *
+ * Returns 0 upon successful completion or -1, in case of error.
+ */
+int
+AttachTaskToReactor(struct Task *task, int reactorId)
+{
+	struct epoll_event	event;
+	struct Reactor		*reactor;
+	int					rc;
+
+	if ((reactorId >= 0) && (reactorId < chalkboard->reactors.numberOfReactors))
+		task->reactor.reactorId = reactorId;
+	else
+		task->reactor.reactorId =
+			__sync_fetch_and_add(&chalkboard->reactors.nextReactorId, 1) %
+			chalkboard->reactors.numberOfReactors;
+
+	task->reactor.sessionOnline = 0;
+	task->reactor.paquet = NULL;
+	task->reactor.receiveBuffer = NULL;
+
+	ExpectFixedPart(task,
+		TaskStateDemande,
+		&task->dialogue.demande,
+		sizeof(task->dialogue.demande));
+
+	reactor = &chalkboard->reactors.list[task->reactor.reactorId];
+
+	event.events = REACTOR_EVENTS;
+	event.data.ptr = task;
+
+	rc = epoll_ctl(reactor->epollFD, EPOLL_CTL_ADD, task->xmit.sockFD, &event);
+	if (rc != 0)
+	{
+		ReportError("[Reactor] Cannot add socket to reactor: errno=%d", errno);
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * ReactorThread()
+ * Wait for sockets of tasks of a reactor to become readable and serve them.
+ *
+ * @arg:		Pointer to reactor.
+ */
+static void *
+ReactorThread(void *arg)
+{
+	struct Reactor		*reactor = (struct Reactor *) arg;
+	struct epoll_event	events[REACTOR_EVENTS_PER_WAIT];
+	struct Task			*task;
+	int					numberOfEvents;
+	int					eventId;
+	int					rc;
+
+	for (;;)
+	{
+		numberOfEvents = epoll_wait(reactor->epollFD,
+			events,
+			REACTOR_EVENTS_PER_WAIT,
+			-1);
+		if (numberOfEvents < 0)
+		{
+			if (errno != EINTR)
+				ReportError("[Reactor] Cannot wait for events: errno=%d", errno);
+
+			continue;
+		}
+
+		for (eventId = 0; eventId < numberOfEvents; eventId++)
+		{
+			task = (struct Task *) events[eventId].data.ptr;
+
+#ifdef OUTPUT_QUEUE
+			if ((events[eventId].events & EPOLLOUT) &&
+					__atomic_load_n(&task->xmit.outputBlocked, __ATOMIC_SEQ_CST))
+				ResumeOutputQueue(task);
+#endif
+
+			rc = ServeTask(task);
+			if (rc == ReactorRearm)
+				rc = ResumeTask(task);
+
+			if (rc == ReactorClose)
+			{
+				DetachTask(task);
+
+				if (StartWorker(&CloseThread, task) != 0)
+					CloseTask(task);
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * ServeTask()
+ * Receive whatever the socket of a task has without blocking and advance
+ * the task through its states.
+ *
+ * Returns ReactorRearm if the reactor has to wait for more data,
+ * ReactorHandedOver if the task has been handed to another thread,
+ * or ReactorClose if the task has to be closed.
+ */
+static int
+ServeTask(struct Task *task)
+{
+	ssize_t				toReceiveTotal;
+	ssize_t				receivedTotal;
+	uint32				dialogueType;
+	int					rc;
+
+	for (;;)
+	{
+		if (GetTaskStatus(task) != TaskStatusGood)
+			return ReactorClose;
+
+		switch (task->reactor.state)
+		{
+			case TaskStateDemande:
+				rc = ReceiveFixedPart(task);
+				if (rc <= 0)
+					return (rc == 0) ? ReactorRearm : ReactorClose;
+
+				dialogueType = be32toh(task->dialogue.demande.dialogueType);
+				switch (dialogueType)
+				{
+					case API_DialogueTypeAnticipant:
+						ReportInfo("[Reactor] Start anticipant dialogue");
+
+						task->reactor.receiveBuffer = MMPS_PeekBufferOfSize(chalkboard->pools.dynamic,
+							sizeof(struct DialogueAnticipant),
+							BUFFER_DIALOGUE_FIRST);
+						if (task->reactor.receiveBuffer == NULL)
+						{
+							SetTaskStatus(task, TaskStatusOutOfMemory);
+							return ReactorClose;
+						}
+
+						ExpectFixedPart(task,
+							TaskStateAnticipant,
+							task->reactor.receiveBuffer->data,
+							sizeof(struct DialogueAnticipant));
+						break;
+
+					case API_DialogueTypeRegular:
+						return (StartWorker(&AuthentifyThread, task) == 0) ?
+							ReactorHandedOver : ReactorClose;
+
+					default:
+						ReportInfo("[Reactor] Unknown dialogue type %u", dialogueType);
+						return ReactorClose;
+				}
+				break;
+
+			case TaskStateAnticipant:
+				rc = ReceiveFixedPart(task);
+				if (rc <= 0)
+				{
+					if (rc < 0)
+						SetTaskStatus(task, TaskStatusMissingAnticipantRecord);
+
+					return (rc == 0) ? ReactorRearm : ReactorClose;
+				}
+
+				return (StartWorker(&AnticipantThread, task) == 0) ?
+					ReactorHandedOver : ReactorClose;
+
+			case TaskStatePilot:
+				if (task->reactor.paquet == NULL)
+				{
+					rc = NewPaquet(task);
+					if (rc != 0)
+						return ReactorClose;
+				}
+
+				rc = ReceiveFixedPart(task);
+				if (rc <= 0)
+					return (rc == 0) ? ReactorRearm : ReactorClose;
+
+				FillPaquetWithPilotData(task->reactor.paquet);
+
+				if (CheckPaquetPilot(task->reactor.paquet) != 0)
+					return ReactorClose;
+
+				task->reactor.receiveBuffer = MMPS_PeekBufferOfSize(chalkboard->pools.dynamic,
+					KB,
+					BUFFER_DIALOGUE_FIRST);
+				if (task->reactor.receiveBuffer == NULL)
+				{
+					SetTaskStatus(task, TaskStatusOutOfMemory);
+					return ReactorClose;
+				}
+
+				task->reactor.state = TaskStatePayload;
+				break;
+
+			case TaskStatePayload:
+				toReceiveTotal = task->reactor.paquet->payloadSize -
+					MMPS_TotalDataSize(task->reactor.receiveBuffer);
+				if (toReceiveTotal > 0)
+				{
+					receivedTotal = MMPS_ReceiveIntoChainWithFlags(task->xmit.sockFD,
+						task->reactor.receiveBuffer,
+						Min(toReceiveTotal, PAYLOAD_RECEIVE_SIZE),
+						MSG_DONTWAIT);
+					if (receivedTotal == MMPS_OUT_OF_MEMORY)
+					{
+						ReportError("[Reactor] Cannot extend buffer");
+						SetTaskStatus(task, TaskStatusCannotExtendBufferForInput);
+						return ReactorClose;
+					}
+					else if (receivedTotal < 0)
+					{
+						if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+							return ReactorRearm;
+
+						ReportError("[Reactor] Error reading from socket for paquet: errno=%d", errno);
+						SetTaskStatus(task, TaskStatusReadFromSocketFailed);
+						return ReactorClose;
+					}
+					else if (receivedTotal == 0)
+					{
+						ReportInfo("[Reactor] Connection lost");
+						return ReactorClose;
+					}
+
+					// Take the rest on the next round, or learn there
+					// that the socket has nothing more for now.
+					//
+					if (receivedTotal < toReceiveTotal)
+						break;
+				}
+
+				rc = DispatchPaquet(task);
+				if (rc != 0)
+					return ReactorClose;
+				break;
+		}
+	}
+}
+
+/**
+ * ReceiveFixedPart()
+ * Receive without blocking into the fixed size part the task expects.
+ *
+ * Returns 1 if the part is complete, 0 if more data is to come
+ * or -1 if the connection is lost.
+ */
+static int
+ReceiveFixedPart(struct Task *task)
+{
+	ssize_t				receivedPerStep;
+
+	while (task->reactor.fixedReceived < task->reactor.fixedSize)
+	{
+		receivedPerStep = recv(task->xmit.sockFD,
+			task->reactor.fixedData + task->reactor.fixedReceived,
+			task->reactor.fixedSize - task->reactor.fixedReceived,
+			MSG_DONTWAIT);
+		if (receivedPerStep > 0)
+		{
+			task->reactor.fixedReceived += receivedPerStep;
+		}
+		else if (receivedPerStep == 0)
+		{
+			ReportInfo("[Reactor] Connection lost");
+			return -1;
+		}
+		else if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+		{
+			return 0;
+		}
+		else if (errno != EINTR)
+		{
+			ReportError("[Reactor] Error reading from socket: errno=%d", errno);
+			SetTaskStatus(task, TaskStatusReadFromSocketFailed);
+			return -1;
+		}
+	}
+
+	return 1;
+}
+
+/**
+ * ExpectFixedPart()
+ * Switch the task to a state in which a fixed size part is to be received.
+ */
+static void
+ExpectFixedPart(
+	struct Task		*task,
+	int				state,
+	void			*data,
+	size_t			size)
+{
+	task->reactor.state = state;
+	task->reactor.fixedData = (char *) data;
+	task->reactor.fixedSize = size;
+	task->reactor.fixedReceived = 0;
+}
+
+/**
+ * NewPaquet()
+ * Take a buffer for the next paquet of a task and expect its pilot.
+ *
+ * Returns 0 upon successful completion or -1, in case of error.
+ */
+static int
+NewPaquet(struct Task *task)
+{
+	struct MMPS_Buffer	*paquetBuffer;
+	struct Paquet		*paquet;
+
+	// Reactor cannot wait for a buffer to be given back.
+	//
+	paquetBuffer = MMPS_PeekBuffer(chalkboard->pools.paquet, BUFFER_DIALOGUE_PAQUET);
+	if (paquetBuffer == NULL)
+	{
+		ReportSoftAlert("[Reactor] Out of memory");
+		SetTaskStatus(task, TaskStatusOutOfMemory);
+		return -1;
+	}
+
+	paquet = (struct Paquet *) paquetBuffer->data;
+	paquet->containerBuffer = paquetBuffer;
+
+	paquet->task = task;
+	paquet->nextInChain = NULL;
+	paquet->inputBuffer = NULL;
+	paquet->outputBuffer = NULL;
+	paquet->pilot = paquetBuffer->follower;
+
+	task->reactor.paquet = paquet;
+
+	ExpectFixedPart(task,
+		TaskStatePilot,
+		paquet->pilot,
+		sizeof(struct PaquetPilot));
+
+	return 0;
+}
+
+/**
+ * DispatchPaquet()
+ * Hand a completely received paquet over to be processed
+ * and expect the next one.
+ *
+ * Returns 0 upon successful completion or -1, in case of error.
+ */
+static int
+DispatchPaquet(struct Task *task)
+{
+	struct Paquet	*paquet = task->reactor.paquet;
+	int				rc;
+
+	paquet->inputBuffer = task->reactor.receiveBuffer;
+
+	task->reactor.paquet = NULL;
+	task->reactor.receiveBuffer = NULL;
+	task->reactor.state = TaskStatePilot;
+
+#ifdef ANTICIPANT_DIALOGUE_REGULAR
+	ReportInfo("[Reactor] Received paquet %u with command 0x%08X (payload %d bytes)",
+		paquet->paquetId,
+		paquet->commandCode,
+		paquet->payloadSize);
+#endif
+
+	rc = StartPaquet(paquet);
+	if (rc != 0)
+	{
+		ReportError("[Reactor] Cannot start paquet: rc=%d", rc);
+		SetTaskStatus(task, TaskStatusCannotCreatePaquetThread);
+
+		MMPS_PokeBuffer(paquet->inputBuffer);
+		MMPS_PokeBuffer(paquet->containerBuffer);
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * ResumeTask()
+ * Arm the socket of a task for its next event.
+ *
+ * Returns ReactorRearm upon successful completion or ReactorClose,
+ * in case of error.
+ */
+static int
+ResumeTask(struct Task *task)
+{
+	struct epoll_event	event;
+	struct Reactor		*reactor;
+	int					rc;
+
+	reactor = &chalkboard->reactors.list[task->reactor.reactorId];
+
+	event.events = REACTOR_EVENTS;
+	event.data.ptr = task;
+
+#ifdef OUTPUT_QUEUE
+	if (__atomic_load_n(&task->xmit.outputBlocked, __ATOMIC_SEQ_CST))
+		event.events |= EPOLLOUT;
+#endif
+
+	rc = epoll_ctl(reactor->epollFD, EPOLL_CTL_MOD, task->xmit.sockFD, &event);
+	if (rc != 0)
+	{
+		ReportError("[Reactor] Cannot rearm socket: errno=%d", errno);
+		return ReactorClose;
+	}
+
+#ifdef OUTPUT_QUEUE
+	// A paquet thread may have found the socket full and armed it
+	// for output just before it has been armed here for input only.
+	//
+	if (!(event.events & EPOLLOUT) &&
+			__atomic_load_n(&task->xmit.outputBlocked, __ATOMIC_SEQ_CST))
+		return ResumeTask(task);
+#endif
+
+	return ReactorRearm;
+}
+
+/**
+ * WatchTaskOutput()
+ * Rearm the socket of a task for input and output.
+ *
+ * Returns 0 upon successful completion or -1, in case of error.
+ */
+int
+WatchTaskOutput(struct Task *task)
+{
+	return (ResumeTask(task) == ReactorRearm) ? 0 : -1;
+}
+
+/**
+ * DetachTask()
+ * Take the socket of a task out of its reactor.
+ */
+static void
+DetachTask(struct Task *task)
+{
+	struct Reactor		*reactor;
+	int					rc;
+
+	reactor = &chalkboard->reactors.list[task->reactor.reactorId];
+
+	rc = epoll_ctl(reactor->epollFD, EPOLL_CTL_DEL, task->xmit.sockFD, NULL);
+	if (rc != 0)
+		ReportError("[Reactor] Cannot remove socket from reactor: errno=%d", errno);
+}
+
+/**
+ * StartWorker()
+ * Start a detached thread to do the blocking part of a dialogue.
+ *
+ * Returns 0 upon successful completion or an error code, in case of error.
+ */
+static int
+StartWorker(void *(*routine)(void *), struct Task *task)
+{
+	pthread_attr_t		attr;
+	pthread_t			thread;
+	int					rc;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+	rc = pthread_create(&thread, &attr, routine, task);
+	if (rc != 0)
+		ReportError("[Reactor] Cannot create worker thread: rc=%d", rc);
+
+	pthread_attr_destroy(&attr);
+
+	return rc;
+}
+
+/**
+ * AuthentifyThread()
+ * Authentify a regular dialogue, send the verdict and let the reactor
+ * receive paquets of the task.
+ *
+ * @arg:		Pointer to task.
+ */
+static void *
+AuthentifyThread(void *arg)
+{
+	struct Task	*task = (struct Task *) arg;
+	int			rc;
+
+	AuthentifyDialogue(task);
+
+	ReportInfo("[Reactor] Regular dialogue begin");
+
+	rc = SetSessionOnline(task);
+	if (rc < 0)
+	{
+		ReportError("[Reactor] Cannot set session online");
+		SetTaskStatus(task, TaskStatusCannotSetSessionOnline);
+	}
+
+	task->reactor.sessionOnline = 1;
+
+	if (GetTaskStatus(task) == TaskStatusGood)
+	{
+		task->reactor.state = TaskStatePilot;
+
+		if (ResumeTask(task) == ReactorRearm)
+			return NULL;
+	}
+
+	DetachTask(task);
+	CloseTask(task);
+
+	return NULL;
+}
+
+/**
+ * AnticipantThread()
+ * Register the device of an anticipant dialogue and close the task.
+ *
+ * @arg:		Pointer to task.
+ */
+static void *
+AnticipantThread(void *arg)
+{
+	struct Task	*task = (struct Task *) arg;
+
+	RegisterAnticipant(task,
+		(struct DialogueAnticipant *) task->reactor.receiveBuffer->data);
+
+	ReportInfo("[Reactor] Anticipant dialogue end");
+
+	DetachTask(task);
+	CloseTask(task);
+
+	return NULL;
+}
+
+/**
+ * CloseThread()
+ * Close a task the reactor has given up.
+ *
+ * @arg:		Pointer to task.
+ */
+static void *
+CloseThread(void *arg)
+{
+	CloseTask((struct Task *) arg);
+
+	return NULL;
+}
+
+/**
+ * CloseTask()
+ * Give back what the task holds for receive, set its session offline
+ * and release the task. Task must not be attached to its reactor any more.
+ */
+static void
+CloseTask(struct Task *task)
+{
+	int			rc;
+
+	if (task->reactor.paquet != NULL)
+	{
+		MMPS_PokeBuffer(task->reactor.paquet->containerBuffer);
+		task->reactor.paquet = NULL;
+	}
+
+	if (task->reactor.receiveBuffer != NULL)
+	{
+		MMPS_PokeBuffer(task->reactor.receiveBuffer);
+		task->reactor.receiveBuffer = NULL;
+	}
+
+	if (task->reactor.sessionOnline != 0)
+	{
+		rc = SetSessionOffline(task);
+		if (rc < 0)
+		{
+			ReportError("[Reactor] Cannot set session offline");
+			SetTaskStatus(task, TaskStatusCannotSetSessionOffline);
+		}
+
+		ReportInfo("[Reactor] Regular dialogue end");
+	}
+
+	long taskStatus = GetTaskStatus(task);
+	if (taskStatus == TaskStatusGood) {
+       	ReportInfo("[Reactor] Task complete");
+	} else {
+	    int commonStatus = taskStatus & 0xFFFFFFFF;
+	    int communicationStatus = taskStatus >> 32;
+       	ReportInfo("[Reactor] Task cancelled with status 0x%08X:%08X",
+       	    communicationStatus, commonStatus);
+    }
+
+	TaskCleanup(task);
+}
+
+#endif // TASK_REACTOR
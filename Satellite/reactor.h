@@ -0,0 +1,60 @@
+#pragma once
+
+#include <pthread.h>
+
+#include "tasks.h"
+
+/**
+ * Maximal number of events a reactor takes from epoll at once.
+ */
+#define REACTOR_EVENTS_PER_WAIT                 64
+
+/**
+ * Reactor id to let AttachTaskToReactor() choose the reactor.
+ */
+#define ANY_REACTOR                             -1
+
+struct Reactor
+{
+	pthread_t			thread;
+	int					reactorId;
+	int					epollFD;
+};
+
+/**
+ * StartReactors()
+ * Start one reactor thread per online CPU. Each reactor owns the sockets
+ * of its tasks through epoll and receives dialogue demande, anticipant
+ * record and paquets as they arrive. Complete units are handed to threads
+ * that live only while they are processed.
+ *
+ * Returns 0 upon successful completion or -1, in case of error.
+ */
+int
+StartReactors(void);
+
+/**
+ * AttachTaskToReactor()
+ * Hand the socket of a new task to a reactor, which waits
+ * for its dialogue demande.
+ *
+ * @task:
+ * @reactorId:		Reactor to serve the task or ANY_REACTOR
+ *					to take the next one in turn.
+ *
+ * Returns 0 upon successful completion or -1, in case of error.
+ */
+int
+AttachTaskToReactor(struct Task *task, int reactorId);
+
+/**
+ * WatchTaskOutput()
+ * Let the reactor of a task wait, besides input, for its socket
+ * to take more output.
+ *
+ * @task:
+ *
+ * Returns 0 upon successful completion or -1, in case of error.
+ */
+int
+WatchTaskOutput(struct Task *task);
@@ -154,16 +154,28 @@ DialogueAnticipant(struct Task *task)
         return;
     }
 
-    char deviceToken[API_TokenBinarySize];
-    rc = RegisterDevice(task, &anticipant, (char *) &deviceToken);
+    rc = RegisterAnticipant(task, &anticipant);
     if (rc != 0)
         return;
 
+    ReportInfo("[TaskKernel] Anticipant dialogue end");
+}
+
+int
+RegisterAnticipant(struct Task *task, struct DialogueAnticipant *anticipant)
+{
+    int rc;
+
+    char deviceToken[API_TokenBinarySize];
+    rc = RegisterDevice(task, anticipant, (char *) &deviceToken);
+    if (rc != 0)
+        return rc;
+
     rc = SendFixed(task, (char *) &deviceToken, sizeof(deviceToken));
     if (rc != 0)
-        return;
+        return rc;
 
-    ReportInfo("[TaskKernel] Anticipant dialogue end");
+    return 0;
 }
 
 void
@@ -171,7 +183,10 @@ DialogueRegular(struct Task *task)
 {
     int rc;
 
-    struct MMPS_Buffer *receiveBuffer = NULL;
+    // Data received but not yet taken as paquets. It holds at most the
+    // beginning of one paquet while the next receive is waiting.
+    //
+    struct MMPS_Buffer *frames = NULL;
 
     ReportInfo("[TaskKernel] Regular dialogue begin");
 
@@ -188,175 +203,69 @@ DialogueRegular(struct Task *task)
     {
         ReportInfo("[TaskKernel] Dialoque loop");
 
-        struct MMPS_Buffer *paquetBuffer;
-
-        // Get a buffer for new paquet.
-        //
-        paquetBuffer = MMPS_PeekBuffer(chalkboard->pools.paquet, BUFFER_DIALOGUE_PAQUET);
-        if (paquetBuffer == NULL)
-        {
-            ReportSoftAlert("[TaskKernel] Out of memory");
-            SetTaskStatus(task, TaskStatusOutOfMemory);
-            break;
-        }
-
-        paquet = (struct Paquet *) paquetBuffer->data;
-        paquet->containerBuffer = paquetBuffer;
-
-        paquet->task = task;
-        paquet->nextInChain = NULL;
-        paquet->inputBuffer = NULL;
-        paquet->outputBuffer = NULL;
-        paquet->pilot = paquetBuffer->follower;
-
-        int receiveNeeded;
-
-        // If there is no rest data from previous receive then allocate a new buffer and start receive.
-        //
-        if (receiveBuffer == NULL)
+        if (paquet == NULL)
         {
-            receiveBuffer = MMPS_PeekBufferOfSize(chalkboard->pools.dynamic,
-                KB,
-                BUFFER_DIALOGUE_FIRST);
+            struct MMPS_Buffer *paquetBuffer;
 
-            if (receiveBuffer == NULL)
+            // Get a buffer for new paquet. If all of them are in use,
+            // wait a little for one to be given back.
+            //
+            paquetBuffer = MMPS_PeekBufferTimed(chalkboard->pools.paquet, 0,
+                BUFFER_DIALOGUE_PAQUET,
+                PAQUET_BUFFER_WAIT_TIMEOUT);
+            if (paquetBuffer == NULL)
             {
+                ReportSoftAlert("[TaskKernel] Out of memory");
                 SetTaskStatus(task, TaskStatusOutOfMemory);
                 break;
             }
 
-            receiveNeeded = 1;
-        }
-        else
-        {
-            // If there is rest of data from previous receive available then check
-            // whether a complete paquet content is already available.
-
-            struct PaquetPilot *pilot = (struct PaquetPilot *) paquet->pilot;
-            uint32 payloadSize = be32toh(pilot->payloadSize);
+            paquet = (struct Paquet *) paquetBuffer->data;
+            paquet->containerBuffer = paquetBuffer;
 
-            // Receive is needed if rest of data contains only a part of paquet.
-            //
-            if (MMPS_TotalDataSize(receiveBuffer) < payloadSize)
-            {
-                receiveNeeded = 1;
-            }
-            else
-            {
-                //
-                // Otherwise complete paquet is available already from previous receive.
-                // In such case receive should be skipped.
-                //
-                receiveNeeded = 0;
-                FillPaquetWithPilotData(paquet);
-            }
+            paquet->task = task;
+            paquet->nextInChain = NULL;
+            paquet->inputBuffer = NULL;
+            paquet->outputBuffer = NULL;
+            paquet->pilot = paquetBuffer->follower;
         }
 
-        if (receiveNeeded != 0)
+        // Take the next paquet out of data received so far. Only if it is
+        // not complete, receive whatever is available, which may carry
+        // several paquets at once.
+        //
+        rc = TakePaquetFromFrames(paquet, &frames);
+        if (rc < 0)
+            break;
+
+        if (rc == 0)
         {
-            rc = ReceivePaquet(paquet, receiveBuffer);
+            rc = ReceiveFrames(task, &frames);
             if (rc != 0)
                 break;
-        }
 
-        int totalReceivedData = MMPS_TotalDataSize(receiveBuffer);
+            continue;
+        }
 
 #ifdef ANTICIPANT_DIALOGUE_REGULAR
-        ReportInfo("[TaskKernel] Received paquet  %u with command 0x%08X with %d bytes (payload %d bytes)",
+        ReportInfo("[TaskKernel] Received paquet  %u with command 0x%08X (payload %d bytes)",
                 paquet->paquetId,
                 paquet->commandCode,
-                totalReceivedData,
                 paquet->payloadSize);
 #endif
 
-        if (totalReceivedData < paquet->payloadSize)
-        {
-            //
-            // If amount of data in receive buffer is less then necessary for current paquet
-            // then quit with error.
-            //
-            ReportInfo("[TaskKernel] Received data incomplete");
-
-            SetTaskStatus(task, TaskStatusReceivedDataIncomplete);
-            MMPS_PokeBuffer(receiveBuffer);
-            receiveBuffer = NULL;
-            break;
-        }
-        else if (totalReceivedData == paquet->payloadSize)
-        {
-            ReportInfo("[TaskKernel] Received complete paquet");
-
-            // If amount of data in receive buffer is exactly what is necessary for current paquet
-            // associate receive buffer to paquet and reset pointer to receive buffer so
-            // that a new buffer will be allocated on next loop.
-            //
-            paquet->inputBuffer = receiveBuffer;
-            receiveBuffer = NULL;
-        }
-        else
-        {
-            ReportInfo("[TaskKernel] Received part of paquet");
-
-            // If amount of received data is greater than necessary for current paquet
-            // then cut off the rest of data from current paquet and move if
-            // to a separate buffer, that would be used on next loop.
-
-            // First associate receive buffer to current paquet.
-            //
-            paquet->inputBuffer = receiveBuffer;
-
-            // Then truncate the buffer.
-            //
-            struct MMPS_Buffer *sliceDataBuffer = receiveBuffer;
-            int paquetDataRest = paquet->payloadSize;
-            while (sliceDataBuffer->next != NULL)
-            {
-                paquetDataRest -= sliceDataBuffer->dataSize;
-                sliceDataBuffer = sliceDataBuffer->next;
-            }
-
-            // Allocate new receive buffer to be used on next loop.
-            //
-            receiveBuffer = MMPS_PeekBufferOfSize(
-                    chalkboard->pools.dynamic,
-                    KB,
-                    BUFFER_DIALOGUE_FOLLOWING);
-            if (receiveBuffer == NULL)
-            {
-                SetTaskStatus(task, TaskStatusOutOfMemory);
-                break;
-            }
-
-            // Move the rest of data from current paquet to a new receive buffer.
-            //
-            int sizeOfRestOfData = sliceDataBuffer->dataSize - paquetDataRest;
-            memcpy(receiveBuffer->data,
-                    sliceDataBuffer->data + paquetDataRest,
-                    sizeOfRestOfData);
-            receiveBuffer->dataSize = sizeOfRestOfData;
-
-            // Cut the rest of data from current paquet.
-            //
-            sliceDataBuffer->dataSize = paquetDataRest;
-        }
-
-        // Start new thread to process current paquet.
+        // Hand current paquet over to be processed.
         //
-        rc = pthread_create(&paquet->thread, NULL, &PaquetThread, paquet);
+        rc = StartPaquet(paquet);
         if (rc == 0)
         {
             paquet = NULL;
         }
         else
         {
-            ReportError("[TaskKernel] Cannot create paquet thread: errno=%d", errno);
+            ReportError("[TaskKernel] Cannot start paquet: rc=%d", rc);
 
             SetTaskStatus(task, TaskStatusCannotCreatePaquetThread);
-/*
-            if (receiveBuffer != NULL)
-                MMPS_PokeBuffer(receiveBuffer);
-            MMPS_PokeBuffer(paquet->inputBuffer);
-*/
             break;
         }
     }
@@ -372,10 +281,10 @@ DialogueRegular(struct Task *task)
         MMPS_PokeBuffer(paquet->containerBuffer);
     }
 
-    // Release ressources of temporary receive buffer in case something went wrong.
+    // Release data received but not taken as paquets.
     //
-    if (receiveBuffer != NULL)
-        MMPS_PokeBuffer(receiveBuffer);
+    if (frames != NULL)
+        MMPS_PokeBuffer(frames);
 
     rc = SetSessionOffline(task);
     if (rc < 0)
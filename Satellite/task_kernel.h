@@ -1,10 +1,15 @@
 #pragma once
 
+#include "anticipant.h"
+
 int
 AuthentifyDialogue(struct Task *task);
 
 void
 DialogueAnticipant(struct Task *task);
 
+int
+RegisterAnticipant(struct Task *task, struct DialogueAnticipant *anticipant);
+
 void
 DialogueRegular(struct Task *task);
@@ -1,6 +1,7 @@
 #include <c.h>
 #include <errno.h>
 #include <poll.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
@@ -12,10 +13,14 @@
 
 #include "chalkboard.h"
 #include "paquet.h"
+#ifdef TASK_REACTOR
+#include "reactor.h"
+#endif
 #include "report.h"
 #include "tasks.h"
 #include "task_kernel.h"
 #include "task_xmit.h"
+#include "uring.h"
 
 // Take a pointer to chalkboard. Chalkboard must be initialized
 // before any routine of this module could be called.
@@ -39,6 +44,102 @@ extern struct Chalkboard *chalkboard;
 //#define TIMEOUT_ON_WAIT_FOR_TRANSMIT_4KB		 1		    // Seconds per 4 KB
 //#define TIMEOUT_ON_WAIT_FOR_TRANSMIT_MAX		10		    // Seconds maximal
 
+// Received data is framed into paquets in chains of buffers of this size.
+// Each receive takes as much as is available up to the framing receive size,
+// a larger paquet is received in several steps.
+//
+#define FRAMING_BUFFER_SIZE						4 * KB
+#define FRAMING_RECEIVE_SIZE					16 * KB
+
+// Maximal number of elements of gather list sent by one io_uring request.
+//
+#define URING_SEND_VECTOR_LENGTH				64
+
+static int
+ReserveFrameSpace(struct MMPS_Buffer *frames);
+
+static int
+ReceiveFramesClassic(
+	struct Task *task,
+	struct MMPS_Buffer **frames,
+	size_t bytesWanted);
+
+#ifdef OUTPUT_QUEUE
+/**
+ * Response of a paquet waiting in the output queue of its task.
+ * It lives in a buffer of its own and owns the output buffer chain
+ * of the paquet, so that the paquet may be released before it is sent.
+ */
+struct PaquetOutput
+{
+	struct PaquetOutput	*next;
+	struct MMPS_Buffer	*containerBuffer;
+	struct MMPS_Buffer	*chain;
+	struct PaquetPilot	pilot;
+};
+
+// Gather list of a drain lives in a buffer of this size,
+// which limits the number of elements sent by one system call.
+//
+#define OUTPUT_VECTOR_BUFFER_SIZE				4 * KB
+#define OUTPUT_QUEUE_VECTORS					(OUTPUT_VECTOR_BUFFER_SIZE / sizeof(struct iovec))
+
+// Results of sending the output queue besides success and error.
+//
+#define OutputSocketFull						1
+
+static int
+QueuePaquetOutput(struct Paquet *paquet);
+
+static void
+FlushOutputQueue(struct Task *task);
+
+static int
+DrainOutputQueue(struct Task *task);
+
+static struct PaquetOutput *
+TakeOutputQueue(struct Task *task);
+
+static int
+SendOutputs(struct Task *task);
+
+static unsigned int
+FillOutputVector(
+	struct Task *task,
+	struct iovec *vector,
+	int *complete);
+
+static void
+AdvanceOutputs(struct Task *task, size_t sent);
+
+#ifndef TASK_REACTOR
+static int
+WaitForOutputSpace(struct Task *task);
+#endif
+
+static void
+ReleaseOutputs(struct PaquetOutput *outputs);
+#endif
+
+#ifdef IO_URING_XMIT
+static int
+ReceiveFixedFromStream(
+	struct Task *task,
+	char *buffer,
+	ssize_t expectedSize);
+
+static int
+SendByUring(
+	struct Task *task,
+	struct iovec *vector,
+	unsigned int vectorLength);
+
+#ifndef OUTPUT_QUEUE
+static int
+SendPaquetByUring(struct Paquet *paquet);
+#endif
+#endif
+
 #ifdef DUPLEX
 #define ReceiveMutexLock(task)          pthread_mutex_lock(&task->xmit.receiveMutex);
 #define ReceiveMutexUnlock(task)        pthread_mutex_unlock(&task->xmit.receiveMutex);
@@ -80,6 +181,11 @@ ReceiveFixed(
 	ssize_t				receivedPerStep;
 	ssize_t				receivedTotal;
 
+#ifdef IO_URING_XMIT
+	if (task->xmit.stream != NULL)
+		return ReceiveFixedFromStream(task, buffer, expectedSize);
+#endif
+
     ReceiveMutexLock(task);
 
 	pollFD.fd = sockFD;
@@ -147,6 +253,17 @@ SendFixed(
 	ssize_t				sentPerStep;
 	ssize_t				sentTotal;
 
+#ifdef IO_URING_XMIT
+	struct iovec		vector;
+
+	if (chalkboard->uring != NULL) {
+		vector.iov_base = buffer;
+		vector.iov_len = bytesToSend;
+
+		return SendByUring(task, &vector, 1);
+	}
+#endif
+
     SendMutexLock(task);
 
 	pollFD.fd = sockFD;
@@ -202,259 +319,478 @@ SendFixed(
 	return 0;
 }
 
+/**
+ * CheckPaquetPilot()
+ * Check signature and payload size of a received pilot. Payload size
+ * comes from the client, it must not claim more memory than any paquet needs.
+ *
+ * @paquet:
+ *
+ * Returns 0 if pilot is valid or -1 otherwise.
+ */
 int
-ReceivePaquet(struct Paquet *paquet, struct MMPS_Buffer *receiveBuffer)
+CheckPaquetPilot(struct Paquet *paquet)
 {
 	struct Task			*task = paquet->task;
-	struct pollfd		*pollFD = &paquet->pollFD;
-	int                 sockFD = task->xmit.sockFD;
-	ssize_t				receivedPerStep;
-	ssize_t				receivedPerBuffer;
-	ssize_t				receivedTotal;
-	ssize_t				toReceivePerBuffer;
-	ssize_t				toReceiveTotal;
-
-    ReceiveMutexLock(task);
-
-	pollFD->fd = sockFD;
-	pollFD->events = POLLIN;
+	struct PaquetPilot	*pilot = (struct PaquetPilot *) paquet->pilot;
 
-	int pollRC = poll(pollFD, 1, TIMEOUT_ON_POLL_FOR_PAQUET);
-	if (pollFD->revents & (POLLERR | POLLHUP | POLLNVAL))
+	uint64 signature = be64toh(pilot->signature);
+	if (signature != API_PaquetSignature)
 	{
-        ReceiveMutexUnlock(task);
-
-		ReportError("[Xmit] Poll error on receive: revents=0x%04X", pollFD->revents);
-		SetTaskStatus(task, TaskStatusPollForReceiveFailed);
+		ReportError("[Xmit] No valid paquet signature: 0x%016lX", signature);
+		SetTaskStatus(task, TaskStatusMissingPaquetSignature);
 		return -1;
 	}
 
-	if (pollRC == 0)
+	if (paquet->payloadSize > MAXIMAL_PAYLOAD_SIZE)
 	{
-        ReceiveMutexUnlock(task);
-
-		ReportInfo("[Xmit] Wait for receive timed out");
-		SetTaskStatus(task, TaskStatusPollForReceiveTimeout);
+		ReportError("[Xmit] Payload size %u exceeds maximum of %u",
+			paquet->payloadSize,
+			MAXIMAL_PAYLOAD_SIZE);
+		SetTaskStatus(task, TaskStatusWrongPayloadSize);
 		return -1;
 	}
-	else if (pollRC != 1)
-	{
-        ReceiveMutexUnlock(task);
 
-		ReportError("[Xmit] Poll error on receive");
-		SetTaskStatus(task, TaskStatusPollForReceiveError);
-		return -1;
-	}
+	return 0;
+}
 
-	struct PaquetPilot *pilot = NULL;
+/**
+ * TakePaquetFromFrames()
+ * Take the first paquet of received data, if it is complete. Pilot is copied
+ * to the paquet, payload is split off the received data without copy and
+ * becomes input buffer of the paquet, unless it lies in several buffers
+ * and has to be copied into one. Received data keeps what follows.
+ *
+ * @paquet:
+ * @frames:        Received data, NULL if there is none.
+ *
+ * Returns 1 if paquet is taken, 0 if it is not complete yet
+ * or -1, in case of error.
+ */
+int
+TakePaquetFromFrames(
+	struct Paquet *paquet,
+	struct MMPS_Buffer **frames)
+{
+	struct Task			*task = paquet->task;
+	struct PaquetPilot	*pilot = (struct PaquetPilot *) paquet->pilot;
+	struct MMPS_Buffer	*payload;
+	struct MMPS_Buffer	*rest;
+	struct MMPS_Buffer	*contiguous;
+	size_t				receivedTotal;
+	size_t				frameSize;
 
-	struct MMPS_Buffer *buffer = receiveBuffer;
+	receivedTotal = (*frames == NULL) ? 0 : MMPS_TotalDataSize(*frames);
 
-#if 1
+	if (receivedTotal < sizeof(struct PaquetPilot))
+		return 0;
 
-	pilot = (struct PaquetPilot *) paquet->pilot;
+	MMPS_ResetCursor(*frames);
+	MMPS_GetDataFromChain(*frames, (char *) pilot, sizeof(struct PaquetPilot), NULL);
 
-	struct msghdr       message;
-    struct iovec        iov[2];
-
-    message.msg_name       = NULL;
-    message.msg_namelen    = 0;
-    message.msg_iov        = &iov[0];
-
-    message.msg_iovlen     = 1;
-    message.msg_control    = NULL;
-    message.msg_controllen = 0;
-    iov[0].iov_len = sizeof(struct PaquetPilot);
-    iov[0].iov_base = pilot;
-	receivedTotal = recvmsg(sockFD, &message, 0);
-    if (receivedTotal < 0)
-    {
-        ReceiveMutexUnlock(task);
+	FillPaquetWithPilotData(paquet);
 
-        ReportError("[Xmit] Error has occurred on receive: errno=%d", errno);
+	if (CheckPaquetPilot(paquet) != 0)
+		return -1;
 
-        return -1;
-    }
+	frameSize = sizeof(struct PaquetPilot) + paquet->payloadSize;
 
-    // If nothing is received, then the connection is closed.
-    // Just quit, let the main socket be able to accept new connection.
-    //
-    if (receivedTotal == 0)
-    {
-        ReceiveMutexUnlock(task);
+	if (receivedTotal < frameSize)
+		return 0;
 
-        ReportInfo("[Xmit] Connection lost");
+	// Split the pilot off. If nothing follows the pilot,
+	// its buffer is emptied and serves as input buffer.
+	//
+	payload = MMPS_SplitChain(*frames, sizeof(struct PaquetPilot));
+	if (payload == NULL)
+	{
+		if (receivedTotal > sizeof(struct PaquetPilot))
+		{
+			SetTaskStatus(task, TaskStatusOutOfMemory);
+			return -1;
+		}
 
-        return -1;
-    }
+		MMPS_ResetBufferData(*frames);
 
-    ReportInfo("[Xmit] Received %lu bytes", receivedTotal);
+		paquet->inputBuffer = *frames;
+		*frames = NULL;
 
-	FillPaquetWithPilotData(paquet);
+		return 1;
+	}
 
-	uint64 signature = be64toh(pilot->signature);
-	if (signature != API_PaquetSignature)
+	MMPS_PokeBuffer(*frames);
+
+	// Split the rest of data off the payload. The rest references the same
+	// data blocks and further data is received behind it.
+	//
+	rest = MMPS_SplitChain(payload, paquet->payloadSize);
+	if ((rest == NULL) && (receivedTotal > frameSize))
 	{
-        ReceiveMutexUnlock(task);
+		MMPS_PokeBuffer(payload);
+		*frames = NULL;
 
-		ReportError("[Xmit] No valid paquet signature: 0x%016lX", signature);
-		SetTaskStatus(task, TaskStatusMissingPaquetSignature);
+		SetTaskStatus(task, TaskStatusOutOfMemory);
 		return -1;
 	}
 
-    iov[0].iov_len = paquet->payloadSize;
-    iov[0].iov_base = buffer->data;
-	receivedTotal = recvmsg(sockFD, &message, 0);
-    if (receivedTotal < 0)
-    {
-        ReceiveMutexUnlock(task);
+	*frames = rest;
+
+	// Handlers read structures straight from the input buffer, so a payload
+	// that is spread over several frame buffers is copied into one buffer.
+	//
+	if (payload->next != NULL)
+	{
+		contiguous = MMPS_PeekBufferOfSizeWithPolicy(chalkboard->pools.dynamic,
+			paquet->payloadSize,
+			MMPS_EXHAUSTION_LARGER,
+			BUFFER_DIALOGUE_FOLLOWING);
+		if ((contiguous == NULL) || (contiguous->next != NULL))
+		{
+			if (contiguous != NULL)
+				MMPS_PokeBuffer(contiguous);
 
-        ReportError("[Xmit] Error has occurred on receive: errno=%d", errno);
+			MMPS_PokeBuffer(payload);
 
-        return -1;
-    }
+			SetTaskStatus(task, TaskStatusCannotAllocateBufferForInput);
+			return -1;
+		}
 
-    // If nothing is received, then the connection is closed.
-    // Just quit, let the main socket be able to accept new connection.
-    //
-    if (receivedTotal == 0)
-    {
-        ReceiveMutexUnlock(task);
+		MMPS_ResetCursor(payload);
+		MMPS_GetDataFromChain(payload, contiguous->data, paquet->payloadSize, NULL);
 
-        ReportInfo("[Xmit] Connection lost");
+		contiguous->dataSize = paquet->payloadSize;
+		MMPS_ResetCursor(contiguous);
 
-        return -1;
-    }
+		MMPS_PokeBuffer(payload);
+		payload = contiguous;
+	}
 
-    ReportInfo("[Xmit] Received %lu bytes", receivedTotal);
+	paquet->inputBuffer = payload;
 
-    buffer->dataSize = receivedTotal;
+	return 1;
+}
 
-#else
+/**
+ * ReceiveFrames()
+ * Receive as much data as is available behind the data received so far,
+ * at least one byte. The number of bytes received at once is limited
+ * to the framing receive size, also for a larger paquet.
+ *
+ * @task:
+ * @frames:        Received data, NULL if there is none.
+ *
+ * Returns 0 upon successful completion or -1, in case of error
+ * or if the connection is closed.
+ */
+int
+ReceiveFrames(
+	struct Task *task,
+	struct MMPS_Buffer **frames)
+{
+#ifdef IO_URING_RECEIVE
+	int					receivedTotal;
+#endif
 
-	// In case there is data already in receive buffer left from previous read...
+	// Data that has been split off completely leaves empty buffers.
 	//
-	receivedTotal = buffer->dataSize;
-	toReceiveTotal = buffer->bufferSize - buffer->dataSize;
-	receivedPerBuffer = buffer->dataSize;
-
-	for (;;)
+	if ((*frames != NULL) && (MMPS_TotalDataSize(*frames) == 0))
 	{
-		toReceivePerBuffer = toReceiveTotal - receivedTotal;
-
-		if (toReceivePerBuffer > buffer->bufferSize - receivedPerBuffer)
-			toReceivePerBuffer = buffer->bufferSize - receivedPerBuffer;
+		MMPS_PokeBuffer(*frames);
+		*frames = NULL;
+	}
 
-		do
+#ifdef IO_URING_XMIT
+	if (task->xmit.stream != NULL)
+	{
+		if (*frames == NULL)
 		{
-			receivedPerStep = read(sockFD,
-				buffer->data + receivedPerBuffer,
-				toReceivePerBuffer - receivedPerBuffer);
-			if (receivedPerStep == 0)
+			*frames = MMPS_PeekBufferOfSize(chalkboard->pools.dynamic,
+				FRAMING_BUFFER_SIZE,
+				BUFFER_DIALOGUE_FIRST);
+			if (*frames == NULL)
 			{
-                ReceiveMutexUnlock(task);
-
-				ReportError("[Xmit] Nothing read from socket");
-				SetTaskStatus(task, TaskStatusNoDataReceived);
+				SetTaskStatus(task, TaskStatusCannotAllocateBufferForInput);
 				return -1;
 			}
-			else if (receivedPerStep == -1)
-			{
-                ReceiveMutexUnlock(task);
+		}
 
-				ReportError("[Xmit] Error reading from socket for paquet: errno=%d", errno);
-				SetTaskStatus(task, TaskStatusReadFromSocketFailed);
-				return -1;
-			}
+		ReceiveMutexLock(task);
 
-			receivedPerBuffer += receivedPerStep;
+		receivedTotal = UringStreamReceiveAvailable(task->xmit.stream,
+			*frames,
+			FRAMING_RECEIVE_SIZE,
+			TIMEOUT_ON_POLL_FOR_PAQUET);
 
-			if ((pilot == NULL) && (toReceivePerBuffer >= sizeof(struct PaquetPilot)))
-			{
-				pilot = (struct PaquetPilot *) paquet->pilot;
+		ReceiveMutexUnlock(task);
 
-                memcpy(pilot, buffer->data, sizeof(struct PaquetPilot));
+		if (receivedTotal == URING_OUT_OF_MEMORY)
+		{
+			ReportError("[Xmit] Cannot extend buffer");
+			SetTaskStatus(task, TaskStatusCannotExtendBufferForInput);
+			return -1;
+		}
+		else if (receivedTotal == URING_TIMEOUT)
+		{
+			ReportInfo("[Xmit] Wait for receive timed out");
+			SetTaskStatus(task, TaskStatusPollForReceiveTimeout);
+			return -1;
+		}
+		else if (receivedTotal < 0)
+		{
+			ReportError("[Xmit] Error has occurred on receive: errno=%d", errno);
+			SetTaskStatus(task, TaskStatusReadFromSocketFailed);
+			return -1;
+		}
+		else if (receivedTotal == 0)
+		{
+			ReportInfo("[Xmit] Connection lost");
+			return -1;
+		}
 
-                if (receivedPerBuffer > sizeof(struct PaquetPilot))
-                {
-                    memcpy(buffer->data,
-                            buffer->data + sizeof(struct PaquetPilot),
-                            receivedPerBuffer - sizeof(struct PaquetPilot));
-                }
+		return 0;
+	}
+#endif
 
-				FillPaquetWithPilotData(paquet);
+#ifdef IO_URING_RECEIVE
+	// If a connection waits for its next paquet and receive buffers are lent
+	// to the kernel, then receive buffer is taken only when data arrives.
+	// Falls back to classic receive if the buffer ring has run dry.
+	//
+	if ((*frames == NULL) && (chalkboard->uring != NULL))
+	{
+		struct MMPS_Buffer	*buffer;
 
-				uint64 signature = be64toh(pilot->signature);
-				if (signature != API_PaquetSignature)
-				{
-                    ReceiveMutexUnlock(task);
+		ReceiveMutexLock(task);
 
-					ReportError("[Xmit] No valid paquet signature: 0x%016lX", signature);
-					SetTaskStatus(task, TaskStatusMissingPaquetSignature);
-					return -1;
-				}
+		receivedTotal = UringReceive(chalkboard->uring,
+			task->xmit.sockFD,
+			FRAMING_RECEIVE_SIZE,
+			TIMEOUT_ON_POLL_FOR_PAQUET,
+			&buffer);
 
-				toReceiveTotal = sizeof(struct PaquetPilot) + paquet->payloadSize;
+		ReceiveMutexUnlock(task);
 
-				if (paquet->payloadSize < buffer->bufferSize)
-					toReceivePerBuffer = paquet->payloadSize;
-			}
+		if (receivedTotal > 0)
+		{
+			*frames = buffer;
+			return 0;
+		}
+		else if (receivedTotal == URING_TIMEOUT)
+		{
+			ReportInfo("[Xmit] Wait for receive timed out");
+			SetTaskStatus(task, TaskStatusPollForReceiveTimeout);
+			return -1;
+		}
+		else if (receivedTotal == 0)
+		{
+			ReportInfo("[Xmit] Connection lost");
+			return -1;
+		}
+		else if (receivedTotal != URING_NO_BUFFERS)
+		{
+			ReportError("[Xmit] Error has occurred on receive: errno=%d", errno);
+			SetTaskStatus(task, TaskStatusReadFromSocketFailed);
+			return -1;
+		}
+	}
+#endif
+
+	return ReceiveFramesClassic(task, frames, FRAMING_RECEIVE_SIZE);
+}
+
+/**
+ * ReceiveFramesClassic()
+ * Wait until the socket is readable and only then take space for the data,
+ * so that a connection waiting for its next paquet holds no more buffers
+ * than the beginning of a paquet it has received already.
+ *
+ * @task:
+ * @frames:
+ * @bytesWanted:
+ */
+static int
+ReceiveFramesClassic(
+	struct Task *task,
+	struct MMPS_Buffer **frames,
+	size_t bytesWanted)
+{
+	struct pollfd		pollFD;
+	struct MMPS_Buffer	*buffer;
+	int                 sockFD = task->xmit.sockFD;
+	ssize_t				receivedTotal;
+	int					reserved = 0;
+	int					rc;
+
+    ReceiveMutexLock(task);
+
+	for (;;)
+	{
+		pollFD.fd = sockFD;
+		pollFD.events = POLLIN;
+
+		int pollRC = poll(&pollFD, 1, TIMEOUT_ON_POLL_FOR_PAQUET);
+		if (pollFD.revents & (POLLERR | POLLNVAL))
+		{
+			ReceiveMutexUnlock(task);
+
+			ReportError("[Xmit] Poll error on receive: revents=0x%04X", pollFD.revents);
+			SetTaskStatus(task, TaskStatusPollForReceiveFailed);
+			return -1;
+		}
+
+		if (pollRC == 0)
+		{
+			ReceiveMutexUnlock(task);
+
+			ReportInfo("[Xmit] Wait for receive timed out");
+			SetTaskStatus(task, TaskStatusPollForReceiveTimeout);
+			return -1;
 		}
-		while (receivedPerBuffer < toReceivePerBuffer);
+		else if (pollRC != 1)
+		{
+			if (errno == EINTR)
+				continue;
 
-		buffer->dataSize = receivedPerBuffer;
+			ReceiveMutexUnlock(task);
 
-		receivedTotal += receivedPerBuffer;
+			ReportError("[Xmit] Poll error on receive");
+			SetTaskStatus(task, TaskStatusPollForReceiveError);
+			return -1;
+		}
 
-		if (receivedTotal < toReceiveTotal)
+		if (reserved == 0)
 		{
-		    struct MMPS_Pool *pool = chalkboard->pools.dynamic;
-			struct MMPS_Buffer *nextBuffer =
-			    MMPS_PeekBufferOfSize(pool, toReceiveTotal - receivedTotal, BUFFER_XMIT);
+			if (*frames == NULL)
+			{
+				*frames = MMPS_PeekBufferOfSize(chalkboard->pools.dynamic,
+					FRAMING_BUFFER_SIZE,
+					BUFFER_DIALOGUE_FIRST);
+				if (*frames == NULL)
+				{
+					ReceiveMutexUnlock(task);
+
+					SetTaskStatus(task, TaskStatusCannotAllocateBufferForInput);
+					return -1;
+				}
+			}
 
-			if (nextBuffer == NULL)
+			rc = ReserveFrameSpace(*frames);
+			if (rc != 0)
 			{
-                ReceiveMutexUnlock(task);
+				ReceiveMutexUnlock(task);
 
-				ReportError("[Xmit] Cannot extend buffer");
 				SetTaskStatus(task, TaskStatusCannotExtendBufferForInput);
 				return -1;
 			}
 
-			buffer->next = nextBuffer;
-			buffer = nextBuffer;
-		} else {
-			break;
+			reserved = 1;
 		}
 
-		receivedPerBuffer = 0;
+		receivedTotal = MMPS_ReceiveIntoChainWithFlags(sockFD,
+			*frames,
+			bytesWanted,
+			MSG_DONTWAIT);
+		if ((receivedTotal != MMPS_SOCKET_ERROR) ||
+				((errno != EAGAIN) && (errno != EWOULDBLOCK)))
+			break;
 	}
 
-	if (receivedTotal < sizeof(struct PaquetPilot))
-	{
-        ReceiveMutexUnlock(task);
+    ReceiveMutexUnlock(task);
 
-		ReportError("[Xmit] Missing paquet pilot (received %d bytes only)", (int)receivedTotal);
-		SetTaskStatus(task, TaskStatusMissingPaquetPilot);
+	if (receivedTotal == MMPS_OUT_OF_MEMORY)
+	{
+		ReportError("[Xmit] Cannot extend buffer");
+		SetTaskStatus(task, TaskStatusCannotExtendBufferForInput);
+		return -1;
+	}
+	else if (receivedTotal < 0)
+	{
+		ReportError("[Xmit] Error has occurred on receive: errno=%d", errno);
+		SetTaskStatus(task, TaskStatusReadFromSocketFailed);
 		return -1;
 	}
+	else if (receivedTotal == 0)
+	{
+        ReportInfo("[Xmit] Connection lost");
 
-#endif
+        return -1;
+	}
 
-    ReceiveMutexUnlock(task);
+	// Give back reserved space that has not been filled.
+	//
+	for (buffer = *frames; buffer->next != NULL; buffer = buffer->next)
+	{
+		if (buffer->next->dataSize == 0)
+			break;
+	}
+
+	MMPS_TruncateChain(buffer);
+
+    ReportInfo("[Xmit] Received %ld bytes", receivedTotal);
 
 	return 0;
 }
 
+/**
+ * ReserveFrameSpace()
+ * Extend received data with framing buffers until there is space
+ * for the framing receive size behind the data.
+ *
+ * @frames:
+ */
+static int
+ReserveFrameSpace(struct MMPS_Buffer *frames)
+{
+	struct MMPS_Buffer	*buffer;
+	struct MMPS_Buffer	*lastBuffer;
+	size_t				capacity;
+
+	lastBuffer = frames;
+	for (buffer = frames; buffer != NULL; buffer = buffer->next)
+	{
+		if (buffer->dataSize != 0)
+			lastBuffer = buffer;
+	}
+
+	capacity = 0;
+	for (buffer = lastBuffer; buffer != NULL; buffer = buffer->next)
+	{
+		capacity += buffer->bufferSize - buffer->dataSize;
+		lastBuffer = buffer;
+	}
+
+	while (capacity < FRAMING_RECEIVE_SIZE)
+	{
+		buffer = MMPS_PeekBufferOfSize(chalkboard->pools.dynamic,
+			FRAMING_BUFFER_SIZE,
+			BUFFER_DIALOGUE_FIRST);
+		if (buffer == NULL)
+			return -1;
+
+		MMPS_AppendBuffer(lastBuffer, buffer);
+
+		capacity += buffer->bufferSize;
+		lastBuffer = buffer;
+	}
+
+	return 0;
+}
 int
 SendPaquet(struct Paquet *paquet)
 {
+#ifdef OUTPUT_QUEUE
+	return QueuePaquetOutput(paquet);
+#else
 	struct Task			*task = paquet->task;
 	struct pollfd		*pollFD = &paquet->pollFD;
 	int                 sockFD = task->xmit.sockFD;
-	size_t				toSendPerBuffer;
-	ssize_t				sentPerStep;
-	ssize_t				sentPerBuffer;
+	ssize_t				sentTotal;
+	ssize_t				toSendTotal;
+
+#ifdef IO_URING_XMIT
+	if (chalkboard->uring != NULL)
+		return SendPaquetByUring(paquet);
+#endif
 
     SendMutexLock(task);
 
@@ -465,7 +801,7 @@ SendPaquet(struct Paquet *paquet)
 	if (pollFD->revents & (POLLERR | POLLHUP | POLLNVAL)) {
         SendMutexUnlock(task);
 
-		ReportError("[Xmit] Poll error on send: 0x%04X", pollFD->revents);
+		ReportError("[Xmit] Poll error on send: 0x%04X", pollFD->revents);
 		SetTaskStatus(task, TaskStatusPollForSendFailed);
 		return -1;
 	}
@@ -473,13 +809,13 @@ SendPaquet(struct Paquet *paquet)
 	if (pollRC == 0) {
         SendMutexUnlock(task);
 
-		ReportInfo("[Xmit] Wait for send timed out");
+		ReportInfo("[Xmit] Wait for send timed out");
 		SetTaskStatus(task, TaskStatusPollForSendTimeout);
 		return -1;
 	} else if (pollRC != 1) {
         SendMutexUnlock(task);
 
-		ReportError("[Xmit] Poll error on send");
+		ReportError("[Xmit] Poll error on send");
 		SetTaskStatus(task, TaskStatusPollForSendError);
 		return -1;
 	}
@@ -488,103 +824,710 @@ SendPaquet(struct Paquet *paquet)
 	if (buffer == NULL) {
         SendMutexUnlock(task);
 
-		ReportError("[Xmit] No output buffer provided");
+		ReportError("[Xmit] No output buffer provided");
 		SetTaskStatus(task, TaskStatusNoOutputDataProvided);
 		return -1;
 	}
 
 	struct PaquetPilot *pilot = (struct PaquetPilot *) paquet->pilot;
 
-#if 1
-
 	pilot->signature = htobe64(API_PaquetSignature);
 	pilot->paquetId = htobe32(paquet->paquetId);
 	pilot->commandCode = htobe32(paquet->commandCode);
 	pilot->payloadSize = htobe32(MMPS_TotalDataSize(buffer));
 
-	struct msghdr       message;
-    struct iovec        iov[XMIT_MAX_NUMBER_OF_VECTORS];
-
-    message.msg_name       = NULL;
-    message.msg_namelen    = 0;
-    message.msg_iov        = &iov[0];
-
-    message.msg_iovlen     = 1;
-    message.msg_control    = NULL;
-    message.msg_controllen = 0;
-    iov[0].iov_len = sizeof(struct PaquetPilot);
-    iov[0].iov_base = pilot;
-
-    if (MMPS_TotalDataSize(buffer) > 0)
-    {
-        unsigned int vectorId = 1;
-        while (buffer != NULL)
-        {
-        	if (buffer->dataSize == 0)
-        		break;
-
-        	iov[vectorId].iov_len = buffer->dataSize;
-        	iov[vectorId].iov_base = buffer->data;
-        	vectorId++;
-        	message.msg_iovlen++;
-        	buffer = buffer->next;
-
-            if (message.msg_iovlen == XMIT_MAX_NUMBER_OF_VECTORS)
-            {
-                break;
-            }
-        }
-    }
-
-	sentPerStep = sendmsg(sockFD, &message, 0);
-    if (sentPerStep < 0)
-    {
-        ReceiveMutexUnlock(task);
+	// Pilot and the whole output buffer chain go with one gather list.
+	//
+	toSendTotal = sizeof(struct PaquetPilot) + MMPS_TotalDataSize(buffer);
 
-        ReportError("[Xmit] Error has occurred on send: errno=%d", errno);
+	sentTotal = MMPS_SendChainWithHeader(sockFD,
+		pilot,
+		sizeof(struct PaquetPilot),
+		buffer);
+	if (sentTotal < 0) {
+        SendMutexUnlock(task);
 
-        return -1;
-    }
+		ReportError("[Xmit] Error writing to socket: errno=%d", errno);
+		SetTaskStatus(task, TaskStatusWriteToSocketFailed);
+		return -1;
+	} else if (sentTotal < toSendTotal) {
+        SendMutexUnlock(task);
 
-    ReportInfo("[Xmit] Sent %ld bytes", sentPerStep);
+		ReportError("[Xmit] Sent %ld of %ld bytes only", sentTotal, toSendTotal);
+		SetTaskStatus(task, TaskStatusNoDataSent);
+		return -1;
+	}
 
-#else
+    ReportInfo("[Xmit] Sent %ld bytes", sentTotal);
+
+    SendMutexUnlock(task);
+
+	return 0;
+#endif
+}
+
+#ifdef IO_URING_XMIT
+/**
+ * ReceiveFixedFromStream()
+ * Read fixed size data out of multishot receive of the task.
+ * Counterpart of ReceiveFixed() without poll and read per step.
+ *
+ * @task:
+ * @buffer:
+ * @expectedSize:
+ */
+static int
+ReceiveFixedFromStream(
+	struct Task *task,
+	char *buffer,
+	ssize_t expectedSize)
+{
+	int					receivedTotal;
+
+    ReceiveMutexLock(task);
+
+	receivedTotal = UringStreamReceive(task->xmit.stream,
+		buffer,
+		expectedSize,
+		TIMEOUT_ON_POLL_FOR_PILOT);
+
+    ReceiveMutexUnlock(task);
+
+	if (receivedTotal == URING_TIMEOUT) {
+		ReportInfo("[Xmit] Wait for receive timed out");
+		SetTaskStatus(task, TaskStatusPollForReceiveTimeout);
+		return -1;
+	} else if (receivedTotal < 0) {
+		ReportError("[Xmit] Error reading from socket for fixed data: errno=%d", errno);
+		SetTaskStatus(task, TaskStatusReadFromSocketFailed);
+		return -1;
+	} else if (receivedTotal < expectedSize) {
+		ReportError("[Xmit] Nothing read from socket");
+		SetTaskStatus(task, TaskStatusNoDataReceived);
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * SendByUring()
+ * Send a gather list through io_uring. Timeout is linked to the send
+ * instead of polling the socket beforehand. Send mutex of the task
+ * must not be held.
+ *
+ * @task:
+ * @vector:
+ * @vectorLength:
+ */
+static int
+SendByUring(
+	struct Task *task,
+	struct iovec *vector,
+	unsigned int vectorLength)
+{
+	int					rc;
+
+    SendMutexLock(task);
+
+	rc = UringSend(chalkboard->uring,
+		task->xmit.sockFD,
+		vector,
+		vectorLength,
+		TIMEOUT_ON_WAIT_FOR_BEGIN_TO_TRANSMIT);
+
+    SendMutexUnlock(task);
+
+	if (rc == URING_TIMEOUT) {
+		ReportInfo("[Xmit] Wait for send timed out");
+		SetTaskStatus(task, TaskStatusPollForSendTimeout);
+		return -1;
+	} else if (rc != 0) {
+		ReportError("[Xmit] Error writing to socket: errno=%d", errno);
+		SetTaskStatus(task, TaskStatusWriteToSocketFailed);
+		return -1;
+	}
+
+	return 0;
+}
+
+#ifndef OUTPUT_QUEUE
+/**
+ * SendPaquetByUring()
+ * Send pilot and output buffer chain of a paquet through io_uring,
+ * with one request per URING_SEND_VECTOR_LENGTH buffers.
+ *
+ * @paquet:
+ */
+static int
+SendPaquetByUring(struct Paquet *paquet)
+{
+	struct Task			*task = paquet->task;
+	struct PaquetPilot	*pilot = (struct PaquetPilot *) paquet->pilot;
+	struct MMPS_Buffer	*buffer = paquet->outputBuffer;
+	struct iovec		vector[URING_SEND_VECTOR_LENGTH];
+	unsigned int		vectorLength;
+	ssize_t				toSendTotal;
+	int					rc;
+
+	if (buffer == NULL) {
+		ReportError("[Xmit] No output buffer provided");
+		SetTaskStatus(task, TaskStatusNoOutputDataProvided);
+		return -1;
+	}
 
 	pilot->signature = htobe64(API_PaquetSignature);
 	pilot->paquetId = htobe32(paquet->paquetId);
 	pilot->commandCode = htobe32(paquet->commandCode);
-	pilot->payloadSize = htobe32(MMPS_TotalDataSize(buffer) - sizeof(struct PaquetPilot));
+	pilot->payloadSize = htobe32(MMPS_TotalDataSize(buffer));
+
+	toSendTotal = sizeof(struct PaquetPilot) + MMPS_TotalDataSize(buffer);
+
+    SendMutexLock(task);
+
+	vector[0].iov_base = pilot;
+	vector[0].iov_len = sizeof(struct PaquetPilot);
+	vectorLength = 1;
+
+	rc = 0;
+
+	for (;;) {
+		if (buffer != NULL) {
+			vector[vectorLength].iov_base = buffer->data;
+			vector[vectorLength].iov_len = buffer->dataSize;
+			vectorLength++;
+
+			buffer = buffer->next;
+		}
 
+		if ((buffer == NULL) || (vectorLength == URING_SEND_VECTOR_LENGTH)) {
+			rc = UringSend(chalkboard->uring,
+				task->xmit.sockFD,
+				vector,
+				vectorLength,
+				TIMEOUT_ON_WAIT_FOR_BEGIN_TO_TRANSMIT);
+			if ((rc != 0) || (buffer == NULL))
+				break;
+
+			vectorLength = 0;
+		}
+	}
+
+    SendMutexUnlock(task);
+
+	if (rc == URING_TIMEOUT) {
+		ReportInfo("[Xmit] Wait for send timed out");
+		SetTaskStatus(task, TaskStatusPollForSendTimeout);
+		return -1;
+	} else if (rc != 0) {
+		ReportError("[Xmit] Error writing to socket: errno=%d", errno);
+		SetTaskStatus(task, TaskStatusWriteToSocketFailed);
+		return -1;
+	}
+
+    ReportInfo("[Xmit] Sent %ld bytes", toSendTotal);
+
+	return 0;
+}
+#endif
+#endif
+
+#ifdef OUTPUT_QUEUE
+/**
+ * QueuePaquetOutput()
+ * Put the response of a paquet in the output queue of its task and send
+ * the queue, unless another thread is sending it already. Output buffer
+ * chain is taken over by the queue.
+ *
+ * @paquet:
+ */
+static int
+QueuePaquetOutput(struct Paquet *paquet)
+{
+	struct Task			*task = paquet->task;
+	struct MMPS_Buffer	*containerBuffer;
+	struct PaquetOutput	*output;
+	struct PaquetOutput	*head;
+
+	if (paquet->outputBuffer == NULL) {
+		ReportError("[Xmit] No output buffer provided");
+		SetTaskStatus(task, TaskStatusNoOutputDataProvided);
+		return -1;
+	}
+
+	containerBuffer = MMPS_PeekBufferOfSize(chalkboard->pools.dynamic,
+		sizeof(struct PaquetOutput),
+		BUFFER_XMIT);
+	if (containerBuffer == NULL) {
+		SetTaskStatus(task, TaskStatusCannotAllocateBufferForOutput);
+		return -1;
+	}
+
+	output = (struct PaquetOutput *) containerBuffer->data;
+	output->containerBuffer = containerBuffer;
+	output->chain = paquet->outputBuffer;
+
+	memcpy(&output->pilot, paquet->pilot, sizeof(struct PaquetPilot));
+
+	output->pilot.signature = htobe64(API_PaquetSignature);
+	output->pilot.paquetId = htobe32(paquet->paquetId);
+	output->pilot.commandCode = htobe32(paquet->commandCode);
+	output->pilot.payloadSize = htobe32(MMPS_TotalDataSize(output->chain));
+
+	// Most responses are written into the input buffer of the paquet.
+	//
+	if (paquet->inputBuffer == paquet->outputBuffer)
+		paquet->inputBuffer = NULL;
+
+	paquet->outputBuffer = NULL;
+
+	head = __atomic_load_n(&task->xmit.outputQueue, __ATOMIC_RELAXED);
 	do {
-		toSendPerBuffer = buffer->dataSize;
-		sentPerBuffer = 0;
-		do {
-			sentPerStep = write(sockFD,
-			    buffer->data + sentPerBuffer,
-			    toSendPerBuffer);
-			if (sentPerStep == 0) {
-                SendMutexUnlock(task);
-
-				ReportError("[Xmit] Nothing written to socket");
-				SetTaskStatus(task, TaskStatusNoDataSent);
-				return -1;
-			} else if (sentPerStep == -1) {
-                SendMutexUnlock(task);
+		output->next = head;
+	} while (__atomic_compare_exchange_n(&task->xmit.outputQueue,
+			&head,
+			output,
+			0,
+			__ATOMIC_SEQ_CST,
+			__ATOMIC_RELAXED) == 0);
+
+	FlushOutputQueue(task);
+
+	return 0;
+}
+
+/**
+ * FlushOutputQueue()
+ * Send the output queue of a task if no other thread is sending it.
+ * A thread that finds the draining flag raised leaves its output
+ * to that thread and returns at once. If the socket is full, the rest
+ * is left to the reactor of the task with the draining flag still raised.
+ *
+ * @task:
+ */
+static void
+FlushOutputQueue(struct Task *task)
+{
+	int					cancelState;
+#ifdef TASK_REACTOR
+	int					rc;
+#endif
+
+	while (__atomic_exchange_n(&task->xmit.outputDraining, 1, __ATOMIC_SEQ_CST) == 0)
+	{
+		// Outputs taken from the queue must not be left behind
+		// by a cancelled paquet thread.
+		//
+		pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &cancelState);
+
+#ifdef TASK_REACTOR
+		rc = DrainOutputQueue(task);
+		if (rc == OutputSocketFull) {
+			__atomic_store_n(&task->xmit.outputBlocked, 1, __ATOMIC_SEQ_CST);
+
+			if (WatchTaskOutput(task) != 0)
+				SetTaskStatus(task, TaskStatusPollForSendError);
+
+			pthread_setcancelstate(cancelState, NULL);
+			return;
+		}
+#else
+		DrainOutputQueue(task);
+#endif
+
+		pthread_setcancelstate(cancelState, NULL);
+
+		__atomic_store_n(&task->xmit.outputDraining, 0, __ATOMIC_SEQ_CST);
+
+		// Output queued after the last look at the queue, but before the flag
+		// was lowered, would be left unsent.
+		//
+		if (__atomic_load_n(&task->xmit.outputQueue, __ATOMIC_SEQ_CST) == NULL)
+			break;
+	}
+}
+
+#ifdef TASK_REACTOR
+/**
+ * ResumeOutputQueue()
+ * Go on sending the output queue of a task whose socket has room again.
+ * Called by the reactor of the task, the draining flag is still raised.
+ *
+ * @task:
+ */
+void
+ResumeOutputQueue(struct Task *task)
+{
+	int					rc;
+
+	__atomic_store_n(&task->xmit.outputBlocked, 0, __ATOMIC_SEQ_CST);
+
+	rc = DrainOutputQueue(task);
+	if (rc == OutputSocketFull) {
+		__atomic_store_n(&task->xmit.outputBlocked, 1, __ATOMIC_SEQ_CST);
+		return;
+	}
+
+	__atomic_store_n(&task->xmit.outputDraining, 0, __ATOMIC_SEQ_CST);
+
+	if (__atomic_load_n(&task->xmit.outputQueue, __ATOMIC_SEQ_CST) != NULL)
+		FlushOutputQueue(task);
+}
+#endif
+
+/**
+ * DrainOutputQueue()
+ * Send outputs that have been taken from the queue before, then take
+ * and send the queue until it is empty. Draining flag must be raised.
+ *
+ * @task:
+ *
+ * Returns 0 if everything is sent or released or OutputSocketFull,
+ * if the socket cannot take more and the rest is kept for later.
+ */
+static int
+DrainOutputQueue(struct Task *task)
+{
+	int					rc;
+
+	for (;;)
+	{
+		if (task->xmit.outputPending == NULL) {
+			task->xmit.outputPending = TakeOutputQueue(task);
+			task->xmit.outputSent = 0;
 
-				ReportError("[Xmit] Error writing to socket: errno=%d", errno);
+			if (task->xmit.outputPending == NULL)
+				return 0;
+		}
+
+		// Task is being closed, there is nobody to answer to.
+		//
+		if (GetTaskStatus(task) != TaskStatusGood) {
+			ReleaseOutputs(task->xmit.outputPending);
+			task->xmit.outputPending = NULL;
+			continue;
+		}
+
+		rc = SendOutputs(task);
+		if (rc == OutputSocketFull)
+			return rc;
+	}
+}
+
+/**
+ * TakeOutputQueue()
+ * Take all outputs of the queue in the order they were queued.
+ *
+ * @task:
+ */
+static struct PaquetOutput *
+TakeOutputQueue(struct Task *task)
+{
+	struct PaquetOutput	*newestFirst;
+	struct PaquetOutput	*oldestFirst = NULL;
+	struct PaquetOutput	*output;
+
+	newestFirst = __atomic_exchange_n(&task->xmit.outputQueue, NULL, __ATOMIC_SEQ_CST);
+
+	while (newestFirst != NULL)
+	{
+		output = newestFirst;
+		newestFirst = output->next;
+
+		output->next = oldestFirst;
+		oldestFirst = output;
+	}
+
+	return oldestFirst;
+}
+
+/**
+ * SendOutputs()
+ * Send pilots and output buffer chains of outputs taken from the queue
+ * with as few system calls as possible and release them as they are sent.
+ * All but the last gather list go with MSG_MORE, so that the kernel packs
+ * them into full segments. Send mutex is held only for each system call.
+ *
+ * @task:
+ *
+ * Returns 0 upon successful completion, OutputSocketFull if the socket
+ * cannot take more (in reactor mode) or -1, in case of error.
+ */
+static int
+SendOutputs(struct Task *task)
+{
+	struct MMPS_Buffer	*vectorBuffer;
+	struct iovec		*vector = NULL;
+	struct msghdr		message;
+	unsigned int		vectorLength;
+	ssize_t				sentPerStep;
+	int					complete;
+	int					rc = 0;
+
+	vectorBuffer = MMPS_PeekBufferOfSize(chalkboard->pools.dynamic,
+		OUTPUT_VECTOR_BUFFER_SIZE,
+		BUFFER_XMIT);
+	if (vectorBuffer == NULL) {
+		SetTaskStatus(task, TaskStatusCannotAllocateBufferForOutput);
+		rc = -1;
+	}
+	else
+	{
+		vector = (struct iovec *) vectorBuffer->data;
+	}
+
+	while ((rc == 0) && (task->xmit.outputPending != NULL))
+	{
+		vectorLength = FillOutputVector(task, vector, &complete);
+
+#ifdef IO_URING_XMIT
+		if (chalkboard->uring != NULL) {
+			size_t toSendTotal = 0;
+			unsigned int vectorId;
+
+			for (vectorId = 0; vectorId < vectorLength; vectorId++)
+				toSendTotal += vector[vectorId].iov_len;
+
+			SendMutexLock(task);
+
+			rc = UringSend(chalkboard->uring,
+				task->xmit.sockFD,
+				vector,
+				vectorLength,
+				TIMEOUT_ON_WAIT_FOR_BEGIN_TO_TRANSMIT);
+
+			SendMutexUnlock(task);
+
+			if (rc == URING_TIMEOUT) {
+				ReportInfo("[Xmit] Wait for send timed out");
+				SetTaskStatus(task, TaskStatusPollForSendTimeout);
+				rc = -1;
+			} else if (rc != 0) {
+				ReportError("[Xmit] Error writing to socket: errno=%d", errno);
 				SetTaskStatus(task, TaskStatusWriteToSocketFailed);
-				return -1;
+				rc = -1;
+			} else {
+				AdvanceOutputs(task, toSendTotal);
 			}
 
-			sentPerBuffer += sentPerStep;
-		} while (sentPerBuffer < toSendPerBuffer);
+			continue;
+		}
+#endif
+
+		memset(&message, 0, sizeof(message));
+		message.msg_iov = vector;
+		message.msg_iovlen = vectorLength;
+
+		SendMutexLock(task);
+
+		sentPerStep = sendmsg(task->xmit.sockFD,
+			&message,
+			MSG_NOSIGNAL | MSG_DONTWAIT | ((complete != 0) ? 0 : MSG_MORE));
+
+		SendMutexUnlock(task);
+
+		if (sentPerStep >= 0) {
+			AdvanceOutputs(task, sentPerStep);
+			continue;
+		}
+
+		if (errno == EINTR)
+			continue;
 
-		buffer = buffer->next;
-	} while (buffer != NULL);
+		if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+			ReportError("[Xmit] Error writing to socket: errno=%d", errno);
+			SetTaskStatus(task, TaskStatusWriteToSocketFailed);
+			rc = -1;
+			continue;
+		}
 
+#ifdef TASK_REACTOR
+		// Reactor of the task sends the rest when the socket has room.
+		//
+		rc = OutputSocketFull;
+#else
+		rc = WaitForOutputSpace(task);
 #endif
+	}
 
-    SendMutexUnlock(task);
+	if (vectorBuffer != NULL)
+		MMPS_PokeBuffer(vectorBuffer);
+
+	if (rc < 0) {
+		ReleaseOutputs(task->xmit.outputPending);
+		task->xmit.outputPending = NULL;
+	}
+
+	return rc;
+}
+
+/**
+ * FillOutputVector()
+ * Fill a gather list with data of outputs taken from the queue
+ * that has not been sent yet.
+ *
+ * @task:
+ * @vector:
+ * @complete:		Where to store whether the gather list takes
+ *					all outputs to their end.
+ *
+ * Returns number of elements of gather list.
+ */
+static unsigned int
+FillOutputVector(
+	struct Task *task,
+	struct iovec *vector,
+	int *complete)
+{
+	struct PaquetOutput	*output;
+	struct MMPS_Buffer	*buffer;
+	unsigned int		vectorLength = 0;
+	size_t				skip = task->xmit.outputSent;
+
+	for (output = task->xmit.outputPending; output != NULL; output = output->next)
+	{
+		if (skip < sizeof(struct PaquetPilot)) {
+			if (vectorLength == OUTPUT_QUEUE_VECTORS)
+				break;
+
+			vector[vectorLength].iov_base = (char *) &output->pilot + skip;
+			vector[vectorLength].iov_len = sizeof(struct PaquetPilot) - skip;
+			vectorLength++;
+
+			skip = 0;
+		} else {
+			skip -= sizeof(struct PaquetPilot);
+		}
+
+		for (buffer = output->chain; buffer != NULL; buffer = buffer->next)
+		{
+			if (skip >= buffer->dataSize) {
+				skip -= buffer->dataSize;
+				continue;
+			}
+
+			if (vectorLength == OUTPUT_QUEUE_VECTORS)
+				break;
+
+			vector[vectorLength].iov_base = buffer->data + skip;
+			vector[vectorLength].iov_len = buffer->dataSize - skip;
+			vectorLength++;
+
+			skip = 0;
+		}
+
+		if (buffer != NULL)
+			break;
+	}
+
+	*complete = (output == NULL);
+
+	return vectorLength;
+}
+
+/**
+ * AdvanceOutputs()
+ * Account data that has been sent and release outputs sent to their end.
+ *
+ * @task:
+ * @sent:			Number of bytes sent.
+ */
+static void
+AdvanceOutputs(struct Task *task, size_t sent)
+{
+	struct PaquetOutput	*output;
+	size_t				outputSize;
+
+	while ((output = task->xmit.outputPending) != NULL)
+	{
+		outputSize = sizeof(struct PaquetPilot) + be32toh(output->pilot.payloadSize);
+
+		if (task->xmit.outputSent + sent < outputSize) {
+			task->xmit.outputSent += sent;
+			break;
+		}
+
+		sent -= outputSize - task->xmit.outputSent;
+
+		task->xmit.outputPending = output->next;
+		task->xmit.outputSent = 0;
+
+		output->next = NULL;
+		ReleaseOutputs(output);
+	}
+}
+
+#ifndef TASK_REACTOR
+/**
+ * WaitForOutputSpace()
+ * Wait for the socket to take more data. Thread mode has no event loop
+ * to take the wait over, so the draining thread waits, but without
+ * holding the send mutex.
+ *
+ * @task:
+ */
+static int
+WaitForOutputSpace(struct Task *task)
+{
+	struct pollfd		pollFD;
+
+	pollFD.fd = task->xmit.sockFD;
+	pollFD.events = POLLOUT;
+
+	int pollRC = poll(&pollFD, 1, TIMEOUT_ON_WAIT_FOR_BEGIN_TO_TRANSMIT);
+	if (pollFD.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+		ReportError("[Xmit] Poll error on send: revents=0x%04X", pollFD.revents);
+		SetTaskStatus(task, TaskStatusPollForSendFailed);
+		return -1;
+	}
+
+	if (pollRC == 0) {
+		ReportInfo("[Xmit] Wait for send timed out");
+		SetTaskStatus(task, TaskStatusPollForSendTimeout);
+		return -1;
+	} else if ((pollRC != 1) && (errno != EINTR)) {
+		ReportError("[Xmit] Poll error on send");
+		SetTaskStatus(task, TaskStatusPollForSendError);
+		return -1;
+	}
 
 	return 0;
 }
+#endif
+
+/**
+ * ReleaseOutputs()
+ * Give back output buffer chains and containers of outputs.
+ *
+ * @outputs:
+ */
+static void
+ReleaseOutputs(struct PaquetOutput *outputs)
+{
+	struct PaquetOutput	*output;
+
+	while (outputs != NULL)
+	{
+		output = outputs;
+		outputs = output->next;
+
+		MMPS_PokeBuffer(output->chain);
+		MMPS_PokeBuffer(output->containerBuffer);
+	}
+}
+
+/**
+ * DiscardOutputQueue()
+ * Release outputs a closed task has not sent.
+ *
+ * @task:
+ */
+void
+DiscardOutputQueue(struct Task *task)
+{
+	ReleaseOutputs(task->xmit.outputPending);
+	task->xmit.outputPending = NULL;
+
+	ReleaseOutputs(TakeOutputQueue(task));
+}
+#endif
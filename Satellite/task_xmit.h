@@ -2,8 +2,6 @@
 
 #include "mmps.h"
 
-#define XMIT_MAX_NUMBER_OF_VECTORS 1000
-
 /**
  * FillPaquetWithPilotData()
  *
@@ -25,8 +23,84 @@ SendFixed(
 	char *buffer,
 	ssize_t bytesToSend);
 
+/**
+ * CheckPaquetPilot()
+ * Check signature and announced payload size of a received pilot,
+ * which has been filled into the paquet.
+ *
+ * @paquet:
+ *
+ * Returns 0 if pilot is valid or -1 otherwise.
+ */
 int
-ReceivePaquet(struct Paquet *paquet, struct MMPS_Buffer *receiveBuffer);
+CheckPaquetPilot(struct Paquet *paquet);
 
+/**
+ * TakePaquetFromFrames()
+ * Take the first paquet of received data, if it is complete,
+ * and keep what follows it.
+ *
+ * @paquet:
+ * @frames:		Received data, NULL if there is none.
+ *
+ * Returns 1 if paquet is taken, 0 if it is not complete yet
+ * or -1, in case of error.
+ */
+int
+TakePaquetFromFrames(
+	struct Paquet *paquet,
+	struct MMPS_Buffer **frames);
+
+/**
+ * ReceiveFrames()
+ * Receive as much data as is available behind the data received so far,
+ * so that several paquets are taken with one receive. A larger paquet
+ * is received in steps of bounded size.
+ *
+ * @task:
+ * @frames:		Received data, NULL if there is none.
+ *
+ * Returns 0 upon successful completion or -1, in case of error
+ * or if the connection is closed.
+ */
+int
+ReceiveFrames(
+	struct Task *task,
+	struct MMPS_Buffer **frames);
+
+/**
+ * SendPaquet()
+ * Send the response of a paquet. With output queue the response is queued
+ * and sent by whichever thread sends the queue of the task, so that
+ * the calling thread does not wait for the socket while another thread
+ * is sending. Output buffer of the paquet is taken over then.
+ *
+ * @paquet:
+ *
+ * Returns 0 upon successful completion or -1, in case of error.
+ */
 int
 SendPaquet(struct Paquet *paquet);
+
+#ifdef OUTPUT_QUEUE
+/**
+ * DiscardOutputQueue()
+ * Release responses a closed task has not sent.
+ *
+ * @task:
+ */
+void
+DiscardOutputQueue(struct Task *task);
+
+#ifdef TASK_REACTOR
+/**
+ * ResumeOutputQueue()
+ * Send the rest of the output queue of a task, when its socket,
+ * that has been full, can take more data.
+ *
+ * @task:
+ */
+void
+ResumeOutputQueue(struct Task *task);
+#endif
+#endif
@@ -12,6 +12,8 @@
 #include "task_kernel.h"
 #include "task_list.h"
 #include "task_xmit.h"
+#include "reactor.h"
+#include "uring.h"
 
 // Take a pointer to chalkboard. Chalkboard must be initialized
 // before any routine of this module could be called.
@@ -20,24 +22,18 @@ extern struct Chalkboard *chalkboard;
 
 // TASKS
 // TASK_THREAD
+// TASK_REACTOR
 
 void *
 TaskThread(void *arg);
 
-int
-TaskInit(struct Task *task);
-
-void
-TaskCleanup(void *arg);
-
-struct Task *
-StartTask(
+static struct Task *
+NewTask(
 	int					sockFD,
 	char				*clientIP)
 {
 	struct MMPS_Buffer	*taskBuffer;
 	struct Task			*task;
-	int 				rc;
 
 	ReportInfo("[Task] Starting new task");
 
@@ -59,13 +55,82 @@ StartTask(
 
 	strncpy(task->clientIP, clientIP, sizeof(task->clientIP));
 
+	return task;
+}
+
+#ifdef TASK_REACTOR
+
+struct Task *
+StartTask(
+	int					sockFD,
+	char				*clientIP)
+{
+	return StartTaskOnReactor(sockFD, clientIP, ANY_REACTOR);
+}
+
+struct Task *
+StartTaskOnReactor(
+	int					sockFD,
+	char				*clientIP,
+	int					reactorId)
+{
+	struct Task			*task;
+	int 				rc;
+
+	task = NewTask(sockFD, clientIP);
+	if (task == NULL)
+		return NULL;
+
+	// Socket is owned by a reactor, no thread is held by the task
+	// while it waits for data.
+	//
+	rc = TaskInit(task);
+	if (rc != 0) {
+		TaskListPushTask(task->taskId, NULL);
+    	MMPS_PokeBuffer(task->containerBuffer);
+        return NULL;
+    }
+
+	rc = AttachTaskToReactor(task, reactorId);
+	if (rc != 0) {
+		// Socket is closed by the listener.
+		//
+		task->xmit.sockFD = -1;
+		TaskCleanup(task);
+        return NULL;
+    }
+
+#ifdef TASKS
+	ReportInfo("[Task] ... attached task 0x%016lX to reactor %d to serve %s",
+		(unsigned long) task,
+		task->reactor.reactorId,
+		task->clientIP);
+#endif
+
+	return task;
+}
+
+#else
+
+struct Task *
+StartTask(
+	int					sockFD,
+	char				*clientIP)
+{
+	struct Task			*task;
+	int 				rc;
+
+	task = NewTask(sockFD, clientIP);
+	if (task == NULL)
+		return NULL;
+
 #ifdef TASKS
 	ReportInfo("[Task] ... creating a thread");
 #endif
 
     rc = pthread_create(&task->thread, NULL, &TaskThread, task);
     if (rc != 0) {
-    	MMPS_PokeBuffer(taskBuffer);
+    	MMPS_PokeBuffer(task->containerBuffer);
         ReportError("[Task] Cannot create task: errno=%d", errno);
         return NULL;
     }
@@ -79,6 +144,8 @@ StartTask(
 	return task;
 }
 
+#endif
+
 inline void
 __SetTaskStatus(struct Task *task, uint64 statusMask)
 {
@@ -122,6 +189,12 @@ RemovePaquetFromTask(struct Task *task, struct Paquet *paquet)
 {
 	struct Paquet *paquetUnderCursor;
 
+#ifdef PAQUET_WORKERS
+	// Task cleanup waits under this mutex until the chain is empty.
+	//
+	pthread_mutex_lock(&task->paquet.drainMutex);
+#endif
+
 	pthread_spin_lock(&task->paquet.chainLock);
 
 	if (task->paquet.chainAnchor == paquet) {
@@ -141,6 +214,13 @@ RemovePaquetFromTask(struct Task *task, struct Paquet *paquet)
 	}
 
 	pthread_spin_unlock(&task->paquet.chainLock);
+
+#ifdef PAQUET_WORKERS
+	if (task->paquet.chainAnchor == NULL)
+		pthread_cond_broadcast(&task->paquet.drainCondition);
+
+	pthread_mutex_unlock(&task->paquet.drainMutex);
+#endif
 }
 
 void *
@@ -246,6 +326,24 @@ TaskInit(struct Task *task)
         return -1;
     }
 
+#ifdef PAQUET_WORKERS
+    rc = pthread_mutex_init(&task->paquet.drainMutex, &mutexAttr);
+	if (rc != 0) {
+		ReportError("[Task] Cannot initialize mutex: rc=%d", rc);
+        return -1;
+    }
+
+    rc = pthread_cond_init(&task->paquet.drainCondition, NULL);
+	if (rc != 0) {
+		ReportError("[Task] Cannot initialize condition: rc=%d", rc);
+        return -1;
+    }
+
+	task->paquet.workerId =
+		__sync_fetch_and_add(&chalkboard->paquetWorkers.nextWorkerId, 1) %
+		chalkboard->paquetWorkers.numberOfWorkers;
+#endif
+
     rc = pthread_mutex_init(&task->broadcast.editMutex, &mutexAttr);
 	if (rc != 0) {
 		ReportError("[Task] Cannot initialize mutex: rc=%d", rc);
@@ -274,6 +372,30 @@ TaskInit(struct Task *task)
 
 	task->broadcast.broadcastPaquet = NULL;
 
+#ifdef OUTPUT_QUEUE
+	task->xmit.outputQueue = NULL;
+	task->xmit.outputDraining = 0;
+	task->xmit.outputPending = NULL;
+	task->xmit.outputSent = 0;
+#ifdef TASK_REACTOR
+	task->xmit.outputBlocked = 0;
+#endif
+#endif
+
+#ifdef IO_URING_XMIT
+	task->xmit.stream = NULL;
+
+#ifndef TASK_REACTOR
+	// Socket of a reactor task is received from by its reactor.
+	//
+	if (chalkboard->uring != NULL) {
+		task->xmit.stream = UringOpenStream(chalkboard->uring, task->xmit.sockFD);
+		if (task->xmit.stream == NULL)
+			ReportWarning("[Task] Cannot start multishot receive, use classic receive");
+	}
+#endif
+#endif
+
     return 0;
 }
 
@@ -281,9 +403,26 @@ void
 TaskCleanup(void *arg)
 {
 	struct Task 	*task = (struct Task *)arg;
+#ifndef PAQUET_WORKERS
 	struct Paquet	*paquetToCancel;
+#endif
 	int 			rc;
 
+#ifdef PAQUET_WORKERS
+	// Cancel is cooperative. Paquets that have not been started are dropped
+	// by workers, others finish at the next point they look at the flag.
+	// Paquets leave the chain under the drain mutex, so the last one
+	// cannot be missed.
+	//
+	CancelPaquetsOfTask(task);
+
+	pthread_mutex_lock(&task->paquet.drainMutex);
+
+	while (task->paquet.chainAnchor != NULL)
+		pthread_cond_wait(&task->paquet.drainCondition, &task->paquet.drainMutex);
+
+	pthread_mutex_unlock(&task->paquet.drainMutex);
+#else
 	do {
 		pthread_spin_lock(&task->paquet.chainLock);
 
@@ -295,6 +434,16 @@ TaskCleanup(void *arg)
 			PaquetCancel(paquetToCancel);
 
 	} while (paquetToCancel != NULL);
+#endif
+
+#ifdef IO_URING_XMIT
+	if (task->xmit.stream != NULL)
+		UringCloseStream(task->xmit.stream);
+#endif
+
+#ifdef OUTPUT_QUEUE
+	DiscardOutputQueue(task);
+#endif
 
 	close(task->xmit.sockFD);
 
@@ -342,6 +491,18 @@ TaskCleanup(void *arg)
 	if (rc != 0)
 		ReportError("[Task] Cannot destroy mutex: rc=%d", rc);
 
+#ifdef PAQUET_WORKERS
+	pthread_mutex_lock(&task->paquet.drainMutex);
+	pthread_mutex_unlock(&task->paquet.drainMutex);
+	rc = pthread_mutex_destroy(&task->paquet.drainMutex);
+	if (rc != 0)
+		ReportError("[Task] Cannot destroy mutex: rc=%d", rc);
+
+    rc = pthread_cond_destroy(&task->paquet.drainCondition);
+	if (rc != 0)
+		ReportError("[Task] Cannot destroy condition: rc=%d", rc);
+#endif
+
 	pthread_mutex_lock(&task->broadcast.editMutex);
 	pthread_mutex_unlock(&task->broadcast.editMutex);
 	rc = pthread_mutex_destroy(&task->broadcast.editMutex);
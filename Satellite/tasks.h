@@ -47,6 +47,14 @@
 
 #define TaskStatusOtherError					0x8000000000000000ll
 
+// States of a task served by a reactor (TASK_REACTOR), telling what is
+// being received from its socket.
+//
+#define TaskStateDemande						1
+#define TaskStateAnticipant						2
+#define TaskStatePilot							3
+#define TaskStatePayload						4
+
 #pragma pack(push, 1)
 struct DialogueDemande
 {
@@ -102,6 +110,29 @@ struct Task
 	struct
 	{
 		int					sockFD;
+#ifdef IO_URING_XMIT
+		// Multishot receive of the socket or NULL, if receive goes
+		// the classic way.
+		//
+		struct UringStream	*stream;
+#endif
+#ifdef OUTPUT_QUEUE
+		// Responses waiting to be sent, the newest first. The queue is sent
+		// by the one thread that has raised the draining flag.
+		//
+		struct PaquetOutput	*outputQueue;
+		int					outputDraining;
+		// Responses taken from the queue, but not sent to their end yet,
+		// the oldest first, and how much of the first one is sent.
+		//
+		struct PaquetOutput	*outputPending;
+		size_t				outputSent;
+#ifdef TASK_REACTOR
+		// Socket is full and the reactor of the task sends the rest.
+		//
+		int					outputBlocked;
+#endif
+#endif
 #ifdef DUPLEX
 		pthread_mutex_t		receiveMutex;
 		pthread_mutex_t		sendMutex;
@@ -117,6 +148,17 @@ struct Task
 		pthread_spinlock_t	heavyJobLock;
 		pthread_mutex_t		downloadMutex;
 		struct Paquet		*chainAnchor;
+#ifdef PAQUET_WORKERS
+		// Worker whose queue takes all paquets of the task, so that they
+		// are started in the order they were received.
+		//
+		unsigned int		workerId;
+
+		// Signaled when the last paquet leaves the chain.
+		//
+		pthread_mutex_t		drainMutex;
+		pthread_cond_t		drainCondition;
+#endif
 	}
 	paquet;
 
@@ -130,6 +172,21 @@ struct Task
 		pthread_cond_t		waitCondition;
 	}
 	broadcast;
+
+#ifdef TASK_REACTOR
+	struct
+	{
+		int					reactorId;
+		int					state;
+		int					sessionOnline;
+		char				*fixedData;
+		size_t				fixedSize;
+		size_t				fixedReceived;
+		struct Paquet		*paquet;
+		struct MMPS_Buffer	*receiveBuffer;
+	}
+	reactor;
+#endif
 };
 
 struct Paquet
@@ -138,6 +195,9 @@ struct Paquet
 	struct Task			*task;
 	struct Paquet		*nextInChain;
 	pthread_t			thread;
+#ifdef PAQUET_WORKERS
+	int					cancelled;
+#endif
 	struct pollfd		pollFD;
 	int					paquetId;
 	int					commandCode;
@@ -152,6 +212,20 @@ StartTask(
 	int				sockFD,
 	char			*clientIP);
 
+#ifdef TASK_REACTOR
+struct Task *
+StartTaskOnReactor(
+	int				sockFD,
+	char			*clientIP,
+	int				reactorId);
+#endif
+
+int
+TaskInit(struct Task *task);
+
+void
+TaskCleanup(void *arg);
+
 inline void
 __SetTaskStatus(struct Task *task, uint64 statusMask);
 
@@ -0,0 +1,1433 @@
+#ifdef IO_URING_RECEIVE
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+#include "mmps.h"
+#include "report.h"
+#include "uring.h"
+
+// Buffer group id receive buffers are registered with.
+//
+#define URING_BUFFER_GROUP      0
+
+// User data of completions nobody waits for (linked timeouts, cancels).
+//
+#define URING_NO_REQUEST        0
+
+// User data of multishot receive of a stream is the pointer to the stream
+// with the lowest bit set, to tell it from the pointer to a request.
+//
+#define URING_STREAM_TAG        1
+
+// Maximal number of entries submitted at once by one request.
+//
+#define URING_MAX_LINKED        2
+
+struct Uring
+{
+    int                     ringFD;
+
+    /**
+     * Submission queue, shared with the kernel. Submissions of several
+     * threads are serialized by submit mutex. Entries put to the queue while
+     * another thread is handing entries over to the kernel are handed over
+     * by that thread in the same batch.
+     */
+    pthread_mutex_t         submitMutex;
+    int                     sqPoll;
+    int                     submitting;
+    unsigned int            submitted;
+    void                    *submissionRing;
+    size_t                  submissionRingSize;
+    unsigned int            *submissionHead;
+    unsigned int            *submissionTail;
+    unsigned int            *submissionFlags;
+    unsigned int            submissionMask;
+    unsigned int            numberOfSubmissions;
+    unsigned int            *submissionArray;
+    struct io_uring_sqe     *submissionEntries;
+    size_t                  submissionEntriesSize;
+
+    /**
+     * Completion queue, shared with the kernel. There is no thread of its own
+     * to reap completions. A thread waiting for a completion waits for it
+     * in the kernel and reaps completions of all threads, while others wait
+     * for the generation of reaped completions to change. Completion queue
+     * is accessed under completion mutex only.
+     */
+    pthread_mutex_t         completionMutex;
+    pthread_cond_t          completionCondition;
+    int                     reaping;
+    unsigned int            generation;
+    void                    *completionRing;
+    size_t                  completionRingSize;
+    unsigned int            *completionHead;
+    unsigned int            *completionTail;
+    unsigned int            completionMask;
+    struct io_uring_cqe     *completionEntries;
+
+    struct MMPS_BufferRing  *receiveBuffers;
+};
+
+/**
+ * Request waiting for its completion. It lives on the stack of the waiting
+ * thread and is referenced by user data of its submission. Its completion
+ * is stored under completion mutex.
+ */
+struct UringRequest
+{
+    int                     completed;
+    int                     result;
+    unsigned int            flags;
+};
+
+#ifdef IO_URING_XMIT
+/**
+ * Multishot receive of a connection. The kernel keeps receiving into buffers
+ * of the buffer ring as data arrives, the reaping thread queues them
+ * on the stream and readers copy data out of them.
+ */
+struct UringStream
+{
+    struct Uring            *uring;
+    int                     sockFD;
+    pthread_mutex_t         mutex;
+
+    /**
+     * Received buffers in the order of arrival. Cursor of the first one
+     * points to the data not read yet.
+     */
+    struct MMPS_Buffer      *firstBuffer;
+    struct MMPS_Buffer      *lastBuffer;
+
+    /**
+     * Multishot receive is in the kernel.
+     */
+    int                     armed;
+
+    /**
+     * Multishot receive has stopped because the buffer ring has run dry.
+     */
+    int                     starved;
+
+    /**
+     * Connection is closed by the peer.
+     */
+    int                     closed;
+
+    /**
+     * Error of multishot receive (positive errno) or 0.
+     */
+    int                     error;
+};
+#endif
+
+static int
+MapRings(
+    struct Uring            *uring,
+    struct io_uring_params  *params);
+
+static void
+UnmapRings(struct Uring *uring);
+
+static void
+PrepareEntry(
+    struct io_uring_sqe     *entry,
+    unsigned int            opcode,
+    int                     sockFD,
+    unsigned long           address,
+    unsigned int            length,
+    unsigned int            flags,
+    unsigned long           userData);
+
+static unsigned int
+PrepareLinkedTimeout(
+    struct io_uring_sqe         *entries,
+    struct __kernel_timespec    *timespec,
+    int                         timeout);
+
+static int
+SubmitEntries(
+    struct Uring            *uring,
+    struct io_uring_sqe     *entries,
+    unsigned int            numberOfEntries);
+
+static int
+FlushEntries(struct Uring *uring);
+
+static void
+InitRequest(struct UringRequest *request);
+
+static void
+WaitForCompletion(
+    struct Uring            *uring,
+    struct UringRequest     *request);
+
+static int
+AwaitCompletions(
+    struct Uring            *uring,
+    unsigned int            generation,
+    struct timespec         *deadline);
+
+static void
+DispatchCompletions(struct Uring *uring);
+
+static void
+CompleteRequest(
+    struct UringRequest     *request,
+    struct io_uring_cqe     *entry);
+
+#ifdef IO_URING_XMIT
+static int
+ArmStream(struct UringStream *stream);
+
+static void
+CompleteStream(
+    struct UringStream      *stream,
+    struct io_uring_cqe     *entry);
+
+static int
+ReadStream(
+    struct UringStream      *stream,
+    char                    *data,
+    struct MMPS_Buffer      *chain,
+    unsigned int            size,
+    unsigned int            minimum,
+    int                     timeout);
+#endif
+
+/**
+ * CreateUring()
+ * Set up io_uring instance for receive with buffers lent to the kernel
+ * from an MMPS bank.
+ *
+ * Returns pointer to io_uring descriptor or NULL, if io_uring is not
+ * supported by the kernel or cannot be set up.
+ */
+struct Uring *
+CreateUring(
+    unsigned int        numberOfSubmissions,
+    unsigned int        numberOfCompletions,
+    unsigned int        sqPollIdle,
+    struct MMPS_Pool    *pool,
+    unsigned int        bankId,
+    unsigned int        numberOfBuffers,
+    unsigned int        ownerId)
+{
+    struct Uring            *uring;
+    struct io_uring_params  params;
+    int                     rc;
+
+    uring = malloc(sizeof(struct Uring));
+    if (uring == NULL)
+    {
+        ReportSoftAlert("[Uring] Out of memory");
+
+        return NULL;
+    }
+
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = numberOfCompletions;
+
+    if (sqPollIdle > 0)
+    {
+        params.flags |= IORING_SETUP_SQPOLL;
+        params.sq_thread_idle = sqPollIdle;
+    }
+
+    uring->ringFD = syscall(__NR_io_uring_setup, numberOfSubmissions, &params);
+    if ((uring->ringFD < 0) && (sqPollIdle > 0))
+    {
+        ReportWarning("[Uring] Cannot set up submission queue polling, submit by system calls: errno=%d",
+            errno);
+
+        memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = numberOfCompletions;
+
+        uring->ringFD = syscall(__NR_io_uring_setup, numberOfSubmissions, &params);
+    }
+
+    if (uring->ringFD < 0)
+    {
+        ReportWarning("[Uring] Cannot set up io_uring: errno=%d", errno);
+
+        free(uring);
+
+        return NULL;
+    }
+
+    rc = MapRings(uring, &params);
+    if (rc != 0)
+    {
+        close(uring->ringFD);
+        free(uring);
+
+        return NULL;
+    }
+
+    pthread_mutex_init(&uring->submitMutex, NULL);
+    pthread_mutex_init(&uring->completionMutex, NULL);
+    pthread_cond_init(&uring->completionCondition, NULL);
+
+    uring->reaping = 0;
+    uring->generation = 0;
+
+    uring->sqPoll = ((params.flags & IORING_SETUP_SQPOLL) != 0);
+    uring->submitting = 0;
+    uring->submitted = *uring->submissionTail;
+
+    rc = MMPS_InitBufferRing(pool,
+            bankId,
+            uring->ringFD,
+            URING_BUFFER_GROUP,
+            numberOfBuffers,
+            ownerId,
+            &uring->receiveBuffers);
+    if (rc != MMPS_OK)
+    {
+        ReportWarning("[Uring] Cannot lend receive buffers to the kernel: rc=%d", rc);
+
+        pthread_cond_destroy(&uring->completionCondition);
+        pthread_mutex_destroy(&uring->completionMutex);
+        pthread_mutex_destroy(&uring->submitMutex);
+        UnmapRings(uring);
+        close(uring->ringFD);
+        free(uring);
+
+        return NULL;
+    }
+
+    ReportInfo("[Uring] Receive with %u buffers of bank %u lent to the kernel%s",
+        numberOfBuffers,
+        bankId,
+        (uring->sqPoll != 0) ? ", submission queue polled by the kernel" : "");
+
+    return uring;
+}
+
+/**
+ * UringReceive()
+ * Receive from a socket into a buffer the kernel takes out of the buffer ring
+ * only when data arrives, so that no buffer is held by a waiting connection.
+ *
+ * Returns number of bytes received, 0 if the connection is closed,
+ * URING_NO_BUFFERS if the buffer ring has run dry, URING_TIMEOUT
+ * or URING_ERROR (with errno set).
+ */
+int
+UringReceive(
+    struct Uring        *uring,
+    int                 sockFD,
+    unsigned int        length,
+    int                 timeout,
+    struct MMPS_Buffer  **buffer)
+{
+    struct io_uring_sqe         entries[URING_MAX_LINKED];
+    struct __kernel_timespec    timespec;
+    struct UringRequest         request;
+    unsigned int                numberOfEntries;
+    int                         rc;
+
+    InitRequest(&request);
+
+    PrepareEntry(&entries[0], IORING_OP_RECV, sockFD, 0, length,
+        IOSQE_BUFFER_SELECT,
+        (unsigned long) &request);
+
+    numberOfEntries = PrepareLinkedTimeout(entries, &timespec, timeout);
+
+    rc = SubmitEntries(uring, entries, numberOfEntries);
+    if (rc != 0)
+        return URING_ERROR;
+
+    // Linked timeout cancels the receive when it expires,
+    // so that the receive completes in any case.
+    //
+    WaitForCompletion(uring, &request);
+
+    *buffer = MMPS_TakeFromBufferRing(uring->receiveBuffers,
+            request.flags,
+            request.result);
+
+    if (*buffer != NULL)
+    {
+        if (request.result > 0)
+            return request.result;
+
+        MMPS_PokeBuffer(*buffer);
+        *buffer = NULL;
+    }
+
+    if (request.result == -ENOBUFS)
+    {
+        MMPS_ReplenishBufferRing(uring->receiveBuffers);
+
+        return URING_NO_BUFFERS;
+    }
+
+    if (request.result == -ECANCELED)
+        return URING_TIMEOUT;
+
+    if (request.result < 0)
+    {
+        errno = -request.result;
+
+        return URING_ERROR;
+    }
+
+    return 0;
+}
+
+#ifdef IO_URING_XMIT
+/**
+ * UringSend()
+ * Send data of a gather list with a linked timeout. Vector is moved past
+ * the data sent if the kernel sends it in several steps.
+ *
+ * Returns 0 upon successful completion, URING_TIMEOUT or URING_ERROR
+ * (with errno set).
+ */
+int
+UringSend(
+    struct Uring        *uring,
+    int                 sockFD,
+    struct iovec        *vector,
+    unsigned int        vectorLength,
+    int                 timeout)
+{
+    struct io_uring_sqe         entries[URING_MAX_LINKED];
+    struct __kernel_timespec    timespec;
+    struct UringRequest         request;
+    struct msghdr               message;
+    unsigned int                numberOfEntries;
+    size_t                      sent;
+    int                         rc;
+
+    while (vectorLength > 0)
+    {
+        if (vector->iov_len == 0)
+        {
+            vector++;
+            vectorLength--;
+            continue;
+        }
+
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = vector;
+        message.msg_iovlen = vectorLength;
+
+        InitRequest(&request);
+
+        PrepareEntry(&entries[0], IORING_OP_SENDMSG, sockFD,
+            (unsigned long) &message, 1, 0,
+            (unsigned long) &request);
+
+        entries[0].msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+
+        numberOfEntries = PrepareLinkedTimeout(entries, &timespec, timeout);
+
+        rc = SubmitEntries(uring, entries, numberOfEntries);
+        if (rc != 0)
+            return URING_ERROR;
+
+        WaitForCompletion(uring, &request);
+
+        if (request.result == -ECANCELED)
+            return URING_TIMEOUT;
+
+        if (request.result <= 0)
+        {
+            errno = (request.result < 0) ? -request.result : EPIPE;
+
+            return URING_ERROR;
+        }
+
+        // Move past the data that is sent.
+        //
+        sent = request.result;
+
+        while ((vectorLength > 0) && (sent >= vector->iov_len))
+        {
+            sent -= vector->iov_len;
+            vector++;
+            vectorLength--;
+        }
+
+        if (vectorLength > 0)
+        {
+            vector->iov_base = (char *) vector->iov_base + sent;
+            vector->iov_len -= sent;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * UringOpenStream()
+ * Start multishot receive on a socket.
+ *
+ * Returns pointer to stream descriptor or NULL, in case of error.
+ */
+struct UringStream *
+UringOpenStream(
+    struct Uring        *uring,
+    int                 sockFD)
+{
+    struct UringStream  *stream;
+    int                 rc;
+
+    stream = malloc(sizeof(struct UringStream));
+    if (stream == NULL)
+    {
+        ReportSoftAlert("[Uring] Out of memory");
+
+        return NULL;
+    }
+
+    stream->uring = uring;
+    stream->sockFD = sockFD;
+    stream->firstBuffer = NULL;
+    stream->lastBuffer = NULL;
+    stream->armed = 0;
+    stream->starved = 0;
+    stream->closed = 0;
+    stream->error = 0;
+
+    pthread_mutex_init(&stream->mutex, NULL);
+
+    pthread_mutex_lock(&stream->mutex);
+
+    rc = ArmStream(stream);
+
+    pthread_mutex_unlock(&stream->mutex);
+
+    if (rc != 0)
+    {
+        pthread_mutex_destroy(&stream->mutex);
+        free(stream);
+
+        return NULL;
+    }
+
+    return stream;
+}
+
+/**
+ * UringCloseStream()
+ * Stop multishot receive, wait for its last completion and give back
+ * buffers that have not been read.
+ */
+void
+UringCloseStream(struct UringStream *stream)
+{
+    struct Uring            *uring = stream->uring;
+    struct io_uring_sqe     entry;
+    unsigned int            generation;
+    int                     armed;
+    int                     rc;
+
+    pthread_mutex_lock(&stream->mutex);
+
+    armed = stream->armed;
+
+    pthread_mutex_unlock(&stream->mutex);
+
+    if (armed != 0)
+    {
+        PrepareEntry(&entry, IORING_OP_ASYNC_CANCEL, -1,
+            (unsigned long) stream | URING_STREAM_TAG, 0, 0,
+            URING_NO_REQUEST);
+
+        rc = SubmitEntries(uring, &entry, 1);
+        if (rc != 0)
+        {
+            // Receive ends with end of stream as well.
+            //
+            shutdown(stream->sockFD, SHUT_RD);
+        }
+
+        pthread_mutex_lock(&stream->mutex);
+
+        while (stream->armed != 0)
+        {
+            // Generation is read before stream mutex is released,
+            // so that the last completion cannot be missed.
+            //
+            generation = __atomic_load_n(&uring->generation, __ATOMIC_ACQUIRE);
+
+            pthread_mutex_unlock(&stream->mutex);
+
+            pthread_mutex_lock(&uring->completionMutex);
+            AwaitCompletions(uring, generation, NULL);
+            pthread_mutex_unlock(&uring->completionMutex);
+
+            pthread_mutex_lock(&stream->mutex);
+        }
+
+        pthread_mutex_unlock(&stream->mutex);
+    }
+
+    if (stream->firstBuffer != NULL)
+        MMPS_PokeBuffer(stream->firstBuffer);
+
+    pthread_mutex_destroy(&stream->mutex);
+
+    free(stream);
+}
+
+/**
+ * UringStreamReceive()
+ * Read data of a stream to memory, wait for it if necessary.
+ *
+ * Returns number of bytes read, less than requested only if the connection
+ * is closed, URING_TIMEOUT or URING_ERROR (with errno set).
+ */
+int
+UringStreamReceive(
+    struct UringStream  *stream,
+    char                *data,
+    unsigned int        size,
+    int                 timeout)
+{
+    return ReadStream(stream, data, NULL, size, size, timeout);
+}
+
+/**
+ * UringStreamReceiveIntoChain()
+ * Read data of a stream behind the data of a buffer chain, wait for it
+ * if necessary. Chain is extended as needed.
+ *
+ * Returns number of bytes read, less than requested only if the connection
+ * is closed, URING_TIMEOUT, URING_OUT_OF_MEMORY or URING_ERROR (with errno set).
+ */
+int
+UringStreamReceiveIntoChain(
+    struct UringStream  *stream,
+    struct MMPS_Buffer  *chain,
+    unsigned int        size,
+    int                 timeout)
+{
+    return ReadStream(stream, NULL, chain, size, size, timeout);
+}
+
+/**
+ * UringStreamReceiveAvailable()
+ * Read data of a stream behind the data of a buffer chain, as much as
+ * has been received but no more than requested. Wait only if nothing
+ * has been received yet. Chain is extended as needed.
+ *
+ * Returns number of bytes read, 0 if the connection is closed,
+ * URING_TIMEOUT, URING_OUT_OF_MEMORY or URING_ERROR (with errno set).
+ */
+int
+UringStreamReceiveAvailable(
+    struct UringStream  *stream,
+    struct MMPS_Buffer  *chain,
+    unsigned int        size,
+    int                 timeout)
+{
+    return ReadStream(stream, NULL, chain, size, 1, timeout);
+}
+#endif
+
+/**
+ * MapRings()
+ * Map submission queue, completion queue and submission entries
+ * of io_uring instance.
+ *
+ * Returns 0 upon successful completion or -1, in case of error.
+ */
+static int
+MapRings(
+    struct Uring            *uring,
+    struct io_uring_params  *params)
+{
+    char *ring;
+
+    uring->submissionRingSize = params->sq_off.array +
+        params->sq_entries * sizeof(unsigned int);
+
+    uring->submissionRing = mmap(NULL,
+        uring->submissionRingSize,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE,
+        uring->ringFD,
+        IORING_OFF_SQ_RING);
+    if (uring->submissionRing == MAP_FAILED)
+    {
+        ReportError("[Uring] Cannot map submission queue: errno=%d", errno);
+
+        return -1;
+    }
+
+    uring->completionRingSize = params->cq_off.cqes +
+        params->cq_entries * sizeof(struct io_uring_cqe);
+
+    uring->completionRing = mmap(NULL,
+        uring->completionRingSize,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE,
+        uring->ringFD,
+        IORING_OFF_CQ_RING);
+    if (uring->completionRing == MAP_FAILED)
+    {
+        ReportError("[Uring] Cannot map completion queue: errno=%d", errno);
+
+        munmap(uring->submissionRing, uring->submissionRingSize);
+
+        return -1;
+    }
+
+    uring->submissionEntriesSize = params->sq_entries * sizeof(struct io_uring_sqe);
+
+    uring->submissionEntries = mmap(NULL,
+        uring->submissionEntriesSize,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE,
+        uring->ringFD,
+        IORING_OFF_SQES);
+    if (uring->submissionEntries == MAP_FAILED)
+    {
+        ReportError("[Uring] Cannot map submission entries: errno=%d", errno);
+
+        munmap(uring->completionRing, uring->completionRingSize);
+        munmap(uring->submissionRing, uring->submissionRingSize);
+
+        return -1;
+    }
+
+    ring = uring->submissionRing;
+    uring->submissionHead = (unsigned int *) (ring + params->sq_off.head);
+    uring->submissionTail = (unsigned int *) (ring + params->sq_off.tail);
+    uring->submissionFlags = (unsigned int *) (ring + params->sq_off.flags);
+    uring->submissionMask = *(unsigned int *) (ring + params->sq_off.ring_mask);
+    uring->numberOfSubmissions = params->sq_entries;
+    uring->submissionArray = (unsigned int *) (ring + params->sq_off.array);
+
+    ring = uring->completionRing;
+    uring->completionHead = (unsigned int *) (ring + params->cq_off.head);
+    uring->completionTail = (unsigned int *) (ring + params->cq_off.tail);
+    uring->completionMask = *(unsigned int *) (ring + params->cq_off.ring_mask);
+    uring->completionEntries = (struct io_uring_cqe *) (ring + params->cq_off.cqes);
+
+    return 0;
+}
+
+/**
+ * UnmapRings()
+ * Unmap submission queue, completion queue and submission entries.
+ */
+static void
+UnmapRings(struct Uring *uring)
+{
+    munmap(uring->submissionEntries, uring->submissionEntriesSize);
+    munmap(uring->completionRing, uring->completionRingSize);
+    munmap(uring->submissionRing, uring->submissionRingSize);
+}
+
+/**
+ * PrepareEntry()
+ * Fill a submission entry.
+ */
+static void
+PrepareEntry(
+    struct io_uring_sqe     *entry,
+    unsigned int            opcode,
+    int                     sockFD,
+    unsigned long           address,
+    unsigned int            length,
+    unsigned int            flags,
+    unsigned long           userData)
+{
+    memset(entry, 0, sizeof(struct io_uring_sqe));
+
+    entry->opcode = opcode;
+    entry->flags = flags;
+    entry->fd = sockFD;
+    entry->addr = address;
+    entry->len = length;
+    entry->user_data = userData;
+
+    if (flags & IOSQE_BUFFER_SELECT)
+        entry->buf_group = URING_BUFFER_GROUP;
+}
+
+/**
+ * PrepareLinkedTimeout()
+ * Link a timeout to the first of given entries, so that the kernel cancels
+ * it when the timeout expires and no poll is needed to wait with a timeout.
+ * Timespec must stay valid until the entries are completed.
+ *
+ * @timeout:    Timeout in milliseconds, or -1 to wait forever.
+ *
+ * Returns number of entries to submit.
+ */
+static unsigned int
+PrepareLinkedTimeout(
+    struct io_uring_sqe         *entries,
+    struct __kernel_timespec    *timespec,
+    int                         timeout)
+{
+    if (timeout < 0)
+        return 1;
+
+    timespec->tv_sec = timeout / 1000;
+    timespec->tv_nsec = (timeout % 1000) * 1000000L;
+
+    entries[0].flags |= IOSQE_IO_LINK;
+
+    PrepareEntry(&entries[1], IORING_OP_LINK_TIMEOUT, -1,
+        (unsigned long) timespec, 1, 0,
+        URING_NO_REQUEST);
+
+    return 2;
+}
+
+/**
+ * SubmitEntries()
+ * Put entries to submission queue and hand them over to the kernel.
+ * With submission queue polling the kernel thread takes them, otherwise
+ * entries of all threads that have been put to the queue meanwhile are
+ * handed over with one system call. If submission queue is full, wait
+ * for the kernel to take entries off it.
+ *
+ * Returns 0 upon successful completion or -1, in case of error.
+ */
+static int
+SubmitEntries(
+    struct Uring            *uring,
+    struct io_uring_sqe     *entries,
+    unsigned int            numberOfEntries)
+{
+    unsigned int            head;
+    unsigned int            tail;
+    unsigned int            index;
+    unsigned int            entryIndex;
+    int                     rc;
+
+    pthread_mutex_lock(&uring->submitMutex);
+
+    for (;;)
+    {
+        head = __atomic_load_n(uring->submissionHead, __ATOMIC_ACQUIRE);
+        tail = *uring->submissionTail;
+
+        if ((tail - head) + numberOfEntries <= uring->numberOfSubmissions)
+            break;
+
+        if (uring->sqPoll != 0)
+        {
+            // Wait for the kernel thread to take entries off the queue.
+            //
+            pthread_mutex_unlock(&uring->submitMutex);
+
+            syscall(__NR_io_uring_enter, uring->ringFD, 0, 0,
+                IORING_ENTER_SQ_WAIT, NULL, 0);
+
+            pthread_mutex_lock(&uring->submitMutex);
+        }
+        else if (uring->submitting != 0)
+        {
+            // Wait for the batch in progress to be handed over.
+            //
+            pthread_mutex_unlock(&uring->submitMutex);
+            sched_yield();
+            pthread_mutex_lock(&uring->submitMutex);
+        }
+        else
+        {
+            // Entries left behind by a failed batch fill the queue,
+            // hand them over before these are put to the queue.
+            //
+            rc = FlushEntries(uring);
+            if (rc != 0)
+            {
+                pthread_mutex_unlock(&uring->submitMutex);
+
+                return -1;
+            }
+        }
+    }
+
+    for (entryIndex = 0; entryIndex < numberOfEntries; entryIndex++)
+    {
+        index = (tail + entryIndex) & uring->submissionMask;
+
+        uring->submissionEntries[index] = entries[entryIndex];
+        uring->submissionArray[index] = index;
+    }
+
+    __atomic_store_n(uring->submissionTail, tail + numberOfEntries, __ATOMIC_RELEASE);
+
+    if (uring->sqPoll != 0)
+    {
+        // Kernel thread falls asleep when idle and must be woken up then.
+        //
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+        if (__atomic_load_n(uring->submissionFlags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP)
+            syscall(__NR_io_uring_enter, uring->ringFD, 0, 0,
+                IORING_ENTER_SQ_WAKEUP, NULL, 0);
+
+        pthread_mutex_unlock(&uring->submitMutex);
+
+        return 0;
+    }
+
+    // Another thread is in the kernel with a batch,
+    // it takes these entries along with the next one.
+    //
+    if (uring->submitting != 0)
+    {
+        pthread_mutex_unlock(&uring->submitMutex);
+
+        return 0;
+    }
+
+    rc = FlushEntries(uring);
+
+    pthread_mutex_unlock(&uring->submitMutex);
+
+    return rc;
+}
+
+/**
+ * FlushEntries()
+ * Hand entries of submission queue over to the kernel, until no more have
+ * been put to the queue meanwhile. Submit mutex must be held and is released
+ * for system calls. If the kernel refuses entries because completions are
+ * not reaped, reap them.
+ *
+ * Returns 0 upon successful completion or -1, in case of error.
+ */
+static int
+FlushEntries(struct Uring *uring)
+{
+    unsigned int            toSubmit;
+    int                     error;
+    int                     rc;
+
+    uring->submitting = 1;
+
+    rc = 0;
+    error = 0;
+
+    while ((toSubmit = *uring->submissionTail - uring->submitted) > 0)
+    {
+        pthread_mutex_unlock(&uring->submitMutex);
+
+        rc = syscall(__NR_io_uring_enter, uring->ringFD, toSubmit, 0, 0, NULL, 0);
+        error = errno;
+
+        // Completion queue is full, reap completions to make room.
+        //
+        if ((rc == 0) || ((rc < 0) && ((error == EAGAIN) || (error == EBUSY))))
+        {
+            pthread_mutex_lock(&uring->completionMutex);
+            DispatchCompletions(uring);
+            pthread_mutex_unlock(&uring->completionMutex);
+
+            sched_yield();
+        }
+
+        pthread_mutex_lock(&uring->submitMutex);
+
+        if (rc > 0)
+            uring->submitted += rc;
+        else if ((rc < 0) && (error != EINTR) && (error != EAGAIN) && (error != EBUSY))
+            break;
+    }
+
+    uring->submitting = 0;
+
+    if (rc < 0)
+    {
+        ReportError("[Uring] Cannot submit entries: errno=%d", error);
+        errno = error;
+
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * InitRequest()
+ * Prepare a request to wait for its completion.
+ */
+static void
+InitRequest(struct UringRequest *request)
+{
+    request->completed = 0;
+}
+
+/**
+ * WaitForCompletion()
+ * Wait until the request is completed. Completions are reaped by the waiting
+ * thread itself, unless another thread is reaping already.
+ */
+static void
+WaitForCompletion(
+    struct Uring            *uring,
+    struct UringRequest     *request)
+{
+    pthread_mutex_lock(&uring->completionMutex);
+
+    while (request->completed == 0)
+        AwaitCompletions(uring, uring->generation, NULL);
+
+    pthread_mutex_unlock(&uring->completionMutex);
+}
+
+/**
+ * AwaitCompletions()
+ * Wait until completions are reaped after the given generation. If no other
+ * thread is reaping, wait for completions in the kernel and reap them,
+ * otherwise wait for the reaping thread. Completion mutex must be held.
+ *
+ * @generation: Generation of reaped completions seen by the caller.
+ * @deadline:   Time to wait until, or NULL to wait forever.
+ *
+ * Returns 0 upon successful completion or URING_TIMEOUT.
+ */
+static int
+AwaitCompletions(
+    struct Uring            *uring,
+    unsigned int            generation,
+    struct timespec         *deadline)
+{
+    struct io_uring_getevents_arg   arg;
+    struct __kernel_timespec        timespec;
+    struct timespec                 now;
+    unsigned int                    flags;
+    int                             rc;
+
+    while (uring->generation == generation)
+    {
+        if (deadline != NULL)
+        {
+            clock_gettime(CLOCK_REALTIME, &now);
+
+            if ((now.tv_sec > deadline->tv_sec) ||
+                ((now.tv_sec == deadline->tv_sec) && (now.tv_nsec >= deadline->tv_nsec)))
+                return URING_TIMEOUT;
+        }
+
+        if (uring->reaping != 0)
+        {
+            if (deadline == NULL)
+                pthread_cond_wait(&uring->completionCondition, &uring->completionMutex);
+            else
+                pthread_cond_timedwait(&uring->completionCondition, &uring->completionMutex, deadline);
+
+            continue;
+        }
+
+        // Completions may be there already.
+        //
+        if (*uring->completionHead != __atomic_load_n(uring->completionTail, __ATOMIC_ACQUIRE))
+        {
+            DispatchCompletions(uring);
+
+            continue;
+        }
+
+        flags = IORING_ENTER_GETEVENTS;
+
+        if (deadline != NULL)
+        {
+            timespec.tv_sec = deadline->tv_sec - now.tv_sec;
+            timespec.tv_nsec = deadline->tv_nsec - now.tv_nsec;
+            if (timespec.tv_nsec < 0)
+            {
+                timespec.tv_sec--;
+                timespec.tv_nsec += 1000000000L;
+            }
+
+            memset(&arg, 0, sizeof(arg));
+            arg.ts = (unsigned long) &timespec;
+
+            flags |= IORING_ENTER_EXT_ARG;
+        }
+
+        uring->reaping = 1;
+
+        pthread_mutex_unlock(&uring->completionMutex);
+
+        rc = syscall(__NR_io_uring_enter, uring->ringFD, 0, 1, flags,
+            (deadline != NULL) ? &arg : NULL,
+            (deadline != NULL) ? sizeof(arg) : 0);
+        if ((rc < 0) && (errno != EINTR) && (errno != ETIME))
+        {
+            ReportError("[Uring] Cannot wait for completions: errno=%d", errno);
+
+            usleep(1000);
+        }
+
+        pthread_mutex_lock(&uring->completionMutex);
+
+        uring->reaping = 0;
+
+        DispatchCompletions(uring);
+
+        // Let another thread take over reaping, if this one is done.
+        //
+        pthread_cond_broadcast(&uring->completionCondition);
+    }
+
+    return 0;
+}
+
+/**
+ * DispatchCompletions()
+ * Reap completions of completion queue and hand them over to requests
+ * and streams waiting for them. Completion mutex must be held.
+ */
+static void
+DispatchCompletions(struct Uring *uring)
+{
+    struct io_uring_cqe     *entry;
+    unsigned long           userData;
+    unsigned int            head;
+    unsigned int            tail;
+
+    head = *uring->completionHead;
+    tail = __atomic_load_n(uring->completionTail, __ATOMIC_ACQUIRE);
+
+    if (head == tail)
+        return;
+
+    while (head != tail)
+    {
+        entry = &uring->completionEntries[head & uring->completionMask];
+
+        userData = entry->user_data;
+
+        if (userData == URING_NO_REQUEST)
+        {
+            // Linked timeout or cancel, nobody waits for it.
+        }
+#ifdef IO_URING_XMIT
+        else if (userData & URING_STREAM_TAG)
+        {
+            CompleteStream((struct UringStream *) (userData & ~URING_STREAM_TAG), entry);
+        }
+#endif
+        else
+        {
+            CompleteRequest((struct UringRequest *) userData, entry);
+        }
+
+        head++;
+    }
+
+    __atomic_store_n(uring->completionHead, head, __ATOMIC_RELEASE);
+
+    __atomic_store_n(&uring->generation, uring->generation + 1, __ATOMIC_RELEASE);
+
+    pthread_cond_broadcast(&uring->completionCondition);
+}
+
+/**
+ * CompleteRequest()
+ * Store the result of a completion. Completion mutex must be held.
+ */
+static void
+CompleteRequest(
+    struct UringRequest     *request,
+    struct io_uring_cqe     *entry)
+{
+    request->result = entry->res;
+    request->flags = entry->flags;
+    request->completed = 1;
+}
+
+#ifdef IO_URING_XMIT
+/**
+ * ArmStream()
+ * Submit multishot receive of a stream. Stream mutex must be held,
+ * it is released while the entry is submitted.
+ *
+ * Returns 0 upon successful completion or -1, in case of error.
+ */
+static int
+ArmStream(struct UringStream *stream)
+{
+    struct io_uring_sqe     entry;
+    int                     rc;
+
+    PrepareEntry(&entry, IORING_OP_RECV, stream->sockFD, 0, 0,
+        IOSQE_BUFFER_SELECT,
+        (unsigned long) stream | URING_STREAM_TAG);
+
+    entry.ioprio = IORING_RECV_MULTISHOT;
+
+    // Stream is marked armed before the entry is submitted,
+    // so that its completion finds it armed.
+    //
+    stream->armed = 1;
+    stream->starved = 0;
+
+    pthread_mutex_unlock(&stream->mutex);
+
+    rc = SubmitEntries(stream->uring, &entry, 1);
+
+    pthread_mutex_lock(&stream->mutex);
+
+    if (rc != 0)
+    {
+        stream->armed = 0;
+        stream->error = errno;
+
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * CompleteStream()
+ * Queue the buffer of a multishot receive completion on its stream.
+ * Reader is woken up as the generation of reaped completions changes.
+ */
+static void
+CompleteStream(
+    struct UringStream      *stream,
+    struct io_uring_cqe     *entry)
+{
+    struct MMPS_Buffer      *buffer;
+
+    buffer = MMPS_TakeFromBufferRing(stream->uring->receiveBuffers,
+            entry->flags,
+            entry->res);
+
+    if ((buffer != NULL) && (entry->res <= 0))
+    {
+        MMPS_PokeBuffer(buffer);
+        buffer = NULL;
+    }
+
+    pthread_mutex_lock(&stream->mutex);
+
+    if (buffer != NULL)
+    {
+        if (stream->lastBuffer == NULL)
+        {
+            stream->firstBuffer = buffer;
+        }
+        else
+        {
+            stream->lastBuffer->next = buffer;
+            buffer->prev = stream->lastBuffer;
+        }
+
+        stream->lastBuffer = buffer;
+    }
+
+    // Without more flag this is the last completion of multishot receive.
+    //
+    if ((entry->flags & IORING_CQE_F_MORE) == 0)
+    {
+        stream->armed = 0;
+
+        if (entry->res == 0)
+            stream->closed = 1;
+        else if (entry->res == -ENOBUFS)
+            stream->starved = 1;
+        else if ((entry->res < 0) && (entry->res != -ECANCELED))
+            stream->error = -entry->res;
+    }
+
+    pthread_mutex_unlock(&stream->mutex);
+}
+
+/**
+ * ReadStream()
+ * Copy data of a stream either to memory or behind the data of a buffer
+ * chain. Multishot receive is submitted again if it has stopped.
+ *
+ * @size:       Maximal number of bytes to read.
+ * @minimum:    Number of bytes to wait for, the rest is read only
+ *              if it has been received already.
+ * @timeout:    Timeout in milliseconds, or -1 to wait forever.
+ *
+ * Returns number of bytes read, less than requested only if the connection
+ * is closed, URING_TIMEOUT, URING_OUT_OF_MEMORY or URING_ERROR (with errno set).
+ */
+static int
+ReadStream(
+    struct UringStream      *stream,
+    char                    *data,
+    struct MMPS_Buffer      *chain,
+    unsigned int            size,
+    unsigned int            minimum,
+    int                     timeout)
+{
+    struct MMPS_Buffer      *buffer;
+    struct MMPS_Buffer      *chainBuffer = NULL;
+    struct Uring            *uring = stream->uring;
+    struct timespec         deadline;
+    unsigned int            generation;
+    unsigned int            received = 0;
+    unsigned int            available;
+    unsigned int            step;
+    int                     rc;
+
+    // Data is appended behind the last buffer of a chain that holds data.
+    //
+    if (chain != NULL)
+    {
+        chainBuffer = chain;
+        for (buffer = chain; buffer != NULL; buffer = buffer->next)
+            if (buffer->dataSize != 0)
+                chainBuffer = buffer;
+
+        chainBuffer->cursor = chainBuffer->data + chainBuffer->dataSize;
+    }
+
+    if (timeout >= 0)
+    {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+
+        deadline.tv_sec += timeout / 1000;
+        deadline.tv_nsec += (timeout % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+
+    pthread_mutex_lock(&stream->mutex);
+
+    while (received < size)
+    {
+        buffer = stream->firstBuffer;
+        if (buffer != NULL)
+        {
+            available = buffer->dataSize - (buffer->cursor - buffer->data);
+
+            step = size - received;
+            if (step > available)
+                step = available;
+
+            if (chain != NULL)
+            {
+                chainBuffer = MMPS_PutDataToChain(chainBuffer, buffer->cursor, step);
+                if (chainBuffer == NULL)
+                {
+                    pthread_mutex_unlock(&stream->mutex);
+
+                    return URING_OUT_OF_MEMORY;
+                }
+            }
+            else
+            {
+                memcpy(data + received, buffer->cursor, step);
+            }
+
+            buffer->cursor += step;
+            received += step;
+
+            // Buffer is read to the end, give it back.
+            //
+            if (buffer->cursor == buffer->data + buffer->dataSize)
+            {
+                stream->firstBuffer = buffer->next;
+                if (stream->firstBuffer == NULL)
+                    stream->lastBuffer = NULL;
+                else
+                    stream->firstBuffer->prev = NULL;
+
+                buffer->next = NULL;
+
+                MMPS_PokeBuffer(buffer);
+            }
+
+            continue;
+        }
+
+        if (received >= minimum)
+            break;
+
+        if (stream->error != 0)
+        {
+            pthread_mutex_unlock(&stream->mutex);
+
+            errno = stream->error;
+
+            return URING_ERROR;
+        }
+
+        if (stream->closed != 0)
+            break;
+
+        if (stream->armed == 0)
+        {
+            // Multishot receive has stopped. If the buffer ring has run dry,
+            // give buffers a moment to come back before it goes on.
+            //
+            if (stream->starved != 0)
+            {
+                pthread_mutex_unlock(&stream->mutex);
+
+                usleep(1000);
+                MMPS_ReplenishBufferRing(uring->receiveBuffers);
+
+                pthread_mutex_lock(&stream->mutex);
+            }
+
+            rc = ArmStream(stream);
+            if (rc != 0)
+            {
+                pthread_mutex_unlock(&stream->mutex);
+
+                errno = stream->error;
+
+                return URING_ERROR;
+            }
+
+            continue;
+        }
+
+        // Generation is read before stream mutex is released,
+        // so that a completion queued meanwhile cannot be missed.
+        //
+        generation = __atomic_load_n(&uring->generation, __ATOMIC_ACQUIRE);
+
+        pthread_mutex_unlock(&stream->mutex);
+
+        pthread_mutex_lock(&uring->completionMutex);
+        rc = AwaitCompletions(uring, generation, (timeout < 0) ? NULL : &deadline);
+        pthread_mutex_unlock(&uring->completionMutex);
+
+        pthread_mutex_lock(&stream->mutex);
+
+        if (rc == URING_TIMEOUT)
+        {
+            pthread_mutex_unlock(&stream->mutex);
+
+            return URING_TIMEOUT;
+        }
+    }
+
+    pthread_mutex_unlock(&stream->mutex);
+
+    return received;
+}
+#endif
+
+#endif // IO_URING_RECEIVE
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <sys/uio.h>
+
+#include "mmps.h"
+
+#if defined(IO_URING_XMIT) && !defined(IO_URING_RECEIVE)
+#error IO_URING_XMIT requires IO_URING_RECEIVE
+#endif
+
+/**
+ * Results of io_uring routines besides the number of bytes received.
+ */
+#define URING_ERROR                     -1
+#define URING_NO_BUFFERS                -2
+#define URING_TIMEOUT                   -3
+#define URING_OUT_OF_MEMORY             -4
+
+struct Uring;
+
+#ifdef IO_URING_XMIT
+struct UringStream;
+#endif
+
+/**
+ * CreateUring()
+ * Set up io_uring instance for receive with buffers lent to the kernel
+ * from an MMPS bank. Completions are reaped by threads waiting for them.
+ *
+ * @numberOfSubmissions:    Number of entries of submission queue.
+ * @numberOfCompletions:    Number of entries of completion queue, at least
+ *                          the number of receives that may be pending at once.
+ * @sqPollIdle:             Milliseconds the kernel thread polls submission
+ *                          queue before it falls asleep, or 0 to submit
+ *                          by system calls.
+ * @pool:                   MMPS pool of receive buffers.
+ * @bankId:                 Bank id of receive buffers.
+ * @numberOfBuffers:        Number of buffers lent to the kernel (power of two).
+ * @ownerId:                Owner id of receive buffers.
+ *
+ * Returns pointer to io_uring descriptor or NULL, if io_uring is not
+ * supported by the kernel or cannot be set up.
+ */
+struct Uring *
+CreateUring(
+    unsigned int        numberOfSubmissions,
+    unsigned int        numberOfCompletions,
+    unsigned int        sqPollIdle,
+    struct MMPS_Pool    *pool,
+    unsigned int        bankId,
+    unsigned int        numberOfBuffers,
+    unsigned int        ownerId);
+
+/**
+ * UringReceive()
+ * Receive from a socket into a buffer the kernel takes out of the buffer ring
+ * only when data arrives, so that no buffer is held by a waiting connection.
+ *
+ * @uring:                  Pointer to io_uring descriptor.
+ * @sockFD:                 Socket to receive from.
+ * @length:                 Maximal number of bytes to receive.
+ * @timeout:                Maximal time to wait in milliseconds.
+ * @buffer:                 Where to store the pointer to MMPS buffer
+ *                          holding the received data.
+ *
+ * Returns number of bytes received, 0 if the connection is closed,
+ * URING_NO_BUFFERS if the buffer ring has run dry, URING_TIMEOUT
+ * or URING_ERROR (with errno set).
+ */
+int
+UringReceive(
+    struct Uring        *uring,
+    int                 sockFD,
+    unsigned int        length,
+    int                 timeout,
+    struct MMPS_Buffer  **buffer);
+
+#ifdef IO_URING_XMIT
+/**
+ * UringSend()
+ * Send data of a gather list with a linked timeout instead of polling
+ * the socket. Vector is modified if the data is sent in several steps.
+ *
+ * @uring:                  Pointer to io_uring descriptor.
+ * @sockFD:                 Socket to send to.
+ * @vector:                 Gather list of data to send.
+ * @vectorLength:           Number of elements of gather list.
+ * @timeout:                Maximal time to wait in milliseconds for each step.
+ *
+ * Returns 0 upon successful completion, URING_TIMEOUT or URING_ERROR
+ * (with errno set).
+ */
+int
+UringSend(
+    struct Uring        *uring,
+    int                 sockFD,
+    struct iovec        *vector,
+    unsigned int        vectorLength,
+    int                 timeout);
+
+/**
+ * UringOpenStream()
+ * Start multishot receive on a socket. The kernel keeps receiving
+ * into buffers of the buffer ring as data arrives, without a submission
+ * per read.
+ *
+ * @uring:                  Pointer to io_uring descriptor.
+ * @sockFD:                 Socket to receive from.
+ *
+ * Returns pointer to stream descriptor or NULL, in case of error.
+ */
+struct UringStream *
+UringOpenStream(
+    struct Uring        *uring,
+    int                 sockFD);
+
+/**
+ * UringCloseStream()
+ * Stop multishot receive and release the stream. Must be called
+ * before the socket is closed.
+ *
+ * @stream:                 Pointer to stream descriptor.
+ */
+void
+UringCloseStream(struct UringStream *stream);
+
+/**
+ * UringStreamReceive()
+ * Read data of a stream to memory, wait for it if necessary.
+ *
+ * @stream:                 Pointer to stream descriptor.
+ * @data:                   Where to copy the data to.
+ * @size:                   Number of bytes to read.
+ * @timeout:                Maximal time to wait in milliseconds.
+ *
+ * Returns number of bytes read, less than requested only if the connection
+ * is closed, URING_TIMEOUT or URING_ERROR (with errno set).
+ */
+int
+UringStreamReceive(
+    struct UringStream  *stream,
+    char                *data,
+    unsigned int        size,
+    int                 timeout);
+
+/**
+ * UringStreamReceiveIntoChain()
+ * Read data of a stream behind the data of a buffer chain, wait for it
+ * if necessary. Chain is extended as needed.
+ *
+ * @stream:                 Pointer to stream descriptor.
+ * @chain:                  Buffer chain to append the data to.
+ * @size:                   Number of bytes to read.
+ * @timeout:                Maximal time to wait in milliseconds.
+ *
+ * Returns number of bytes read, less than requested only if the connection
+ * is closed, URING_TIMEOUT, URING_OUT_OF_MEMORY or URING_ERROR (with errno set).
+ */
+int
+UringStreamReceiveIntoChain(
+    struct UringStream  *stream,
+    struct MMPS_Buffer  *chain,
+    unsigned int        size,
+    int                 timeout);
+
+/**
+ * UringStreamReceiveAvailable()
+ * Read data of a stream behind the data of a buffer chain, as much as
+ * has been received but no more than requested. Wait only if nothing
+ * has been received yet. Chain is extended as needed.
+ *
+ * @stream:                 Pointer to stream descriptor.
+ * @chain:                  Buffer chain to append the data to.
+ * @size:                   Maximal number of bytes to read.
+ * @timeout:                Maximal time to wait in milliseconds.
+ *
+ * Returns number of bytes read, 0 if the connection is closed,
+ * URING_TIMEOUT, URING_OUT_OF_MEMORY or URING_ERROR (with errno set).
+ */
+int
+UringStreamReceiveAvailable(
+    struct UringStream  *stream,
+    struct MMPS_Buffer  *chain,
+    unsigned int        size,
+    int                 timeout);
+#endif